@@ -49,6 +49,7 @@
 #define ID_DAP_SWO_Control              0x1AU
 #define ID_DAP_SWO_Status               0x1BU
 #define ID_DAP_SWO_Data                 0x1CU
+#define ID_DAP_SWD_Sequence             0x1DU
 
 #define ID_DAP_QueueCommands            0x7EU
 #define ID_DAP_ExecuteCommands          0x7FU
@@ -158,6 +159,12 @@
 #define DP_SELECT                       0x08U   // Select Register (JTAG R/W & SW W)
 #define DP_RESEND                       0x08U   // Resend (SW Read Only)
 #define DP_RDBUFF                       0x0CU   // Read Buffer (Read Only)
+#define DP_TARGETSEL                    0x0CU   // Target Selection (SW Write only, DPv2)
+
+// MEM-AP registers known in DAP_Data.swd_ap
+#define DAP_SWD_AP_SELECT               (1U<<0)
+#define DAP_SWD_AP_CSW                  (1U<<1)
+#define DAP_SWD_AP_TAR                  (1U<<2)
 
 // JTAG IR Codes
 #define JTAG_ABORT                      0x08U
@@ -171,6 +178,10 @@
 #define JTAG_SEQUENCE_TMS               0x40U   // TMS value
 #define JTAG_SEQUENCE_TDO               0x80U   // TDO capture
 
+// SWD Sequence Info
+#define SWD_SEQUENCE_CLK                0x3FU   // SWCLK count
+#define SWD_SEQUENCE_DIN                0x80U   // SWDIO capture
+
 
 #include <stddef.h>
 #include <stdint.h>
@@ -179,7 +190,9 @@
 typedef struct {
   uint8_t     debug_port;                       // Debug Port
   uint8_t     fast_clock;                       // Fast Clock Flag
+  uint8_t     spi_clock;                        // SPI Shift Engine Flag (DAP_SPI)
   uint32_t   clock_delay;                       // Clock Delay
+  uint32_t   clock_freq;                        // Measured SWJ Clock Frequency in Hz
   struct {                                      // Transfer Configuration
     uint8_t   idle_cycles;                      // Idle cycles after transfer
     uint16_t  retry_count;                      // Number of retries after WAIT response
@@ -191,6 +204,13 @@ typedef struct {
     uint8_t    turnaround;                      // Turnaround period
     uint8_t    data_phase;                      // Always generate Data Phase
   } swd_conf;
+  struct {                                      // MEM-AP registers written by SWD transfers
+    uint32_t   select;                          // DP SELECT
+    uint32_t   csw;                             // CSW of the selected AP
+    uint32_t   tar;                             // TAR of the selected AP
+    uint8_t    valid;                           // DAP_SWD_AP_* of the known registers
+    uint32_t   mem_ap;                          // Bit n: IDR of APSEL n read, a MEM-AP (APSEL 0..31)
+  } swd_ap;
 #endif
 #if (DAP_JTAG != 0)
   struct {                                      // JTAG Device Chain
@@ -211,12 +231,17 @@ extern volatile uint8_t    DAP_TransferAbort;   // Transfer Abort Flag
 
 // Functions
 extern void     SWJ_Sequence    (uint32_t count, const uint8_t *data);
+extern uint32_t SWJ_ClockPeriod (uint32_t delay);
+extern void     SWJ_Calibrate   (void);
 extern void     JTAG_Sequence   (uint32_t info,  const uint8_t *tdi, uint8_t *tdo);
 extern void     JTAG_IR         (uint32_t ir);
 extern uint32_t JTAG_ReadIDCode (void);
 extern void     JTAG_WriteAbort (uint32_t data);
 extern uint8_t  JTAG_Transfer   (uint32_t request, uint32_t *data);
-extern uint8_t  SWD_Transfer    (uint32_t request, uint32_t *data);
+extern void     SWD_TransferSelect (void);
+extern void     SWD_Sequence    (uint32_t info,  const uint8_t *swdo, uint8_t *swdi);
+extern void     SWD_GangSequence (uint32_t targets, uint32_t count, const uint8_t *data);
+extern void     SWD_GangTransfer (uint32_t targets, uint32_t request, uint32_t *data, uint8_t *ack);
 
 extern void     Delayms         (uint32_t delay);
 
@@ -228,10 +253,25 @@ extern uint32_t SWO_Status                              (uint8_t *response);
 extern uint32_t SWO_Data        (const uint8_t *request, uint8_t *response);
 
 extern uint32_t DAP_ProcessVendorCommand (const uint8_t *request, uint8_t *response);
+extern uint32_t DAP_VendorStreamPending  (void);
+extern uint32_t DAP_ProcessVendorStream  (uint8_t *response);
 extern uint32_t DAP_ProcessCommand       (const uint8_t *request, uint8_t *response);
 extern uint32_t DAP_ExecuteCommand       (const uint8_t *request, uint8_t *response);
 
 extern void     DAP_Setup (void);
+extern void     DAP_Restore (const DAP_Data_t *data);
+extern void     DAP_BenchmarkDispatch (uint32_t count, uint32_t *direct, uint32_t *dispatch);
+extern void     DAP_BenchmarkSWD      (uint32_t count, uint32_t *cycles, uint32_t *clocks);
+extern void     DAP_BenchmarkTurnaround (uint32_t count, uint32_t *cycles);
+extern void     DAP_BenchmarkSequence (uint32_t count, uint32_t *swj, uint32_t *jtag);
+
+// SWD Transfer I/O through the variant installed by SWD_TransferSelect
+typedef uint8_t (*SWD_Transfer_t)(uint32_t request, uint32_t *data);
+extern SWD_Transfer_t SWD_TransferIO;
+
+static inline uint8_t SWD_Transfer (uint32_t request, uint32_t *data) {
+  return SWD_TransferIO(request, data);
+}
 
 // Configurable delay for clock generation
 #ifndef DELAY_SLOW_CYCLES
@@ -241,7 +281,9 @@ static inline void PIN_DELAY_SLOW (uint32_t delay) {
   uint32_t count;
   // ESP_LOGI("SWD_DELAY","PIN_DELAY_SLOW");
   count = delay;
-  while (--count);
+  while (--count) {
+    __asm__ volatile ("");              // Keep the loop, its cost is calibrated
+  }
 }
 
 // Fixed delay for fast clock generation
@@ -260,5 +302,12 @@ static inline void PIN_DELAY_FAST (void) {
 #endif
 }
 
+// Trace output, compiled out completely unless DAP_TRACE is set
+#if (DAP_TRACE != 0)
+#define DAP_TRACE_LOG(...)      ESP_LOGD("DAP", __VA_ARGS__)
+#else
+#define DAP_TRACE_LOG(...)      ((void)0)
+#endif
+
 
 #endif  /* __DAP_H__ */
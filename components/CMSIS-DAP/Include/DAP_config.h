@@ -54,11 +54,15 @@ This information includes:
 /* I removed RTE directory from the source code. Zach Lee */
 
 //#include "../Include/swd_host.h"
-#include "driver/gpio.h"
-#include "freertos/FreeRTOS.h"
-#include "freertos/task.h"
-#include "esp_log.h"
 #include "SWD_host.h"
+
+/// Pin driver that implements the hardware I/O pin, LED and timestamp access functions.
+#define DAP_PIN_DRIVER_ESP32S2 0 ///< ESP32-S2 GPIO (DAP_pins_esp32s2.h)
+#define DAP_PIN_DRIVER_SIM 1	 ///< Host simulation with a target model (DAP_pins_sim.h)
+#ifndef DAP_PIN_DRIVER
+#define DAP_PIN_DRIVER DAP_PIN_DRIVER_ESP32S2 ///< Selected pin driver
+#endif
+
 /// Processor Clock of the Cortex-M MCU used in the Debug Unit.
 /// This value is used to calculate the SWD/JTAG clock speed.
 #define CPU_CLOCK 240000000U ///< Specifies the CPU Clock in Hz.
@@ -92,6 +96,27 @@ This information includes:
 /// The command \ref DAP_SWJ_Clock can be used to overwrite this default setting.
 #define DAP_DEFAULT_SWJ_CLOCK 4000000U ///< Default SWD/JTAG clock frequency in Hz.
 
+/// Shift the SWD request and data phases and whole bytes of SWJ and JTAG sequences with the
+/// SPI peripheral (see DAP_spi.h). Turnaround and acknowledge stay bit-banged, and the bit-bang
+/// I/O is used for all of it when the SPI is not available or cannot generate the SWJ clock.
+/// Firmware builds set CONFIG_DAP_SPI in menuconfig.
+#ifndef DAP_SPI
+#define DAP_SPI 0 ///< SPI Shift Engine: 1 = used when possible, 0 = bit-bang only.
+#endif
+
+/// Gang programming of identical SWD targets: SWCLK and nRESET are shared, every target has
+/// its own SWDIO pin and all of them are clocked in lockstep (see SWD_GangTransfer and
+/// target_flash_gang). The SWDIO pins are listed by the pin driver (PIN_GANG_SWDIO), firmware
+/// builds set CONFIG_DAP_GANG in menuconfig.
+#ifndef DAP_GANG
+#define DAP_GANG 0 ///< Gang Mode: 1 = available, 0 = not available.
+#endif
+#define DAP_GANG_CNT 4U ///< Maximum number of targets in gang mode (2 .. 16).
+
+/// SWD multi-drop (DPv2 TARGETSEL) targets whose DP state (SELECT, CSW) SWD_host keeps while
+/// another target is selected (see swd_select_target). Valid range is 1 .. 255.
+#define DAP_MULTIDROP_CNT 4U ///< Multi-drop targets with a cached DP state.
+
 /// Maximum Package Size for Command and Response data.
 /// This configuration settings is used to optimize the communication performance with the
 /// debugger and depends on the USB peripheral. Typical vales are 64 for Full-speed USB HID or WinUSB,
@@ -102,7 +127,7 @@ This information includes:
 /// This configuration settings is used to optimize the communication performance with the
 /// debugger and depends on the USB peripheral. For devices with limited RAM or USB buffer the
 /// setting can be reduced (valid range is 1 .. 255).
-#define DAP_PACKET_COUNT 1U ///< Specifies number of packets buffered.
+#define DAP_PACKET_COUNT 8U ///< Specifies number of packets buffered.
 
 /// Indicate that UART Serial Wire Output (SWO) trace is available.
 /// This information is returned by the command \ref DAP_Info as part of <b>Capabilities</b>.
@@ -124,6 +149,16 @@ This information includes:
 /// Clock frequency of the Test Domain Timer. Timer value is returned with \ref TIMESTAMP_GET.
 #define TIMESTAMP_CLOCK 240000000U ///< Timestamp clock in Hz (0 = timestamps not supported).
 
+/// Trace of DAP commands and transfers through ESP_LOGD.
+/// When disabled the trace calls are removed by the preprocessor and cost nothing in the transfer loops.
+#define DAP_TRACE 0 ///< DAP Trace: 1 = enabled, 0 = compiled out.
+
+/// Benchmark vendor commands (dispatch, SWD clock, turnaround, sequences, see DAP_vendor.c).
+/// Release firmware leaves them out, benchmark builds set CONFIG_DAP_BENCHMARK in menuconfig.
+#ifndef DAP_BENCHMARK
+#define DAP_BENCHMARK 0 ///< Benchmark: 1 = available, 0 = not available.
+#endif
+
 /// Debug Unit is connected to fixed Target Device.
 /// The Debug Unit may be part of an evaluation board and always connected to a fixed
 /// known device.  In this case a Device Vendor and Device Name string is stored which
@@ -170,463 +205,32 @@ static inline uint8_t DAP_GetSerNumString(char *str)
 
 ///@}
 
-/* Private defines -----------------------------------------------------------*/
-// ATTENTION: DO NOT USE RTC GPIO16
-#define PIN_SWDIO 9
-#define PIN_SWCLK 10
-
-#define PIN_TDO 14
-#define PIN_TDI 15
-#define PIN_nTRST 16 // optional
-#define PIN_nRESET 17
-
-// LED_BUILTIN
-#define PIN_LED_CONNECTED 2
-// LED_BUILTIN
-#define PIN_LED_RUNNING 15
-// Target Running LED           Not available
-
-//**************************************************************************************************
-/**
-\defgroup DAP_Config_PortIO_gr CMSIS-DAP Hardware I/O Pin Access
-\ingroup DAP_ConfigIO_gr
-@{
-
-Standard I/O Pins of the CMSIS-DAP Hardware Debug Port support standard JTAG mode
-and Serial Wire Debug (SWD) mode. In SWD mode only 2 pins are required to implement the debug
-interface of a device. The following I/O Pins are provided:
-
-JTAG I/O Pin                 | SWD I/O Pin          | CMSIS-DAP Hardware pin mode
----------------------------- | -------------------- | ---------------------------------------------
-TCK: Test Clock              | SWCLK: Clock         | Output Push/Pull
-TMS: Test Mode Select        | SWDIO: Data I/O      | Output Push/Pull; Input (for receiving data)
-TDI: Test Data Input         |                      | Output Push/Pull
-TDO: Test Data Output        |                      | Input
-nTRST: Test Reset (optional) |                      | Output Open Drain with pull-up resistor
-nRESET: Device Reset         | nRESET: Device Reset | Output Open Drain with pull-up resistor
-
-
-DAP Hardware I/O Pin Access Functions
--------------------------------------
-The various I/O Pins are accessed by functions that implement the Read, Write, Set, or Clear to
-these I/O Pins.
-
-For the SWDIO I/O Pin there are additional functions that are called in SWD I/O mode only.
-This functions are provided to achieve faster I/O that is possible with some advanced GPIO
-peripherals that can independently write/read a single I/O pin without affecting any other pins
-of the same I/O port. The following SWDIO I/O Pin functions are provided:
- - \ref PIN_SWDIO_OUT_ENABLE to enable the output mode from the DAP hardware.
- - \ref PIN_SWDIO_OUT_DISABLE to enable the input mode to the DAP hardware.
- - \ref PIN_SWDIO_IN to read from the SWDIO I/O pin with utmost possible speed.
- - \ref PIN_SWDIO_OUT to write to the SWDIO I/O pin with utmost possible speed.
-*/
-
-// Configure DAP I/O pins ------------------------------
-
-//   LPC-Link-II HW uses buffers for debug port pins. Therefore it is not
-//   possible to disable outputs SWCLK/TCK, TDI and they are left active.
-//   Only SWDIO/TMS output can be disabled but it is also left active.
-//   nRESET is configured for open drain mode.
-
-/** Setup JTAG I/O pins: TCK, TMS, TDI, TDO, nTRST, and nRESET.
-Configures the DAP Hardware I/O pins for JTAG mode:
- - TCK, TMS, TDI, nTRST, nRESET to output mode and set to high level.
- - TDO to input mode.
-*/
-static inline void PORT_JTAG_SETUP(void)
-{
-	gpio_pad_select_gpio(PIN_SWCLK);
-	gpio_set_direction(PIN_SWCLK, GPIO_MODE_INPUT_OUTPUT);
-	gpio_pad_select_gpio(PIN_SWDIO);
-	gpio_set_direction(PIN_SWDIO, GPIO_MODE_INPUT_OUTPUT);
-
-	GPIO_OUTPUT_SET(PIN_SWCLK, 1);
-	GPIO_OUTPUT_SET(PIN_SWDIO, 1);
-
-	gpio_pad_select_gpio(PIN_TDI);
-	gpio_set_direction(PIN_TDI, GPIO_MODE_INPUT_OUTPUT);
-	gpio_pad_select_gpio(PIN_TDO);
-	gpio_set_direction(PIN_TDI, GPIO_MODE_INPUT_OUTPUT);
-	gpio_pad_select_gpio(PIN_nRESET);
-	gpio_set_direction(PIN_nRESET, GPIO_MODE_INPUT_OUTPUT);
-
-	GPIO_OUTPUT_SET(PIN_TDI, 1);
-	GPIO_OUTPUT_SET(PIN_TDO, 1);
-	GPIO_OUTPUT_SET(PIN_nRESET, 1);
-}
-
-/** Setup SWD I/O pins: SWCLK, SWDIO, and nRESET.
-Configures the DAP Hardware I/O pins for Serial Wire Debug (SWD) mode:
- - SWCLK, SWDIO, nRESET to output mode and set to default high level.
- - TDI, TDO, nTRST to HighZ mode (pins are unused in SWD mode).
-*/
-static inline void PORT_SWD_SETUP(void)
-{
-	ESP_LOGI("SWD_DELAY", "PORT_SWD_SETUP");
-	gpio_pad_select_gpio(PIN_SWCLK);
-	gpio_set_direction(PIN_SWCLK, GPIO_MODE_INPUT_OUTPUT);
-	gpio_pad_select_gpio(PIN_SWDIO);
-	gpio_set_direction(PIN_SWDIO, GPIO_MODE_INPUT_OUTPUT);
-
-	WRITE_PERI_REG(GPIO_OUT_W1TS_REG, (0x1 << PIN_SWCLK));
-	WRITE_PERI_REG(GPIO_OUT_W1TS_REG, (0x1 << PIN_SWDIO));
-
-	gpio_pad_select_gpio(PIN_TDI);
-	gpio_set_direction(PIN_TDI, GPIO_MODE_INPUT_OUTPUT);
-	gpio_pad_select_gpio(PIN_TDO);
-	gpio_set_direction(PIN_TDI, GPIO_MODE_INPUT_OUTPUT);
-	gpio_pad_select_gpio(PIN_nRESET);
-	gpio_set_direction(PIN_nRESET, GPIO_MODE_INPUT_OUTPUT);
-
-	GPIO_OUTPUT_SET(PIN_TDI, 1);
-	GPIO_OUTPUT_SET(PIN_TDO, 1);
-	GPIO_OUTPUT_SET(PIN_nRESET, 1);
-}
-
-/** Disable JTAG/SWD I/O Pins.
-Disables the DAP Hardware I/O pins which configures:
- - TCK/SWCLK, TMS/SWDIO, TDI, TDO, nTRST, nRESET to High-Z mode.
-*/
-static inline void PORT_OFF(void)
-{
-	gpio_pad_select_gpio(PIN_SWCLK);
-	gpio_set_direction(PIN_SWCLK, GPIO_MODE_INPUT);
-	gpio_pad_select_gpio(PIN_SWDIO);
-	gpio_set_direction(PIN_SWDIO, GPIO_MODE_INPUT);
-
-	gpio_pad_select_gpio(PIN_TDI);
-	gpio_set_direction(PIN_TDI, GPIO_MODE_INPUT);
-	gpio_pad_select_gpio(PIN_TDO);
-	gpio_set_direction(PIN_TDI, GPIO_MODE_INPUT);
-	gpio_pad_select_gpio(PIN_nRESET);
-	gpio_set_direction(PIN_nRESET, GPIO_MODE_INPUT);
-}
-
-// SWCLK/TCK I/O pin -------------------------------------
-
-/** SWCLK/TCK I/O pin: Get Input.
-\return Current status of the SWCLK/TCK DAP hardware I/O pin.
-*/
-static inline uint32_t PIN_SWCLK_TCK_IN(void)
-{
-	// return (uint32_t)READ_PERI_REG(GPIO_PIN10_REG)? 1 : 0;
-	return (uint32_t)GPIO_INPUT_GET(PIN_SWCLK) ? 1 : 0;
-}
-
-/** SWCLK/TCK I/O pin: Set Output to High.
-Set the SWCLK/TCK DAP hardware I/O pin to high level.
-*/
-static inline void PIN_SWCLK_TCK_SET(void)
-{
-	//GPIO_OUTPUT_SET(PIN_SWCLK, 1);
-	WRITE_PERI_REG(GPIO_OUT_W1TS_REG, (0x1 << PIN_SWCLK));
-}
-
-/** SWCLK/TCK I/O pin: Set Output to Low.
-Set the SWCLK/TCK DAP hardware I/O pin to low level.
-*/
-static inline void PIN_SWCLK_TCK_CLR(void)
-{
-	// GPIO_OUTPUT_SET(PIN_SWCLK, 0);
-	WRITE_PERI_REG(GPIO_OUT_W1TC_REG, (0x1 << PIN_SWCLK));
-}
-
-// SWDIO/TMS Pin I/O --------------------------------------
-
-/** SWDIO/TMS I/O pin: Get Input.
-\return Current status of the SWDIO/TMS DAP hardware I/O pin.
-*/
-static inline uint32_t PIN_SWDIO_TMS_IN(void)
-{
-	return (uint32_t)READ_PERI_REG(GPIO_PIN9_REG) ? 1 : 0;
-}
-
-/** SWDIO/TMS I/O pin: Set Output to High.
-Set the SWDIO/TMS DAP hardware I/O pin to high level.
-*/
-static inline void PIN_SWDIO_TMS_SET(void)
-{
-	// GPIO_OUTPUT_SET(PIN_SWDIO, 1);
-	WRITE_PERI_REG(GPIO_OUT_W1TS_REG, (0x1 << PIN_SWDIO));
-}
-
-/** SWDIO/TMS I/O pin: Set Output to Low.
-Set the SWDIO/TMS DAP hardware I/O pin to low level.
-*/
-static inline void PIN_SWDIO_TMS_CLR(void)
-{
-
-	WRITE_PERI_REG(GPIO_OUT_W1TC_REG, (0x1 << PIN_SWDIO));
-}
-
-/** SWDIO I/O pin: Get Input (used in SWD mode only).
-\return Current status of the SWDIO DAP hardware I/O pin.
-*/
-
-static inline uint32_t PIN_SWDIO_IN(void)
-{
-	// return (uint32_t)READ_PERI_REG(GPIO_FUNC9_IN_SEL_CFG_REG)? 1 : 0;
-
-	return (uint32_t)GPIO_INPUT_GET(PIN_SWDIO) ? 1 : 0;
-
-	// return (uint32_t)GPIO_REG_READ(GPIO_PIN_ADDR(14))? 1 : 0;
-
-}
-
-/** SWDIO I/O pin: Set Output (used in SWD mode only).
-\param bit Output value for the SWDIO DAP hardware I/O pin.
-*/
-static inline void PIN_SWDIO_OUT(uint32_t bit)
-{
-	/**
-    * Important: Use only one bit (bit0) of param!
-	* Sometimes the func "SWD_TransferFunction" of SW_DP.c will
-	* issue "2" as param instead of "0". Zach Lee
-	*/
-	if ((bit & 1U) == 1)
-	{
-		WRITE_PERI_REG(GPIO_OUT_W1TS_REG, (0x1 << PIN_SWDIO));
-	}
-	else
-	{
-		WRITE_PERI_REG(GPIO_OUT_W1TC_REG, (0x1 << PIN_SWDIO));
-	}
-}
-
-/** SWDIO I/O pin: Switch to Output mode (used in SWD mode only).
-Configure the SWDIO DAP hardware I/O pin to output mode. This function is
-called prior \ref PIN_SWDIO_OUT function calls.
-*/
-static inline void PIN_SWDIO_OUT_ENABLE(void)
-{
-
-	// gpio_pad_select_gpio(PIN_SWDIO);
-	gpio_set_direction(PIN_SWDIO, GPIO_MODE_OUTPUT);
-	// gpio_output_enable(PIN_SWDIO);
-	// WRITE_PERI_REG(GPIO_OUT_W1TS_REG, (0x1 << PIN_SWDIO));
-}
-
-/** SWDIO I/O pin: Switch to Input mode (used in SWD mode only).
-Configure the SWDIO DAP hardware I/O pin to input mode. This function is
-called prior \ref PIN_SWDIO_IN function calls.
-*/
-static inline void PIN_SWDIO_OUT_DISABLE(void)
-{
-
-	// gpio_pad_select_gpio(PIN_SWDIO);
-	gpio_set_direction(PIN_SWDIO, GPIO_MODE_INPUT);
-	// gpio_output_enable(PIN_SWDIO);
-	// WRITE_PERI_REG(GPIO_OUT_W1TS_REG, (0x1 << PIN_SWDIO));
-}
-
-// TDI Pin I/O ---------------------------------------------
-
-/** TDI I/O pin: Get Input.
-\return Current status of the TDI DAP hardware I/O pin.
-*/
-static inline uint32_t PIN_TDI_IN(void)
-{
-	// return (uint32_t)READ_PERI_REG(GPIO_IN_REG&(0x1 << PIN_TDI))? 1 : 0;
-	return (uint32_t)GPIO_INPUT_GET(PIN_TDI) ? 1 : 0;
-}
-
-/** TDI I/O pin: Set Output.
-\param bit Output value for the TDI DAP hardware I/O pin.
-*/
-static inline void PIN_TDI_OUT(uint32_t bit)
-{
-
-	if ((bit & 1U) == 1)
-	{
-		WRITE_PERI_REG(GPIO_OUT_W1TS_REG, (0x1 << PIN_TDI));
-		// GPIO_OUTPUT_SET(PIN_TDI, 1);
-		// JTAG_TDI_GPIO_Port->BSRR = JTAG_TDI_Pin;
-	}
-	else
-	{
-		WRITE_PERI_REG(GPIO_OUT_W1TC_REG, (0x1 << PIN_TDI));
-		// GPIO_OUTPUT_SET(PIN_TDI, 0);
-		// JTAG_TDI_GPIO_Port->BRR = JTAG_TDI_Pin;
-	}
-}
-
-// TDO Pin I/O ---------------------------------------------
-
-/** TDO I/O pin: Get Input.
-\return Current status of the TDO DAP hardware I/O pin.
-*/
-static inline uint32_t PIN_TDO_IN(void)
-{
-	return (uint32_t)GPIO_INPUT_GET(PIN_TDO) ? 1 : 0;
-	// return (uint32_t)READ_PERI_REG(GPIO_IN_REG&(0x1 << PIN_TDO))? 1 : 0;
-	//   return (uint32_t)(JTAG_TDO_GPIO_Port->IDR & JTAG_TDO_Pin ? 1:0);
-}
-
-// nTRST Pin I/O -------------------------------------------
-
-/** nTRST I/O pin: Get Input.
-\return Current status of the nTRST DAP hardware I/O pin.
-*/
-static inline uint32_t PIN_nTRST_IN(void)
-{
-	return (0U); // Not available
-}
-
-/** nTRST I/O pin: Set Output.
-\param bit JTAG TRST Test Reset pin status:
-           - 0: issue a JTAG TRST Test Reset.
-           - 1: release JTAG TRST Test Reset.
-*/
-static inline void PIN_nTRST_OUT(uint32_t bit)
-{
-	(void)bit;
-	; // Not available
-}
-
-// nRESET Pin I/O------------------------------------------
-
-/** nRESET I/O pin: Get Input.
-\return Current status of the nRESET DAP hardware I/O pin.
-*/
-static inline uint32_t PIN_nRESET_IN(void)
-{
-	return (0U); //
-				 //   return (uint32_t)(JTAG_nRESET_GPIO_Port->ODR & JTAG_nRESET_Pin ? 1:0);
-}
-
-/** nRESET I/O pin: Set Output.
-\param bit target device hardware reset pin status:
-           - 0: issue a device hardware reset.
-           - 1: release device hardware reset.
-*/
-static inline void PIN_nRESET_OUT(uint32_t bit)
-{
-
-	if ((bit & 1U) == 1)
-	{
-
-	}
-	else
-	{
-		if (swd_init_debug())
-		{
-			ESP_LOGI("RST", "Connect");
-		}
-		else
-		{
-			ESP_LOGI("RST", "Disconnect");
-		}
-		uint32_t swd_mem_write_data = 0x05FA0000 | 0x4;
-		swd_write_memory(0xE000ED0C, (uint8_t *)&swd_mem_write_data, 4);
-	}
-}
-
-///@}
-
-//**************************************************************************************************
-/**
-\defgroup DAP_Config_LEDs_gr CMSIS-DAP Hardware Status LEDs
-\ingroup DAP_ConfigIO_gr
-@{
-
-CMSIS-DAP Hardware may provide LEDs that indicate the status of the CMSIS-DAP Debug Unit.
-
-It is recommended to provide the following LEDs for status indication:
- - Connect LED: is active when the DAP hardware is connected to a debugger.
- - Running LED: is active when the debugger has put the target device into running state.
-*/
-
-/** Debug Unit: Set status of Connected LED.
-\param bit status of the Connect LED.
-           - 1: Connect LED ON: debugger is connected to CMSIS-DAP Debug Unit.
-           - 0: Connect LED OFF: debugger is not connected to CMSIS-DAP Debug Unit.
-*/
-static inline void LED_CONNECTED_OUT(uint32_t bit)
-{
-
-	if ((bit & 1U) == 1)
-	{
-		gpio_set_level(PIN_LED_CONNECTED, 1);
-		// LED_GPIO_Port->BRR =  LED_CONNECTED_Pin;
-	}
-	else
-	{
-		gpio_set_level(PIN_LED_CONNECTED, 0);
-		// LED_GPIO_Port->BSRR = LED_CONNECTED_Pin;
-	}
-}
-
-/** Debug Unit: Set status Target Running LED.
-\param bit status of the Target Running LED.
-           - 1: Target Running LED ON: program execution in target started.
-           - 0: Target Running LED OFF: program execution in target stopped.
-*/
-static inline void LED_RUNNING_OUT(uint32_t bit)
-{
-	(void)bit;
-	; // Not available
-}
-
-///@}
-
-//**************************************************************************************************
-/**
-\defgroup DAP_Config_Timestamp_gr CMSIS-DAP Timestamp
-\ingroup DAP_ConfigIO_gr
-@{
-Access function for Test Domain Timer.
-
-The value of the Test Domain Timer in the Debug Unit is returned by the function \ref TIMESTAMP_GET. By
-default, the DWT timer is used.  The frequency of this timer is configured with \ref TIMESTAMP_CLOCK.
+// Hardware I/O pins, LEDs, timestamp and DAP_SETUP of the selected pin driver
+#if (DAP_PIN_DRIVER == DAP_PIN_DRIVER_SIM)
+#include "DAP_pins_sim.h"
+#else
+#include "DAP_pins_esp32s2.h"
+#endif
 
-*/
+#if (DAP_SPI != 0)
+#include "DAP_spi.h"
+#endif
 
-/** Get timestamp of Test Domain Timer.
-\return Current timestamp value.
-*/
-// static inline uint32_t TIMESTAMP_GET (void) {
-//   return (DWT->CYCCNT);
-// }
-static inline uint32_t TIMESTAMP_GET(void)
-{
-	return xTaskGetTickCount();
-}
-///@}
+// Target RAM for algorithms loaded from the FLM store, set in menuconfig on the ESP32-S2
+#ifndef CONFIG_DAP_FLM_RAM_START
+#define CONFIG_DAP_FLM_RAM_START 0x20000000
+#endif
+#ifndef CONFIG_DAP_FLM_RAM_SIZE
+#define CONFIG_DAP_FLM_RAM_SIZE 0x1000
+#endif
 
 //**************************************************************************************************
 /**
-\defgroup DAP_Config_Initialization_gr CMSIS-DAP Initialization
+\defgroup DAP_Config_Reset_gr CMSIS-DAP Target Reset
 \ingroup DAP_ConfigIO_gr
 @{
-
-CMSIS-DAP Hardware I/O and LED Pins are initialized with the function \ref DAP_SETUP.
 */
 
-/** Setup of the Debug Unit I/O pins and LEDs (called when Debug Unit is initialized).
-This function performs the initialization of the CMSIS-DAP Hardware I/O Pins and the
-Status LEDs. In detail the operation of Hardware I/O and LED pins are enabled and set:
- - I/O clock system enabled.
- - all I/O pins: input buffer enabled, output pins are set to HighZ mode.
- - for nTRST, nRESET a weak pull-up (if available) is enabled.
- - LED output pins are enabled and LEDs are turned off.
-*/
-static inline void DAP_SETUP(void)
-{
-
-	PORT_JTAG_SETUP();
-	PORT_SWD_SETUP();
-	gpio_set_direction(PIN_SWCLK, GPIO_MODE_INPUT_OUTPUT);
-	gpio_set_direction(PIN_SWDIO, GPIO_MODE_INPUT_OUTPUT);	//
-	gpio_set_direction(PIN_nRESET, GPIO_MODE_INPUT_OUTPUT); //
-	gpio_set_direction(PIN_TDI, GPIO_MODE_INPUT_OUTPUT);
-	gpio_set_direction(PIN_TDO, GPIO_MODE_INPUT_OUTPUT);
-	// Configure: LED as output (turned off)
-	gpio_set_direction(PIN_LED_CONNECTED, GPIO_MODE_DEF_OUTPUT);
-	LED_CONNECTED_OUT(0);
-	gpio_set_direction(PIN_LED_RUNNING, GPIO_MODE_DEF_OUTPUT);
-	LED_RUNNING_OUT(0);
-}
-
 /** Reset Target Device with custom specific I/O pin or command sequence.
 This function allows the optional implementation of a device specific reset sequence.
 It is called when the command \ref DAP_ResetTarget and is for example required
@@ -0,0 +1,560 @@
+/*---------------------------------------------------------------------------
+ * DAP_pins_esp32s2.h  CMSIS-DAP pin driver for the ESP32-S2
+ *
+ * Hardware I/O pin, LED and timestamp access used by DAP_config.h when
+ * DAP_PIN_DRIVER is DAP_PIN_DRIVER_ESP32S2. The GPIO numbers come from
+ * Kconfig (CMSIS-DAP -> Debug port pins), optionally overridden from NVS,
+ * and are loaded by DAP_SETUP into DAP_Pins together with the register masks
+ * the pin functions use.
+ *---------------------------------------------------------------------------*/
+#ifndef __DAP_PINS_ESP32S2_H__
+#define __DAP_PINS_ESP32S2_H__
+
+#include "sdkconfig.h"
+#include "driver/gpio.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "xtensa/hal.h"
+
+/* Private defines -----------------------------------------------------------*/
+// Pin map loaded by DAP_PinsLoad. SWCLK, SWDIO and TDI have to be in GPIO0..31:
+// they are driven through GPIO_OUT_W1TS/W1TC and read from GPIO_IN.
+// ATTENTION: DO NOT USE RTC GPIO16
+#define PIN_SWDIO (DAP_Pins.swdio)
+#define PIN_SWCLK (DAP_Pins.swclk)
+
+#define PIN_TDO (DAP_Pins.tdo)
+#define PIN_TDI (DAP_Pins.tdi)
+#define PIN_nRESET (DAP_Pins.nreset)
+
+#define PIN_LED_CONNECTED (DAP_Pins.led_connected)
+#define PIN_LED_RUNNING (DAP_Pins.led_running)
+
+// NVS namespace of the pin map, u8 keys "swclk", "swdio", "tdi", "tdo", "nreset",
+// "led_con" and "led_run". Missing keys keep the Kconfig pin.
+#define DAP_PINS_NVS_NAMESPACE "dap_pins"
+
+//**************************************************************************************************
+/**
+\defgroup DAP_Config_PortIO_gr CMSIS-DAP Hardware I/O Pin Access
+\ingroup DAP_ConfigIO_gr
+@{
+
+Standard I/O Pins of the CMSIS-DAP Hardware Debug Port support standard JTAG mode
+and Serial Wire Debug (SWD) mode. In SWD mode only 2 pins are required to implement the debug
+interface of a device. The following I/O Pins are provided:
+
+JTAG I/O Pin                 | SWD I/O Pin          | CMSIS-DAP Hardware pin mode
+---------------------------- | -------------------- | ---------------------------------------------
+TCK: Test Clock              | SWCLK: Clock         | Output Push/Pull
+TMS: Test Mode Select        | SWDIO: Data I/O      | Output Push/Pull; Input (for receiving data)
+TDI: Test Data Input         |                      | Output Push/Pull
+TDO: Test Data Output        |                      | Input
+nTRST: Test Reset (optional) |                      | Output Open Drain with pull-up resistor
+nRESET: Device Reset         | nRESET: Device Reset | Output Open Drain with pull-up resistor
+
+
+DAP Hardware I/O Pin Access Functions
+-------------------------------------
+The various I/O Pins are accessed by functions that implement the Read, Write, Set, or Clear to
+these I/O Pins.
+
+For the SWDIO I/O Pin there are additional functions that are called in SWD I/O mode only.
+This functions are provided to achieve faster I/O that is possible with some advanced GPIO
+peripherals that can independently write/read a single I/O pin without affecting any other pins
+of the same I/O port. The following SWDIO I/O Pin functions are provided:
+ - \ref PIN_SWDIO_OUT_ENABLE to enable the output mode from the DAP hardware.
+ - \ref PIN_SWDIO_OUT_DISABLE to enable the input mode to the DAP hardware.
+ - \ref PIN_SWDIO_IN to read from the SWDIO I/O pin with utmost possible speed.
+ - \ref PIN_SWDIO_OUT to write to the SWDIO I/O pin with utmost possible speed.
+*/
+
+// Pin map with the register masks precomputed by DAP_PinsLoad, so every pin access
+// in the SWD/JTAG loops is a single GPIO register read or write whatever the mapping.
+typedef struct
+{
+	// GPIO numbers
+	uint8_t swclk;
+	uint8_t swdio;
+	uint8_t tdi;
+	uint8_t tdo;
+	uint8_t nreset;
+	uint8_t led_connected;
+	uint8_t led_running;
+	uint8_t tdo_bit; // TDO bit in tdo_in
+
+	uint32_t swclk_mask; // SWCLK bit in GPIO_OUT/GPIO_IN
+	uint32_t swdio_mask; // SWDIO bit in GPIO_OUT/GPIO_ENABLE/GPIO_IN
+	uint32_t tdi_mask;	 // TDI bit in GPIO_OUT/GPIO_IN
+	uint32_t tdo_in;	 // GPIO_IN or GPIO_IN1, the bank of TDO
+} DAP_Pins_t;
+
+extern DAP_Pins_t DAP_Pins;
+
+/** Load the pin map from Kconfig and NVS and precompute its register masks.
+Pins that cannot be used for their function keep the Kconfig value. Called once at boot,
+after NVS is initialized and before DAP_Setup; until then the Kconfig pins are used.
+*/
+extern void DAP_PinsLoad(void);
+
+/** Map the FLM store (the "storage" partition) for reading.
+\param size size of the store.
+\return the store, NULL when there is no storage partition or it cannot be mapped.
+Every successful map is followed by \ref DAP_FlmStoreUnmap.
+*/
+extern const void *DAP_FlmStoreMap(uint32_t *size);
+
+/** Release the mapping of \ref DAP_FlmStoreMap. */
+extern void DAP_FlmStoreUnmap(void);
+
+// Configure DAP I/O pins ------------------------------
+
+//   LPC-Link-II HW uses buffers for debug port pins. Therefore it is not
+//   possible to disable outputs SWCLK/TCK, TDI and they are left active.
+//   Only SWDIO/TMS output can be disabled but it is also left active.
+//   nRESET is configured for open drain mode.
+
+/** Setup JTAG I/O pins: TCK, TMS, TDI, TDO, nTRST, and nRESET.
+Configures the DAP Hardware I/O pins for JTAG mode:
+ - TCK, TMS, TDI, nTRST, nRESET to output mode and set to high level.
+ - TDO to input mode.
+*/
+static inline void PORT_JTAG_SETUP(void)
+{
+	gpio_pad_select_gpio(PIN_SWCLK);
+	gpio_set_direction(PIN_SWCLK, GPIO_MODE_INPUT_OUTPUT);
+	gpio_pad_select_gpio(PIN_SWDIO);
+	gpio_set_direction(PIN_SWDIO, GPIO_MODE_INPUT_OUTPUT);
+
+	GPIO_OUTPUT_SET(PIN_SWCLK, 1);
+	GPIO_OUTPUT_SET(PIN_SWDIO, 1);
+
+	gpio_pad_select_gpio(PIN_TDI);
+	gpio_set_direction(PIN_TDI, GPIO_MODE_INPUT_OUTPUT);
+	gpio_pad_select_gpio(PIN_TDO);
+	gpio_set_direction(PIN_TDI, GPIO_MODE_INPUT_OUTPUT);
+	gpio_pad_select_gpio(PIN_nRESET);
+	gpio_set_direction(PIN_nRESET, GPIO_MODE_INPUT_OUTPUT);
+
+	GPIO_OUTPUT_SET(PIN_TDI, 1);
+	GPIO_OUTPUT_SET(PIN_TDO, 1);
+	GPIO_OUTPUT_SET(PIN_nRESET, 1);
+}
+
+/** Setup SWD I/O pins: SWCLK, SWDIO, and nRESET.
+Configures the DAP Hardware I/O pins for Serial Wire Debug (SWD) mode:
+ - SWCLK, SWDIO, nRESET to output mode and set to default high level.
+ - TDI, TDO, nTRST to HighZ mode (pins are unused in SWD mode).
+*/
+static inline void PORT_SWD_SETUP(void)
+{
+	ESP_LOGI("SWD_DELAY", "PORT_SWD_SETUP");
+	gpio_pad_select_gpio(PIN_SWCLK);
+	gpio_set_direction(PIN_SWCLK, GPIO_MODE_INPUT_OUTPUT);
+	gpio_pad_select_gpio(PIN_SWDIO);
+	gpio_set_direction(PIN_SWDIO, GPIO_MODE_INPUT_OUTPUT);
+
+	WRITE_PERI_REG(GPIO_OUT_W1TS_REG, DAP_Pins.swclk_mask);
+	WRITE_PERI_REG(GPIO_OUT_W1TS_REG, DAP_Pins.swdio_mask);
+
+	gpio_pad_select_gpio(PIN_TDI);
+	gpio_set_direction(PIN_TDI, GPIO_MODE_INPUT_OUTPUT);
+	gpio_pad_select_gpio(PIN_TDO);
+	gpio_set_direction(PIN_TDI, GPIO_MODE_INPUT_OUTPUT);
+	gpio_pad_select_gpio(PIN_nRESET);
+	gpio_set_direction(PIN_nRESET, GPIO_MODE_INPUT_OUTPUT);
+
+	GPIO_OUTPUT_SET(PIN_TDI, 1);
+	GPIO_OUTPUT_SET(PIN_TDO, 1);
+	GPIO_OUTPUT_SET(PIN_nRESET, 1);
+}
+
+/** Disable JTAG/SWD I/O Pins.
+Disables the DAP Hardware I/O pins which configures:
+ - TCK/SWCLK, TMS/SWDIO, TDI, TDO, nTRST, nRESET to High-Z mode.
+*/
+static inline void PORT_OFF(void)
+{
+	gpio_pad_select_gpio(PIN_SWCLK);
+	gpio_set_direction(PIN_SWCLK, GPIO_MODE_INPUT);
+	gpio_pad_select_gpio(PIN_SWDIO);
+	gpio_set_direction(PIN_SWDIO, GPIO_MODE_INPUT);
+
+	gpio_pad_select_gpio(PIN_TDI);
+	gpio_set_direction(PIN_TDI, GPIO_MODE_INPUT);
+	gpio_pad_select_gpio(PIN_TDO);
+	gpio_set_direction(PIN_TDI, GPIO_MODE_INPUT);
+	gpio_pad_select_gpio(PIN_nRESET);
+	gpio_set_direction(PIN_nRESET, GPIO_MODE_INPUT);
+}
+
+// SWCLK/TCK I/O pin -------------------------------------
+
+/** SWCLK/TCK I/O pin: Get Input.
+\return Current status of the SWCLK/TCK DAP hardware I/O pin.
+*/
+static inline uint32_t PIN_SWCLK_TCK_IN(void)
+{
+	return (READ_PERI_REG(GPIO_IN_REG) >> DAP_Pins.swclk) & 1U;
+}
+
+/** SWCLK/TCK I/O pin: Set Output to High.
+Set the SWCLK/TCK DAP hardware I/O pin to high level.
+*/
+static inline void PIN_SWCLK_TCK_SET(void)
+{
+	WRITE_PERI_REG(GPIO_OUT_W1TS_REG, DAP_Pins.swclk_mask);
+}
+
+/** SWCLK/TCK I/O pin: Set Output to Low.
+Set the SWCLK/TCK DAP hardware I/O pin to low level.
+*/
+static inline void PIN_SWCLK_TCK_CLR(void)
+{
+	WRITE_PERI_REG(GPIO_OUT_W1TC_REG, DAP_Pins.swclk_mask);
+}
+
+// SWDIO/TMS Pin I/O --------------------------------------
+
+/** SWDIO/TMS I/O pin: Get Input.
+\return Current status of the SWDIO/TMS DAP hardware I/O pin.
+*/
+static inline uint32_t PIN_SWDIO_TMS_IN(void)
+{
+	return (READ_PERI_REG(GPIO_IN_REG) >> DAP_Pins.swdio) & 1U;
+}
+
+/** SWDIO/TMS I/O pin: Set Output to High.
+Set the SWDIO/TMS DAP hardware I/O pin to high level.
+*/
+static inline void PIN_SWDIO_TMS_SET(void)
+{
+	WRITE_PERI_REG(GPIO_OUT_W1TS_REG, DAP_Pins.swdio_mask);
+}
+
+/** SWDIO/TMS I/O pin: Set Output to Low.
+Set the SWDIO/TMS DAP hardware I/O pin to low level.
+*/
+static inline void PIN_SWDIO_TMS_CLR(void)
+{
+	WRITE_PERI_REG(GPIO_OUT_W1TC_REG, DAP_Pins.swdio_mask);
+}
+
+/** SWDIO I/O pin: Get Input (used in SWD mode only).
+\return Current status of the SWDIO DAP hardware I/O pin.
+*/
+
+static inline uint32_t PIN_SWDIO_IN(void)
+{
+	return (READ_PERI_REG(GPIO_IN_REG) >> DAP_Pins.swdio) & 1U;
+}
+
+/** SWDIO I/O pin: Set Output (used in SWD mode only).
+\param bit Output value for the SWDIO DAP hardware I/O pin.
+*/
+static inline void PIN_SWDIO_OUT(uint32_t bit)
+{
+	/**
+    * Important: Use only one bit (bit0) of param!
+	* Sometimes the func "SWD_TransferFunction" of SW_DP.c will
+	* issue "2" as param instead of "0". Zach Lee
+	*/
+	// GPIO_OUT_W1TS sits one word below GPIO_OUT_W1TC, bit0 picks the register without a branch
+	WRITE_PERI_REG(GPIO_OUT_W1TC_REG - ((bit & 1U) << 2), DAP_Pins.swdio_mask);
+}
+
+/** SWDIO I/O pin: Switch to Output mode (used in SWD mode only).
+Configure the SWDIO DAP hardware I/O pin to output mode. This function is
+called prior \ref PIN_SWDIO_OUT function calls.
+*/
+static inline void PIN_SWDIO_OUT_ENABLE(void)
+{
+	// The pad input stays enabled from PORT_SWD_SETUP, only the output driver is switched
+	WRITE_PERI_REG(GPIO_ENABLE_W1TS_REG, DAP_Pins.swdio_mask);
+}
+
+/** SWDIO I/O pin: Switch to Input mode (used in SWD mode only).
+Configure the SWDIO DAP hardware I/O pin to input mode. This function is
+called prior \ref PIN_SWDIO_IN function calls.
+*/
+static inline void PIN_SWDIO_OUT_DISABLE(void)
+{
+	WRITE_PERI_REG(GPIO_ENABLE_W1TC_REG, DAP_Pins.swdio_mask);
+}
+
+#if (DAP_GANG != 0)
+
+// Gang SWDIO Pin I/O --------------------------------------
+
+// SWDIO pins of the gang targets from Kconfig (CMSIS-DAP -> Gang programming), target 0 is the
+// regular SWDIO (set by DAP_PinsLoad). All of them have to be in GPIO0..31: one
+// GPIO_OUT_W1TS/W1TC write drives and one GPIO_IN read samples every target.
+#define PIN_GANG_SWDIO {CONFIG_DAP_PIN_SWDIO, CONFIG_DAP_PIN_GANG_SWDIO1, \
+						CONFIG_DAP_PIN_GANG_SWDIO2, CONFIG_DAP_PIN_GANG_SWDIO3}
+
+extern uint8_t DAP_GangPins[DAP_GANG_CNT];
+
+/** Gang SWDIO: GPIO mask of a target.
+\param n gang target number.
+\return bit of the SWDIO pin of target n in the GPIO registers.
+*/
+static inline uint32_t PIN_GANG_SWDIO_MASK(uint32_t n)
+{
+	return 1U << DAP_GangPins[n];
+}
+
+/** Setup the gang SWDIO pins: output mode and set to high level.
+*/
+static inline void PORT_GANG_SETUP(void)
+{
+	uint32_t n;
+
+	for (n = 0U; n < DAP_GANG_CNT; n++)
+	{
+		gpio_pad_select_gpio(DAP_GangPins[n]);
+		gpio_set_direction(DAP_GangPins[n], GPIO_MODE_INPUT_OUTPUT);
+		WRITE_PERI_REG(GPIO_OUT_W1TS_REG, PIN_GANG_SWDIO_MASK(n));
+	}
+}
+
+/** Gang SWDIO: Set Outputs.
+\param set GPIO mask of the SWDIO pins to drive high.
+\param clr GPIO mask of the SWDIO pins to drive low.
+*/
+static inline void PIN_GANG_SWDIO_OUT(uint32_t set, uint32_t clr)
+{
+	WRITE_PERI_REG(GPIO_OUT_W1TS_REG, set);
+	WRITE_PERI_REG(GPIO_OUT_W1TC_REG, clr);
+}
+
+/** Gang SWDIO: Get Inputs.
+\return GPIO input register, masked per target with PIN_GANG_SWDIO_MASK.
+*/
+static inline uint32_t PIN_GANG_SWDIO_IN(void)
+{
+	return READ_PERI_REG(GPIO_IN_REG);
+}
+
+/** Gang SWDIO: Switch pins to Output mode.
+\param mask GPIO mask of the SWDIO pins.
+*/
+static inline void PIN_GANG_SWDIO_OUT_ENABLE(uint32_t mask)
+{
+	WRITE_PERI_REG(GPIO_ENABLE_W1TS_REG, mask);
+}
+
+/** Gang SWDIO: Switch pins to Input mode.
+\param mask GPIO mask of the SWDIO pins.
+*/
+static inline void PIN_GANG_SWDIO_OUT_DISABLE(uint32_t mask)
+{
+	WRITE_PERI_REG(GPIO_ENABLE_W1TC_REG, mask);
+}
+
+#endif
+
+// TDI Pin I/O ---------------------------------------------
+
+/** TDI I/O pin: Get Input.
+\return Current status of the TDI DAP hardware I/O pin.
+*/
+static inline uint32_t PIN_TDI_IN(void)
+{
+	return (READ_PERI_REG(GPIO_IN_REG) >> DAP_Pins.tdi) & 1U;
+}
+
+/** TDI I/O pin: Set Output.
+\param bit Output value for the TDI DAP hardware I/O pin.
+*/
+static inline void PIN_TDI_OUT(uint32_t bit)
+{
+	// Same register selection as PIN_SWDIO_OUT
+	WRITE_PERI_REG(GPIO_OUT_W1TC_REG - ((bit & 1U) << 2), DAP_Pins.tdi_mask);
+}
+
+// TDO Pin I/O ---------------------------------------------
+
+/** TDO I/O pin: Get Input.
+\return Current status of the TDO DAP hardware I/O pin.
+*/
+static inline uint32_t PIN_TDO_IN(void)
+{
+	return (READ_PERI_REG(DAP_Pins.tdo_in) >> DAP_Pins.tdo_bit) & 1U;
+}
+
+// nTRST Pin I/O -------------------------------------------
+
+/** nTRST I/O pin: Get Input.
+\return Current status of the nTRST DAP hardware I/O pin.
+*/
+static inline uint32_t PIN_nTRST_IN(void)
+{
+	return (0U); // Not available
+}
+
+/** nTRST I/O pin: Set Output.
+\param bit JTAG TRST Test Reset pin status:
+           - 0: issue a JTAG TRST Test Reset.
+           - 1: release JTAG TRST Test Reset.
+*/
+static inline void PIN_nTRST_OUT(uint32_t bit)
+{
+	(void)bit;
+	; // Not available
+}
+
+// nRESET Pin I/O------------------------------------------
+
+/** nRESET I/O pin: Get Input.
+\return Current status of the nRESET DAP hardware I/O pin.
+*/
+static inline uint32_t PIN_nRESET_IN(void)
+{
+	return (0U); //
+				 //   return (uint32_t)(JTAG_nRESET_GPIO_Port->ODR & JTAG_nRESET_Pin ? 1:0);
+}
+
+/** nRESET I/O pin: Set Output.
+\param bit target device hardware reset pin status:
+           - 0: issue a device hardware reset.
+           - 1: release device hardware reset.
+*/
+static inline void PIN_nRESET_OUT(uint32_t bit)
+{
+
+	if ((bit & 1U) == 1)
+	{
+
+	}
+	else
+	{
+		if (swd_init_debug())
+		{
+			ESP_LOGI("RST", "Connect");
+		}
+		else
+		{
+			ESP_LOGI("RST", "Disconnect");
+		}
+		uint32_t swd_mem_write_data = 0x05FA0000 | 0x4;
+		swd_write_memory(0xE000ED0C, (uint8_t *)&swd_mem_write_data, 4);
+	}
+}
+
+///@}
+
+//**************************************************************************************************
+/**
+\defgroup DAP_Config_LEDs_gr CMSIS-DAP Hardware Status LEDs
+\ingroup DAP_ConfigIO_gr
+@{
+
+CMSIS-DAP Hardware may provide LEDs that indicate the status of the CMSIS-DAP Debug Unit.
+
+It is recommended to provide the following LEDs for status indication:
+ - Connect LED: is active when the DAP hardware is connected to a debugger.
+ - Running LED: is active when the debugger has put the target device into running state.
+*/
+
+/** Debug Unit: Set status of Connected LED.
+\param bit status of the Connect LED.
+           - 1: Connect LED ON: debugger is connected to CMSIS-DAP Debug Unit.
+           - 0: Connect LED OFF: debugger is not connected to CMSIS-DAP Debug Unit.
+*/
+static inline void LED_CONNECTED_OUT(uint32_t bit)
+{
+
+	if ((bit & 1U) == 1)
+	{
+		gpio_set_level(PIN_LED_CONNECTED, 1);
+		// LED_GPIO_Port->BRR =  LED_CONNECTED_Pin;
+	}
+	else
+	{
+		gpio_set_level(PIN_LED_CONNECTED, 0);
+		// LED_GPIO_Port->BSRR = LED_CONNECTED_Pin;
+	}
+}
+
+/** Debug Unit: Set status Target Running LED.
+\param bit status of the Target Running LED.
+           - 1: Target Running LED ON: program execution in target started.
+           - 0: Target Running LED OFF: program execution in target stopped.
+*/
+static inline void LED_RUNNING_OUT(uint32_t bit)
+{
+	(void)bit;
+	; // Not available
+}
+
+///@}
+
+//**************************************************************************************************
+/**
+\defgroup DAP_Config_Timestamp_gr CMSIS-DAP Timestamp
+\ingroup DAP_ConfigIO_gr
+@{
+Access function for Test Domain Timer.
+
+The value of the Test Domain Timer in the Debug Unit is returned by the function \ref TIMESTAMP_GET. By
+default, the DWT timer is used.  The frequency of this timer is configured with \ref TIMESTAMP_CLOCK.
+
+*/
+
+/** Get timestamp of Test Domain Timer.
+\return Current timestamp value.
+*/
+// static inline uint32_t TIMESTAMP_GET (void) {
+//   return (DWT->CYCCNT);
+// }
+static inline uint32_t TIMESTAMP_GET(void)
+{
+	return xTaskGetTickCount();
+}
+
+/** Get CPU cycle counter (used for benchmarks and the flash session times).
+\return Current CPU cycle count, running at \ref CPU_CLOCK.
+*/
+static inline uint32_t CYCLE_COUNT_GET(void)
+{
+	return xthal_get_ccount();
+}
+///@}
+
+//**************************************************************************************************
+/**
+\defgroup DAP_Config_Initialization_gr CMSIS-DAP Initialization
+\ingroup DAP_ConfigIO_gr
+@{
+
+CMSIS-DAP Hardware I/O and LED Pins are initialized with the function \ref DAP_SETUP.
+*/
+
+/** Setup of the Debug Unit I/O pins and LEDs (called when Debug Unit is initialized).
+This function performs the initialization of the CMSIS-DAP Hardware I/O Pins and the
+Status LEDs. In detail the operation of Hardware I/O and LED pins are enabled and set:
+ - I/O clock system enabled.
+ - all I/O pins: input buffer enabled, output pins are set to HighZ mode.
+ - for nTRST, nRESET a weak pull-up (if available) is enabled.
+ - LED output pins are enabled and LEDs are turned off.
+*/
+static inline void DAP_SETUP(void)
+{
+	PORT_JTAG_SETUP();
+	PORT_SWD_SETUP();
+	gpio_set_direction(PIN_SWCLK, GPIO_MODE_INPUT_OUTPUT);
+	gpio_set_direction(PIN_SWDIO, GPIO_MODE_INPUT_OUTPUT);	//
+	gpio_set_direction(PIN_nRESET, GPIO_MODE_INPUT_OUTPUT); //
+	gpio_set_direction(PIN_TDI, GPIO_MODE_INPUT_OUTPUT);
+	gpio_set_direction(PIN_TDO, GPIO_MODE_INPUT_OUTPUT);
+	// Configure: LED as output (turned off)
+	gpio_set_direction(PIN_LED_CONNECTED, GPIO_MODE_DEF_OUTPUT);
+	LED_CONNECTED_OUT(0);
+	gpio_set_direction(PIN_LED_RUNNING, GPIO_MODE_DEF_OUTPUT);
+	LED_RUNNING_OUT(0);
+}
+
+///@}
+
+#endif /* __DAP_PINS_ESP32S2_H__ */
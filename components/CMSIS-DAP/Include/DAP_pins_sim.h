@@ -0,0 +1,281 @@
+/*---------------------------------------------------------------------------
+ * DAP_pins_sim.h  CMSIS-DAP pin driver for a host simulation
+ *
+ * Hardware I/O pin, LED and timestamp access used by DAP_config.h when
+ * DAP_PIN_DRIVER is DAP_PIN_DRIVER_SIM. The pins only exist as variables;
+ * every rising SWCLK/TCK edge is handed to a target model which answers with
+ * the level it drives on SWDIO/TDO. Gang targets (DAP_GANG) get a model each
+ * on their own SWDIO line. Edges can be recorded into a trace buffer.
+ *---------------------------------------------------------------------------*/
+#ifndef __DAP_PINS_SIM_H__
+#define __DAP_PINS_SIM_H__
+
+#include <stdint.h>
+#include <time.h>
+
+// Target model attached to the simulated debug port
+typedef struct
+{
+	void *ctx; // Model instance passed to the callbacks
+	// Rising SWCLK/TCK edge: target samples swdio/tdi (swdio only valid when
+	// swdio_oe is set) and returns the level it drives on SWDIO/TDO until the
+	// next rising edge.
+	uint32_t (*clock)(void *ctx, uint32_t swdio, uint32_t swdio_oe, uint32_t tdi);
+	// nRESET level change (may be NULL)
+	void (*reset)(void *ctx, uint32_t nreset);
+} dap_sim_model_t;
+
+// Edge trace record, one per rising SWCLK/TCK edge
+#define DAP_SIM_TRACE_SWDIO (1U << 0)	   // SWDIO/TMS level driven by the probe
+#define DAP_SIM_TRACE_SWDIO_OE (1U << 1) // SWDIO driven by the probe
+#define DAP_SIM_TRACE_TDI (1U << 2)	   // TDI level
+#define DAP_SIM_TRACE_TARGET (1U << 3)   // SWDIO/TDO level driven by the target after the edge
+
+// Simulated pin state
+typedef struct
+{
+	uint8_t swclk;		   // SWCLK/TCK level
+	uint8_t swdio;		   // SWDIO/TMS level driven by the probe
+	uint8_t swdio_oe;	   // SWDIO/TMS output enabled on the probe
+	uint8_t tdi;		   // TDI level
+	uint8_t target;		   // SWDIO/TDO level driven by the target
+	uint8_t nreset;		   // nRESET level
+	uint8_t led_connected; // Connected LED
+	uint8_t led_running;   // Running LED
+	uint32_t edges;		   // Number of rising SWCLK/TCK edges
+	uint32_t spi_bits;	   // Number of bits shifted by the SPI engine (DAP_SPI)
+	uint32_t gang_swdio;   // Gang SWDIO levels driven by the probe, bit n = target n
+	uint32_t gang_oe;	   // Gang SWDIO outputs enabled on the probe
+	uint32_t gang_target;  // Gang SWDIO levels driven by the targets
+	uint32_t ticks;		   // Simulated time base for TIMESTAMP_GET
+	uint8_t *trace;		   // Edge trace buffer (may be NULL)
+	uint32_t trace_size;   // Size of the trace buffer
+	uint32_t trace_count;  // Number of recorded edges
+} dap_sim_pins_t;
+
+extern dap_sim_pins_t dap_sim_pins;
+
+extern void dap_sim_attach(const dap_sim_model_t *model);
+extern void dap_sim_gang_attach(uint32_t n, const dap_sim_model_t *model);
+extern void dap_sim_trace(uint8_t *buf, uint32_t size);
+extern void dap_sim_flm_store(const void *store, uint32_t size);
+extern void dap_sim_clock(void);
+extern void dap_sim_reset(uint32_t nreset);
+
+// Port setup ---------------------------------------------
+
+static inline void PORT_JTAG_SETUP(void)
+{
+	dap_sim_pins.swclk = 1U;
+	dap_sim_pins.swdio = 1U;
+	dap_sim_pins.swdio_oe = 1U;
+	dap_sim_pins.tdi = 1U;
+}
+
+static inline void PORT_SWD_SETUP(void)
+{
+	dap_sim_pins.swclk = 1U;
+	dap_sim_pins.swdio = 1U;
+	dap_sim_pins.swdio_oe = 1U;
+}
+
+static inline void PORT_OFF(void)
+{
+	dap_sim_pins.swdio_oe = 0U;
+}
+
+// SWCLK/TCK I/O pin -------------------------------------
+
+static inline uint32_t PIN_SWCLK_TCK_IN(void)
+{
+	return dap_sim_pins.swclk;
+}
+
+static inline void PIN_SWCLK_TCK_SET(void)
+{
+	if (dap_sim_pins.swclk == 0U)
+	{
+		dap_sim_pins.swclk = 1U;
+		dap_sim_clock();
+	}
+}
+
+static inline void PIN_SWCLK_TCK_CLR(void)
+{
+	dap_sim_pins.swclk = 0U;
+}
+
+// SWDIO/TMS Pin I/O --------------------------------------
+
+static inline uint32_t PIN_SWDIO_TMS_IN(void)
+{
+	return dap_sim_pins.swdio_oe ? dap_sim_pins.swdio : dap_sim_pins.target;
+}
+
+static inline void PIN_SWDIO_TMS_SET(void)
+{
+	dap_sim_pins.swdio = 1U;
+}
+
+static inline void PIN_SWDIO_TMS_CLR(void)
+{
+	dap_sim_pins.swdio = 0U;
+}
+
+static inline uint32_t PIN_SWDIO_IN(void)
+{
+	return dap_sim_pins.swdio_oe ? dap_sim_pins.swdio : dap_sim_pins.target;
+}
+
+static inline void PIN_SWDIO_OUT(uint32_t bit)
+{
+	dap_sim_pins.swdio = (uint8_t)(bit & 1U);
+}
+
+static inline void PIN_SWDIO_OUT_ENABLE(void)
+{
+	dap_sim_pins.swdio_oe = 1U;
+}
+
+static inline void PIN_SWDIO_OUT_DISABLE(void)
+{
+	dap_sim_pins.swdio_oe = 0U;
+}
+
+#if (DAP_GANG != 0)
+
+// Gang SWDIO Pin I/O --------------------------------------
+
+// Bit n of the masks is the SWDIO line of gang target n
+static inline uint32_t PIN_GANG_SWDIO_MASK(uint32_t n)
+{
+	return 1U << n;
+}
+
+static inline void PORT_GANG_SETUP(void)
+{
+	dap_sim_pins.gang_swdio = (1U << DAP_GANG_CNT) - 1U;
+	dap_sim_pins.gang_oe = (1U << DAP_GANG_CNT) - 1U;
+}
+
+static inline void PIN_GANG_SWDIO_OUT(uint32_t set, uint32_t clr)
+{
+	dap_sim_pins.gang_swdio = (dap_sim_pins.gang_swdio | set) & ~clr;
+}
+
+static inline uint32_t PIN_GANG_SWDIO_IN(void)
+{
+	return (dap_sim_pins.gang_swdio & dap_sim_pins.gang_oe) |
+		   (dap_sim_pins.gang_target & ~dap_sim_pins.gang_oe);
+}
+
+static inline void PIN_GANG_SWDIO_OUT_ENABLE(uint32_t mask)
+{
+	dap_sim_pins.gang_oe |= mask;
+}
+
+static inline void PIN_GANG_SWDIO_OUT_DISABLE(uint32_t mask)
+{
+	dap_sim_pins.gang_oe &= ~mask;
+}
+
+#endif
+
+// TDI Pin I/O ---------------------------------------------
+
+static inline uint32_t PIN_TDI_IN(void)
+{
+	return dap_sim_pins.tdi;
+}
+
+static inline void PIN_TDI_OUT(uint32_t bit)
+{
+	dap_sim_pins.tdi = (uint8_t)(bit & 1U);
+}
+
+// TDO Pin I/O ---------------------------------------------
+
+static inline uint32_t PIN_TDO_IN(void)
+{
+	return dap_sim_pins.target;
+}
+
+// nTRST Pin I/O -------------------------------------------
+
+static inline uint32_t PIN_nTRST_IN(void)
+{
+	return (0U); // Not available
+}
+
+static inline void PIN_nTRST_OUT(uint32_t bit)
+{
+	(void)bit;
+	; // Not available
+}
+
+// nRESET Pin I/O------------------------------------------
+
+static inline uint32_t PIN_nRESET_IN(void)
+{
+	return dap_sim_pins.nreset;
+}
+
+static inline void PIN_nRESET_OUT(uint32_t bit)
+{
+	dap_sim_reset(bit & 1U);
+}
+
+// LEDs ----------------------------------------------------
+
+static inline void LED_CONNECTED_OUT(uint32_t bit)
+{
+	dap_sim_pins.led_connected = (uint8_t)(bit & 1U);
+}
+
+static inline void LED_RUNNING_OUT(uint32_t bit)
+{
+	dap_sim_pins.led_running = (uint8_t)(bit & 1U);
+}
+
+// Timestamp -----------------------------------------------
+
+// Simulated time advances by one tick per query so timeouts always expire
+static inline uint32_t TIMESTAMP_GET(void)
+{
+	return dap_sim_pins.ticks++;
+}
+
+// Host time stands in for the CPU cycle counter, scaled to CPU_CLOCK
+static inline uint32_t CYCLE_COUNT_GET(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint32_t)((((uint64_t)ts.tv_sec * 1000000000U + (uint64_t)ts.tv_nsec) * (CPU_CLOCK / 1000000U)) / 1000U);
+}
+
+// FLM store -----------------------------------------------
+
+// In-memory FLM store set by dap_sim_flm_store, NULL when there is none
+extern const void *DAP_FlmStoreMap(uint32_t *size);
+extern void DAP_FlmStoreUnmap(void);
+
+// Logging -------------------------------------------------
+
+// The ESP-IDF log calls of the shared sources are dropped on the host
+#define ESP_LOGE(tag, ...) ((void)(tag))
+#define ESP_LOGW(tag, ...) ((void)(tag))
+#define ESP_LOGI(tag, ...) ((void)(tag))
+
+// Initialization ------------------------------------------
+
+static inline void DAP_SETUP(void)
+{
+	PORT_JTAG_SETUP();
+	PORT_SWD_SETUP();
+	dap_sim_pins.nreset = 1U;
+	LED_CONNECTED_OUT(0);
+	LED_RUNNING_OUT(0);
+}
+
+#endif /* __DAP_PINS_SIM_H__ */
@@ -0,0 +1,46 @@
+/*---------------------------------------------------------------------------
+ * DAP_spi.h  SPI shift engine for the SWD and JTAG bit streams
+ *
+ * Interface used by SW_DP.c and JTAG_DP.c when DAP_SPI is enabled, implemented
+ * by the selected pin driver (DAP_spi_esp32s2.c or DAP_spi_sim.c).
+ *
+ * Bit streams are LSB first. The clock idles high, the probe changes its data
+ * after the falling edge and data is sampled on the rising edge (SPI mode 3),
+ * the same framing as the bit-banged SW_*_BIT and JTAG_CYCLE_* macros. The
+ * engine owns SWCLK/TCK and its data output only for the duration of a call
+ * and hands them back to the GPIO with SWCLK/TCK high and the data output at
+ * the last bit shifted out. SWDIO output enable stays under control of
+ * PIN_SWDIO_OUT_ENABLE/PIN_SWDIO_OUT_DISABLE.
+ *---------------------------------------------------------------------------*/
+#ifndef __DAP_SPI_H__
+#define __DAP_SPI_H__
+
+#include <stdint.h>
+
+/** Set the SPI clock.
+\param clock requested clock in Hz.
+\return clock generated by the SPI (not above the request),
+        0 when the SPI cannot generate it and the bit-bang I/O has to be used.
+*/
+extern uint32_t SPI_SetClock(uint32_t clock);
+
+/** Shift bits out on SWDIO/TMS.
+\param data bits to send, LSB first.
+\param bits number of bits.
+*/
+extern void SPI_SWD_Write(const uint8_t *data, uint32_t bits);
+
+/** Shift bits in from SWDIO.
+\param data buffer for the received bits, LSB first (bits rounded up to whole bytes).
+\param bits number of bits.
+*/
+extern void SPI_SWD_Read(uint8_t *data, uint32_t bits);
+
+/** Shift bits out on TDI and in from TDO, TMS is left unchanged.
+\param tdi bits to send, LSB first.
+\param tdo buffer for the captured bits (bits rounded up to whole bytes), NULL = no capture.
+\param bits number of bits.
+*/
+extern void SPI_JTAG_Shift(const uint8_t *tdi, uint8_t *tdo, uint32_t bits);
+
+#endif /* __DAP_SPI_H__ */
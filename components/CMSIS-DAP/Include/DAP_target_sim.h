@@ -0,0 +1,104 @@
+/*---------------------------------------------------------------------------
+ * DAP_target_sim.h  ADIv5 SW-DP / MEM-AP target model for the host simulation
+ *
+ * Plugs into the simulated pin driver (DAP_pins_sim.h) and answers the SWD
+ * bit stream like a Cortex-M debug port: DP IDCODE, CTRL/STAT, SELECT,
+ * RESEND, RDBUFF and ABORT, one MEM-AP with CSW, TAR, DRW, BD0-3, CFG, BASE
+ * and IDR (posted reads, TAR auto-increment with wrap), and the debug
+ * registers DHCSR, DCRSR, DCRDR and DEMCR. WAIT and FAULT responses can be
+ * injected to exercise the retry and error paths of the DAP engine. With a
+ * TARGETSEL value the DP is a DPv2 multi-drop target with a dormant state,
+ * several of them share the SWDIO line through dap_target_sim_attach_bus.
+ *---------------------------------------------------------------------------*/
+#ifndef __DAP_TARGET_SIM_H__
+#define __DAP_TARGET_SIM_H__
+
+#include <stdint.h>
+
+#define DAP_TARGET_SIM_REGIONS 4U // Number of memory regions
+
+// Memory region on the MEM-AP bus
+typedef struct
+{
+	uint32_t base;	  // Start address
+	uint32_t size;	  // Size in bytes (0 = unused)
+	uint8_t *mem;	  // Backing store
+	uint8_t writable; // 0 = writes are ignored (ROM/flash)
+} dap_target_sim_region_t;
+
+// Transaction statistics
+typedef struct
+{
+	uint32_t ok;	 // OK responses
+	uint32_t wait;	 // WAIT responses
+	uint32_t fault;	 // FAULT responses
+	uint32_t ap_rd;	 // Accepted AP reads
+	uint32_t ap_wr;	 // Accepted AP writes
+	uint32_t bus_rd; // Memory reads done by the MEM-AP
+	uint32_t bus_wr; // Memory writes done by the MEM-AP
+} dap_target_sim_stats_t;
+
+typedef struct dap_target_sim
+{
+	// Configuration, set up by dap_target_sim_init and may be changed afterwards
+	uint32_t idcode;	 // DP IDCODE
+	uint32_t ap_idr;	 // MEM-AP IDR
+	uint32_t ap_base;	 // MEM-AP BASE (ROM table address | present bits)
+	uint32_t cpuid;		 // SCB CPUID
+	uint32_t tar_wrap;	 // TAR auto-increment wrap boundary in bytes (power of 2)
+	uint8_t turnaround;	 // Turnaround cycles, must match DAP_Data.swd_conf.turnaround
+	uint32_t targetsel;	 // TARGETSEL of a multi-drop DPv2 (0 = single-drop)
+	uint16_t ap_wait;	 // WAIT responses given while an accepted AP access is busy
+	uint32_t fault_after; // Bus fault on the n-th AP memory access from now (0 = off)
+	dap_target_sim_region_t region[DAP_TARGET_SIM_REGIONS];
+	// Called when the halted core is resumed, emulates the code it runs and returns 1 when
+	// the core halts again (breakpoint). NULL = the core keeps running.
+	uint32_t (*run)(struct dap_target_sim *t);
+	uint32_t run_time; // MEM-AP accesses before the code emulated by run halts (0 = at once)
+	void *user; // Free for the owner of the model
+
+	// DP/AP state
+	uint32_t ctrl_stat; // CTRL/STAT request and sticky bits
+	uint32_t select;	// SELECT
+	uint32_t rdbuff;	// Result of the last AP read
+	uint32_t csw;		// MEM-AP CSW
+	uint32_t tar;		// MEM-AP TAR
+	uint16_t busy;		// WAIT responses left for the current AP access
+	uint32_t ap_error;	// Sticky bits of the current AP access, in CTRL/STAT once it completes
+
+	// Core debug state
+	uint32_t dhcsr;	   // DHCSR control bits
+	uint32_t dcrdr;	   // DCRDR
+	uint32_t demcr;	   // DEMCR
+	uint32_t running;  // MEM-AP accesses left until run is called, 0 = not running
+	uint32_t reg[128]; // Core registers, indexed by DCRSR REGSEL
+
+	dap_target_sim_stats_t stats;
+
+	// SWD line state
+	uint8_t phase;	  // Protocol phase
+	uint8_t ack;	  // Acknowledge of the current request
+	uint8_t request;  // Request bits APnDP, RnW, A2, A3
+	uint8_t ones;	  // Consecutive high bits for line reset detection
+	uint16_t cycle;	  // Cycle counter within the phase
+	uint32_t shift;	  // Data shift register
+	uint32_t parity;  // Data parity
+	uint8_t out;	  // Level driven by the target in the next cycle
+	uint8_t line_reset; // Line reset seen, cleared by an IDCODE read
+
+	// Multi-drop state
+	uint8_t dormant;	 // Dormant, only the selection alert is detected
+	uint8_t selected;	 // Selected by the last TARGETSEL (or no TARGETSEL after the line reset)
+	uint8_t md_reset;	 // Line reset seen, the next packet may be a TARGETSEL
+	uint16_t since_reset; // Cycles since the end of the last line reset
+	uint16_t activate;	 // Cycles after the selection alert (0 = no alert)
+	uint64_t seq[2];	 // Last 128 bits driven by the probe, oldest in bit 0
+} dap_target_sim_t;
+
+extern void dap_target_sim_init(dap_target_sim_t *t);
+extern void dap_target_sim_attach(dap_target_sim_t *t);
+extern void dap_target_sim_gang_attach(dap_target_sim_t *t, uint32_t n);
+extern void dap_target_sim_attach_bus(dap_target_sim_t **t, uint32_t count);
+extern int dap_target_sim_add_region(dap_target_sim_t *t, uint32_t base, uint32_t size, uint8_t *mem, uint8_t writable);
+
+#endif /* __DAP_TARGET_SIM_H__ */
@@ -10,6 +10,10 @@ error_tt target_flash_uninit(void);
 error_tt target_flash_program_page(uint32_t addr, const uint8_t *buf, uint32_t size);
 error_tt target_flash_erase_sector(uint32_t addr);
 error_tt target_flash_erase_chip(void);
+void target_flash_gang(uint32_t targets);
+error_tt target_flash_gang_status(uint32_t target);
+error_tt target_flash_crc32(uint32_t addr, uint32_t size, uint32_t *crc);
+uint32_t flash_crc32(const uint8_t *data, uint32_t size);
 
 
 #endif // __SWD_FLASH_H__
@@ -21,16 +21,38 @@ typedef enum
 uint8_t swd_init(void);
 uint8_t swd_off(void);
 uint8_t swd_init_debug(void);
+uint8_t swd_select_target(uint32_t targetsel);
+void swd_invalidate_state(void);
 uint8_t swd_read_dp(uint8_t adr, uint32_t *val);
 uint8_t swd_write_dp(uint8_t adr, uint32_t val);
 uint8_t swd_read_ap(uint32_t adr, uint32_t *val);
 uint8_t swd_write_ap(uint32_t adr, uint32_t val);
+void swd_batch_start(void);
+void swd_batch_read_dp(uint8_t adr, uint32_t *val);
+void swd_batch_write_dp(uint8_t adr, uint32_t val);
+void swd_batch_read_ap(uint32_t adr, uint32_t *val);
+void swd_batch_check_ap(uint32_t adr, uint32_t mask, uint32_t expect);
+void swd_batch_write_ap(uint32_t adr, uint32_t val);
+void swd_batch_read_word(uint32_t addr, uint32_t *val);
+void swd_batch_write_word(uint32_t addr, uint32_t val);
+uint8_t swd_batch_end(void);
+uint32_t swd_tar_wrap(uint8_t apsel);
+uint8_t swd_set_tar_wrap(uint8_t apsel, uint32_t size);
+uint8_t swd_detect_tar_wrap(uint8_t apsel);
 uint8_t swd_read_memory(uint32_t address, uint8_t *data, uint32_t size);
 uint8_t swd_write_memory(uint32_t address, uint8_t *data, uint32_t size);
+uint8_t swd_read_core_registers(const uint8_t *regs, uint32_t cnt, uint32_t *val);
+uint8_t swd_write_core_registers(const uint8_t *regs, uint32_t cnt, const uint32_t *val);
 uint8_t swd_flash_syscall_exec(const program_syscall_t *sysCallParam, uint32_t entry, uint32_t arg1, uint32_t arg2, uint32_t arg3, uint32_t arg4);
+uint8_t swd_flash_syscall_start(const program_syscall_t *sysCallParam, uint32_t entry, uint32_t arg1, uint32_t arg2, uint32_t arg3, uint32_t arg4);
+uint8_t swd_flash_syscall_halted(uint8_t *halted);
+uint8_t swd_flash_syscall_value(uint32_t *val);
+uint8_t swd_flash_syscall_result(void);
 void swd_set_target_reset(uint8_t asserted);
 uint8_t swd_set_target_state_hw(TARGET_RESET_STATE state);
 uint8_t swd_set_target_state_sw(TARGET_RESET_STATE state);
+void swd_gang_select(uint32_t targets);
+uint32_t swd_gang_live(void);
 
 
 #endif
@@ -0,0 +1,31 @@
+#ifndef __SWD_TARGET_H__
+#define __SWD_TARGET_H__
+
+#include <stdint.h>
+
+#include "../algo/flash_blob.h"
+
+// Identification of the target behind the SW-DP, filled by target_identify
+typedef struct
+{
+	uint32_t dp_idcode;	 // DP IDCODE
+	uint32_t ap_idr;	 // MEM-AP IDR
+	uint32_t rom_base;	 // ROM table address, 0 = none
+	uint32_t rom_pidr;	 // ROM table designer (JEP106, bits 22:12) and part number (bits 11:0)
+	uint32_t components; // CoreSight components found in the ROM table walk
+	uint32_t cpuid;		 // SCB CPUID
+	uint32_t dbgmcu;	 // DBGMCU_IDCODE address, 0 = unknown part
+	uint32_t idcode;	 // DBGMCU_IDCODE: REV_ID (bits 31:16), DEV_ID (bits 11:0)
+	uint32_t flash_start;
+	uint32_t flash_size;		   // Bytes, from the flash size register
+	const sector_info_t *sectors; // Sector groups of the flash
+	uint32_t sector_cnt;
+	const char *family; // NULL = unknown part
+	uint8_t algo;		// Registry index of the flash algorithm, valid with family
+	uint8_t cached;		// Result taken from the cache of the previous identification
+} target_id_t;
+
+uint8_t target_identify(target_id_t *id);
+uint32_t target_sector_size(const target_id_t *id, uint32_t addr, uint32_t size);
+
+#endif // __SWD_TARGET_H__
@@ -21,8 +21,6 @@
  ******************************************************************************/
 
 #include <string.h>
-#include "freertos/FreeRTOS.h"
-#include "freertos/task.h"
 #ifdef _RTE_
 #include "RTE_Components.h" // Component selection
 #endif
@@ -31,7 +29,6 @@
 #endif
 #include "DAP_config.h"
 #include "DAP.h"
-#include "driver/gpio.h"
 
 #define DAP_FW_VER "ESP32_DAP" // Firmware Version
 
@@ -48,14 +45,6 @@
 #error "Maximum Packet Count is 255"
 #endif
 
-// Clock Macros
-
-#define MAX_SWJ_CLOCK(delay_cycles) \
-	((CPU_CLOCK / 2U) / (IO_PORT_WRITE_CYCLES + delay_cycles))
-
-#define CLOCK_DELAY(swj_clock) \
-	(((CPU_CLOCK / 2U) / swj_clock) - IO_PORT_WRITE_CYCLES)
-
 DAP_Data_t DAP_Data;				// DAP Data
 volatile uint8_t DAP_TransferAbort; // Transfer Abort Flag
 
@@ -161,7 +150,7 @@ static uint32_t TimerTick;
 // Start Timer
 static __inline void TIMER_START(uint32_t usec)
 {
-	TimerTick = xTaskGetTickCount();
+	TimerTick = TIMESTAMP_GET();
 }
 
 // Stop Timer
@@ -172,7 +161,7 @@ static __inline void TIMER_STOP(void)
 // Check if Timer expired
 static __inline uint32_t TIMER_EXPIRED(void)
 {
-	return ((xTaskGetTickCount() > TimerTick) ? 1U : 0U);
+	return ((TIMESTAMP_GET() > TimerTick) ? 1U : 0U);
 }
 
 #endif
@@ -236,7 +225,7 @@ static uint32_t DAP_HostStatus(const uint8_t *request, uint8_t *response)
 static uint32_t DAP_Connect(const uint8_t *request, uint8_t *response)
 {
 	uint32_t port;
-	ESP_LOGD("SWD_DELAY", "DAP_Connect");
+	DAP_TRACE_LOG("DAP_Connect");
 	if (*request == DAP_PORT_AUTODETECT)
 	{
 		port = DAP_DEFAULT_PORT;
@@ -348,7 +337,7 @@ static uint32_t DAP_SWJ_Pins(const uint8_t *request, uint8_t *response)
 		PIN_nRESET_OUT(value >> DAP_SWJ_nRESET);
 	}
 
-	ESP_LOGD("SWD_DELAY", "DELAY");
+	DAP_TRACE_LOG("DELAY");
 	if (wait)
 	{
 #if (TIMESTAMP_CLOCK != 0U)
@@ -365,7 +354,7 @@ static uint32_t DAP_SWJ_Pins(const uint8_t *request, uint8_t *response)
 		wait = 1U;
 #endif
 		// uint32_t timestamp = xTaskGetTickCount();
-		ESP_LOGD("SWD_DELAY", "DELAY1");
+		DAP_TRACE_LOG("DELAY1");
 		TIMER_START(wait);
 		do
 		{
@@ -406,7 +395,7 @@ static uint32_t DAP_SWJ_Pins(const uint8_t *request, uint8_t *response)
 			}
 			break;
 		} while (!TIMER_EXPIRED());
-		ESP_LOGD("SWD_DELAY", "DELAY2");
+		DAP_TRACE_LOG("DELAY2");
 		TIMER_STOP();
 	}
 
@@ -425,6 +414,104 @@ static uint32_t DAP_SWJ_Pins(const uint8_t *request, uint8_t *response)
 	return ((6U << 16) | 1U);
 }
 
+#if ((DAP_SWD != 0) || (DAP_JTAG != 0))
+
+// SWJ clock table: clock delays (0 = fast clock) and their measured SWCLK/TCK
+// period in CPU cycles, ordered from the fastest to the slowest clock
+#define SWJ_CLOCK_TABLE_SIZE 32U
+
+static const uint16_t SWJ_ClockDelay[SWJ_CLOCK_TABLE_SIZE] = {
+	0U, 1U, 2U, 3U, 4U, 5U, 6U, 7U,
+	8U, 9U, 10U, 11U, 12U, 13U, 14U, 15U,
+	16U, 24U, 32U, 48U, 64U, 96U, 128U, 192U,
+	256U, 384U, 512U, 768U, 1024U, 1536U, 2048U, 3072U};
+
+static uint32_t SWJ_ClockPeriodTable[SWJ_CLOCK_TABLE_SIZE];
+static uint8_t SWJ_ClockCalibrated;
+
+// Measure the clock period of every table delay, done once at boot
+void SWJ_Calibrate(void)
+{
+	uint32_t n;
+
+	for (n = 0U; n < SWJ_CLOCK_TABLE_SIZE; n++)
+	{
+		SWJ_ClockPeriodTable[n] = SWJ_ClockPeriod(SWJ_ClockDelay[n]);
+		if (SWJ_ClockPeriodTable[n] == 0U)
+		{
+			SWJ_ClockPeriodTable[n] = 1U;
+		}
+	}
+	SWJ_ClockCalibrated = 1U;
+}
+
+// Select the fastest clock that does not exceed the requested one
+//   clock: requested SWJ clock in Hz (not 0)
+static void SWJ_SetClock(uint32_t clock)
+{
+	uint32_t period;
+	uint32_t delay;
+	uint32_t n;
+#if (DAP_SPI != 0)
+	uint32_t freq;
+#endif
+
+	if (!SWJ_ClockCalibrated)
+	{
+		SWJ_Calibrate();
+	}
+
+	for (n = 0U; n < SWJ_CLOCK_TABLE_SIZE; n++)
+	{
+		if ((CPU_CLOCK / SWJ_ClockPeriodTable[n]) <= clock)
+		{
+			break;
+		}
+	}
+
+	if (n == 0U)
+	{
+		// Requested clock is at or above the fastest clock
+		DAP_Data.fast_clock = 1U;
+		DAP_Data.clock_delay = 1U;
+		period = SWJ_ClockPeriodTable[0];
+	}
+	else if (n < SWJ_CLOCK_TABLE_SIZE)
+	{
+		DAP_Data.fast_clock = 0U;
+		DAP_Data.clock_delay = SWJ_ClockDelay[n];
+		period = SWJ_ClockPeriodTable[n];
+	}
+	else
+	{
+		// Slower than the table, the period grows linearly with the delay
+		n = SWJ_CLOCK_TABLE_SIZE - 1U;
+		delay = (uint32_t)(((uint64_t)SWJ_ClockDelay[n] * (CPU_CLOCK / clock) +
+							(SWJ_ClockPeriodTable[n] - 1U)) /
+						   SWJ_ClockPeriodTable[n]);
+		period = (uint32_t)(((uint64_t)SWJ_ClockPeriodTable[n] * delay) / SWJ_ClockDelay[n]);
+		DAP_Data.fast_clock = 0U;
+		DAP_Data.clock_delay = delay;
+	}
+	DAP_Data.clock_freq = CPU_CLOCK / period;
+
+#if (DAP_SPI != 0)
+	// SPI shifts the data phases, the bit-bang settings above stay in use for the rest
+	freq = SPI_SetClock(clock);
+	DAP_Data.spi_clock = (freq != 0U) ? 1U : 0U;
+	if (freq != 0U)
+	{
+		DAP_Data.clock_freq = freq;
+	}
+#endif
+
+#if (DAP_SWD != 0)
+	SWD_TransferSelect();
+#endif
+}
+
+#endif
+
 // Process SWJ Clock command and prepare response
 //   request:  pointer to request data
 //   response: pointer to response data
@@ -434,7 +521,6 @@ static uint32_t DAP_SWJ_Clock(const uint8_t *request, uint8_t *response)
 {
 #if ((DAP_SWD != 0) || (DAP_JTAG != 0))
 	uint32_t clock;
-	uint32_t delay;
 
 	clock = (*(request + 0) << 0) |
 			(*(request + 1) << 8) |
@@ -447,28 +533,7 @@ static uint32_t DAP_SWJ_Clock(const uint8_t *request, uint8_t *response)
 		return ((4U << 16) | 1U);
 	}
 
-	if (clock >= MAX_SWJ_CLOCK(DELAY_FAST_CYCLES))
-	{
-		DAP_Data.fast_clock = 1U;
-		DAP_Data.clock_delay = 1U;
-	}
-	else
-	{
-		DAP_Data.fast_clock = 0U;
-
-		delay = ((CPU_CLOCK / 2U) + (clock - 1U)) / clock;
-		if (delay > IO_PORT_WRITE_CYCLES)
-		{
-			delay -= IO_PORT_WRITE_CYCLES;
-			delay = (delay + (DELAY_SLOW_CYCLES - 1U)) / DELAY_SLOW_CYCLES;
-		}
-		else
-		{
-			delay = 1U;
-		}
-
-		DAP_Data.clock_delay = delay;
-	}
+	SWJ_SetClock(clock);
 
 	*response = DAP_OK;
 #else
@@ -495,6 +560,10 @@ static uint32_t DAP_SWJ_Sequence(const uint8_t *request, uint8_t *response)
 
 #if ((DAP_SWD != 0) || (DAP_JTAG != 0))
 	SWJ_Sequence(count, request);
+#if (DAP_SWD != 0)
+	DAP_Data.swd_ap.valid = 0U; // Possibly another target after a line reset
+	DAP_Data.swd_ap.mem_ap = 0U;
+#endif
 	*response = DAP_OK;
 #else
 	*response = DAP_ERROR;
@@ -518,6 +587,7 @@ static uint32_t DAP_SWD_Configure(const uint8_t *request, uint8_t *response)
 	value = *request;
 	DAP_Data.swd_conf.turnaround = (value & 0x03U) + 1U;
 	DAP_Data.swd_conf.data_phase = (value & 0x04U) ? 1U : 0U;
+	SWD_TransferSelect();
 
 	*response = DAP_OK;
 #else
@@ -527,6 +597,72 @@ static uint32_t DAP_SWD_Configure(const uint8_t *request, uint8_t *response)
 	return ((1U << 16) | 1U);
 }
 
+// Process SWD Sequence command and prepare response
+//   request:  pointer to request data
+//   response: pointer to response data
+//   return:   number of bytes in response (lower 16 bits)
+//             number of bytes in request (upper 16 bits)
+static uint32_t DAP_SWD_Sequence(const uint8_t *request, uint8_t *response)
+{
+	uint32_t sequence_info;
+	uint32_t sequence_count;
+	uint32_t request_count;
+	uint32_t response_count;
+	uint32_t count;
+
+#if (DAP_SWD != 0)
+	*response++ = DAP_OK;
+	DAP_Data.swd_ap.valid = 0U; // Possibly another target after TARGETSEL
+	DAP_Data.swd_ap.mem_ap = 0U;
+#else
+	*response++ = DAP_ERROR;
+#endif
+	request_count = 1U;
+	response_count = 1U;
+
+	sequence_count = *request++;
+	while (sequence_count--)
+	{
+		sequence_info = *request++;
+		count = sequence_info & SWD_SEQUENCE_CLK;
+		if (count == 0U)
+		{
+			count = 64U;
+		}
+		count = (count + 7U) / 8U;
+#if (DAP_SWD != 0)
+		if (sequence_info & SWD_SEQUENCE_DIN)
+		{
+			PIN_SWDIO_OUT_DISABLE();
+		}
+		else
+		{
+			PIN_SWDIO_OUT_ENABLE();
+		}
+		SWD_Sequence(sequence_info, request, response);
+		if (sequence_count == 0U)
+		{
+			PIN_SWDIO_OUT_ENABLE();
+		}
+#endif
+		if (sequence_info & SWD_SEQUENCE_DIN)
+		{
+			request_count++;
+#if (DAP_SWD != 0)
+			response += count;
+			response_count += count;
+#endif
+		}
+		else
+		{
+			request += count;
+			request_count += count + 1U;
+		}
+	}
+
+	return ((request_count << 16) | response_count);
+}
+
 // Process JTAG Sequence command and prepare response
 //   request:  pointer to request data
 //   response: pointer to response data
@@ -668,6 +804,9 @@ static uint32_t DAP_TransferConfigure(const uint8_t *request, uint8_t *response)
 	DAP_Data.transfer.idle_cycles = *(request + 0);
 	DAP_Data.transfer.retry_count = *(request + 1) | (*(request + 2) << 8);
 	DAP_Data.transfer.match_retry = *(request + 3) | (*(request + 4) << 8);
+#if (DAP_SWD != 0)
+	SWD_TransferSelect();
+#endif
 
 	*response = DAP_OK;
 	return ((5U << 16) | 1U);
@@ -679,9 +818,165 @@ static uint32_t DAP_TransferConfigure(const uint8_t *request, uint8_t *response)
 //   return:   number of bytes in response (lower 16 bits)
 //             number of bytes in request (upper 16 bits)
 #if (DAP_SWD != 0)
+
+// MEM-AP registers and CSW fields followed in DAP_Data.swd_ap
+#define MEM_AP_CSW 0x00U
+#define MEM_AP_TAR 0x04U
+#define MEM_AP_DRW 0x0CU
+#define MEM_AP_BANK 0xF0U // SELECT APBANKSEL
+#define MEM_AP_CSW_SIZE 0x07U
+#define MEM_AP_CSW_ADDRINC 0x30U
+#define MEM_AP_CSW_SADDRINC 0x10U // Single auto-increment
+#define AP_IDR 0x0CU // IDR in bank 0xF
+#define AP_IDR_CLASS 0x0001E000U // IDR CLASS field
+#define AP_IDR_CLASS_MEM_AP 0x00010000U // CLASS = 0b1000, MEM-AP
+
+// Follow SELECT and the CSW and TAR of the selected MEM-AP through a transfer request:
+// a register the request may have changed is forgotten, a successful write (ok) recorded.
+// Reads are passed before the transfer.
+static void DAP_SWD_APTrack(uint32_t request, uint32_t data, uint32_t ok)
+{
+	uint32_t a = request & (DAP_TRANSFER_A2 | DAP_TRANSFER_A3);
+	uint32_t reg = 0U;
+
+	if ((request & DAP_TRANSFER_APnDP) == 0U)
+	{
+		if (((request & DAP_TRANSFER_RnW) == 0U) && (a == DP_SELECT))
+		{
+			// CSW and TAR stay known while the same AP is selected
+			if (!ok || ((DAP_Data.swd_ap.valid & DAP_SWD_AP_SELECT) == 0U) ||
+				((DAP_Data.swd_ap.select ^ data) & 0xFF000000U))
+			{
+				DAP_Data.swd_ap.valid = 0U;
+			}
+			if (ok)
+			{
+				DAP_Data.swd_ap.select = data;
+				DAP_Data.swd_ap.valid |= DAP_SWD_AP_SELECT;
+			}
+		}
+		return;
+	}
+
+	if (((DAP_Data.swd_ap.valid & DAP_SWD_AP_SELECT) == 0U) || (DAP_Data.swd_ap.select & MEM_AP_BANK))
+	{
+		return;
+	}
+	if (a == MEM_AP_DRW)
+	{
+		DAP_Data.swd_ap.valid &= ~DAP_SWD_AP_TAR;
+		return;
+	}
+	if (request & DAP_TRANSFER_RnW)
+	{
+		return;
+	}
+	if (a == MEM_AP_CSW)
+	{
+		DAP_Data.swd_ap.csw = data;
+		reg = DAP_SWD_AP_CSW;
+	}
+	else if (a == MEM_AP_TAR)
+	{
+		DAP_Data.swd_ap.tar = data;
+		reg = DAP_SWD_AP_TAR;
+	}
+	DAP_Data.swd_ap.valid = ok ? (DAP_Data.swd_ap.valid | reg) : (DAP_Data.swd_ap.valid & ~reg);
+}
+
+// APSEL + 1 when an AP read request reads IDR, 0 otherwise
+static uint32_t DAP_SWD_APIdr(uint32_t request)
+{
+	if (((request & (DAP_TRANSFER_APnDP | DAP_TRANSFER_RnW | DAP_TRANSFER_A2 | DAP_TRANSFER_A3)) !=
+		 (DAP_TRANSFER_APnDP | DAP_TRANSFER_RnW | AP_IDR)) ||
+		((DAP_Data.swd_ap.valid & DAP_SWD_AP_SELECT) == 0U) ||
+		((DAP_Data.swd_ap.select & MEM_AP_BANK) != MEM_AP_BANK))
+	{
+		return 0U;
+	}
+	return (DAP_Data.swd_ap.select >> 24) + 1U;
+}
+
+// Record the IDR value read from APSEL idr - 1 (idr from DAP_SWD_APIdr, 0 = no IDR read)
+static void DAP_SWD_APIdentify(uint32_t idr, uint32_t data)
+{
+	if ((idr == 0U) || (idr > 32U))
+	{
+		return;
+	}
+	if ((data & AP_IDR_CLASS) == AP_IDR_CLASS_MEM_AP)
+	{
+		DAP_Data.swd_ap.mem_ap |= 1U << (idr - 1U);
+	}
+	else
+	{
+		DAP_Data.swd_ap.mem_ap &= ~(1U << (idr - 1U));
+	}
+}
+
+// Address increment of a DRW block that continues past the TAR auto-increment wrap,
+// 0 when the selected AP has not been identified as a MEM-AP through its IDR, when
+// SELECT, CSW or TAR is unknown or CSW is not set for single auto-increment
+static uint32_t DAP_SWD_BlockIncrement(uint32_t request, uint32_t *wrap)
+{
+	const uint32_t known = DAP_SWD_AP_SELECT | DAP_SWD_AP_CSW | DAP_SWD_AP_TAR;
+
+	if (((request & (DAP_TRANSFER_APnDP | DAP_TRANSFER_A2 | DAP_TRANSFER_A3)) != (DAP_TRANSFER_APnDP | MEM_AP_DRW)) ||
+		((DAP_Data.swd_ap.valid & known) != known) ||
+		((DAP_Data.swd_ap.select & MEM_AP_BANK) != 0U) ||
+		((DAP_Data.swd_ap.select >> 24) >= 32U) ||
+		((DAP_Data.swd_ap.mem_ap & (1U << (DAP_Data.swd_ap.select >> 24))) == 0U) ||
+		((DAP_Data.swd_ap.csw & MEM_AP_CSW_ADDRINC) != MEM_AP_CSW_SADDRINC) ||
+		((DAP_Data.swd_ap.csw & MEM_AP_CSW_SIZE) > 2U))
+	{
+		return 0U;
+	}
+
+	*wrap = swd_tar_wrap((uint8_t)(DAP_Data.swd_ap.select >> 24));
+	return 1U << (DAP_Data.swd_ap.csw & MEM_AP_CSW_SIZE);
+}
+
+// Continue a DRW block at addr after TAR wrapped: the posted read of a read block is
+// collected into data through RDBUFF, TAR written and the read posted again
+static uint32_t DAP_SWD_BlockTAR(uint32_t request, uint32_t addr, uint32_t *data)
+{
+	uint32_t retry;
+	uint32_t ack;
+
+	if (request & DAP_TRANSFER_RnW)
+	{
+		retry = DAP_Data.transfer.retry_count;
+		do
+		{
+			ack = SWD_Transfer(DP_RDBUFF | DAP_TRANSFER_RnW, data);
+		} while ((ack == DAP_TRANSFER_WAIT) && retry-- && !DAP_TransferAbort);
+		if (ack != DAP_TRANSFER_OK)
+		{
+			return ack;
+		}
+	}
+
+	retry = DAP_Data.transfer.retry_count;
+	do
+	{
+		ack = SWD_Transfer(DAP_TRANSFER_APnDP | MEM_AP_TAR, &addr);
+	} while ((ack == DAP_TRANSFER_WAIT) && retry-- && !DAP_TransferAbort);
+
+	if ((ack == DAP_TRANSFER_OK) && (request & DAP_TRANSFER_RnW))
+	{
+		retry = DAP_Data.transfer.retry_count;
+		do
+		{
+			ack = SWD_Transfer(request, NULL);
+		} while ((ack == DAP_TRANSFER_WAIT) && retry-- && !DAP_TransferAbort);
+	}
+
+	return ack;
+}
+
 static uint32_t DAP_SWD_Transfer(const uint8_t *request, uint8_t *response)
 {
-	ESP_LOGD("SWD_DELAY", "DAP_SWD_Transfer");
+	DAP_TRACE_LOG("DAP_SWD_Transfer");
 	const uint8_t *request_head;
 	uint32_t request_count;
 	uint32_t request_value;
@@ -689,6 +984,7 @@ static uint32_t DAP_SWD_Transfer(const uint8_t *request, uint8_t *response)
 	uint32_t response_count;
 	uint32_t response_value;
 	uint32_t post_read;
+	uint32_t post_idr;
 	uint32_t check_write;
 	uint32_t match_value;
 	uint32_t match_retry;
@@ -705,19 +1001,21 @@ static uint32_t DAP_SWD_Transfer(const uint8_t *request, uint8_t *response)
 	DAP_TransferAbort = 0U;
 
 	post_read = 0U;
+	post_idr = 0U;
 	check_write = 0U;
 
 	request++; // Ignore DAP index
 
 	request_count = *request++;
-	ESP_LOGD("SWD_DELAY", "DAP_SWD_Transfer%d", request_count);
+	DAP_TRACE_LOG("DAP_SWD_Transfer%d", request_count);
 	for (; request_count; request_count--)
 	{
 
 		request_value = *request++;
-		ESP_LOGD("SWD_DELAY", "DAP_SWD_Transfer%d", request_value);
+		DAP_TRACE_LOG("DAP_SWD_Transfer%d", request_value);
 		if (request_value & DAP_TRANSFER_RnW)
 		{
+			DAP_SWD_APTrack(request_value, 0U, 0U);
 			// Read register
 			if (post_read)
 			{
@@ -725,7 +1023,7 @@ static uint32_t DAP_SWD_Transfer(const uint8_t *request, uint8_t *response)
 				retry = DAP_Data.transfer.retry_count;
 				if ((request_value & (DAP_TRANSFER_APnDP | DAP_TRANSFER_MATCH_VALUE)) == DAP_TRANSFER_APnDP)
 				{
-					ESP_LOGD("SWD_DELAY", "Read previous AP and post next AP read");
+					DAP_TRACE_LOG("Read previous AP and post next AP read");
 					// Read previous AP data and post next AP read
 					do
 					{
@@ -734,7 +1032,7 @@ static uint32_t DAP_SWD_Transfer(const uint8_t *request, uint8_t *response)
 				}
 				else
 				{
-					ESP_LOGD("SWD_DELAY", "Read previous AP");
+					DAP_TRACE_LOG("Read previous AP");
 					// Read previous AP data
 					do
 					{
@@ -744,7 +1042,7 @@ static uint32_t DAP_SWD_Transfer(const uint8_t *request, uint8_t *response)
 				}
 				if (response_value != DAP_TRANSFER_OK)
 				{
-					ESP_LOGD("SWD_DELAY", "DAP_TRANSFER_ERROR1");
+					DAP_TRACE_LOG("DAP_TRANSFER_ERROR1");
 					break;
 				}
 				// Store previous AP data
@@ -752,6 +1050,8 @@ static uint32_t DAP_SWD_Transfer(const uint8_t *request, uint8_t *response)
 				*response++ = (uint8_t)(data >> 8);
 				*response++ = (uint8_t)(data >> 16);
 				*response++ = (uint8_t)(data >> 24);
+				DAP_SWD_APIdentify(post_idr, data);
+				post_idr = post_read ? DAP_SWD_APIdr(request_value) : 0U;
 			}
 			if (request_value & DAP_TRANSFER_MATCH_VALUE)
 			{
@@ -813,11 +1113,12 @@ static uint32_t DAP_SWD_Transfer(const uint8_t *request, uint8_t *response)
 						} while ((response_value == DAP_TRANSFER_WAIT) && retry-- && !DAP_TransferAbort);
 						if (response_value != DAP_TRANSFER_OK)
 						{
-							ESP_LOGD("SWD_DELAY", "DAP_TRANSFER_ERROR2");
+							DAP_TRACE_LOG("DAP_TRANSFER_ERROR2");
 							break;
 						}
 
 						post_read = 1U;
+						post_idr = DAP_SWD_APIdr(request_value);
 					}
 				}
 				else
@@ -829,7 +1130,7 @@ static uint32_t DAP_SWD_Transfer(const uint8_t *request, uint8_t *response)
 					} while ((response_value == DAP_TRANSFER_WAIT) && retry-- && !DAP_TransferAbort);
 					if (response_value != DAP_TRANSFER_OK)
 					{
-						ESP_LOGD("SWD_DELAY", "DAP_TRANSFER_ERROR3");
+						DAP_TRACE_LOG("DAP_TRANSFER_ERROR3");
 						break;
 					}
 					// Store data
@@ -861,6 +1162,7 @@ static uint32_t DAP_SWD_Transfer(const uint8_t *request, uint8_t *response)
 				*response++ = (uint8_t)(data >> 8);
 				*response++ = (uint8_t)(data >> 16);
 				*response++ = (uint8_t)(data >> 24);
+				DAP_SWD_APIdentify(post_idr, data);
 				post_read = 0U;
 			}
 			// Load data
@@ -883,6 +1185,7 @@ static uint32_t DAP_SWD_Transfer(const uint8_t *request, uint8_t *response)
 				{
 					response_value = SWD_Transfer(request_value, &data);
 				} while ((response_value == DAP_TRANSFER_WAIT) && retry-- && !DAP_TransferAbort);
+				DAP_SWD_APTrack(request_value, data, response_value == DAP_TRANSFER_OK);
 				if (response_value != DAP_TRANSFER_OK)
 				{
 					break;
@@ -936,6 +1239,7 @@ static uint32_t DAP_SWD_Transfer(const uint8_t *request, uint8_t *response)
 			*response++ = (uint8_t)(data >> 8);
 			*response++ = (uint8_t)(data >> 16);
 			*response++ = (uint8_t)(data >> 24);
+			DAP_SWD_APIdentify(post_idr, data);
 		}
 		else if (check_write)
 		{
@@ -1333,6 +1637,10 @@ static uint32_t DAP_SWD_TransferBlock(const uint8_t *request, uint8_t *response)
 	uint8_t *response_head;
 	uint32_t retry;
 	uint32_t data;
+	uint32_t inc;
+	uint32_t wrap;
+	uint32_t addr;
+	uint32_t tar;
 
 	response_count = 0U;
 	response_value = 0U;
@@ -1351,6 +1659,15 @@ static uint32_t DAP_SWD_TransferBlock(const uint8_t *request, uint8_t *response)
 	}
 
 	request_value = *request++;
+
+	// DRW block past the TAR wrap boundary of a MEM-AP: TAR is written again
+	// where the auto-increment wraps, so the block continues linearly
+	wrap = 0U;
+	inc = DAP_SWD_BlockIncrement(request_value, &wrap);
+	addr = DAP_Data.swd_ap.tar;
+	tar = addr;
+	DAP_SWD_APTrack(request_value, 0U, 0U);
+
 	if (request_value & DAP_TRANSFER_RnW)
 	{
 		// Read register block
@@ -1366,6 +1683,8 @@ static uint32_t DAP_SWD_TransferBlock(const uint8_t *request, uint8_t *response)
 			{
 				goto end;
 			}
+			addr += inc;
+			tar = (tar & ~(wrap - 1U)) | ((tar + inc) & (wrap - 1U));
 		}
 		while (request_count--)
 		{
@@ -1375,11 +1694,20 @@ static uint32_t DAP_SWD_TransferBlock(const uint8_t *request, uint8_t *response)
 				// Last AP read
 				request_value = DP_RDBUFF | DAP_TRANSFER_RnW;
 			}
-			retry = DAP_Data.transfer.retry_count;
-			do
+			if ((request_count != 0U) && (tar != addr))
 			{
-				response_value = SWD_Transfer(request_value, &data);
-			} while ((response_value == DAP_TRANSFER_WAIT) && retry-- && !DAP_TransferAbort);
+				// Posted read collected through RDBUFF, next one posted at addr
+				response_value = DAP_SWD_BlockTAR(request_value, addr, &data);
+				tar = addr;
+			}
+			else
+			{
+				retry = DAP_Data.transfer.retry_count;
+				do
+				{
+					response_value = SWD_Transfer(request_value, &data);
+				} while ((response_value == DAP_TRANSFER_WAIT) && retry-- && !DAP_TransferAbort);
+			}
 			if (response_value != DAP_TRANSFER_OK)
 			{
 				goto end;
@@ -1390,6 +1718,11 @@ static uint32_t DAP_SWD_TransferBlock(const uint8_t *request, uint8_t *response)
 			*response++ = (uint8_t)(data >> 16);
 			*response++ = (uint8_t)(data >> 24);
 			response_count++;
+			if (request_count != 0U)
+			{
+				addr += inc;
+				tar = (tar & ~(wrap - 1U)) | ((tar + inc) & (wrap - 1U));
+			}
 		}
 	}
 	else
@@ -1403,6 +1736,15 @@ static uint32_t DAP_SWD_TransferBlock(const uint8_t *request, uint8_t *response)
 				   (*(request + 2) << 16) |
 				   (*(request + 3) << 24);
 			request += 4;
+			if (tar != addr)
+			{
+				response_value = DAP_SWD_BlockTAR(request_value, addr, NULL);
+				if (response_value != DAP_TRANSFER_OK)
+				{
+					goto end;
+				}
+				tar = addr;
+			}
 			// Write DP/AP register
 			retry = DAP_Data.transfer.retry_count;
 			do
@@ -1414,6 +1756,8 @@ static uint32_t DAP_SWD_TransferBlock(const uint8_t *request, uint8_t *response)
 				goto end;
 			}
 			response_count++;
+			addr += inc;
+			tar = (tar & ~(wrap - 1U)) | ((tar + inc) & (wrap - 1U));
 		}
 		// Check last write
 		retry = DAP_Data.transfer.retry_count;
@@ -1423,6 +1767,13 @@ static uint32_t DAP_SWD_TransferBlock(const uint8_t *request, uint8_t *response)
 		} while ((response_value == DAP_TRANSFER_WAIT) && retry-- && !DAP_TransferAbort);
 	}
 
+	if ((inc != 0U) && (response_value == DAP_TRANSFER_OK))
+	{
+		// TAR now known at the end of the block
+		DAP_Data.swd_ap.tar = tar;
+		DAP_Data.swd_ap.valid |= DAP_SWD_AP_TAR;
+	}
+
 end:
 	*(response_head + 0) = (uint8_t)(response_count >> 0);
 	*(response_head + 1) = (uint8_t)(response_count >> 8);
@@ -1562,6 +1913,10 @@ end:
 #endif
 
 // Process Transfer Block command and prepare response
+// With SWD a DRW block continues linearly past the TAR auto-increment wrap (TAR is
+// written again at the boundary) when SELECT, CSW and TAR were written through
+// Transfer, CSW selects single auto-increment and the AP was identified as a
+// MEM-AP by an IDR read. Otherwise TAR wraps as in the Arm reference firmware.
 //   request:  pointer to request data
 //   response: pointer to response data
 //   return:   number of bytes in response (lower 16 bits)
@@ -1688,17 +2043,62 @@ static uint32_t DAP_WriteAbort(const uint8_t *request, uint8_t *response)
 	return ((5U << 16) | num);
 }
 
-// Process DAP Vendor command request and prepare response
-// Default function (can be overridden)
-//   request:  pointer to request data
-//   response: pointer to response data
+// DAP command handler
+//   request:  pointer to request data (after the command ID)
+//   response: pointer to response data (after the command ID)
 //   return:   number of bytes in response (lower 16 bits)
 //             number of bytes in request (upper 16 bits)
-uint32_t DAP_ProcessVendorCommand(const uint8_t *request, uint8_t *response)
+typedef uint32_t (*DAP_Handler_t)(const uint8_t *request, uint8_t *response);
+
+// Adapters for handlers that take no request data
+static uint32_t DAP_DisconnectCommand(const uint8_t *request, uint8_t *response)
 {
-	*response = ID_DAP_Invalid;
-	return ((1U << 16) | 1U);
+	(void)request;
+	return DAP_Disconnect(response);
+}
+
+static uint32_t DAP_ResetTargetCommand(const uint8_t *request, uint8_t *response)
+{
+	(void)request;
+	return DAP_ResetTarget(response);
+}
+
+#if ((SWO_UART != 0) || (SWO_MANCHESTER != 0))
+static uint32_t SWO_StatusCommand(const uint8_t *request, uint8_t *response)
+{
+	(void)request;
+	return SWO_Status(response);
 }
+#endif
+
+// Command dispatch table indexed by command ID, unused IDs are NULL
+static const DAP_Handler_t DAP_HandlerTable[ID_DAP_SWD_Sequence + 1U] = {
+	[ID_DAP_HostStatus] = DAP_HostStatus,
+	[ID_DAP_Connect] = DAP_Connect,
+	[ID_DAP_Disconnect] = DAP_DisconnectCommand,
+	[ID_DAP_TransferConfigure] = DAP_TransferConfigure,
+	[ID_DAP_Transfer] = DAP_Transfer,
+	[ID_DAP_TransferBlock] = DAP_TransferBlock,
+	[ID_DAP_WriteABORT] = DAP_WriteAbort,
+	[ID_DAP_Delay] = DAP_Delay,
+	[ID_DAP_ResetTarget] = DAP_ResetTargetCommand,
+	[ID_DAP_SWJ_Pins] = DAP_SWJ_Pins,
+	[ID_DAP_SWJ_Clock] = DAP_SWJ_Clock,
+	[ID_DAP_SWJ_Sequence] = DAP_SWJ_Sequence,
+	[ID_DAP_SWD_Configure] = DAP_SWD_Configure,
+	[ID_DAP_JTAG_Sequence] = DAP_JTAG_Sequence,
+	[ID_DAP_JTAG_Configure] = DAP_JTAG_Configure,
+	[ID_DAP_JTAG_IDCODE] = DAP_JTAG_IDCode,
+#if ((SWO_UART != 0) || (SWO_MANCHESTER != 0))
+	[ID_DAP_SWO_Transport] = SWO_Transport,
+	[ID_DAP_SWO_Mode] = SWO_Mode,
+	[ID_DAP_SWO_Baudrate] = SWO_Baudrate,
+	[ID_DAP_SWO_Control] = SWO_Control,
+	[ID_DAP_SWO_Status] = SWO_StatusCommand,
+	[ID_DAP_SWO_Data] = SWO_Data,
+#endif
+	[ID_DAP_SWD_Sequence] = DAP_SWD_Sequence,
+};
 
 // Process DAP command request and prepare response
 //   request:  pointer to request data
@@ -1707,108 +2107,173 @@ uint32_t DAP_ProcessVendorCommand(const uint8_t *request, uint8_t *response)
 //             number of bytes in request (upper 16 bits)
 uint32_t DAP_ProcessCommand(const uint8_t *request, uint8_t *response)
 {
+	DAP_Handler_t handler;
 	uint32_t num;
 
 	if ((*request >= ID_DAP_Vendor0) && (*request <= ID_DAP_Vendor31))
 	{
-		return DAP_ProcessVendorCommand(request, response);
+		num = DAP_ProcessVendorCommand(request, response);
+#if (DAP_SWD != 0)
+		DAP_Data.swd_ap.valid = 0U; // Vendor commands access the target on their own
+#endif
+		return num;
 	}
 
+	DAP_TRACE_LOG("DAP_ProcessCommand %d", *request);
 	*response++ = *request;
-	ESP_LOGD("SWD_DELAY", "DAP_ProcessCommand %d", *request);
-	switch (*request++)
+
+	if (*request == ID_DAP_Info)
 	{
-	case ID_DAP_Info:
-		num = DAP_Info(*request, response + 1);
+		num = DAP_Info(*(request + 1), response + 1);
 		*response = (uint8_t)num;
 		return ((2U << 16) + 2U + num);
+	}
 
-	case ID_DAP_HostStatus:
-		num = DAP_HostStatus(request, response);
-		break;
+	handler = NULL;
+	if (*request < (sizeof(DAP_HandlerTable) / sizeof(DAP_HandlerTable[0])))
+	{
+		handler = DAP_HandlerTable[*request];
+	}
+	if (handler == NULL)
+	{
+		*(response - 1) = ID_DAP_Invalid;
+		return ((1U << 16) | 1U);
+	}
 
-	case ID_DAP_Connect:
-		num = DAP_Connect(request, response);
-		break;
-	case ID_DAP_Disconnect:
-		num = DAP_Disconnect(response);
-		break;
+	num = handler(request + 1, response);
+	return ((1U << 16) + 1U + num);
+}
 
-	case ID_DAP_Delay:
-		num = DAP_Delay(request, response);
-		break;
+#if (DAP_BENCHMARK != 0)
+// Measure the command dispatch overhead
+//   count:    number of commands to run
+//   direct:   CPU cycles for count calls of the handler through a pointer
+//   dispatch: CPU cycles for count calls through DAP_ProcessCommand
+void DAP_BenchmarkDispatch(uint32_t count, uint32_t *direct, uint32_t *dispatch)
+{
+	// Host Status with an unknown status type only answers DAP_ERROR
+	static const uint8_t request[3] = {ID_DAP_HostStatus, 0xFFU, 0x00U};
+	volatile DAP_Handler_t handler = DAP_HostStatus;
+	uint8_t response[2];
+	uint32_t start;
+	uint32_t n;
 
-	case ID_DAP_ResetTarget:
-		num = DAP_ResetTarget(response);
-		break;
+	start = CYCLE_COUNT_GET();
+	for (n = count; n != 0U; n--)
+	{
+		handler(&request[1], &response[1]);
+	}
+	*direct = CYCLE_COUNT_GET() - start;
 
-	case ID_DAP_SWJ_Pins:
+	start = CYCLE_COUNT_GET();
+	for (n = count; n != 0U; n--)
+	{
+		DAP_ProcessCommand(request, response);
+	}
+	*dispatch = CYCLE_COUNT_GET() - start;
+}
 
-		num = DAP_SWJ_Pins(request, response);
-		break;
-	case ID_DAP_SWJ_Clock:
-		num = DAP_SWJ_Clock(request, response);
-		break;
-	case ID_DAP_SWJ_Sequence:
-		num = DAP_SWJ_Sequence(request, response);
-		break;
+#if (DAP_SWD != 0)
+// Measure the cost of SWDIO turnarounds
+//   count:  number of output disable/enable pairs to run
+//   cycles: CPU cycles spent
+void DAP_BenchmarkTurnaround(uint32_t count, uint32_t *cycles)
+{
+	uint32_t start;
 
-	case ID_DAP_SWD_Configure:
-		num = DAP_SWD_Configure(request, response);
-		break;
+	start = CYCLE_COUNT_GET();
+	while (count--)
+	{
+		PIN_SWDIO_OUT_DISABLE();
+		PIN_SWDIO_OUT_ENABLE();
+	}
+	*cycles = CYCLE_COUNT_GET() - start;
+}
 
-	case ID_DAP_JTAG_Sequence:
-		num = DAP_JTAG_Sequence(request, response);
-		break;
-	case ID_DAP_JTAG_Configure:
-		num = DAP_JTAG_Configure(request, response);
-		break;
-	case ID_DAP_JTAG_IDCODE:
-		num = DAP_JTAG_IDCode(request, response);
-		break;
+// Measure the SWCLK rate achieved at fast_clock with DP IDCODE reads
+//   count:  number of transfers to run
+//   cycles: CPU cycles spent
+//   clocks: SWCLK cycles generated
+void DAP_BenchmarkSWD(uint32_t count, uint32_t *cycles, uint32_t *clocks)
+{
+	uint32_t fast_clock;
+	uint32_t trn;
+	uint32_t start;
+	uint32_t ack;
+	uint32_t data;
 
-	case ID_DAP_TransferConfigure:
-		num = DAP_TransferConfigure(request, response);
-		break;
-	case ID_DAP_Transfer:
-		num = DAP_Transfer(request, response);
-		break;
-	case ID_DAP_TransferBlock:
-		num = DAP_TransferBlock(request, response);
-		break;
+	fast_clock = DAP_Data.fast_clock;
+	DAP_Data.fast_clock = 1U;
+	SWD_TransferSelect();
+	trn = DAP_Data.swd_conf.turnaround;
 
-	case ID_DAP_WriteABORT:
-		num = DAP_WriteAbort(request, response);
-		break;
+	*clocks = 0U;
+	start = CYCLE_COUNT_GET();
+	while (count--)
+	{
+		ack = SWD_Transfer(DP_IDCODE | DAP_TRANSFER_RnW, &data);
+		// Request, turnaround and acknowledge
+		*clocks += 8U + trn + 3U;
+		if ((ack == DAP_TRANSFER_OK) || (ack == DAP_TRANSFER_ERROR))
+		{
+			*clocks += 33U + trn + DAP_Data.transfer.idle_cycles;
+		}
+		else if ((ack == DAP_TRANSFER_WAIT) || (ack == DAP_TRANSFER_FAULT))
+		{
+			*clocks += trn + (DAP_Data.swd_conf.data_phase ? 33U : 0U);
+		}
+		else
+		{
+			*clocks += trn + 33U; // Protocol error back off
+		}
+	}
+	*cycles = CYCLE_COUNT_GET() - start;
 
-#if ((SWO_UART != 0) || (SWO_MANCHESTER != 0))
-	case ID_DAP_SWO_Transport:
-		num = SWO_Transport(request, response);
-		break;
-	case ID_DAP_SWO_Mode:
-		num = SWO_Mode(request, response);
-		break;
-	case ID_DAP_SWO_Baudrate:
-		num = SWO_Baudrate(request, response);
-		break;
-	case ID_DAP_SWO_Control:
-		num = SWO_Control(request, response);
-		break;
-	case ID_DAP_SWO_Status:
-		num = SWO_Status(response);
-		break;
-	case ID_DAP_SWO_Data:
-		num = SWO_Data(request, response);
-		break;
+	DAP_Data.fast_clock = fast_clock;
+	SWD_TransferSelect();
+}
 #endif
 
-	default:
-		*(response - 1) = ID_DAP_Invalid;
-		return ((1U << 16) | 1U);
+#if (DAP_JTAG != 0)
+// Measure SWJ and JTAG sequence throughput at the current SWJ clock with a
+// 64-bit TMS run (line reset and JTAG-to-SWD switch) and a 256-bit DR scan
+// with TDO capture. Both disturb the debug port, run them while disconnected.
+//   count: number of sequences and scans to run
+//   swj:   CPU cycles for count SWJ sequences
+//   jtag:  CPU cycles for count DR scans
+void DAP_BenchmarkSequence(uint32_t count, uint32_t *swj, uint32_t *jtag)
+{
+	static const uint8_t tms[8] = {0xFFU, 0xFFU, 0xFFU, 0xFFU, 0xFFU, 0xFFU, 0x9EU, 0xE7U};
+	uint8_t tdi[32];
+	uint8_t tdo[32];
+	uint32_t start;
+	uint32_t n;
+
+	for (n = 0U; n < sizeof(tdi); n++)
+	{
+		tdi[n] = (uint8_t)(n * 0x25U);
 	}
 
-	return ((1U << 16) + 1U + num);
+	start = CYCLE_COUNT_GET();
+	for (n = count; n != 0U; n--)
+	{
+		SWJ_Sequence(64U, tms);
+	}
+	*swj = CYCLE_COUNT_GET() - start;
+
+	// Shift-DR stays in place with TMS low, 64 TCK cycles per sequence
+	start = CYCLE_COUNT_GET();
+	for (n = count; n != 0U; n--)
+	{
+		JTAG_Sequence(JTAG_SEQUENCE_TDO, &tdi[0], &tdo[0]);
+		JTAG_Sequence(JTAG_SEQUENCE_TDO, &tdi[8], &tdo[8]);
+		JTAG_Sequence(JTAG_SEQUENCE_TDO, &tdi[16], &tdo[16]);
+		JTAG_Sequence(JTAG_SEQUENCE_TDO, &tdi[24], &tdo[24]);
+	}
+	*jtag = CYCLE_COUNT_GET() - start;
 }
+#endif
+#endif
 
 // Execute DAP command (process request and prepare response)
 //   request:  pointer to request data
@@ -1842,10 +2307,13 @@ uint32_t DAP_ExecuteCommand(const uint8_t *request, uint8_t *response)
 void DAP_Setup(void)
 {
 
+	DAP_SETUP(); // Device specific setup
+
 	// Default settings
 	DAP_Data.debug_port = 0U;
-	DAP_Data.fast_clock = 0U;
-	DAP_Data.clock_delay = CLOCK_DELAY(DAP_DEFAULT_SWJ_CLOCK);
+#if ((DAP_SWD != 0) || (DAP_JTAG != 0))
+	SWJ_SetClock(DAP_DEFAULT_SWJ_CLOCK); // Calibrates the clock table on first use
+#endif
 	DAP_Data.transfer.idle_cycles = 0U;
 	DAP_Data.transfer.retry_count = 100U;
 	DAP_Data.transfer.match_retry = 0U;
@@ -1853,10 +2321,28 @@ void DAP_Setup(void)
 #if (DAP_SWD != 0)
 	DAP_Data.swd_conf.turnaround = 1U;
 	DAP_Data.swd_conf.data_phase = 0U;
+	DAP_Data.swd_ap.valid = 0U;
+	DAP_Data.swd_ap.mem_ap = 0U;
+	SWD_TransferSelect();
 #endif
 #if (DAP_JTAG != 0)
 	DAP_Data.jtag_dev.count = 0U;
 #endif
+}
 
-	DAP_SETUP(); // Device specific setup
+// Restore the DAP settings saved before code that runs DAP_Setup (SWD_host): the SPI
+// clock and the SWD transfer variant follow the saved clock and turnaround again
+void DAP_Restore(const DAP_Data_t *data)
+{
+	DAP_Data = *data;
+#if (DAP_SPI != 0)
+	if (DAP_Data.spi_clock)
+	{
+		// The frequency in effect selects the same divider again
+		DAP_Data.spi_clock = (SPI_SetClock(DAP_Data.clock_freq) != 0U) ? 1U : 0U;
+	}
+#endif
+#if (DAP_SWD != 0)
+	SWD_TransferSelect();
+#endif
 }
@@ -0,0 +1,147 @@
+/*---------------------------------------------------------------------------
+ * DAP_pins_esp32s2.c  CMSIS-DAP pin driver for the ESP32-S2
+ *
+ * Pin map with its register masks and the gang SWDIO pin table behind
+ * DAP_pins_esp32s2.h. Only built when DAP_PIN_DRIVER is DAP_PIN_DRIVER_ESP32S2.
+ *---------------------------------------------------------------------------*/
+#include "DAP_config.h"
+
+#if (DAP_PIN_DRIVER == DAP_PIN_DRIVER_ESP32S2)
+
+#include "nvs.h"
+#include "esp_partition.h"
+
+// PIN_SWDIO_OUT and PIN_TDI_OUT select the set/clear register from the bit value
+_Static_assert((GPIO_OUT_W1TC_REG - GPIO_OUT_W1TS_REG) == 4, "GPIO_OUT_W1TS/W1TC layout");
+
+// Pins driven and read through the GPIO0..31 registers
+#define PIN_IS_BANK0_OUTPUT(pin) (((pin) < 32) && GPIO_IS_VALID_OUTPUT_GPIO(pin))
+
+_Static_assert(PIN_IS_BANK0_OUTPUT(CONFIG_DAP_PIN_SWCLK), "SWCLK has to be an output in GPIO0..31");
+_Static_assert(PIN_IS_BANK0_OUTPUT(CONFIG_DAP_PIN_SWDIO), "SWDIO has to be an output in GPIO0..31");
+_Static_assert(PIN_IS_BANK0_OUTPUT(CONFIG_DAP_PIN_TDI), "TDI has to be an output in GPIO0..31");
+
+static const char *TAG = "DAP_pins";
+
+// Kconfig pin map, valid before DAP_PinsLoad runs
+DAP_Pins_t DAP_Pins = {
+	.swclk = CONFIG_DAP_PIN_SWCLK,
+	.swdio = CONFIG_DAP_PIN_SWDIO,
+	.tdi = CONFIG_DAP_PIN_TDI,
+	.tdo = CONFIG_DAP_PIN_TDO,
+	.nreset = CONFIG_DAP_PIN_NRESET,
+	.led_connected = CONFIG_DAP_PIN_LED_CONNECTED,
+	.led_running = CONFIG_DAP_PIN_LED_RUNNING,
+	.tdo_bit = CONFIG_DAP_PIN_TDO & 31,
+	.swclk_mask = 1U << CONFIG_DAP_PIN_SWCLK,
+	.swdio_mask = 1U << CONFIG_DAP_PIN_SWDIO,
+	.tdi_mask = 1U << CONFIG_DAP_PIN_TDI,
+	.tdo_in = (CONFIG_DAP_PIN_TDO < 32) ? GPIO_IN_REG : GPIO_IN1_REG,
+};
+
+#if (DAP_GANG != 0)
+uint8_t DAP_GangPins[] = PIN_GANG_SWDIO;
+_Static_assert(sizeof(DAP_GangPins) == DAP_GANG_CNT, "PIN_GANG_SWDIO lists DAP_GANG_CNT pins");
+#endif
+
+#ifdef CONFIG_DAP_PIN_NVS
+// Pin functions, checked before an NVS entry replaces the Kconfig pin
+#define PIN_USE_BANK0 0U  // SWCLK, SWDIO, TDI
+#define PIN_USE_OUTPUT 1U // nRESET, LEDs
+#define PIN_USE_INPUT 2U  // TDO
+
+static uint32_t DAP_PinValid(uint32_t pin, uint32_t use)
+{
+	switch (use)
+	{
+	case PIN_USE_BANK0:
+		return PIN_IS_BANK0_OUTPUT(pin);
+	case PIN_USE_OUTPUT:
+		return GPIO_IS_VALID_OUTPUT_GPIO(pin);
+	}
+	return GPIO_IS_VALID_GPIO(pin);
+}
+
+// Replace a pin with its NVS entry when there is a usable one
+static void DAP_PinsRead(nvs_handle_t nvs, const char *key, uint8_t *pin, uint32_t use)
+{
+	uint8_t val;
+
+	if (nvs_get_u8(nvs, key, &val) != ESP_OK)
+	{
+		return;
+	}
+	if (!DAP_PinValid(val, use))
+	{
+		ESP_LOGW(TAG, "%s: GPIO%u not usable, keeping GPIO%u", key, val, *pin);
+		return;
+	}
+	*pin = val;
+}
+#endif
+
+void DAP_PinsLoad(void)
+{
+	DAP_Pins_t *p = &DAP_Pins;
+
+	p->swclk = CONFIG_DAP_PIN_SWCLK;
+	p->swdio = CONFIG_DAP_PIN_SWDIO;
+	p->tdi = CONFIG_DAP_PIN_TDI;
+	p->tdo = CONFIG_DAP_PIN_TDO;
+	p->nreset = CONFIG_DAP_PIN_NRESET;
+	p->led_connected = CONFIG_DAP_PIN_LED_CONNECTED;
+	p->led_running = CONFIG_DAP_PIN_LED_RUNNING;
+
+#ifdef CONFIG_DAP_PIN_NVS
+	nvs_handle_t nvs;
+
+	// NVS is initialized by the application first, no namespace = Kconfig pins
+	if (nvs_open(DAP_PINS_NVS_NAMESPACE, NVS_READONLY, &nvs) == ESP_OK)
+	{
+		DAP_PinsRead(nvs, "swclk", &p->swclk, PIN_USE_BANK0);
+		DAP_PinsRead(nvs, "swdio", &p->swdio, PIN_USE_BANK0);
+		DAP_PinsRead(nvs, "tdi", &p->tdi, PIN_USE_BANK0);
+		DAP_PinsRead(nvs, "tdo", &p->tdo, PIN_USE_INPUT);
+		DAP_PinsRead(nvs, "nreset", &p->nreset, PIN_USE_OUTPUT);
+		DAP_PinsRead(nvs, "led_con", &p->led_connected, PIN_USE_OUTPUT);
+		DAP_PinsRead(nvs, "led_run", &p->led_running, PIN_USE_OUTPUT);
+		nvs_close(nvs);
+	}
+#endif
+
+	p->tdo_bit = p->tdo & 31;
+	p->swclk_mask = 1U << p->swclk;
+	p->swdio_mask = 1U << p->swdio;
+	p->tdi_mask = 1U << p->tdi;
+	p->tdo_in = (p->tdo < 32) ? GPIO_IN_REG : GPIO_IN1_REG;
+
+#if (DAP_GANG != 0)
+	DAP_GangPins[0] = p->swdio;
+#endif
+
+	ESP_LOGI(TAG, "SWCLK %u SWDIO %u TDI %u TDO %u nRESET %u", p->swclk, p->swdio, p->tdi, p->tdo, p->nreset);
+}
+
+// Mapping of the FLM store while an algorithm is parsed
+static spi_flash_mmap_handle_t flm_store_handle;
+
+const void *DAP_FlmStoreMap(uint32_t *size)
+{
+	const esp_partition_t *part;
+	const void *store;
+
+	part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, "storage");
+	if ((part == NULL) || (esp_partition_mmap(part, 0, part->size, SPI_FLASH_MMAP_DATA, &store, &flm_store_handle) != ESP_OK))
+	{
+		return NULL;
+	}
+	*size = part->size;
+	return store;
+}
+
+void DAP_FlmStoreUnmap(void)
+{
+	spi_flash_munmap(flm_store_handle);
+}
+
+#endif
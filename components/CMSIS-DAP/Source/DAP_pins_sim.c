@@ -0,0 +1,161 @@
+/*---------------------------------------------------------------------------
+ * DAP_pins_sim.c  CMSIS-DAP pin driver for a host simulation
+ *
+ * Clock edge handling, gang models and trace recording behind
+ * DAP_pins_sim.h. Only built when DAP_PIN_DRIVER is DAP_PIN_DRIVER_SIM.
+ *---------------------------------------------------------------------------*/
+#include "DAP_config.h"
+#include "DAP.h"
+
+#if (DAP_PIN_DRIVER == DAP_PIN_DRIVER_SIM)
+
+dap_sim_pins_t dap_sim_pins;
+
+static dap_sim_model_t sim_model;
+static dap_sim_model_t sim_gang[DAP_GANG_CNT];
+
+static const void *sim_flm_store;
+static uint32_t sim_flm_store_size;
+
+// Attach a target model, NULL detaches it (target then drives SWDIO/TDO high)
+void dap_sim_attach(const dap_sim_model_t *model)
+{
+	if (model != NULL)
+	{
+		sim_model = *model;
+	}
+	else
+	{
+		sim_model.ctx = NULL;
+		sim_model.clock = NULL;
+		sim_model.reset = NULL;
+	}
+	dap_sim_pins.target = 1U;
+}
+
+// Attach a model to the SWDIO line of gang target n, NULL detaches it
+void dap_sim_gang_attach(uint32_t n, const dap_sim_model_t *model)
+{
+	if (n >= DAP_GANG_CNT)
+	{
+		return;
+	}
+	if (model != NULL)
+	{
+		sim_gang[n] = *model;
+	}
+	else
+	{
+		sim_gang[n].ctx = NULL;
+		sim_gang[n].clock = NULL;
+		sim_gang[n].reset = NULL;
+	}
+	dap_sim_pins.gang_target |= 1U << n;
+}
+
+// Use store as the FLM store (storage partition), NULL removes it
+void dap_sim_flm_store(const void *store, uint32_t size)
+{
+	sim_flm_store = store;
+	sim_flm_store_size = (store != NULL) ? size : 0U;
+}
+
+const void *DAP_FlmStoreMap(uint32_t *size)
+{
+	*size = sim_flm_store_size;
+	return sim_flm_store;
+}
+
+void DAP_FlmStoreUnmap(void)
+{
+}
+
+// Record rising edges into buf, NULL stops recording
+void dap_sim_trace(uint8_t *buf, uint32_t size)
+{
+	dap_sim_pins.trace = buf;
+	dap_sim_pins.trace_size = (buf != NULL) ? size : 0U;
+	dap_sim_pins.trace_count = 0U;
+}
+
+// Rising SWCLK/TCK edge
+void dap_sim_clock(void)
+{
+	uint8_t rec;
+	uint32_t n;
+
+	dap_sim_pins.edges++;
+	if (sim_model.clock != NULL)
+	{
+		dap_sim_pins.target = (uint8_t)(sim_model.clock(sim_model.ctx,
+														dap_sim_pins.swdio,
+														dap_sim_pins.swdio_oe,
+														dap_sim_pins.tdi) &
+										1U);
+	}
+	for (n = 0U; n < DAP_GANG_CNT; n++)
+	{
+		if (sim_gang[n].clock != NULL)
+		{
+			if (sim_gang[n].clock(sim_gang[n].ctx,
+								  (dap_sim_pins.gang_swdio >> n) & 1U,
+								  (dap_sim_pins.gang_oe >> n) & 1U,
+								  dap_sim_pins.tdi) &
+				1U)
+			{
+				dap_sim_pins.gang_target |= 1U << n;
+			}
+			else
+			{
+				dap_sim_pins.gang_target &= ~(1U << n);
+			}
+		}
+	}
+
+	if (dap_sim_pins.trace_count < dap_sim_pins.trace_size)
+	{
+		rec = 0U;
+		if (dap_sim_pins.swdio)
+		{
+			rec |= DAP_SIM_TRACE_SWDIO;
+		}
+		if (dap_sim_pins.swdio_oe)
+		{
+			rec |= DAP_SIM_TRACE_SWDIO_OE;
+		}
+		if (dap_sim_pins.tdi)
+		{
+			rec |= DAP_SIM_TRACE_TDI;
+		}
+		if (dap_sim_pins.target)
+		{
+			rec |= DAP_SIM_TRACE_TARGET;
+		}
+		dap_sim_pins.trace[dap_sim_pins.trace_count++] = rec;
+	}
+}
+
+// nRESET output
+void dap_sim_reset(uint32_t nreset)
+{
+	uint32_t n;
+
+	if (dap_sim_pins.nreset != nreset)
+	{
+		dap_sim_pins.nreset = (uint8_t)nreset;
+		if (sim_model.reset != NULL)
+		{
+			sim_model.reset(sim_model.ctx, nreset);
+		}
+		// nRESET is shared by the gang targets
+		for (n = 0U; n < DAP_GANG_CNT; n++)
+		{
+			if (sim_gang[n].reset != NULL)
+			{
+				sim_gang[n].reset(sim_gang[n].ctx, nreset);
+			}
+		}
+	}
+}
+
+#endif
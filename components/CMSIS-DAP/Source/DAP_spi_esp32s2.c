@@ -0,0 +1,221 @@
+/*---------------------------------------------------------------------------
+ * DAP_spi_esp32s2.c  SPI shift engine on the ESP32-S2 GP-SPI (SPI2)
+ *
+ * Implements DAP_spi.h. SWDIO and TDO are connected to the SPI data inputs
+ * once; SWCLK/TCK and SWDIO or TDI are switched between the SPI outputs and
+ * the GPIO through the GPIO matrix around every shift. The output enable of
+ * the pins always comes from the GPIO_ENABLE register so the SWDIO direction
+ * keeps being switched by the bit-bang turnaround. Only built when
+ * DAP_PIN_DRIVER is DAP_PIN_DRIVER_ESP32S2 and DAP_SPI is enabled.
+ *---------------------------------------------------------------------------*/
+#include "DAP_config.h"
+#include "DAP.h"
+
+#if (DAP_PIN_DRIVER == DAP_PIN_DRIVER_ESP32S2) && (DAP_SPI != 0)
+
+#include "driver/spi_master.h"
+#include "soc/spi_periph.h"
+#include "soc/gpio_sig_map.h"
+#include "hal/spi_ll.h"
+
+#define SPI_HOST_ID SPI2_HOST
+
+// Data buffer of the peripheral holds 18 words, shifts are split into 64 byte chunks
+#define SPI_CHUNK_BITS 512U
+
+// Clock range: the slowest divider, and the GPIO matrix limit for sampling without dummy cycles
+#define SPI_MIN_CLOCK (APB_CLK_FREQ / (8192U * 64U))
+#define SPI_MAX_CLOCK 10000000U
+
+// Shift modes
+#define SPI_MODE_NONE 0U
+#define SPI_MODE_SWD_WRITE 1U // Half duplex, SWDIO output
+#define SPI_MODE_SWD_READ 2U  // Half duplex, SWDIO input (3-wire)
+#define SPI_MODE_JTAG 3U	  // Full duplex, TDI output and TDO input
+
+// Engine state
+#define SPI_STATE_INIT 0U		 // Not initialized yet
+#define SPI_STATE_READY 1U		 // Peripheral claimed
+#define SPI_STATE_UNAVAILABLE 2U // Bus already in use, bit-bang only
+
+static spi_dev_t *spi_hw;
+static uint8_t spi_state = SPI_STATE_INIT;
+static uint8_t spi_mode = SPI_MODE_NONE;
+
+// Connect a pin output to a peripheral signal (SIG_GPIO_OUT_IDX = GPIO),
+// output enable from GPIO_ENABLE
+static inline void SPI_Route(uint32_t pin, uint32_t signal)
+{
+	REG_WRITE(GPIO_FUNC0_OUT_SEL_CFG_REG + (pin * 4U), signal | GPIO_FUNC0_OEN_SEL);
+}
+
+// Claim SPI2 and set up the fixed part of the configuration
+static uint32_t SPI_Init(void)
+{
+	spi_bus_config_t bus = {
+		.mosi_io_num = -1,
+		.miso_io_num = -1,
+		.sclk_io_num = -1,
+		.quadwp_io_num = -1,
+		.quadhd_io_num = -1,
+		.max_transfer_sz = SPI_CHUNK_BITS / 8U,
+	};
+
+	if (spi_bus_initialize(SPI_HOST_ID, &bus, 0) != ESP_OK)
+	{
+		return (0U);
+	}
+
+	spi_hw = spi_periph_signal[SPI_HOST_ID].hw;
+	spi_ll_master_init(spi_hw);
+	spi_ll_master_set_mode(spi_hw, 3U);
+	spi_ll_set_tx_lsbfirst(spi_hw, true);
+	spi_ll_set_rx_lsbfirst(spi_hw, true);
+	spi_ll_set_command_bitlen(spi_hw, 0);
+	spi_ll_set_addr_bitlen(spi_hw, 0);
+	spi_ll_set_dummy(spi_hw, 0);
+
+	gpio_matrix_in(PIN_SWDIO, spi_periph_signal[SPI_HOST_ID].spid_in, false);
+	gpio_matrix_in(PIN_TDO, spi_periph_signal[SPI_HOST_ID].spiq_in, false);
+
+	return (1U);
+}
+
+// Select the shift mode, registers are only written when it changes
+static inline void SPI_Mode(uint32_t mode)
+{
+	if (spi_mode == mode)
+	{
+		return;
+	}
+	spi_mode = (uint8_t)mode;
+
+	spi_ll_set_half_duplex(spi_hw, mode != SPI_MODE_JTAG);
+	spi_ll_set_sio_mode(spi_hw, mode == SPI_MODE_SWD_READ);
+	spi_ll_enable_mosi(spi_hw, mode != SPI_MODE_SWD_READ);
+	spi_ll_enable_miso(spi_hw, mode != SPI_MODE_SWD_WRITE);
+}
+
+// Run one transaction and wait for its end
+static inline void SPI_Run(void)
+{
+	spi_ll_user_start(spi_hw);
+	while (!spi_ll_usr_is_done(spi_hw))
+	{
+	}
+}
+
+uint32_t SPI_SetClock(uint32_t clock)
+{
+	spi_ll_clock_val_t reg;
+	uint32_t request;
+	uint32_t freq;
+
+	if (spi_state == SPI_STATE_INIT)
+	{
+		spi_state = SPI_Init() ? SPI_STATE_READY : SPI_STATE_UNAVAILABLE;
+	}
+	if ((spi_state != SPI_STATE_READY) || (clock < SPI_MIN_CLOCK))
+	{
+		return (0U);
+	}
+	if (clock > SPI_MAX_CLOCK)
+	{
+		clock = SPI_MAX_CLOCK;
+	}
+
+	// The divider search picks the nearest clock, step down until it is not above the request
+	request = clock;
+	freq = (uint32_t)spi_ll_master_cal_clock(APB_CLK_FREQ, (int)request, 128, &reg);
+	while ((freq > clock) && (request > SPI_MIN_CLOCK))
+	{
+		request -= freq - clock;
+		freq = (uint32_t)spi_ll_master_cal_clock(APB_CLK_FREQ, (int)request, 128, &reg);
+	}
+	if (freq > clock)
+	{
+		return (0U);
+	}
+
+	spi_ll_master_set_clock_by_reg(spi_hw, &reg);
+	return (freq);
+}
+
+// Level of the last bit of a stream, left on the GPIO output when the pin is handed back
+#define SPI_LAST_BIT(data, bits) ((data)[((bits)-1U) / 8U] >> (((bits)-1U) % 8U))
+
+void SPI_SWD_Write(const uint8_t *data, uint32_t bits)
+{
+	uint32_t n;
+
+	if (bits == 0U)
+	{
+		return;
+	}
+	PIN_SWDIO_OUT(SPI_LAST_BIT(data, bits));
+	SPI_Mode(SPI_MODE_SWD_WRITE);
+	SPI_Route(PIN_SWCLK, spi_periph_signal[SPI_HOST_ID].spiclk_out);
+	SPI_Route(PIN_SWDIO, spi_periph_signal[SPI_HOST_ID].spid_out);
+	while (bits)
+	{
+		n = (bits > SPI_CHUNK_BITS) ? SPI_CHUNK_BITS : bits;
+		spi_ll_write_buffer(spi_hw, data, n);
+		spi_ll_set_mosi_bitlen(spi_hw, n);
+		SPI_Run();
+		data += n / 8U;
+		bits -= n;
+	}
+	SPI_Route(PIN_SWDIO, SIG_GPIO_OUT_IDX);
+	SPI_Route(PIN_SWCLK, SIG_GPIO_OUT_IDX);
+}
+
+void SPI_SWD_Read(uint8_t *data, uint32_t bits)
+{
+	uint32_t n;
+
+	SPI_Mode(SPI_MODE_SWD_READ);
+	SPI_Route(PIN_SWCLK, spi_periph_signal[SPI_HOST_ID].spiclk_out);
+	while (bits)
+	{
+		n = (bits > SPI_CHUNK_BITS) ? SPI_CHUNK_BITS : bits;
+		spi_ll_set_miso_bitlen(spi_hw, n);
+		SPI_Run();
+		spi_ll_read_buffer(spi_hw, data, n);
+		data += n / 8U;
+		bits -= n;
+	}
+	SPI_Route(PIN_SWCLK, SIG_GPIO_OUT_IDX);
+}
+
+void SPI_JTAG_Shift(const uint8_t *tdi, uint8_t *tdo, uint32_t bits)
+{
+	uint32_t n;
+
+	if (bits == 0U)
+	{
+		return;
+	}
+	PIN_TDI_OUT(SPI_LAST_BIT(tdi, bits));
+	SPI_Mode(SPI_MODE_JTAG);
+	SPI_Route(PIN_SWCLK, spi_periph_signal[SPI_HOST_ID].spiclk_out);
+	SPI_Route(PIN_TDI, spi_periph_signal[SPI_HOST_ID].spid_out);
+	while (bits)
+	{
+		n = (bits > SPI_CHUNK_BITS) ? SPI_CHUNK_BITS : bits;
+		spi_ll_write_buffer(spi_hw, tdi, n);
+		spi_ll_set_mosi_bitlen(spi_hw, n);
+		spi_ll_set_miso_bitlen(spi_hw, n);
+		SPI_Run();
+		if (tdo != NULL)
+		{
+			spi_ll_read_buffer(spi_hw, tdo, n);
+			tdo += n / 8U;
+		}
+		tdi += n / 8U;
+		bits -= n;
+	}
+	SPI_Route(PIN_TDI, SIG_GPIO_OUT_IDX);
+	SPI_Route(PIN_SWCLK, SIG_GPIO_OUT_IDX);
+}
+
+#endif
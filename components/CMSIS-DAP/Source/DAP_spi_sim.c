@@ -0,0 +1,87 @@
+/*---------------------------------------------------------------------------
+ * DAP_spi_sim.c  SPI shift engine for the host simulation
+ *
+ * Implements DAP_spi.h on the simulated pins the way the SPI peripheral
+ * shifts in mode 3, one clock per bit: data out after the falling edge, data
+ * in sampled at the rising edge. Bits shifted here are counted in
+ * dap_sim_pins.spi_bits so tests can tell which I/O path produced a trace.
+ * Only built when DAP_PIN_DRIVER is DAP_PIN_DRIVER_SIM and DAP_SPI is enabled.
+ *---------------------------------------------------------------------------*/
+#include "DAP_config.h"
+#include "DAP.h"
+
+#if (DAP_PIN_DRIVER == DAP_PIN_DRIVER_SIM) && (DAP_SPI != 0)
+
+// Same divider range as the ESP32-S2 GP-SPI clocked from an 80 MHz APB
+#define SPI_MIN_CLOCK (80000000U / (8192U * 64U))
+#define SPI_MAX_CLOCK 10000000U
+
+// Data output of a shift
+#define SPI_OUT_SWDIO 0U
+#define SPI_OUT_TDI 1U
+#define SPI_OUT_NONE 2U
+
+static void SPI_Shift(const uint8_t *out, uint8_t *in, uint32_t bits, uint32_t pin)
+{
+	uint32_t n;
+	uint32_t bit;
+
+	for (n = 0U; n < bits; n++)
+	{
+		dap_sim_pins.swclk = 0U;
+		if (pin != SPI_OUT_NONE)
+		{
+			bit = (out[n / 8U] >> (n % 8U)) & 1U;
+			if (pin == SPI_OUT_SWDIO)
+			{
+				dap_sim_pins.swdio = (uint8_t)bit;
+			}
+			else
+			{
+				dap_sim_pins.tdi = (uint8_t)bit;
+			}
+		}
+		if (in != NULL)
+		{
+			bit = (pin == SPI_OUT_TDI) ? dap_sim_pins.target : PIN_SWDIO_IN();
+			if ((n % 8U) == 0U)
+			{
+				in[n / 8U] = 0U;
+			}
+			in[n / 8U] |= (uint8_t)(bit << (n % 8U));
+		}
+		dap_sim_pins.swclk = 1U;
+		dap_sim_clock();
+	}
+	dap_sim_pins.spi_bits += bits;
+}
+
+uint32_t SPI_SetClock(uint32_t clock)
+{
+	if (clock < SPI_MIN_CLOCK)
+	{
+		return (0U);
+	}
+	if (clock > SPI_MAX_CLOCK)
+	{
+		clock = SPI_MAX_CLOCK;
+	}
+	return (clock);
+}
+
+void SPI_SWD_Write(const uint8_t *data, uint32_t bits)
+{
+	SPI_Shift(data, NULL, bits, SPI_OUT_SWDIO);
+}
+
+void SPI_SWD_Read(uint8_t *data, uint32_t bits)
+{
+	SPI_Shift(NULL, data, bits, SPI_OUT_NONE);
+}
+
+void SPI_JTAG_Shift(const uint8_t *tdi, uint8_t *tdo, uint32_t bits)
+{
+	SPI_Shift(tdi, tdo, bits, SPI_OUT_TDI);
+}
+
+#endif
@@ -0,0 +1,878 @@
+/*---------------------------------------------------------------------------
+ * DAP_target_sim.c  ADIv5 SW-DP / MEM-AP target model for the host simulation
+ *
+ * The model sees one call per rising SWCLK edge. It samples the bit the
+ * probe drives in that cycle and returns the level it drives itself in the
+ * next cycle, which is where SW_READ_BIT samples it. Only built when
+ * DAP_PIN_DRIVER is DAP_PIN_DRIVER_SIM.
+ *---------------------------------------------------------------------------*/
+#include <string.h>
+#include "DAP_config.h"
+#include "DAP.h"
+
+#if (DAP_PIN_DRIVER == DAP_PIN_DRIVER_SIM)
+
+#include "DAP_target_sim.h"
+
+// Protocol phases
+#define PHASE_IDLE 0U	  // Waiting for a start bit
+#define PHASE_REQUEST 1U  // Receiving the request header
+#define PHASE_RESPONSE 2U // Turnaround, acknowledge and data phase
+
+#define ACK_NONE 7U		 // No response, the line floats high
+#define ACK_TARGETSEL 8U // TARGETSEL write: no response, data phase received
+
+// Dormant state sequences, bits in transmission order from bit 0
+#define SEQ_SWD_TO_DORMANT 0xE3BCU
+#define SEQ_ALERT_LO 0x86852D956209F392ULL
+#define SEQ_ALERT_HI 0x19BC0EA2E3DDAFE9ULL
+#define SEQ_ACTIVATE_SWD 0x1A0U // 4 cycles low and the activation code 0x1A
+#define SEQ_ACTIVATE_BITS 12U
+
+#define SIM_BUS_MAX 8U // Targets on a multi-drop bus
+
+// CTRL/STAT bits
+#define CS_ORUNDETECT (1U << 0)
+#define CS_STICKYORUN (1U << 1)
+#define CS_STICKYCMP (1U << 4)
+#define CS_STICKYERR (1U << 5)
+#define CS_WDATAERR (1U << 7)
+#define CS_CDBGPWRUPREQ (1U << 28)
+#define CS_CDBGPWRUPACK (1U << 29)
+#define CS_CSYSPWRUPREQ (1U << 30)
+#define CS_CSYSPWRUPACK (1U << 31)
+#define CS_STICKY (CS_STICKYORUN | CS_STICKYCMP | CS_STICKYERR | CS_WDATAERR)
+#define CS_ACK (CS_CDBGPWRUPACK | CS_CSYSPWRUPACK)
+
+// ABORT bits
+#define ABORT_DAPABORT (1U << 0)
+#define ABORT_STKCMPCLR (1U << 1)
+#define ABORT_STKERRCLR (1U << 2)
+#define ABORT_WDERRCLR (1U << 3)
+#define ABORT_ORUNERRCLR (1U << 4)
+
+// MEM-AP registers
+#define AP_CSW 0x00U
+#define AP_TAR 0x04U
+#define AP_DRW 0x0CU
+#define AP_BD0 0x10U
+#define AP_BD3 0x1CU
+#define AP_CFG 0xF4U
+#define AP_BASE 0xF8U
+#define AP_IDR 0xFCU
+
+#define CSW_SIZE_MASK 0x07U
+#define CSW_ADDRINC_MASK 0x30U
+#define CSW_DEVICEEN (1U << 6)
+
+// System control space
+#define SCS_CPUID 0xE000ED00U
+#define SCS_AIRCR 0xE000ED0CU
+#define SCS_DHCSR 0xE000EDF0U
+#define SCS_DCRSR 0xE000EDF4U
+#define SCS_DCRDR 0xE000EDF8U
+#define SCS_DEMCR 0xE000EDFCU
+
+#define DHCSR_C_DEBUGEN (1U << 0)
+#define DHCSR_C_HALT (1U << 1)
+#define DHCSR_C_MASK 0x2FU
+#define DHCSR_S_REGRDY (1U << 16)
+#define DHCSR_S_HALT (1U << 17)
+#define DHCSR_S_RESET_ST (1U << 25)
+#define DHCSR_DBGKEY 0xA05FU
+#define DCRSR_REGWnR (1U << 16)
+#define DEMCR_VC_CORERESET (1U << 0)
+#define AIRCR_VECTKEY 0x05FAU
+#define AIRCR_SYSRESETREQ (1U << 2)
+#define AIRCR_VECTRESET (1U << 0)
+
+static uint32_t sim_parity(uint32_t val)
+{
+	return (uint32_t)__builtin_popcount(val) & 1U;
+}
+
+// Reset the core as done by nRESET or AIRCR
+static void sim_core_reset(dap_target_sim_t *t)
+{
+	if (t->demcr & DEMCR_VC_CORERESET)
+	{
+		t->dhcsr |= DHCSR_C_HALT;
+	}
+	else
+	{
+		t->dhcsr &= ~DHCSR_C_HALT;
+	}
+	t->dhcsr |= DHCSR_S_RESET_ST;
+	t->running = 0U;
+}
+
+// Word access to the system control space
+//   return: 1 when addr is a modelled register
+static uint32_t sim_scs_read(dap_target_sim_t *t, uint32_t addr, uint32_t *val)
+{
+	switch (addr)
+	{
+	case SCS_CPUID:
+		*val = t->cpuid;
+		return 1U;
+	case SCS_AIRCR:
+		*val = 0xFA050000U;
+		return 1U;
+	case SCS_DHCSR:
+		*val = (t->dhcsr & (DHCSR_C_MASK | DHCSR_S_RESET_ST)) | DHCSR_S_REGRDY;
+		if ((t->dhcsr & (DHCSR_C_DEBUGEN | DHCSR_C_HALT)) == (DHCSR_C_DEBUGEN | DHCSR_C_HALT))
+		{
+			*val |= DHCSR_S_HALT;
+		}
+		t->dhcsr &= ~DHCSR_S_RESET_ST; // Cleared on read
+		return 1U;
+	case SCS_DCRSR:
+		*val = 0U; // Write only
+		return 1U;
+	case SCS_DCRDR:
+		*val = t->dcrdr;
+		return 1U;
+	case SCS_DEMCR:
+		*val = t->demcr;
+		return 1U;
+	}
+	return 0U;
+}
+
+static uint32_t sim_scs_write(dap_target_sim_t *t, uint32_t addr, uint32_t val)
+{
+	uint32_t halted;
+
+	switch (addr)
+	{
+	case SCS_CPUID:
+		return 1U;
+	case SCS_AIRCR:
+		if (((val >> 16) == AIRCR_VECTKEY) && (val & (AIRCR_SYSRESETREQ | AIRCR_VECTRESET)))
+		{
+			sim_core_reset(t);
+		}
+		return 1U;
+	case SCS_DHCSR:
+		if ((val >> 16) == DHCSR_DBGKEY)
+		{
+			halted = t->dhcsr & DHCSR_C_HALT;
+			t->dhcsr = (t->dhcsr & ~DHCSR_C_MASK) | (val & DHCSR_C_MASK);
+			if (t->dhcsr & DHCSR_C_HALT)
+			{
+				t->running = 0U; // Halted before the emulated code ends
+			}
+			if (halted && ((t->dhcsr & (DHCSR_C_DEBUGEN | DHCSR_C_HALT)) == DHCSR_C_DEBUGEN) &&
+				(t->run != NULL))
+			{
+				t->running = t->run_time;
+				if ((t->running == 0U) && t->run(t))
+				{
+					t->dhcsr |= DHCSR_C_HALT;
+				}
+			}
+		}
+		return 1U;
+	case SCS_DCRSR:
+		if (val & DCRSR_REGWnR)
+		{
+			t->reg[val & 0x7FU] = t->dcrdr;
+		}
+		else
+		{
+			t->dcrdr = t->reg[val & 0x7FU];
+		}
+		return 1U;
+	case SCS_DCRDR:
+		t->dcrdr = val;
+		return 1U;
+	case SCS_DEMCR:
+		t->demcr = val;
+		return 1U;
+	}
+	return 0U;
+}
+
+static dap_target_sim_region_t *sim_region(dap_target_sim_t *t, uint32_t addr)
+{
+	uint32_t n;
+
+	for (n = 0U; n < DAP_TARGET_SIM_REGIONS; n++)
+	{
+		if ((t->region[n].size != 0U) && ((addr - t->region[n].base) < t->region[n].size))
+		{
+			return &t->region[n];
+		}
+	}
+	return NULL;
+}
+
+// Time of the code started by a resume passes with the MEM-AP accesses
+static void sim_core_step(dap_target_sim_t *t)
+{
+	if ((t->running != 0U) && (--t->running == 0U) && t->run(t))
+	{
+		t->dhcsr |= DHCSR_C_HALT;
+	}
+}
+
+// Memory access of the MEM-AP, data is placed on the byte lanes of addr
+//   return: 0 on bus fault
+static uint32_t sim_bus_read(dap_target_sim_t *t, uint32_t addr, uint32_t size, uint32_t *data)
+{
+	dap_target_sim_region_t *r;
+	uint32_t val;
+	uint32_t n;
+
+	sim_core_step(t);
+	t->stats.bus_rd++;
+	if ((t->fault_after != 0U) && (--t->fault_after == 0U))
+	{
+		return 0U;
+	}
+	if (sim_scs_read(t, addr & ~3U, &val))
+	{
+		*data = val;
+		return 1U;
+	}
+	*data = 0U;
+	for (n = 0U; n < (1U << size); n++)
+	{
+		r = sim_region(t, addr + n);
+		if (r == NULL)
+		{
+			return 0U;
+		}
+		*data |= (uint32_t)r->mem[addr + n - r->base] << (((addr + n) & 3U) * 8U);
+	}
+	return 1U;
+}
+
+static uint32_t sim_bus_write(dap_target_sim_t *t, uint32_t addr, uint32_t size, uint32_t data)
+{
+	dap_target_sim_region_t *r;
+	uint32_t n;
+
+	sim_core_step(t);
+	t->stats.bus_wr++;
+	if ((t->fault_after != 0U) && (--t->fault_after == 0U))
+	{
+		return 0U;
+	}
+	if (sim_scs_write(t, addr & ~3U, data))
+	{
+		return 1U;
+	}
+	for (n = 0U; n < (1U << size); n++)
+	{
+		r = sim_region(t, addr + n);
+		if (r == NULL)
+		{
+			return 0U;
+		}
+		if (r->writable)
+		{
+			r->mem[addr + n - r->base] = (uint8_t)(data >> (((addr + n) & 3U) * 8U));
+		}
+	}
+	return 1U;
+}
+
+// Advance TAR after a DRW access, wrapping inside the tar_wrap boundary
+static void sim_tar_increment(dap_target_sim_t *t)
+{
+	uint32_t inc;
+
+	if ((t->csw & CSW_ADDRINC_MASK) == 0U)
+	{
+		return;
+	}
+	inc = 1U << (t->csw & CSW_SIZE_MASK);
+	t->tar = (t->tar & ~(t->tar_wrap - 1U)) | ((t->tar + inc) & (t->tar_wrap - 1U));
+}
+
+// The AP access in flight completes: a bus error shows up in CTRL/STAT. Until then a
+// DP register read, which does not wait for the access, sees the sticky bits unchanged.
+static void sim_ap_done(dap_target_sim_t *t)
+{
+	t->ctrl_stat |= t->ap_error;
+	t->ap_error = 0U;
+}
+
+// An AP access was accepted, it stays busy for ap_wait WAIT responses
+static void sim_ap_busy(dap_target_sim_t *t)
+{
+	t->busy = t->ap_wait;
+	if (t->busy == 0U)
+	{
+		sim_ap_done(t);
+	}
+}
+
+static uint32_t sim_ap_read(dap_target_sim_t *t, uint32_t addr)
+{
+	uint32_t val = 0U;
+
+	if ((t->select >> 24) != 0U)
+	{
+		return 0U; // No AP at this APSEL
+	}
+	switch (addr)
+	{
+	case AP_CSW:
+		return t->csw | CSW_DEVICEEN;
+	case AP_TAR:
+		return t->tar;
+	case AP_DRW:
+		if (!sim_bus_read(t, t->tar, t->csw & CSW_SIZE_MASK, &val))
+		{
+			t->ap_error |= CS_STICKYERR;
+		}
+		sim_tar_increment(t);
+		return val;
+	case AP_CFG:
+		return 0U;
+	case AP_BASE:
+		return t->ap_base;
+	case AP_IDR:
+		return t->ap_idr;
+	}
+	if ((addr >= AP_BD0) && (addr <= AP_BD3))
+	{
+		if (!sim_bus_read(t, (t->tar & ~0xFU) | (addr & 0xCU), 2U, &val))
+		{
+			t->ap_error |= CS_STICKYERR;
+		}
+	}
+	return val;
+}
+
+static void sim_ap_write(dap_target_sim_t *t, uint32_t addr, uint32_t val)
+{
+	if ((t->select >> 24) != 0U)
+	{
+		return;
+	}
+	switch (addr)
+	{
+	case AP_CSW:
+		t->csw = val & ~CSW_DEVICEEN;
+		return;
+	case AP_TAR:
+		t->tar = val;
+		return;
+	case AP_DRW:
+		if (!sim_bus_write(t, t->tar, t->csw & CSW_SIZE_MASK, val))
+		{
+			t->ap_error |= CS_STICKYERR;
+		}
+		sim_tar_increment(t);
+		return;
+	}
+	if ((addr >= AP_BD0) && (addr <= AP_BD3))
+	{
+		if (!sim_bus_write(t, (t->tar & ~0xFU) | (addr & 0xCU), 2U, val))
+		{
+			t->ap_error |= CS_STICKYERR;
+		}
+	}
+}
+
+// Decode a request header and prepare the acknowledge (and read data)
+static uint32_t sim_request(dap_target_sim_t *t)
+{
+	uint32_t ap = t->request & DAP_TRANSFER_APnDP;
+	uint32_t rnw = t->request & DAP_TRANSFER_RnW;
+	uint32_t a = t->request & 0x0CU;
+
+	// Multi-drop: a TARGETSEL write right after the line reset selects one target,
+	// any other packet there selects all of them
+	if (t->targetsel != 0U)
+	{
+		if (t->md_reset)
+		{
+			t->md_reset = 0U;
+			t->selected = 1U;
+			if (!ap && !rnw && (a == DP_TARGETSEL))
+			{
+				return ACK_TARGETSEL;
+			}
+		}
+		if (!t->selected)
+		{
+			return ACK_NONE;
+		}
+	}
+
+	// After a line reset only an IDCODE read is answered
+	if (t->line_reset)
+	{
+		if (ap || !rnw || (a != DP_IDCODE))
+		{
+			return ACK_NONE;
+		}
+		t->line_reset = 0U;
+	}
+
+	if (!ap)
+	{
+		if (rnw)
+		{
+			switch (a)
+			{
+			case DP_IDCODE:
+				t->shift = t->idcode;
+				return DAP_TRANSFER_OK;
+			case DP_CTRL_STAT:
+				t->shift = 0U;
+				if ((t->select & 0x0FU) == 0U)
+				{
+					t->shift = (t->ctrl_stat & ~CS_ACK) | ((t->ctrl_stat & (CS_CDBGPWRUPREQ | CS_CSYSPWRUPREQ)) << 1);
+				}
+				return DAP_TRANSFER_OK;
+			}
+		}
+		else if ((a == DP_ABORT) || (a == DP_CTRL_STAT))
+		{
+			return DAP_TRANSFER_OK; // Executed with the data phase
+		}
+		if (t->ctrl_stat & CS_STICKY)
+		{
+			return DAP_TRANSFER_FAULT;
+		}
+		if (rnw)
+		{
+			if ((a == DP_RDBUFF) && t->busy)
+			{
+				if (--t->busy == 0U)
+				{
+					sim_ap_done(t);
+				}
+				return DAP_TRANSFER_WAIT;
+			}
+			t->shift = t->rdbuff; // RESEND and RDBUFF
+		}
+		return DAP_TRANSFER_OK;
+	}
+
+	if (t->ctrl_stat & CS_STICKY)
+	{
+		return DAP_TRANSFER_FAULT;
+	}
+	if (t->busy)
+	{
+		if (--t->busy == 0U)
+		{
+			sim_ap_done(t);
+		}
+		return DAP_TRANSFER_WAIT;
+	}
+	if (rnw)
+	{
+		// Posted read: return the previous result and start the next read
+		t->shift = t->rdbuff;
+		t->rdbuff = sim_ap_read(t, (t->select & 0xF0U) | a);
+		sim_ap_busy(t);
+		t->stats.ap_rd++;
+	}
+	return DAP_TRANSFER_OK;
+}
+
+// Execute a write once its data phase has been received
+static void sim_write(dap_target_sim_t *t, uint32_t val)
+{
+	uint32_t a = t->request & 0x0CU;
+
+	if (t->request & DAP_TRANSFER_APnDP)
+	{
+		sim_ap_write(t, (t->select & 0xF0U) | a, val);
+		sim_ap_busy(t);
+		t->stats.ap_wr++;
+		return;
+	}
+	switch (a)
+	{
+	case DP_ABORT:
+		if (val & ABORT_DAPABORT)
+		{
+			t->busy = 0U;
+			t->ap_error = 0U;
+		}
+		if (val & ABORT_STKCMPCLR)
+		{
+			t->ctrl_stat &= ~CS_STICKYCMP;
+		}
+		if (val & ABORT_STKERRCLR)
+		{
+			t->ctrl_stat &= ~CS_STICKYERR;
+		}
+		if (val & ABORT_WDERRCLR)
+		{
+			t->ctrl_stat &= ~CS_WDATAERR;
+		}
+		if (val & ABORT_ORUNERRCLR)
+		{
+			t->ctrl_stat &= ~CS_STICKYORUN;
+		}
+		break;
+	case DP_CTRL_STAT:
+		if ((t->select & 0x0FU) == 0U)
+		{
+			t->ctrl_stat = (t->ctrl_stat & CS_STICKY) | (val & ~(CS_STICKY | CS_ACK));
+		}
+		break;
+	case DP_SELECT:
+		t->select = val;
+		break;
+	}
+}
+
+// Level driven by the target in cycle c after the park bit
+static uint32_t sim_out(dap_target_sim_t *t, uint32_t c)
+{
+	uint32_t trn = t->turnaround;
+
+	if ((c <= trn) || (t->ack == ACK_TARGETSEL))
+	{
+		return 1U; // Turnaround, or nothing driven for a TARGETSEL
+	}
+	if (c <= (trn + 3U))
+	{
+		return (t->ack >> (c - trn - 1U)) & 1U;
+	}
+	if ((t->ack == DAP_TRANSFER_OK) && (t->request & DAP_TRANSFER_RnW))
+	{
+		if (c <= (trn + 35U))
+		{
+			return (t->shift >> (c - trn - 4U)) & 1U;
+		}
+		if (c == (trn + 36U))
+		{
+			return sim_parity(t->shift);
+		}
+	}
+	return 1U;
+}
+
+// Sample the probe in cycle c after the park bit
+//   return: 1 when the transfer is complete
+static uint32_t sim_in(dap_target_sim_t *t, uint32_t c, uint32_t bit)
+{
+	uint32_t trn = t->turnaround;
+	uint32_t d;
+
+	if (t->ack == ACK_TARGETSEL)
+	{
+		// Five undriven cycles instead of turnaround/ACK/turnaround, then the data phase
+		if (c < 6U)
+		{
+			return 0U;
+		}
+		d = c - 6U;
+		if (d < 32U)
+		{
+			t->shift |= bit << d;
+			return 0U;
+		}
+		t->selected = (bit == sim_parity(t->shift)) && (t->shift == t->targetsel);
+		return 1U;
+	}
+	if (t->ack != DAP_TRANSFER_OK)
+	{
+		return (c >= (trn + 3U)) ? 1U : 0U;
+	}
+	if (t->request & DAP_TRANSFER_RnW)
+	{
+		return (c >= (trn + 36U)) ? 1U : 0U;
+	}
+	if (c < ((2U * trn) + 4U))
+	{
+		return 0U;
+	}
+	d = c - ((2U * trn) + 4U);
+	if (d < 32U)
+	{
+		t->shift |= bit << d;
+		return 0U;
+	}
+	if (bit != sim_parity(t->shift))
+	{
+		t->ctrl_stat |= CS_WDATAERR;
+	}
+	else
+	{
+		sim_write(t, t->shift);
+	}
+	return 1U;
+}
+
+// Dormant state of a multi-drop target: watch for the selection alert and the SWD activation code
+//   return: 1 when the target is dormant for this cycle
+static uint32_t sim_dormant(dap_target_sim_t *t, uint32_t bit)
+{
+	t->seq[0] = (t->seq[0] >> 1) | (t->seq[1] << 63);
+	t->seq[1] = (t->seq[1] >> 1) | ((uint64_t)bit << 63);
+
+	if (!t->dormant)
+	{
+		// Line reset followed by the SWD to dormant sequence
+		if ((t->since_reset == 16U) && ((t->seq[1] >> 48) == SEQ_SWD_TO_DORMANT))
+		{
+			t->dormant = 1U;
+			t->activate = 0U;
+		}
+		return t->dormant;
+	}
+
+	if (t->activate != 0U)
+	{
+		if (++t->activate > SEQ_ACTIVATE_BITS)
+		{
+			t->activate = 0U;
+			if ((t->seq[1] >> (64U - SEQ_ACTIVATE_BITS)) == SEQ_ACTIVATE_SWD)
+			{
+				// SWD active, waiting for a line reset
+				t->dormant = 0U;
+				t->phase = PHASE_IDLE;
+				t->line_reset = 1U;
+				t->selected = 0U;
+				t->ones = 0U;
+			}
+		}
+	}
+	else if ((t->seq[0] == SEQ_ALERT_LO) && (t->seq[1] == SEQ_ALERT_HI))
+	{
+		t->activate = 1U;
+	}
+	return 1U;
+}
+
+// Rising SWCLK edge
+static uint32_t sim_clock(void *ctx, uint32_t swdio, uint32_t swdio_oe, uint32_t tdi)
+{
+	dap_target_sim_t *t = (dap_target_sim_t *)ctx;
+	uint32_t bit = swdio & 1U;
+
+	(void)tdi;
+
+	if (t->targetsel != 0U)
+	{
+		if (!swdio_oe)
+		{
+			bit = 1U; // Pulled up
+		}
+		if (t->since_reset < 0xFFFFU)
+		{
+			t->since_reset++;
+		}
+		if (sim_dormant(t, bit))
+		{
+			t->out = 1U;
+			return t->out;
+		}
+	}
+
+	switch (t->phase)
+	{
+	case PHASE_IDLE:
+		if (swdio_oe && bit)
+		{
+			t->phase = PHASE_REQUEST;
+			t->cycle = 0U;
+			t->shift = 0U;
+		}
+		t->out = 1U;
+		break;
+
+	case PHASE_REQUEST:
+		t->shift |= bit << t->cycle;
+		if (++t->cycle < 7U)
+		{
+			break;
+		}
+		// APnDP, RnW, A2, A3, Parity, Stop, Park
+		t->request = (uint8_t)(t->shift & 0x0FU);
+		t->phase = PHASE_IDLE;
+		if ((sim_parity(t->request) != ((t->shift >> 4) & 1U)) ||
+			(((t->shift >> 5) & 3U) != 2U))
+		{
+			break; // Not a valid header, no response
+		}
+		t->shift = 0U;
+		t->ack = (uint8_t)sim_request(t);
+		if (t->ack == ACK_NONE)
+		{
+			break;
+		}
+		if (t->ack == DAP_TRANSFER_OK)
+		{
+			t->stats.ok++;
+		}
+		else if (t->ack == DAP_TRANSFER_WAIT)
+		{
+			t->stats.wait++;
+		}
+		else if (t->ack == DAP_TRANSFER_FAULT)
+		{
+			t->stats.fault++;
+		}
+		if (((t->ack == DAP_TRANSFER_WAIT) || (t->ack == DAP_TRANSFER_FAULT)) && (t->ctrl_stat & CS_ORUNDETECT))
+		{
+			t->ctrl_stat |= CS_STICKYORUN;
+		}
+		t->phase = PHASE_RESPONSE;
+		t->cycle = 0U;
+		t->out = (uint8_t)sim_out(t, 1U);
+		break;
+
+	case PHASE_RESPONSE:
+		t->cycle++;
+		if (sim_in(t, t->cycle, bit))
+		{
+			t->phase = PHASE_IDLE;
+			t->out = 1U;
+		}
+		else
+		{
+			t->out = (uint8_t)sim_out(t, t->cycle + 1U);
+		}
+		break;
+	}
+
+	// Line reset: at least 50 cycles with SWDIO high
+	if (swdio_oe && bit)
+	{
+		if (t->ones < 255U)
+		{
+			t->ones++;
+		}
+	}
+	else
+	{
+		t->ones = 0U;
+	}
+	if (t->ones >= 50U)
+	{
+		t->phase = PHASE_IDLE;
+		t->line_reset = 1U;
+		t->md_reset = 1U;
+		t->since_reset = 0U;
+		t->out = 1U;
+	}
+
+	return t->out;
+}
+
+static void sim_reset(void *ctx, uint32_t nreset)
+{
+	if (nreset == 0U)
+	{
+		sim_core_reset((dap_target_sim_t *)ctx);
+	}
+}
+
+// Set up a target with Cortex-M4 identification and no memory regions
+void dap_target_sim_init(dap_target_sim_t *t)
+{
+	memset(t, 0, sizeof(*t));
+	t->idcode = 0x2BA01477U;  // SW-DP v1
+	t->ap_idr = 0x24770011U;  // AHB-AP
+	t->ap_base = 0xE00FF003U; // ROM table present
+	t->cpuid = 0x410FC241U;	  // Cortex-M4 r0p1
+	t->tar_wrap = 1024U;	  // Minimum auto-increment range of ADIv5
+	t->turnaround = 1U;
+	t->line_reset = 1U;
+	t->out = 1U;
+}
+
+// Connect the target to the simulated pins
+void dap_target_sim_attach(dap_target_sim_t *t)
+{
+	dap_sim_model_t model;
+
+	model.ctx = t;
+	model.clock = sim_clock;
+	model.reset = sim_reset;
+	dap_sim_attach(&model);
+}
+
+// Connect the target to the SWDIO line of gang target n
+void dap_target_sim_gang_attach(dap_target_sim_t *t, uint32_t n)
+{
+	dap_sim_model_t model;
+
+	model.ctx = t;
+	model.clock = sim_clock;
+	model.reset = sim_reset;
+	dap_sim_gang_attach(n, &model);
+}
+
+// Multi-drop bus: every target sees the probe, the line is low when any of them drives it low
+static dap_target_sim_t *sim_bus[SIM_BUS_MAX];
+static uint32_t sim_bus_count;
+
+static uint32_t sim_bus_clock(void *ctx, uint32_t swdio, uint32_t swdio_oe, uint32_t tdi)
+{
+	uint32_t out = 1U;
+	uint32_t n;
+
+	(void)ctx;
+
+	for (n = 0U; n < sim_bus_count; n++)
+	{
+		out &= sim_clock(sim_bus[n], swdio, swdio_oe, tdi);
+	}
+	return out;
+}
+
+static void sim_bus_reset(void *ctx, uint32_t nreset)
+{
+	uint32_t n;
+
+	(void)ctx;
+
+	for (n = 0U; n < sim_bus_count; n++)
+	{
+		sim_reset(sim_bus[n], nreset);
+	}
+}
+
+// Connect several multi-drop targets to the simulated pins
+void dap_target_sim_attach_bus(dap_target_sim_t **t, uint32_t count)
+{
+	dap_sim_model_t model;
+
+	if (count > SIM_BUS_MAX)
+	{
+		count = SIM_BUS_MAX;
+	}
+	memcpy(sim_bus, t, count * sizeof(t[0]));
+	sim_bus_count = count;
+
+	model.ctx = NULL;
+	model.clock = sim_bus_clock;
+	model.reset = sim_bus_reset;
+	dap_sim_attach(&model);
+}
+
+// Map memory into the MEM-AP address space
+//   return: 0 when all regions are in use
+int dap_target_sim_add_region(dap_target_sim_t *t, uint32_t base, uint32_t size, uint8_t *mem, uint8_t writable)
+{
+	uint32_t n;
+
+	for (n = 0U; n < DAP_TARGET_SIM_REGIONS; n++)
+	{
+		if (t->region[n].size == 0U)
+		{
+			t->region[n].base = base;
+			t->region[n].size = size;
+			t->region[n].mem = mem;
+			t->region[n].writable = writable;
+			return 1;
+		}
+	}
+	return 0;
+}
+
+#endif
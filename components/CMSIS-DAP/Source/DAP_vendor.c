@@ -20,8 +20,621 @@
  *
  ******************************************************************************/
 
+#include <string.h>
 #include "DAP_config.h"
 #include "DAP.h"
+#include "SWD_flash.h"
+#include "SWD_target.h"
+#include "../algo/flm.h"
+
+// Vendor Command IDs
+#define ID_DAP_Vendor_Benchmark ID_DAP_Vendor0	 // Command dispatch microbenchmark
+#define ID_DAP_Vendor_SWDBenchmark ID_DAP_Vendor1 // SWCLK rate benchmark
+#define ID_DAP_Vendor_TurnBenchmark ID_DAP_Vendor2 // SWDIO turnaround benchmark
+#define ID_DAP_Vendor_ClockInfo ID_DAP_Vendor3	 // Actual SWJ clock frequency
+#define ID_DAP_Vendor_SeqBenchmark ID_DAP_Vendor4 // SWJ/JTAG sequence benchmark
+#define ID_DAP_Vendor_MemRead ID_DAP_Vendor5	 // Target memory read stream
+#define ID_DAP_Vendor_MemWrite ID_DAP_Vendor6	 // Target memory write stream: start
+#define ID_DAP_Vendor_MemWriteData ID_DAP_Vendor7 // Target memory write stream: more data
+#define ID_DAP_Vendor_FlashStart ID_DAP_Vendor8	 // Flash programming session: start
+#define ID_DAP_Vendor_FlashData ID_DAP_Vendor9	 // Flash programming session: image data
+#define ID_DAP_Vendor_FlashStatus ID_DAP_Vendor10 // Flash programming session: progress
+#define ID_DAP_Vendor_FlashEnd ID_DAP_Vendor11	 // Flash programming session: end
+#define ID_DAP_Vendor_AlgoLoad ID_DAP_Vendor12	 // Flash algorithm from the FLM store
+#define ID_DAP_Vendor_Identify ID_DAP_Vendor13	 // Target identification
+#define ID_DAP_Vendor_CoreRead ID_DAP_Vendor14	 // Core register snapshot
+#define ID_DAP_Vendor_TarWrap ID_DAP_Vendor15	 // MEM-AP TAR auto-increment wrap
+// ID_DAP_Vendor16 is the Latency command, answered by the USB transport (main/hid_task.c)
+#define ID_DAP_Vendor_Gang ID_DAP_Vendor17		 // Gang programming: select the targets
+#define ID_DAP_Vendor_GangStatus ID_DAP_Vendor18 // Gang programming: result per target
+
+#if (DAP_SWD != 0)
+
+// Target memory streams of the MemRead/MemWrite commands. Memory is moved through
+// swd_read_memory/swd_write_memory in chunks that end on MEM_CHUNK_SIZE boundaries, so
+// only the first chunk can have unaligned edges; the TAR wrap is handled by SWD_host.
+// CoreRead sends its response through the read stream as well.
+#define MEM_CHUNK_SIZE 1024U
+
+typedef struct
+{
+	uint32_t addr;	// Target address of the buffered chunk
+	uint32_t size;	// Bytes not transferred to or from the buffer yet
+	uint32_t count; // Bytes in the buffer
+	uint32_t pos;	// Read: next buffered byte to send
+	uint8_t status; // DAP_OK, DAP_ERROR after a failed access (sticky)
+	uint8_t read;	// Read stream has response packets pending
+	uint8_t write;	// Write stream of MemWrite is open, takes MemWriteData
+	uint8_t cmd;	// Command of the read stream packets
+	uint8_t buf[MEM_CHUNK_SIZE];
+} DAP_MemStream_t;
+
+static DAP_MemStream_t mem;
+
+// Bytes of the chunk starting at the current address
+static uint32_t MemChunk(void)
+{
+	uint32_t n = MEM_CHUNK_SIZE - (mem.addr & (MEM_CHUNK_SIZE - 1U));
+
+	return (mem.size < n) ? mem.size : n;
+}
+
+// Start a stream at addr: the host may have changed SELECT/CSW, SWD_host must write them again
+static void MemStart(const uint8_t *request)
+{
+	mem.addr = (*(request + 0) << 0) |
+			   (*(request + 1) << 8) |
+			   (*(request + 2) << 16) |
+			   (*(request + 3) << 24);
+	mem.size = (*(request + 4) << 0) |
+			   (*(request + 5) << 8) |
+			   (*(request + 6) << 16) |
+			   (*(request + 7) << 24);
+	mem.count = 0U;
+	mem.pos = 0U;
+	mem.read = 0U;
+	mem.write = 0U;
+	mem.cmd = ID_DAP_Vendor_MemRead;
+	mem.status = (DAP_Data.debug_port == DAP_PORT_SWD) ? DAP_OK : DAP_ERROR;
+	swd_invalidate_state();
+}
+
+// Fill the next read response packet: status (1 byte) and data
+//   return: number of bytes in response
+static uint32_t MemReadPacket(uint8_t *response)
+{
+	uint32_t num = 0U;
+	uint32_t n;
+
+	while ((num < (DAP_PACKET_SIZE - 2U)) && (mem.status == DAP_OK))
+	{
+		if (mem.pos == mem.count)
+		{
+			if (mem.size == 0U)
+			{
+				break;
+			}
+			mem.addr += mem.count;
+			mem.count = MemChunk();
+			mem.pos = 0U;
+			if (DAP_TransferAbort || !swd_read_memory(mem.addr, mem.buf, mem.count))
+			{
+				mem.status = DAP_ERROR;
+				num = 0U;
+				break;
+			}
+			mem.size -= mem.count;
+		}
+		n = mem.count - mem.pos;
+		if (n > (DAP_PACKET_SIZE - 2U - num))
+		{
+			n = DAP_PACKET_SIZE - 2U - num;
+		}
+		memcpy(response + 1U + num, &mem.buf[mem.pos], n);
+		mem.pos += n;
+		num += n;
+	}
+
+	*response = mem.status;
+	mem.read = (mem.status == DAP_OK) && ((mem.size != 0U) || (mem.pos != mem.count));
+
+	return (1U + num);
+}
+
+// Core registers of CoreRead without a register list: R0-R15, xPSR, MSP, PSP and
+// CONTROL/FAULTMASK/BASEPRI/PRIMASK
+static const uint8_t core_regs[] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 20};
+
+// Read core registers of the halted core into the read stream: request is the number of
+// registers (1 byte, 0 = core_regs) and their DCRSR REGSEL numbers (1 byte each)
+//   return: number of bytes in request
+static uint32_t CoreRead(const uint8_t *request)
+{
+	uint32_t val[DAP_PACKET_SIZE - 2U];
+	const uint8_t *regs = request + 1;
+	uint32_t cnt = *request;
+	uint32_t num = 1U + cnt;
+	uint32_t n;
+	uint8_t halted = 0U;
+
+	if (cnt > (DAP_PACKET_SIZE - 2U))
+	{
+		num = 1U; // The list does not fit the packet
+	}
+	else if (cnt == 0U)
+	{
+		regs = core_regs;
+		cnt = sizeof(core_regs);
+	}
+
+	mem.addr = 0U;
+	mem.size = 0U;
+	mem.count = 0U;
+	mem.pos = 0U;
+	mem.write = 0U;
+	mem.cmd = ID_DAP_Vendor_CoreRead;
+	mem.status = DAP_ERROR;
+	swd_invalidate_state();
+
+	if ((DAP_Data.debug_port == DAP_PORT_SWD) && (cnt <= (DAP_PACKET_SIZE - 2U)) &&
+		swd_flash_syscall_halted(&halted) && halted && swd_read_core_registers(regs, cnt, val))
+	{
+		for (n = 0U; n < cnt; n++)
+		{
+			mem.buf[(n * 4U) + 0U] = (uint8_t)(val[n] >> 0);
+			mem.buf[(n * 4U) + 1U] = (uint8_t)(val[n] >> 8);
+			mem.buf[(n * 4U) + 2U] = (uint8_t)(val[n] >> 16);
+			mem.buf[(n * 4U) + 3U] = (uint8_t)(val[n] >> 24);
+		}
+		mem.count = cnt * 4U;
+		mem.status = DAP_OK;
+	}
+
+	return num;
+}
+
+// Set or detect the TAR wrap of a MEM-AP: request is APSEL (1 byte) and the wrap size
+// (4 bytes, 0 = detect), response the status and the wrap size in effect (4 bytes)
+//   return: number of bytes in response
+static uint32_t TarWrap(const uint8_t *request, uint8_t *response)
+{
+	uint8_t apsel = *request;
+	uint32_t size = (*(request + 1) << 0) |
+					(*(request + 2) << 8) |
+					(*(request + 3) << 16) |
+					(*(request + 4) << 24);
+	uint8_t ok;
+
+	if (size != 0U)
+	{
+		ok = swd_set_tar_wrap(apsel, size);
+	}
+	else if (DAP_Data.debug_port == DAP_PORT_SWD)
+	{
+		swd_invalidate_state();
+		ok = swd_detect_tar_wrap(apsel);
+	}
+	else
+	{
+		ok = 0U;
+	}
+
+	size = swd_tar_wrap(apsel);
+	*response++ = ok ? DAP_OK : DAP_ERROR;
+	*response++ = (uint8_t)(size >> 0);
+	*response++ = (uint8_t)(size >> 8);
+	*response++ = (uint8_t)(size >> 16);
+	*response++ = (uint8_t)(size >> 24);
+	return (5U);
+}
+
+// Take write data from a request packet, full chunks are written to the target.
+// Data beyond the stream length is dropped, the buffer never takes more than a chunk.
+static void MemWriteData(const uint8_t *data, uint32_t num)
+{
+	uint32_t n;
+
+	while ((num != 0U) && (mem.count < MemChunk()))
+	{
+		n = MemChunk() - mem.count;
+		if (n > num)
+		{
+			n = num;
+		}
+		memcpy(&mem.buf[mem.count], data, n);
+		mem.count += n;
+		data += n;
+		num -= n;
+		if (mem.count == MemChunk())
+		{
+			if ((mem.status == DAP_OK) && !swd_write_memory(mem.addr, mem.buf, mem.count))
+			{
+				mem.status = DAP_ERROR;
+			}
+			mem.addr += mem.count;
+			mem.size -= mem.count;
+			mem.count = 0U;
+		}
+	}
+}
+
+// Flash programming session of the Flash* commands. The image is collected in blocks of
+// whole pages on the probe and every full block is erased and programmed by the flash
+// algorithm in the target (target_flash_*), the host only streams data and reads back
+// the progress. In the incremental mode a block is a sector, it is compared with the
+// flash through a CRC-32 first and left alone when it has not changed.
+#define FLASH_BLOCK_SIZE 4096U	// Block of the other erase modes
+#define FLASH_BUFFER_SIZE 16384U // Block buffer, largest sector of the incremental mode
+
+// Erase modes of FlashStart
+#define FLASH_ERASE_NONE 0U	  // Flash is erased already
+#define FLASH_ERASE_SECTOR 1U // Sectors are erased before the first page in them is programmed
+#define FLASH_ERASE_CHIP 2U	  // Chip erase at the start of the session
+#define FLASH_ERASE_INCREMENTAL 3U // Only the sectors that differ are erased and programmed
+
+// Algorithm of FlashStart: selected by target_identify
+#define FLASH_ALGO_AUTO 0xFFU
+
+// Session states reported by FlashStatus
+#define FLASH_STATE_IDLE 0U
+#define FLASH_STATE_ACTIVE 1U
+#define FLASH_STATE_DONE 2U
+
+extern uint8_t Select_algo;
+
+typedef struct
+{
+	uint32_t addr;	 // Target address of the buffered block
+	uint32_t size;	 // Image bytes not received yet
+	uint32_t done;	 // Image bytes programmed
+	uint32_t erased; // End of the flash erased in this session (sector erase)
+	uint32_t sector; // Sector size, 0 = no sector erase
+	uint32_t page;	 // Page size
+	uint32_t block;	 // Block size, whole pages
+	uint32_t count;	 // Bytes in the block buffer
+	uint32_t skipped; // Incremental: sectors left alone
+	uint32_t changed; // Incremental: sectors erased and programmed
+	uint32_t check_us; // Incremental: time of the sector compares
+	uint32_t write_us; // Incremental: time of the sector erase and programming
+	uint8_t state;	 // FLASH_STATE_*
+	uint8_t status;	 // DAP_OK, DAP_ERROR after a failed step (sticky)
+	uint8_t error;	 // error_tt of the failed step
+	uint8_t incremental; // Sectors are compared before they are erased
+	uint8_t buf[FLASH_BUFFER_SIZE];
+} DAP_FlashStream_t;
+
+static DAP_FlashStream_t flash;
+static target_id_t target; // Last identification
+
+// Record the result of a session step, the first error is kept
+static void FlashResult(error_tt err)
+{
+	if ((err != ERROR_SUCCESS) && (flash.status == DAP_OK))
+	{
+		flash.status = DAP_ERROR;
+		flash.error = (uint8_t)err;
+	}
+}
+
+// Time since a CYCLE_COUNT_GET value in microseconds. TIMESTAMP_GET counts RTOS ticks
+// on the probe, too coarse for a sector; the cycle count wraps after 17 s at 240 MHz,
+// longer than a sector takes.
+static uint32_t FlashTime(uint32_t start)
+{
+	return (CYCLE_COUNT_GET() - start) / (CPU_CLOCK / 1000000U);
+}
+
+// Erase and program the buffered block, a partial page is padded with the erased value
+static void FlashBlock(void)
+{
+	uint32_t size = ((flash.count + flash.page - 1U) / flash.page) * flash.page;
+	uint32_t start = CYCLE_COUNT_GET();
+	uint32_t crc;
+	error_tt err = ERROR_SUCCESS;
+
+	memset(&flash.buf[flash.count], 0xFF, size - flash.count);
+	if (flash.incremental)
+	{
+		// The whole sector is compared, after programming the rest of it is erased
+		memset(&flash.buf[size], 0xFF, flash.sector - size);
+		err = target_flash_crc32(flash.addr, flash.sector, &crc);
+		flash.check_us += FlashTime(start);
+		if ((err == ERROR_SUCCESS) && (crc == flash_crc32(flash.buf, flash.sector)))
+		{
+			flash.skipped++;
+			flash.done += flash.count;
+			flash.erased = flash.addr + flash.sector;
+			flash.addr += flash.sector;
+			flash.count = 0U;
+			return;
+		}
+		start = CYCLE_COUNT_GET();
+	}
+	while ((flash.sector != 0U) && (err == ERROR_SUCCESS) && (flash.erased < (flash.addr + size)))
+	{
+		err = target_flash_erase_sector(flash.erased);
+		flash.erased += flash.sector;
+	}
+	if (DAP_TransferAbort)
+	{
+		err = ERROR_FAILURE;
+	}
+	if (err == ERROR_SUCCESS)
+	{
+		err = target_flash_program_page(flash.addr, flash.buf, size);
+	}
+	FlashResult(err);
+	if (flash.status == DAP_OK)
+	{
+		flash.done += flash.count;
+	}
+	if (flash.incremental)
+	{
+		flash.changed++;
+		flash.write_us += FlashTime(start);
+	}
+	flash.addr += size;
+	flash.count = 0U;
+}
+
+// Identify the target: the debug port is powered up and target_identify run. The
+// connection of the host stays as it is, swd_init_debug goes through DAP_Setup.
+static uint8_t TargetIdentify(void)
+{
+	DAP_Data_t data = DAP_Data;
+	uint8_t ok;
+
+	memset(&target, 0, sizeof(target));
+	if (DAP_Data.debug_port != DAP_PORT_SWD)
+	{
+		return 0U;
+	}
+	ok = swd_init_debug() && target_identify(&target);
+	DAP_Restore(&data);
+	swd_invalidate_state();
+	return ok;
+}
+
+// Start a session: request is algorithm (1 byte), erase mode (1 byte), address (4 bytes),
+// length (4 bytes), page size (2 bytes), sector size (4 bytes)
+static void FlashStart(const uint8_t *request)
+{
+	uint32_t algo = *(request + 0);
+	uint32_t erase = *(request + 1);
+	error_tt err = ERROR_FAILURE;
+
+	flash.addr = (*(request + 2) << 0) |
+				 (*(request + 3) << 8) |
+				 (*(request + 4) << 16) |
+				 (*(request + 5) << 24);
+	flash.size = (*(request + 6) << 0) |
+				 (*(request + 7) << 8) |
+				 (*(request + 8) << 16) |
+				 (*(request + 9) << 24);
+	flash.page = (*(request + 10) << 0) |
+				 (*(request + 11) << 8);
+	flash.sector = (*(request + 12) << 0) |
+				   (*(request + 13) << 8) |
+				   (*(request + 14) << 16) |
+				   (*(request + 15) << 24);
+	flash.done = 0U;
+	flash.count = 0U;
+	flash.skipped = 0U;
+	flash.changed = 0U;
+	flash.check_us = 0U;
+	flash.write_us = 0U;
+	flash.incremental = (erase == FLASH_ERASE_INCREMENTAL) ? 1U : 0U;
+	flash.status = DAP_OK;
+	flash.error = ERROR_SUCCESS;
+	flash.state = FLASH_STATE_ACTIVE;
+
+	// The identified part gives the algorithm and the sector size
+	if (algo == FLASH_ALGO_AUTO)
+	{
+		algo = (TargetIdentify() && (target.family != NULL)) ? target.algo : ALGO_CNT;
+		if ((algo != ALGO_CNT) && (flash.sector == 0U))
+		{
+			flash.sector = target_sector_size(&target, flash.addr, flash.size);
+		}
+	}
+
+	if (algo < (sizeof(STM32_ALGO) / sizeof(STM32_ALGO[0])))
+	{
+		// The algorithm table is filled on first use
+		if (STM32_ALGO[algo].algo.algo_blob == NULL)
+		{
+			algo_init();
+		}
+		Select_algo = (uint8_t)algo;
+		if (flash.page == 0U)
+		{
+			flash.page = STM32_ALGO[algo].algo.program_buffer_size;
+		}
+		// An FLM cache slot is only filled by AlgoLoad
+		if ((STM32_ALGO[algo].algo.algo_blob != NULL) && (DAP_Data.debug_port == DAP_PORT_SWD) &&
+			(flash.page != 0U) && (flash.page <= FLASH_BLOCK_SIZE) && ((flash.addr % flash.page) == 0U) &&
+			(erase <= FLASH_ERASE_INCREMENTAL) && ((erase != FLASH_ERASE_SECTOR) || (flash.sector != 0U)))
+		{
+			flash.block = (FLASH_BLOCK_SIZE / flash.page) * flash.page;
+			err = ERROR_SUCCESS;
+		}
+		// A sector is a block of whole pages, the image starts on a sector
+		if (flash.incremental && (err == ERROR_SUCCESS))
+		{
+			flash.block = flash.sector;
+			if ((flash.sector == 0U) || (flash.sector > FLASH_BUFFER_SIZE) ||
+				((flash.sector % flash.page) != 0U) || ((flash.addr % flash.sector) != 0U))
+			{
+				err = ERROR_FAILURE;
+			}
+		}
+	}
+	if ((erase != FLASH_ERASE_SECTOR) && (erase != FLASH_ERASE_INCREMENTAL))
+	{
+		flash.sector = 0U;
+	}
+	flash.erased = flash.addr - ((flash.sector != 0U) ? (flash.addr % flash.sector) : 0U);
+
+	if (err == ERROR_SUCCESS)
+	{
+		swd_invalidate_state();
+		err = target_flash_init(flash.addr);
+	}
+	if ((err == ERROR_SUCCESS) && (erase == FLASH_ERASE_CHIP))
+	{
+		err = target_flash_erase_chip();
+	}
+	FlashResult(err);
+}
+
+// Take image data from a request packet, full blocks and the end of the image are programmed
+static void FlashData(const uint8_t *data, uint32_t num)
+{
+	uint32_t n;
+
+	while ((num != 0U) && (flash.status == DAP_OK))
+	{
+		n = flash.block - flash.count;
+		if (n > num)
+		{
+			n = num;
+		}
+		memcpy(&flash.buf[flash.count], data, n);
+		flash.count += n;
+		flash.size -= n;
+		data += n;
+		num -= n;
+		if ((flash.count == flash.block) || (flash.size == 0U))
+		{
+			FlashBlock();
+		}
+	}
+
+	// Data after a failed step is dropped
+	flash.size -= num;
+}
+
+// Incremental mode: estimated time saved by the skipped sectors in microseconds
+static uint32_t FlashSaved(void)
+{
+	uint64_t saved;
+
+	if (flash.changed == 0U)
+	{
+		return (0U);
+	}
+	saved = ((uint64_t)flash.write_us * flash.skipped) / flash.changed;
+	return (saved > flash.check_us) ? (uint32_t)(saved - flash.check_us) : 0U;
+}
+
+// Load a flash algorithm by name: request is the NUL terminated name
+//   return: number of bytes in response
+static uint32_t AlgoLoad(const uint8_t *request, uint32_t num, uint8_t *response)
+{
+	char name[FLM_NAME_SIZE];
+	uint32_t start = 0U;
+	uint32_t size = 0U;
+	uint32_t page = 0U;
+	int algo = -1;
+
+	if ((memchr(request, 0, num) != NULL) && (strlen((const char *)request) < FLM_NAME_SIZE))
+	{
+		strcpy(name, (const char *)request);
+		algo = algo_load(name);
+	}
+	if (algo >= 0)
+	{
+		start = STM32_ALGO[algo].flash_start;
+		size = STM32_ALGO[algo].flash_size;
+		page = STM32_ALGO[algo].algo.program_buffer_size;
+	}
+	*response++ = (algo >= 0) ? DAP_OK : DAP_ERROR;
+	*response++ = (algo >= 0) ? (uint8_t)algo : (uint8_t)(-algo);
+	*response++ = (uint8_t)(start >> 0);
+	*response++ = (uint8_t)(start >> 8);
+	*response++ = (uint8_t)(start >> 16);
+	*response++ = (uint8_t)(start >> 24);
+	*response++ = (uint8_t)(size >> 0);
+	*response++ = (uint8_t)(size >> 8);
+	*response++ = (uint8_t)(size >> 16);
+	*response++ = (uint8_t)(size >> 24);
+	*response++ = (uint8_t)(page >> 0);
+	*response++ = (uint8_t)(page >> 8);
+	*response++ = (uint8_t)(page >> 16);
+	*response++ = (uint8_t)(page >> 24);
+	return (14U);
+}
+
+// Identification: status (1 byte), algorithm (1 byte), cached (1 byte), DP IDCODE,
+// CPUID, DBGMCU_IDCODE, ROM table PIDR, flash address and flash size (4 bytes each)
+//   return: number of bytes in response
+static uint32_t TargetInfo(uint8_t ok, uint8_t *response)
+{
+	const uint32_t val[6] = {target.dp_idcode, target.cpuid, target.idcode, target.rom_pidr,
+							 target.flash_start, target.flash_size};
+	uint32_t n;
+
+	*response++ = (ok && (target.family != NULL)) ? DAP_OK : DAP_ERROR;
+	*response++ = target.algo;
+	*response++ = target.cached;
+	for (n = 0U; n < 6U; n++)
+	{
+		*response++ = (uint8_t)(val[n] >> 0);
+		*response++ = (uint8_t)(val[n] >> 8);
+		*response++ = (uint8_t)(val[n] >> 16);
+		*response++ = (uint8_t)(val[n] >> 24);
+	}
+	return (27U);
+}
+
+// Select the gang targets: request is the target mask (2 bytes, 0 = single target)
+//   return: DAP_OK, DAP_ERROR without gang mode or for targets beyond DAP_GANG_CNT
+static uint8_t GangSelect(const uint8_t *request)
+{
+	uint32_t targets = *(request + 0) | (*(request + 1) << 8);
+
+#if (DAP_GANG != 0)
+	if ((targets >> DAP_GANG_CNT) == 0U)
+	{
+		target_flash_gang(targets);
+		return DAP_OK;
+	}
+#endif
+	(void)targets;
+	return DAP_ERROR;
+}
+
+// Gang result: status (1 byte), live targets (2 bytes), error per target (DAP_GANG_CNT bytes)
+//   return: number of bytes in response
+static uint32_t GangStatus(uint8_t *response)
+{
+	uint32_t live = swd_gang_live();
+	uint32_t n;
+
+	*response++ = (DAP_GANG != 0) ? DAP_OK : DAP_ERROR;
+	*response++ = (uint8_t)(live >> 0);
+	*response++ = (uint8_t)(live >> 8);
+	for (n = 0U; n < DAP_GANG_CNT; n++)
+	{
+		*response++ = (uint8_t)target_flash_gang_status(n);
+	}
+	return (3U + DAP_GANG_CNT);
+}
+
+// Progress of the session: status (1 byte), error (1 byte), bytes programmed (4 bytes)
+//   return: number of bytes in response
+static uint32_t FlashProgress(uint8_t *response)
+{
+	*response++ = flash.status;
+	*response++ = flash.error;
+	*response++ = (uint8_t)(flash.done >> 0);
+	*response++ = (uint8_t)(flash.done >> 8);
+	*response++ = (uint8_t)(flash.done >> 16);
+	*response++ = (uint8_t)(flash.done >> 24);
+	return (6U);
+}
+
+#endif
 
 //**************************************************************************************************
 /** 
@@ -43,86 +656,357 @@ file to the MDK-ARM project under the file group Configuration.
 uint32_t DAP_ProcessVendorCommand(const uint8_t *request, uint8_t *response)
 {
 	uint32_t num = (1U << 16) | 1U;
+#if (DAP_BENCHMARK != 0)
+	uint32_t count, direct, dispatch;
+	uint32_t cycles, clocks, rate;
+#if (DAP_JTAG != 0)
+	uint32_t swj, jtag;
+#endif
+#endif
+#if ((DAP_SWD != 0) || (DAP_JTAG != 0))
+	uint32_t delay;
+#endif
+#if (DAP_SWD != 0)
+	uint32_t n;
+#endif
 
 	*response++ = *request; // copy Command ID
 
 	switch (*request++)
 	{ // first byte in request is Command ID
-	case ID_DAP_Vendor0:
-#if 0 // example user command
-      num += 1U << 16;           // increment request count
-      if (*request == 1U) {      // when first command data byte is 1
-        *response++ = 'X';       // send 'X' as response
-        num++;                   // increment response count
-      }
-#endif
+#if (DAP_BENCHMARK != 0)
+	case ID_DAP_Vendor_Benchmark:
+		// Request:  count (2 bytes)
+		// Response: direct cycles (4 bytes), dispatch cycles (4 bytes)
+		count = (*(request + 0) << 0) |
+				(*(request + 1) << 8);
+		DAP_BenchmarkDispatch(count, &direct, &dispatch);
+		*response++ = (uint8_t)(direct >> 0);
+		*response++ = (uint8_t)(direct >> 8);
+		*response++ = (uint8_t)(direct >> 16);
+		*response++ = (uint8_t)(direct >> 24);
+		*response++ = (uint8_t)(dispatch >> 0);
+		*response++ = (uint8_t)(dispatch >> 8);
+		*response++ = (uint8_t)(dispatch >> 16);
+		*response++ = (uint8_t)(dispatch >> 24);
+		num += (2U << 16) | 8U;
 		break;
 
-	case ID_DAP_Vendor1:
-		break;
-	case ID_DAP_Vendor2:
-		break;
-	case ID_DAP_Vendor3:
-		break;
-	case ID_DAP_Vendor4:
+#if (DAP_SWD != 0)
+	case ID_DAP_Vendor_SWDBenchmark:
+		// Request:  count (2 bytes)
+		// Response: CPU cycles (4 bytes), SWCLK cycles (4 bytes), SWCLK rate in kHz (4 bytes)
+		count = (*(request + 0) << 0) |
+				(*(request + 1) << 8);
+		DAP_BenchmarkSWD(count, &cycles, &clocks);
+		rate = 0U;
+		if (cycles != 0U)
+		{
+			rate = (uint32_t)(((uint64_t)clocks * (CPU_CLOCK / 1000U)) / cycles);
+		}
+		*response++ = (uint8_t)(cycles >> 0);
+		*response++ = (uint8_t)(cycles >> 8);
+		*response++ = (uint8_t)(cycles >> 16);
+		*response++ = (uint8_t)(cycles >> 24);
+		*response++ = (uint8_t)(clocks >> 0);
+		*response++ = (uint8_t)(clocks >> 8);
+		*response++ = (uint8_t)(clocks >> 16);
+		*response++ = (uint8_t)(clocks >> 24);
+		*response++ = (uint8_t)(rate >> 0);
+		*response++ = (uint8_t)(rate >> 8);
+		*response++ = (uint8_t)(rate >> 16);
+		*response++ = (uint8_t)(rate >> 24);
+		num += (2U << 16) | 12U;
 		break;
-	case ID_DAP_Vendor5:
-		break;
-	case ID_DAP_Vendor6:
-		break;
-	case ID_DAP_Vendor7:
-		break;
-	case ID_DAP_Vendor8:
-		break;
-	case ID_DAP_Vendor9:
-		break;
-	case ID_DAP_Vendor10:
-		break;
-	case ID_DAP_Vendor11:
-		break;
-	case ID_DAP_Vendor12:
-		break;
-	case ID_DAP_Vendor13:
-		break;
-	case ID_DAP_Vendor14:
-		break;
-	case ID_DAP_Vendor15:
+
+	case ID_DAP_Vendor_TurnBenchmark:
+		// Request:  count (2 bytes)
+		// Response: CPU cycles for count output disable/enable pairs (4 bytes)
+		count = (*(request + 0) << 0) |
+				(*(request + 1) << 8);
+		DAP_BenchmarkTurnaround(count, &cycles);
+		*response++ = (uint8_t)(cycles >> 0);
+		*response++ = (uint8_t)(cycles >> 8);
+		*response++ = (uint8_t)(cycles >> 16);
+		*response++ = (uint8_t)(cycles >> 24);
+		num += (2U << 16) | 4U;
 		break;
-	case ID_DAP_Vendor16:
+#endif
+
+#if (DAP_JTAG != 0)
+	case ID_DAP_Vendor_SeqBenchmark:
+		// Request:  count (2 bytes)
+		// Response: CPU swj for count 64-bit SWJ sequences (4 bytes), SWJ sequences/s (4 bytes),
+		//           CPU swj for count 256-bit DR scans (4 bytes), DR scans/s (4 bytes)
+		count = (*(request + 0) << 0) |
+				(*(request + 1) << 8);
+		DAP_BenchmarkSequence(count, &swj, &jtag);
+		rate = 0U;
+		if (swj != 0U)
+		{
+			rate = (uint32_t)(((uint64_t)count * CPU_CLOCK) / swj);
+		}
+		*response++ = (uint8_t)(swj >> 0);
+		*response++ = (uint8_t)(swj >> 8);
+		*response++ = (uint8_t)(swj >> 16);
+		*response++ = (uint8_t)(swj >> 24);
+		*response++ = (uint8_t)(rate >> 0);
+		*response++ = (uint8_t)(rate >> 8);
+		*response++ = (uint8_t)(rate >> 16);
+		*response++ = (uint8_t)(rate >> 24);
+		rate = 0U;
+		if (jtag != 0U)
+		{
+			rate = (uint32_t)(((uint64_t)count * CPU_CLOCK) / jtag);
+		}
+		*response++ = (uint8_t)(jtag >> 0);
+		*response++ = (uint8_t)(jtag >> 8);
+		*response++ = (uint8_t)(jtag >> 16);
+		*response++ = (uint8_t)(jtag >> 24);
+		*response++ = (uint8_t)(rate >> 0);
+		*response++ = (uint8_t)(rate >> 8);
+		*response++ = (uint8_t)(rate >> 16);
+		*response++ = (uint8_t)(rate >> 24);
+		num += (2U << 16) | 16U;
 		break;
-	case ID_DAP_Vendor17:
+#endif
+#endif
+
+#if ((DAP_SWD != 0) || (DAP_JTAG != 0))
+	case ID_DAP_Vendor_ClockInfo:
+		// Request:  none
+		// Response: measured SWJ clock in Hz (4 bytes), clock delay (4 bytes, 0 = fast clock)
+		delay = DAP_Data.fast_clock ? 0U : DAP_Data.clock_delay;
+		*response++ = (uint8_t)(DAP_Data.clock_freq >> 0);
+		*response++ = (uint8_t)(DAP_Data.clock_freq >> 8);
+		*response++ = (uint8_t)(DAP_Data.clock_freq >> 16);
+		*response++ = (uint8_t)(DAP_Data.clock_freq >> 24);
+		*response++ = (uint8_t)(delay >> 0);
+		*response++ = (uint8_t)(delay >> 8);
+		*response++ = (uint8_t)(delay >> 16);
+		*response++ = (uint8_t)(delay >> 24);
+		num += 8U;
 		break;
-	case ID_DAP_Vendor18:
+#endif
+
+#if (DAP_SWD != 0)
+	case ID_DAP_Vendor_MemRead:
+		// Request:  address (4 bytes), length (4 bytes)
+		// Response: status (1 byte), data (up to DAP_PACKET_SIZE - 2 bytes). As many further
+		//           packets of this format follow as needed for length bytes, the stream ends
+		//           early with the first packet that has status DAP_ERROR.
+		MemStart(request);
+		num += (8U << 16) + MemReadPacket(response);
 		break;
-	case ID_DAP_Vendor19:
+
+	case ID_DAP_Vendor_MemWrite:
+		// Request:  address (4 bytes), length (4 bytes), data (up to DAP_PACKET_SIZE - 9 bytes)
+		// Response: status (1 byte)
+		MemStart(request);
+		mem.write = 1U;
+		n = (mem.size < (DAP_PACKET_SIZE - 9U)) ? mem.size : (DAP_PACKET_SIZE - 9U);
+		MemWriteData(request + 8, n);
+		*response++ = mem.status;
+		num += ((8U + n) << 16) | 1U;
 		break;
-	case ID_DAP_Vendor20:
+
+	case ID_DAP_Vendor_MemWriteData:
+		// Request:  data (up to DAP_PACKET_SIZE - 1 bytes) for the stream started by MemWrite
+		// Response: status (1 byte), DAP_ERROR once any part of the stream failed or
+		//           when no MemWrite stream is open (the data is not taken then)
+		if (mem.write == 0U)
+		{
+			*response++ = DAP_ERROR;
+			num += 1U;
+			break;
+		}
+		n = (mem.size - mem.count < (DAP_PACKET_SIZE - 1U)) ? (mem.size - mem.count) : (DAP_PACKET_SIZE - 1U);
+		MemWriteData(request, n);
+		*response++ = mem.status;
+		num += (n << 16) | 1U;
 		break;
-	case ID_DAP_Vendor21:
+
+	case ID_DAP_Vendor_FlashStart:
+		// Request:  algorithm (1 byte, 0xFF = identify the target), erase mode (1 byte),
+		//           flash address (4 bytes), image length (4 bytes), page size (2 bytes,
+		//           0 = algorithm buffer size), sector size (4 bytes, erase modes
+		//           FLASH_ERASE_SECTOR and _INCREMENTAL, 0 with algorithm 0xFF = sector
+		//           size of the identified part when the image is in one sector group)
+		// Response: status (1 byte), error (1 byte, error_tt)
+		// The target is reset, halted and the algorithm downloaded and initialized.
+		// In the incremental mode the address is sector aligned and a sector is whole pages
+		// of at most FLASH_BUFFER_SIZE bytes.
+		FlashStart(request);
+		*response++ = flash.status;
+		*response++ = flash.error;
+		num += (16U << 16) | 2U;
 		break;
-	case ID_DAP_Vendor22:
+
+	case ID_DAP_Vendor_FlashData:
+		// Request:  image data (up to DAP_PACKET_SIZE - 1 bytes) for the session
+		// Response: status (1 byte), error (1 byte), bytes programmed (4 bytes)
+		// A packet that completes a block (or the image) returns after the block is programmed,
+		// data after a failed step is dropped and the first error is reported until FlashEnd.
+		n = 0U;
+		if (flash.state == FLASH_STATE_ACTIVE)
+		{
+			n = (flash.size < (DAP_PACKET_SIZE - 1U)) ? flash.size : (DAP_PACKET_SIZE - 1U);
+			FlashData(request, n);
+		}
+		num += (n << 16) + FlashProgress(response);
 		break;
-	case ID_DAP_Vendor23:
+
+	case ID_DAP_Vendor_FlashStatus:
+		// Request:  none
+		// Response: state (1 byte), status (1 byte), error (1 byte), bytes programmed (4 bytes),
+		//           image bytes still expected (4 bytes), incremental mode: sectors skipped
+		//           (4 bytes), sectors programmed (4 bytes), compare time in us (4 bytes),
+		//           estimated time saved in us (4 bytes, skipped sectors at the average time
+		//           of a programmed one less the compare time, 0 before a sector is programmed)
+		*response++ = flash.state;
+		response += FlashProgress(response);
+		*response++ = (uint8_t)(flash.size >> 0);
+		*response++ = (uint8_t)(flash.size >> 8);
+		*response++ = (uint8_t)(flash.size >> 16);
+		*response++ = (uint8_t)(flash.size >> 24);
+		*response++ = (uint8_t)(flash.skipped >> 0);
+		*response++ = (uint8_t)(flash.skipped >> 8);
+		*response++ = (uint8_t)(flash.skipped >> 16);
+		*response++ = (uint8_t)(flash.skipped >> 24);
+		*response++ = (uint8_t)(flash.changed >> 0);
+		*response++ = (uint8_t)(flash.changed >> 8);
+		*response++ = (uint8_t)(flash.changed >> 16);
+		*response++ = (uint8_t)(flash.changed >> 24);
+		*response++ = (uint8_t)(flash.check_us >> 0);
+		*response++ = (uint8_t)(flash.check_us >> 8);
+		*response++ = (uint8_t)(flash.check_us >> 16);
+		*response++ = (uint8_t)(flash.check_us >> 24);
+		n = FlashSaved();
+		*response++ = (uint8_t)(n >> 0);
+		*response++ = (uint8_t)(n >> 8);
+		*response++ = (uint8_t)(n >> 16);
+		*response++ = (uint8_t)(n >> 24);
+		num += 27U;
 		break;
-	case ID_DAP_Vendor24:
+
+	case ID_DAP_Vendor_FlashEnd:
+		// Request:  none
+		// Response: status (1 byte), error (1 byte), bytes programmed (4 bytes)
+		// A partial block still buffered is programmed, then the target is released from
+		// reset to run and the debug port is switched off.
+		if (flash.state == FLASH_STATE_ACTIVE)
+		{
+			if ((flash.count != 0U) && (flash.status == DAP_OK))
+			{
+				FlashBlock();
+			}
+			target_flash_uninit();
+			flash.state = FLASH_STATE_DONE;
+		}
+		num += FlashProgress(response);
 		break;
-	case ID_DAP_Vendor25:
+
+	case ID_DAP_Vendor_AlgoLoad:
+		// Request:  algorithm name (NUL terminated, less than FLM_NAME_SIZE characters)
+		// Response: status (1 byte), algorithm (1 byte, FLM_ERROR_* negated on error),
+		//           flash address (4 bytes), flash size (4 bytes), page size (4 bytes)
+		// A compiled-in or cached algorithm is returned at once, otherwise the FLM file is
+		// parsed from the FLM store in the storage partition into the algorithm cache. The
+		// algorithm number is used by FlashStart, flash address and size are 0 when unknown.
+		n = strnlen((const char *)request, DAP_PACKET_SIZE - 1U);
+		num += ((n + 1U) << 16) + AlgoLoad(request, DAP_PACKET_SIZE - 1U, response);
 		break;
-	case ID_DAP_Vendor26:
+
+	case ID_DAP_Vendor_Identify:
+		// Request:  none
+		// Response: status (1 byte, DAP_ERROR for an unknown part), algorithm (1 byte),
+		//           cached (1 byte), DP IDCODE, CPUID, DBGMCU_IDCODE, ROM table PIDR
+		//           (designer bits 22:12, part bits 11:0), flash address, flash size
+		//           (4 bytes each, 0 when unknown)
+		// Needs a connected SWD port, DP SELECT and the MEM-AP CSW and TAR are changed. The
+		// result of the previous identification is reused (cached = 1) while DP IDCODE and
+		// DBGMCU_IDCODE are unchanged. FlashStart with algorithm 0xFF identifies the target
+		// in the same way.
+		num += TargetInfo(TargetIdentify(), response);
 		break;
-	case ID_DAP_Vendor27:
+
+	case ID_DAP_Vendor_CoreRead:
+		// Request:  register count (1 byte, 0 = R0-R15, xPSR, MSP, PSP and CONTROL/FAULTMASK/
+		//           BASEPRI/PRIMASK), DCRSR REGSEL numbers (count bytes)
+		// Response: status (1 byte, DAP_ERROR when the core is not halted), register values
+		//           (4 bytes each, up to DAP_PACKET_SIZE - 2 bytes). Further packets of this
+		//           format follow through the read stream as for MemRead until all
+		//           registers are sent.
+		// The registers are read through pipelined DCRSR/DCRDR transfers before the first
+		// packet, a debugger takes a halt snapshot with one request.
+		num += (CoreRead(request) << 16) + MemReadPacket(response);
 		break;
-	case ID_DAP_Vendor28:
+
+	case ID_DAP_Vendor_TarWrap:
+		// Request:  APSEL (1 byte), TAR wrap size (4 bytes, power of 2 from 1 KB, 0 = detect)
+		// Response: status (1 byte), TAR wrap size in effect (4 bytes)
+		// The wrap size is where DAP_TransferBlock and the memory commands write TAR again
+		// during a DRW block, 1 KB (the ADIv5 minimum) until set. Detection needs a
+		// connected SWD port and a ROM table on the AP, it changes DP SELECT and the CSW
+		// and TAR of the AP. The setting is kept until the next swd_init_debug.
+		num += (5U << 16) + TarWrap(request, response);
 		break;
-	case ID_DAP_Vendor29:
+
+	case ID_DAP_Vendor_Gang:
+		// Request:  target mask (2 bytes, bit n = gang target n, 0 = single target on SWDIO)
+		// Response: status (1 byte, DAP_ERROR without DAP_GANG or for a target beyond
+		//           DAP_GANG_CNT)
+		// The following FlashStart to FlashEnd session, Identify and the memory commands go to
+		// the selected targets in lockstep. A target failing a transfer or a check drops out,
+		// the others go on. The selection is kept until the next Gang command.
+		*response++ = GangSelect(request);
+		num += (2U << 16) | 1U;
 		break;
-	case ID_DAP_Vendor30:
+
+	case ID_DAP_Vendor_GangStatus:
+		// Request:  none
+		// Response: status (1 byte, DAP_ERROR without DAP_GANG), targets still live (2 bytes),
+		//           error per gang target (DAP_GANG_CNT bytes, error_tt of the flash step the
+		//           target dropped out in, ERROR_FAILURE when it was not selected)
+		num += GangStatus(response);
 		break;
-	case ID_DAP_Vendor31:
+#endif
+
+	default:
+		*(response - 1) = ID_DAP_Invalid;
 		break;
 	}
 
 	return (num);
 }
 
+/** Check for a vendor command with response packets still to send (MemRead stream).
+\return 1 when \ref DAP_ProcessVendorStream has another packet.
+*/
+uint32_t DAP_VendorStreamPending(void)
+{
+#if (DAP_SWD != 0)
+	return mem.read;
+#else
+	return (0U);
+#endif
+}
+
+/** Prepare the next response packet of a streaming vendor command.
+Called by the transport in place of a request while \ref DAP_VendorStreamPending is set.
+\param response  pointer to response data
+\return          number of bytes in response
+*/
+uint32_t DAP_ProcessVendorStream(uint8_t *response)
+{
+#if (DAP_SWD != 0)
+	DAP_Data.swd_ap.valid = 0U;
+	*response = mem.cmd;
+	return (1U + MemReadPacket(response + 1));
+#else
+	(void)response;
+	return (0U);
+#endif
+}
+
 ///@}
@@ -62,6 +62,100 @@
 
 #if (DAP_JTAG != 0)
 
+// Shift 8 bits i_val[7:0] out on TDI
+#define JTAG_SEQUENCE_BYTE(i_val) \
+	JTAG_CYCLE_TDI((i_val) >> 0); \
+	JTAG_CYCLE_TDI((i_val) >> 1); \
+	JTAG_CYCLE_TDI((i_val) >> 2); \
+	JTAG_CYCLE_TDI((i_val) >> 3); \
+	JTAG_CYCLE_TDI((i_val) >> 4); \
+	JTAG_CYCLE_TDI((i_val) >> 5); \
+	JTAG_CYCLE_TDI((i_val) >> 6); \
+	JTAG_CYCLE_TDI((i_val) >> 7)
+
+// Shift 8 bits i_val[7:0] out on TDI and capture TDO into o_val[7:0]
+#define JTAG_SEQUENCE_BYTE_TDO(i_val, o_val) \
+	JTAG_CYCLE_TDIO((i_val) >> 0, bit); \
+	o_val = bit << 0;                   \
+	JTAG_CYCLE_TDIO((i_val) >> 1, bit); \
+	o_val |= bit << 1;                  \
+	JTAG_CYCLE_TDIO((i_val) >> 2, bit); \
+	o_val |= bit << 2;                  \
+	JTAG_CYCLE_TDIO((i_val) >> 3, bit); \
+	o_val |= bit << 3;                  \
+	JTAG_CYCLE_TDIO((i_val) >> 4, bit); \
+	o_val |= bit << 4;                  \
+	JTAG_CYCLE_TDIO((i_val) >> 5, bit); \
+	o_val |= bit << 5;                  \
+	JTAG_CYCLE_TDIO((i_val) >> 6, bit); \
+	o_val |= bit << 6;                  \
+	JTAG_CYCLE_TDIO((i_val) >> 7, bit); \
+	o_val |= bit << 7
+
+// JTAG Sequence kernel: whole bytes unrolled, TDO only sampled when captured
+//   n:      number of TCK cycles
+//   tdi:    pointer to TDI generated data
+//   tdo:    pointer to TDO captured data (NULL = no capture)
+//   return: none
+#define JTAG_SequenceFunction(speed) /**/                                          \
+	static void JTAG_Sequence##speed(uint32_t n, const uint8_t *tdi, uint8_t *tdo) \
+	{                                                                              \
+		const uint32_t delay = DAP_Data.clock_delay;                               \
+		uint32_t i_val;                                                            \
+		uint32_t o_val;                                                            \
+		uint32_t bit;                                                              \
+		uint32_t k;                                                                \
+                                                                                   \
+		(void)delay;                                                               \
+		if (tdo != NULL)                                                           \
+		{                                                                          \
+			for (; n >= 8U; n -= 8U)                                               \
+			{                                                                      \
+				i_val = *tdi++;                                                    \
+				JTAG_SEQUENCE_BYTE_TDO(i_val, o_val);                              \
+				*tdo++ = (uint8_t)o_val;                                           \
+			}                                                                      \
+			if (n)                                                                 \
+			{                                                                      \
+				i_val = *tdi;                                                      \
+				o_val = 0U;                                                        \
+				for (k = 0U; k < n; k++)                                           \
+				{                                                                  \
+					JTAG_CYCLE_TDIO(i_val >> k, bit);                              \
+					o_val |= bit << k;                                             \
+				}                                                                  \
+				*tdo = (uint8_t)o_val;                                             \
+			}                                                                      \
+		}                                                                          \
+		else                                                                       \
+		{                                                                          \
+			for (; n >= 8U; n -= 8U)                                               \
+			{                                                                      \
+				i_val = *tdi++;                                                    \
+				JTAG_SEQUENCE_BYTE(i_val);                                         \
+			}                                                                      \
+			if (n)                                                                 \
+			{                                                                      \
+				i_val = *tdi;                                                      \
+				for (k = 0U; k < n; k++)                                           \
+				{                                                                  \
+					JTAG_CYCLE_TDI(i_val >> k);                                    \
+				}                                                                  \
+			}                                                                      \
+		}                                                                          \
+	}
+
+#undef PIN_DELAY
+#define PIN_DELAY() PIN_DELAY_FAST()
+JTAG_SequenceFunction(Fast);
+
+#undef PIN_DELAY
+#define PIN_DELAY() PIN_DELAY_SLOW(delay)
+JTAG_SequenceFunction(Slow);
+
+#undef PIN_DELAY
+#define PIN_DELAY() PIN_DELAY_SLOW(DAP_Data.clock_delay)
+
 // Generate JTAG Sequence
 //   info:   sequence information
 //   tdi:    pointer to TDI generated data
@@ -69,16 +163,20 @@
 //   return: none
 void JTAG_Sequence(uint32_t info, const uint8_t *tdi, uint8_t *tdo)
 {
-	uint32_t i_val;
-	uint32_t o_val;
-	uint32_t bit;
-	uint32_t n, k;
+	uint32_t n;
+#if (DAP_SPI != 0)
+	uint32_t k;
+#endif
 
 	n = info & JTAG_SEQUENCE_TCK;
 	if (n == 0U)
 	{
 		n = 64U;
 	}
+	if ((info & JTAG_SEQUENCE_TDO) == 0U)
+	{
+		tdo = NULL;
+	}
 
 	if (info & JTAG_SEQUENCE_TMS)
 	{
@@ -89,22 +187,28 @@ void JTAG_Sequence(uint32_t info, const uint8_t *tdi, uint8_t *tdo)
 		PIN_TMS_CLR();
 	}
 
-	while (n)
+#if (DAP_SPI != 0)
+	if (DAP_Data.spi_clock && (n >= 8U))
 	{
-		i_val = *tdi++;
-		o_val = 0U;
-		for (k = 8U; k && n; k--, n--)
+		// Whole bytes through the SPI, the remaining bits below
+		k = n & ~7U;
+		SPI_JTAG_Shift(tdi, tdo, k);
+		tdi += k / 8U;
+		if (tdo != NULL)
 		{
-			JTAG_CYCLE_TDIO(i_val, bit);
-			i_val >>= 1;
-			o_val >>= 1;
-			o_val |= bit << 7;
-		}
-		o_val >>= k;
-		if (info & JTAG_SEQUENCE_TDO)
-		{
-			*tdo++ = (uint8_t)o_val;
+			tdo += k / 8U;
 		}
+		n -= k;
+	}
+#endif
+
+	if (DAP_Data.fast_clock)
+	{
+		JTAG_SequenceFast(n, tdi, tdo);
+	}
+	else
+	{
+		JTAG_SequenceSlow(n, tdi, tdo);
 	}
 }
 
@@ -13,23 +13,86 @@
  */
 #include "SWD_host.h"
 #include "SWD_flash.h"
+#include "DAP_config.h"
 //#include "../algo/STM32F10x_OPT.c"
-uint32_t Flash_Page_Size = 1024;
 extern uint8_t Select_algo;
+
+#if (DAP_GANG != 0)
+static error_tt gang_status[DAP_GANG_CNT]; // Result per gang target
+static uint32_t gang_seen;				   // Live gang targets after the last step
+#endif
+
+// Result of one programming step. In gang mode the targets that dropped out
+// during the step get err as their status, the step only fails when no
+// target is left.
+static error_tt flash_step(uint8_t ok, error_tt err)
+{
+#if (DAP_GANG != 0)
+	uint32_t live = swd_gang_live();
+	uint32_t n;
+
+	for (n = 0; n < DAP_GANG_CNT; n++)
+	{
+		if ((gang_seen & ~live) & (1U << n))
+		{
+			gang_status[n] = err;
+		}
+	}
+
+	gang_seen = live;
+#endif
+
+	return ok ? ERROR_SUCCESS : err;
+}
+
+// Program the targets in the mask (bit n = gang target n) together with the
+// following target_flash_* calls, 0 returns to the single target on SWDIO.
+void target_flash_gang(uint32_t targets)
+{
+#if (DAP_GANG != 0)
+	uint32_t n;
+
+	swd_gang_select(targets);
+	gang_seen = swd_gang_live();
+
+	for (n = 0; n < DAP_GANG_CNT; n++)
+	{
+		gang_status[n] = (gang_seen & (1U << n)) ? ERROR_SUCCESS : ERROR_FAILURE;
+	}
+#else
+	(void)targets;
+#endif
+}
+
+// Result of a gang target: the error of the step it failed in, or ERROR_SUCCESS
+error_tt target_flash_gang_status(uint32_t target)
+{
+#if (DAP_GANG != 0)
+	if (target < DAP_GANG_CNT)
+	{
+		return gang_status[target];
+	}
+#else
+	(void)target;
+#endif
+
+	return ERROR_FAILURE;
+}
+
 error_tt target_flash_init(uint32_t flash_start)
 {
-	if (0 == swd_set_target_state_hw(RESET_PROGRAM))
+	if (ERROR_SUCCESS != flash_step(swd_set_target_state_hw(RESET_PROGRAM), ERROR_RESET))
 	{
 		return ERROR_RESET;
 	}
 
 	// 下载编程算法到目标MCU的SRAM，并初始化
-	if (0 == swd_write_memory(STM32_ALGO[Select_algo].algo.algo_start, (uint8_t *)STM32_ALGO[Select_algo].algo.algo_blob, STM32_ALGO[Select_algo].algo.algo_size))
+	if (ERROR_SUCCESS != flash_step(swd_write_memory(STM32_ALGO[Select_algo].algo.algo_start, (uint8_t *)STM32_ALGO[Select_algo].algo.algo_blob, STM32_ALGO[Select_algo].algo.algo_size), ERROR_ALGO_DL))
 	{
 		return ERROR_ALGO_DL;
 	}
 
-	if (0 == swd_flash_syscall_exec(&STM32_ALGO[Select_algo].algo.sys_call_s, STM32_ALGO[Select_algo].algo.init, flash_start, 0, 0, 0))
+	if (ERROR_SUCCESS != flash_step(swd_flash_syscall_exec(&STM32_ALGO[Select_algo].algo.sys_call_s, STM32_ALGO[Select_algo].algo.init, flash_start, 0, 0, 0), ERROR_INIT))
 	{
 		return ERROR_INIT;
 	}
@@ -45,40 +108,166 @@ error_tt target_flash_uninit(void)
 	return ERROR_SUCCESS;
 }
 
+// Page data is downloaded in slices while the previous ProgramPage call runs, the
+// target is polled for its end between the slices
+#define FLASH_POLL_SLICE 256U
+
+// Second program buffer of the algorithm when it does not overlap the algorithm, the
+// first buffer or the static data and stack of the algorithm. Static data inside the
+// blob (loaded FLM files) has the stack right behind the blob.
+static uint8_t flash_double_buffer(const program_target_t *algo)
+{
+	uint32_t start = algo->program_buffer2;
+	uint32_t end = start + algo->program_buffer_size;
+	uint32_t data = algo->sys_call_s.static_base;
+
+	if ((data >= algo->algo_start) && (data < (algo->algo_start + algo->algo_size)))
+	{
+		data = algo->algo_start + algo->algo_size;
+	}
+
+	if ((start == 0) || (end < start))
+	{
+		return 0;
+	}
+	if ((start < (algo->algo_start + algo->algo_size)) && (end > algo->algo_start))
+	{
+		return 0;
+	}
+	if ((start < (algo->program_buffer + algo->program_buffer_size)) && (end > algo->program_buffer))
+	{
+		return 0;
+	}
+	if ((start < algo->sys_call_s.stack_pointer) && (end > data))
+	{
+		return 0;
+	}
+
+	return 1;
+}
+
+// Download a page to a program buffer. When a ProgramPage call is running (*busy) its end
+// is polled between the slices and its result is taken as soon as the target halts.
+static error_tt flash_download(uint32_t buffer, const uint8_t *buf, uint32_t size, uint8_t *busy)
+{
+	uint32_t n;
+	uint8_t halted;
+
+	while (size > 0)
+	{
+		n = (*busy && (size > FLASH_POLL_SLICE)) ? FLASH_POLL_SLICE : size;
+
+		if (ERROR_SUCCESS != flash_step(swd_write_memory(buffer, (uint8_t *)buf, n), ERROR_ALGO_DATA_SEQ))
+		{
+			return ERROR_ALGO_DATA_SEQ;
+		}
+
+		buffer += n;
+		buf += n;
+		size -= n;
+
+		if (*busy)
+		{
+			if (ERROR_SUCCESS != flash_step(swd_flash_syscall_halted(&halted), ERROR_WRITE))
+			{
+				return ERROR_WRITE;
+			}
+
+			if (halted)
+			{
+				*busy = 0;
+
+				if (ERROR_SUCCESS != flash_step(swd_flash_syscall_result(), ERROR_WRITE))
+				{
+					return ERROR_WRITE;
+				}
+			}
+		}
+	}
+
+	return ERROR_SUCCESS;
+}
+
 error_tt target_flash_program_page(uint32_t addr, const uint8_t *buf, uint32_t size)
 {
+	const program_target_t *algo = &STM32_ALGO[Select_algo].algo;
+	uint32_t buffer[2] = {algo->program_buffer, algo->program_buffer};
+	uint32_t n = 0;
+	uint8_t busy = 0;
+	error_tt status;
+
+	// Ping-pong between two buffers: page N+1 is downloaded while page N programs
+	if (flash_double_buffer(algo))
+	{
+		buffer[1] = algo->program_buffer2;
+	}
+
 	while (size > 0)
 	{
-		uint32_t write_size = size > STM32_ALGO[Select_algo].algo.program_buffer_size ? STM32_ALGO[Select_algo].algo.program_buffer_size : size;
+		uint32_t write_size = size > algo->program_buffer_size ? algo->program_buffer_size : size;
+
+		// A single buffer has to wait for the running call
+		if (busy && (buffer[n] == buffer[n ^ 1]))
+		{
+			busy = 0;
+
+			if (ERROR_SUCCESS != flash_step(swd_flash_syscall_result(), ERROR_WRITE))
+			{
+				return ERROR_WRITE;
+			}
+		}
 
 		// Write page to buffer
-		if (!swd_write_memory(STM32_ALGO[Select_algo].algo.program_buffer, (uint8_t *)buf, write_size))
+		status = flash_download(buffer[n], buf, write_size, &busy);
+
+		if (ERROR_SUCCESS != status)
 		{
-			return ERROR_ALGO_DATA_SEQ;
+			return status;
+		}
+
+		if (busy)
+		{
+			busy = 0;
+
+			if (ERROR_SUCCESS != flash_step(swd_flash_syscall_result(), ERROR_WRITE))
+			{
+				return ERROR_WRITE;
+			}
 		}
 
 		// Run flash programming
-		if (!swd_flash_syscall_exec(&STM32_ALGO[Select_algo].algo.sys_call_s,
-									STM32_ALGO[Select_algo].algo.program_page,
-									addr,
-									STM32_ALGO[Select_algo].algo.program_buffer_size,
-									STM32_ALGO[Select_algo].algo.program_buffer,
-									0))
+		if (ERROR_SUCCESS != flash_step(swd_flash_syscall_start(&algo->sys_call_s,
+																algo->program_page,
+																addr,
+																algo->program_buffer_size,
+																buffer[n],
+																0),
+										ERROR_WRITE))
 		{
 			return ERROR_WRITE;
 		}
 
+		busy = 1;
+		n ^= 1;
 		addr += write_size;
 		buf += write_size;
 		size -= write_size;
 	}
 
+	if (busy)
+	{
+		if (ERROR_SUCCESS != flash_step(swd_flash_syscall_result(), ERROR_WRITE))
+		{
+			return ERROR_WRITE;
+		}
+	}
+
 	return ERROR_SUCCESS;
 }
 
 error_tt target_flash_erase_sector(uint32_t addr)
 {
-	if (0 == swd_flash_syscall_exec(&STM32_ALGO[Select_algo].algo.sys_call_s, STM32_ALGO[Select_algo].algo.erase_sector, addr, 0, 0, 0))
+	if (ERROR_SUCCESS != flash_step(swd_flash_syscall_exec(&STM32_ALGO[Select_algo].algo.sys_call_s, STM32_ALGO[Select_algo].algo.erase_sector, addr, 0, 0, 0), ERROR_ERASE_SECTOR))
 	{
 		return ERROR_ERASE_SECTOR;
 	}
@@ -90,10 +279,103 @@ error_tt target_flash_erase_chip(void)
 {
 	error_tt status = ERROR_SUCCESS;
 
-	if (0 == swd_flash_syscall_exec(&STM32_ALGO[Select_algo].algo.sys_call_s, STM32_ALGO[Select_algo].algo.erase_chip, 0, 0, 0, 0))
+	// EraseChip is optional in a loaded FLM
+	if (STM32_ALGO[Select_algo].algo.erase_chip == 0)
+	{
+		return ERROR_ERASE_ALL;
+	}
+
+	if (ERROR_SUCCESS != flash_step(swd_flash_syscall_exec(&STM32_ALGO[Select_algo].algo.sys_call_s, STM32_ALGO[Select_algo].algo.erase_chip, 0, 0, 0, 0), ERROR_ERASE_ALL))
 	{
 		return ERROR_ERASE_ALL;
 	}
 
 	return status;
 }
+
+// CRC-32 (IEEE 802.3, as zlib) through a nibble table, shared by the probe and the
+// target helper below so both give the same value
+static const uint32_t crc32_table[16] = {
+	0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+	0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C};
+
+// Target helper: uint32_t crc32(const uint8_t *data, uint32_t size), Thumb-1 so it runs on
+// every Cortex-M. Position independent, it is placed in the program buffer and returns
+// through the breakpoint of the flash algorithm.
+//
+//		movs r2, #0				mvns r2, r2			// crc = ~0
+//		adr r3, table			movs r5, #60		// nibble index mask << 2
+//		cmp r1, #0				beq done
+// loop:	ldrb r4, [r0]			adds r0, #1
+//		eors r2, r4
+//		lsls r4, r2, #2			ands r4, r5			ldr r4, [r3, r4]
+//		lsrs r2, r2, #4			eors r2, r4
+//		lsls r4, r2, #2			ands r4, r5			ldr r4, [r3, r4]
+//		lsrs r2, r2, #4			eors r2, r4
+//		subs r1, #1				bne loop
+// done:	mvns r0, r2				bx lr
+static const uint32_t crc32_blob[] = {
+	0x43D22200, 0x253CA30A, 0xD00E2900, 0x30017804, 0x00944062, 0x591C402C, 0x40620912, 0x402C0094,
+	0x0912591C, 0x39014062, 0x43D0D1F0, 0x46C04770, 0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC,
+	0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C, 0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C,
+	0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C};
+
+// Target memory read back for the CRC when the helper cannot run
+#define FLASH_READBACK_SIZE 256U
+
+static uint32_t crc32_update(uint32_t crc, const uint8_t *data, uint32_t size)
+{
+	while (size--)
+	{
+		crc ^= *data++;
+		crc = (crc >> 4) ^ crc32_table[crc & 15];
+		crc = (crc >> 4) ^ crc32_table[crc & 15];
+	}
+
+	return crc;
+}
+
+// CRC-32 of a buffer on the probe
+uint32_t flash_crc32(const uint8_t *data, uint32_t size)
+{
+	return ~crc32_update(0xFFFFFFFF, data, size);
+}
+
+// CRC-32 of target memory, computed by the helper in the target when it fits into the
+// program buffer, otherwise (or when it fails) from the memory read back over SWD.
+// Needs the flash algorithm set up by target_flash_init.
+error_tt target_flash_crc32(uint32_t addr, uint32_t size, uint32_t *crc)
+{
+	const program_target_t *algo = &STM32_ALGO[Select_algo].algo;
+	static uint8_t readback[FLASH_READBACK_SIZE];
+	uint32_t n;
+
+	if (sizeof(crc32_blob) <= algo->program_buffer_size)
+	{
+		if (swd_write_memory(algo->program_buffer, (uint8_t *)crc32_blob, sizeof(crc32_blob)) &&
+			swd_flash_syscall_start(&algo->sys_call_s, algo->program_buffer + 1, addr, size, 0, 0) &&
+			swd_flash_syscall_value(crc))
+		{
+			return ERROR_SUCCESS;
+		}
+	}
+
+	*crc = 0xFFFFFFFF;
+
+	while (size > 0)
+	{
+		n = (size > FLASH_READBACK_SIZE) ? FLASH_READBACK_SIZE : size;
+
+		if (!swd_read_memory(addr, readback, n))
+		{
+			return ERROR_VERIFY;
+		}
+
+		*crc = crc32_update(*crc, readback, n);
+		addr += n;
+		size -= n;
+	}
+
+	*crc = ~*crc;
+	return ERROR_SUCCESS;
+}
@@ -3,13 +3,14 @@
  * @brief   Host driver for accessing the DAP
  */
 
+#include <string.h>
+
 #include "SWD_host.h"
 #include "DAP_config.h"
 #include "DAP.h"
 #include "debug_cm.h"
 // #include "cmsis_compiler.h"
 // #include "core_cm3.h"
-extern uint32_t Flash_Page_Size;
 
 #define NVIC_Addr (0xe000e000)
 #define DBG_Addr (0xe000edf0)
@@ -32,10 +33,24 @@ extern uint32_t Flash_Page_Size;
 #define MAX_SWD_RETRY 10
 #define MAX_TIMEOUT 1000000 // Timeout for syscalls on target
 
+// Debug registers through the banked data registers, TAR = DBG_Addr
+#define BD_DHCSR AP_BD0
+#define BD_DCRSR AP_BD1
+#define BD_DCRDR AP_BD2
+#define BD_DEMCR AP_BD3
+
+#define SWD_BATCH_SIZE 64 // Accesses queued before the batch is run
+
+// MEM-AP TAR auto-increment wrap
+#define TAR_WRAP_MIN 1024 // Range ADIv5 guarantees
+#define TAR_WRAP_MAX 4096 // Largest detected, the size of a ROM table
+#define TAR_WRAP_AP_CNT 4 // APs with a wrap size, a higher APSEL uses TAR_WRAP_MIN
+
 typedef struct
 {
 	uint32_t select;
 	uint32_t csw;
+	uint8_t wrap[TAR_WRAP_AP_CNT]; // log2 of the TAR wrap size per APSEL, 0 = not known
 } DAP_STATE;
 
 typedef struct
@@ -44,8 +59,50 @@ typedef struct
 	uint32_t xpsr;
 } DEBUG_STATE;
 
-static DAP_STATE dap_state;
+typedef struct
+{
+	uint8_t req;	 // SWD request
+	uint32_t adr;	 // Register address as for swd_read_dp/swd_read_ap
+	uint32_t data;	 // Write data
+	uint32_t *val;	 // Read data, NULL = not needed
+	uint32_t mask;	 // Read data check (data & mask) == expect, mask 0 = none
+	uint32_t expect;
+} SWD_BATCH_ITEM;
+
+typedef struct
+{
+	SWD_BATCH_ITEM item[SWD_BATCH_SIZE];
+	uint32_t cnt;
+	SWD_BATCH_ITEM posted; // AP read in flight
+	uint8_t reading;	   // posted is valid
+	uint8_t written;	   // AP writes not acknowledged by a later read yet
+	uint8_t error;
+} SWD_BATCH;
 
+typedef struct
+{
+	uint32_t targetsel; // TARGETSEL value, 0 = slot unused
+	DAP_STATE state;	// DP state while another target is selected
+} DAP_TARGET;
+
+static DAP_STATE dap_state;
+static SWD_BATCH swd_batch;
+
+// Multi-drop: the selected target and the cached DP state of the others
+static uint32_t dap_targetsel; // 0 = single-drop
+static DAP_TARGET dap_targets[DAP_MULTIDROP_CNT];
+static uint32_t dap_target_next; // Slot replaced when all are in use
+
+#if (DAP_GANG != 0)
+// Gang mode: while gang_targets is set all transfers go to the live targets in
+// lockstep. A target failing a transfer or a check leaves gang_live and only
+// sees idle cycles until the next swd_gang_select.
+static uint32_t gang_targets;
+static uint32_t gang_live;
+static uint32_t gang_data[DAP_GANG_CNT]; // Data of the last transfer per target
+#endif
+
+static uint8_t swd_read_word(uint32_t addr, uint32_t *val);
 static uint8_t swd_read_core_register(uint32_t n, uint32_t *val);
 static uint8_t swd_write_core_register(uint32_t n, uint32_t val);
 
@@ -68,10 +125,70 @@ static void int2array(uint8_t *res, uint32_t data, uint8_t len)
 	}
 }
 
+#if (DAP_GANG != 0)
+// Gang transfer: same request and write data on all live targets, WAIT is
+// retried on the targets that answered it only. Targets ending without OK
+// are dropped. Read data of every target is left in gang_data.
+//   return: OK while a target is live, data from the first live target
+static uint8_t swd_gang_transfer_retry(uint32_t req, uint32_t *data)
+{
+	uint8_t ack[DAP_GANG_CNT];
+	uint32_t pending = gang_live;
+	uint32_t i, n;
+
+	if (!(req & SWD_REG_R))
+	{
+		for (n = 0; n < DAP_GANG_CNT; n++)
+		{
+			gang_data[n] = *data;
+		}
+	}
+
+	for (i = 0; (i < MAX_SWD_RETRY) && pending; i++)
+	{
+		SWD_GangTransfer(pending, req, gang_data, ack);
+
+		for (n = 0; n < DAP_GANG_CNT; n++)
+		{
+			if ((pending & (1U << n)) && (ack[n] != DAP_TRANSFER_WAIT))
+			{
+				pending &= ~(1U << n);
+
+				if (ack[n] != DAP_TRANSFER_OK)
+				{
+					gang_live &= ~(1U << n);
+				}
+			}
+		}
+	}
+
+	gang_live &= ~pending;
+
+	if (gang_live == 0)
+	{
+		return DAP_TRANSFER_ERROR;
+	}
+
+	if ((req & SWD_REG_R) && (data != NULL))
+	{
+		*data = gang_data[__builtin_ctz(gang_live)];
+	}
+
+	return DAP_TRANSFER_OK;
+}
+#endif
+
 static uint8_t swd_transfer_retry(uint32_t req, uint32_t *data)
 {
 	uint8_t i, ack;
 
+#if (DAP_GANG != 0)
+	if (gang_targets)
+	{
+		return swd_gang_transfer_retry(req, data);
+	}
+#endif
+
 	for (i = 0; i < MAX_SWD_RETRY; i++)
 	{
 		ack = SWD_Transfer(req, data);
@@ -85,10 +202,106 @@ static uint8_t swd_transfer_retry(uint32_t req, uint32_t *data)
 	return ack;
 }
 
+// Check (val & mask) == expect on the value just read. In gang mode the
+// value of every live target is checked and, with drop set, the targets
+// failing it leave the gang.
+static uint8_t swd_check(uint32_t val, uint32_t mask, uint32_t expect, uint8_t drop)
+{
+#if (DAP_GANG != 0)
+	uint32_t n, fail = 0;
+
+	if (gang_targets)
+	{
+		for (n = 0; n < DAP_GANG_CNT; n++)
+		{
+			if ((gang_live & (1U << n)) && ((gang_data[n] & mask) != expect))
+			{
+				fail |= 1U << n;
+			}
+		}
+
+		if (drop)
+		{
+			gang_live &= ~fail;
+			return (gang_live != 0);
+		}
+
+		return (fail == 0);
+	}
+#else
+	(void)drop;
+#endif
+
+	return ((val & mask) == expect);
+}
+
+// Poll a word in target memory until all bits in mask are set.
+static uint8_t swd_wait_word(uint32_t addr, uint32_t mask, uint32_t timeout, uint32_t *val)
+{
+	uint32_t i;
+
+	for (i = 0; i < timeout; i++)
+	{
+		if (!swd_read_word(addr, val))
+		{
+			return 0;
+		}
+
+		if (swd_check(*val, mask, mask, 0))
+		{
+			return 1;
+		}
+	}
+
+	return swd_check(*val, mask, mask, 1);
+}
+
+// SWJ sequence on SWDIO, or on the SWDIO of all live targets in gang mode.
+static void swd_sequence(uint32_t count, const uint8_t *data)
+{
+#if (DAP_GANG != 0)
+	if (gang_targets)
+	{
+		SWD_GangSequence(gang_live, count, data);
+		return;
+	}
+#endif
+
+	SWJ_Sequence(count, data);
+}
+
+// Select the gang targets (bit n = gang target n) for the following
+// operations, 0 returns to the single target on SWDIO.
+void swd_gang_select(uint32_t targets)
+{
+#if (DAP_GANG != 0)
+	gang_targets = targets & ((1U << DAP_GANG_CNT) - 1U);
+	gang_live = gang_targets;
+#else
+	(void)targets;
+#endif
+}
+
+// Gang targets that passed everything since swd_gang_select, 0 when not in gang mode.
+uint32_t swd_gang_live(void)
+{
+#if (DAP_GANG != 0)
+	return gang_live;
+#else
+	return 0;
+#endif
+}
+
 uint8_t swd_init(void)
 {
 	DAP_Setup();
 	PORT_SWD_SETUP();
+#if (DAP_GANG != 0)
+	if (gang_targets)
+	{
+		PORT_GANG_SETUP();
+	}
+#endif
 
 	return 1;
 }
@@ -96,6 +309,13 @@ uint8_t swd_init(void)
 uint8_t swd_off(void)
 {
 	PORT_OFF();
+#if (DAP_GANG != 0)
+	// Release the SWDIO of the gang targets as well
+	for (uint32_t n = 0; gang_targets && (n < DAP_GANG_CNT); n++)
+	{
+		PIN_GANG_SWDIO_OUT_DISABLE(PIN_GANG_SWDIO_MASK(n));
+	}
+#endif
 
 	return 1;
 }
@@ -153,78 +373,266 @@ uint8_t swd_write_dp(uint8_t adr, uint32_t val)
 	return (ack == 0x01);
 }
 
-// Read access port register.
-uint8_t swd_read_ap(uint32_t adr, uint32_t *val)
+// Batched transfers: swd_batch_start, queue DP and AP accesses, swd_batch_end.
+// The queue is run when it is full and by swd_batch_end. SELECT and CSW writes
+// matching the cached values are dropped, consecutive AP reads are posted so
+// each one returns the data of the previous one and only the last needs an
+// RDBUFF read. Sticky errors are checked once at the end: the ACK of the
+// closing RDBUFF read reports them, after AP writes CTRL/STAT is read. Read
+// data is valid once swd_batch_end returned 1, in gang mode it comes from the
+// first live target while the checks are done on every target.
+void swd_batch_start(void)
 {
-	uint8_t tmp_in, ack;
-	uint8_t tmp_out[4];
-	uint32_t tmp;
-	uint32_t apsel = adr & 0xff000000;
-	uint32_t bank_sel = adr & APBANKSEL;
+	swd_batch.cnt = 0;
+	swd_batch.reading = 0;
+	swd_batch.written = 0;
+	swd_batch.error = 0;
+}
+
+// Store and check read data that arrived with the last transfer
+static uint8_t swd_batch_result(const SWD_BATCH_ITEM *item, uint32_t data)
+{
+	if (item->val != NULL)
+	{
+		*item->val = data;
+	}
+
+	return swd_check(data, item->mask, item->expect, 0);
+}
+
+// Collect the AP read in flight
+static uint8_t swd_batch_drain(void)
+{
+	uint32_t data;
+
+	if (!swd_batch.reading)
+	{
+		return 1;
+	}
+
+	// The ACK also covers the AP writes before the read
+	swd_batch.reading = 0;
+	swd_batch.written = 0;
 
-	if (!swd_write_dp(DP_SELECT, apsel | bank_sel))
+	if (swd_transfer_retry(SWD_REG_DP | SWD_REG_R | SWD_REG_ADR(DP_RDBUFF), &data) != DAP_TRANSFER_OK)
 	{
 		return 0;
 	}
 
-	tmp_in = SWD_REG_AP | SWD_REG_R | SWD_REG_ADR(adr);
-	// first dummy read
-	swd_transfer_retry(tmp_in, (uint32_t *)tmp_out);
-	ack = swd_transfer_retry(tmp_in, (uint32_t *)tmp_out);
+	return swd_batch_result(&swd_batch.posted, data);
+}
 
-	*val = 0;
-	tmp = tmp_out[3];
-	*val |= (tmp << 24);
-	tmp = tmp_out[2];
-	*val |= (tmp << 16);
-	tmp = tmp_out[1];
-	*val |= (tmp << 8);
-	tmp = tmp_out[0];
-	*val |= (tmp << 0);
+static uint8_t swd_batch_select(uint32_t select)
+{
+	if (dap_state.select == select)
+	{
+		return 1;
+	}
 
-	return (ack == 0x01);
+	if (!swd_batch_drain())
+	{
+		return 0;
+	}
+
+	dap_state.select = select;
+	return (swd_transfer_retry(SWD_REG_DP | SWD_REG_W | SWD_REG_ADR(DP_SELECT), &select) == DAP_TRANSFER_OK);
 }
 
-// Write access port register
-uint8_t swd_write_ap(uint32_t adr, uint32_t val)
+static uint8_t swd_batch_item(const SWD_BATCH_ITEM *item)
 {
-	uint8_t data[4];
-	uint8_t req, ack;
-	uint32_t apsel = adr & 0xff000000;
-	uint32_t bank_sel = adr & APBANKSEL;
+	uint32_t data = item->data;
+
+	if (!(item->req & SWD_REG_AP))
+	{
+		if (!swd_batch_drain())
+		{
+			return 0;
+		}
+
+		if (item->req == (SWD_REG_DP | SWD_REG_W | SWD_REG_ADR(DP_SELECT)))
+		{
+			return swd_batch_select(data);
+		}
+
+		if (swd_transfer_retry(item->req, &data) != DAP_TRANSFER_OK)
+		{
+			return 0;
+		}
 
-	if (!swd_write_dp(DP_SELECT, apsel | bank_sel))
+		return (item->req & SWD_REG_R) ? swd_batch_result(item, data) : 1;
+	}
+
+	if (!swd_batch_select(item->adr & (0xff000000 | APBANKSEL)))
 	{
 		return 0;
 	}
 
-	switch (adr)
+	if (item->req & SWD_REG_R)
 	{
-	case AP_CSW:
-		if (dap_state.csw == val)
+		// Posted read, the data of the read in flight comes back
+		if (swd_transfer_retry(item->req, &data) != DAP_TRANSFER_OK)
+		{
+			return 0;
+		}
+
+		if (swd_batch.reading && !swd_batch_result(&swd_batch.posted, data))
+		{
+			return 0;
+		}
+
+		swd_batch.posted = *item;
+		swd_batch.reading = 1;
+		return 1;
+	}
+
+	if (!swd_batch_drain())
+	{
+		return 0;
+	}
+
+	if (item->adr == AP_CSW)
+	{
+		if (dap_state.csw == data)
 		{
 			return 1;
 		}
 
-		dap_state.csw = val;
-		break;
+		dap_state.csw = data;
+	}
 
-	default:
-		break;
+	swd_batch.written = 1;
+	return (swd_transfer_retry(item->req, &data) == DAP_TRANSFER_OK);
+}
+
+static void swd_batch_run(void)
+{
+	uint32_t i;
+
+	for (i = 0; (i < swd_batch.cnt) && !swd_batch.error; i++)
+	{
+		if (!swd_batch_item(&swd_batch.item[i]))
+		{
+			swd_batch.error = 1;
+		}
 	}
 
-	req = SWD_REG_AP | SWD_REG_W | SWD_REG_ADR(adr);
-	int2array(data, val, 4);
+	swd_batch.cnt = 0;
+}
+
+static void swd_batch_queue(uint8_t req, uint32_t adr, uint32_t data, uint32_t *val, uint32_t mask, uint32_t expect)
+{
+	SWD_BATCH_ITEM *item;
 
-	if (swd_transfer_retry(req, (uint32_t *)data) != 0x01)
+	if (swd_batch.cnt == SWD_BATCH_SIZE)
 	{
-		return 0;
+		swd_batch_run();
 	}
 
-	req = SWD_REG_DP | SWD_REG_R | SWD_REG_ADR(DP_RDBUFF);
-	ack = swd_transfer_retry(req, NULL);
+	item = &swd_batch.item[swd_batch.cnt++];
+	item->req = req;
+	item->adr = adr;
+	item->data = data;
+	item->val = val;
+	item->mask = mask;
+	item->expect = expect;
+}
 
-	return (ack == 0x01);
+void swd_batch_read_dp(uint8_t adr, uint32_t *val)
+{
+	swd_batch_queue(SWD_REG_DP | SWD_REG_R | SWD_REG_ADR(adr), adr, 0, val, 0, 0);
+}
+
+void swd_batch_write_dp(uint8_t adr, uint32_t val)
+{
+	swd_batch_queue(SWD_REG_DP | SWD_REG_W | SWD_REG_ADR(adr), adr, val, NULL, 0, 0);
+}
+
+void swd_batch_read_ap(uint32_t adr, uint32_t *val)
+{
+	swd_batch_queue(SWD_REG_AP | SWD_REG_R | SWD_REG_ADR(adr), adr, 0, val, 0, 0);
+}
+
+// Read an AP register and fail the batch unless (value & mask) == expect
+void swd_batch_check_ap(uint32_t adr, uint32_t mask, uint32_t expect)
+{
+	swd_batch_queue(SWD_REG_AP | SWD_REG_R | SWD_REG_ADR(adr), adr, 0, NULL, mask, expect);
+}
+
+void swd_batch_write_ap(uint32_t adr, uint32_t val)
+{
+	swd_batch_queue(SWD_REG_AP | SWD_REG_W | SWD_REG_ADR(adr), adr, val, NULL, 0, 0);
+}
+
+// Read a 32-bit word from target memory
+void swd_batch_read_word(uint32_t addr, uint32_t *val)
+{
+	swd_batch_write_ap(AP_CSW, CSW_VALUE | CSW_SIZE32);
+	swd_batch_write_ap(AP_TAR, addr);
+	swd_batch_read_ap(AP_DRW, val);
+}
+
+// Write a 32-bit word to target memory
+void swd_batch_write_word(uint32_t addr, uint32_t val)
+{
+	swd_batch_write_ap(AP_CSW, CSW_VALUE | CSW_SIZE32);
+	swd_batch_write_ap(AP_TAR, addr);
+	swd_batch_write_ap(AP_DRW, val);
+}
+
+// Run what is left in the queue and check for sticky errors
+uint8_t swd_batch_end(void)
+{
+	uint32_t status;
+	uint8_t ok;
+
+	swd_batch_run();
+
+	if (!swd_batch.error && !swd_batch_drain())
+	{
+		swd_batch.error = 1;
+	}
+
+	if (!swd_batch.error && swd_batch.written)
+	{
+		// A DP register read does not wait for a posted AP write, RDBUFF does: the
+		// last write has completed (or faulted) once it is read. CTRL/STAT is in DP bank 0.
+		if ((swd_transfer_retry(SWD_REG_DP | SWD_REG_R | SWD_REG_ADR(DP_RDBUFF), &status) != DAP_TRANSFER_OK) ||
+			!swd_batch_select(dap_state.select & ~0x0FU) ||
+			(swd_transfer_retry(SWD_REG_DP | SWD_REG_R | SWD_REG_ADR(DP_CTRL_STAT), &status) != DAP_TRANSFER_OK) ||
+			!swd_check(status, STICKYERR | WDATAERR, 0, 1))
+		{
+			swd_batch.error = 1;
+		}
+	}
+
+	ok = !swd_batch.error;
+
+	if (!ok)
+	{
+		// The cached SELECT and CSW may not have reached the target
+		swd_invalidate_state();
+		status = STKCMPCLR | STKERRCLR | WDERRCLR | ORUNERRCLR;
+		swd_transfer_retry(SWD_REG_DP | SWD_REG_W | SWD_REG_ADR(DP_ABORT), &status);
+	}
+
+	swd_batch_start();
+	return ok;
+}
+
+// Read access port register.
+uint8_t swd_read_ap(uint32_t adr, uint32_t *val)
+{
+	swd_batch_start();
+	swd_batch_read_ap(adr, val);
+	return swd_batch_end();
+}
+
+// Write access port register
+uint8_t swd_write_ap(uint32_t adr, uint32_t val)
+{
+	swd_batch_start();
+	swd_batch_write_ap(adr, val);
+	return swd_batch_end();
 }
 
 // Write 32-bit word aligned values to target memory using address auto-increment.
@@ -463,16 +871,115 @@ static uint8_t swd_write_byte(uint32_t addr, uint8_t val)
 
 	if (!swd_write_data(addr, tmp))
 	{
-		return 0;
+		return 0;
+	}
+
+	return 1;
+}
+
+// TAR auto-increment wrap of a MEM-AP in bytes, TAR_WRAP_MIN until it is
+// detected or configured
+uint32_t swd_tar_wrap(uint8_t apsel)
+{
+	if ((apsel >= TAR_WRAP_AP_CNT) || (dap_state.wrap[apsel] == 0))
+	{
+		return TAR_WRAP_MIN;
+	}
+
+	return 1U << dap_state.wrap[apsel];
+}
+
+// Configure the TAR wrap of a MEM-AP, a power of 2 from TAR_WRAP_MIN, 0 = not known
+uint8_t swd_set_tar_wrap(uint8_t apsel, uint32_t size)
+{
+	if ((apsel >= TAR_WRAP_AP_CNT) || ((size != 0) && ((size < TAR_WRAP_MIN) || (size & (size - 1)))))
+	{
+		return 0;
+	}
+
+	dap_state.wrap[apsel] = (size != 0) ? __builtin_ctz(size) : 0;
+	return 1;
+}
+
+// Detect the TAR wrap of a MEM-AP. TAR is set to the last word before the 1 KB
+// and 2 KB boundaries in the ROM table of the AP, a register block without side
+// effects, and read back after a DRW read: it wrapped when it did not reach the
+// boundary. Without a ROM table, or when an access fails, TAR_WRAP_MIN is taken.
+uint8_t swd_detect_tar_wrap(uint8_t apsel)
+{
+	uint32_t ap = (uint32_t)apsel << 24;
+	uint32_t base, size;
+	uint32_t tar[2];
+	uint8_t ok;
+
+	if (apsel >= TAR_WRAP_AP_CNT)
+	{
+		return 0;
+	}
+
+	dap_state.wrap[apsel] = __builtin_ctz(TAR_WRAP_MIN);
+
+	// BASE: 0xFFFFFFFF (legacy) or bit 0 clear = no ROM table
+	if (!swd_read_ap(ap | AP_ROM, &base) || (base == 0xFFFFFFFF) || !(base & 1))
+	{
+		return 0;
+	}
+
+	base &= ~(TAR_WRAP_MAX - 1);
+
+	swd_batch_start();
+	swd_batch_write_ap(ap | AP_CSW, CSW_VALUE | CSW_SIZE32);
+
+	for (size = TAR_WRAP_MIN; size < TAR_WRAP_MAX; size <<= 1)
+	{
+		swd_batch_write_ap(ap | AP_TAR, base + size - 4);
+		swd_batch_read_ap(ap | AP_DRW, NULL);
+		swd_batch_read_ap(ap | AP_TAR, &tar[__builtin_ctz(size / TAR_WRAP_MIN)]);
+	}
+
+	ok = swd_batch_end();
+
+	for (size = TAR_WRAP_MIN; ok && (size < TAR_WRAP_MAX); size <<= 1)
+	{
+		if (tar[__builtin_ctz(size / TAR_WRAP_MIN)] != (base + size))
+		{
+			break;
+		}
+	}
+
+	if (ok)
+	{
+		dap_state.wrap[apsel] = __builtin_ctz(size);
+	}
+
+	return ok;
+}
+
+// TAR wrap of AP 0 for the block transfers, detected on first use. Gang targets
+// keep TAR_WRAP_MIN unless it is configured, a target failing the detection would
+// leave the gang.
+static uint32_t swd_mem_wrap(void)
+{
+#if (DAP_GANG != 0)
+	if (gang_targets)
+	{
+		return swd_tar_wrap(0);
+	}
+#endif
+
+	if (dap_state.wrap[0] == 0)
+	{
+		swd_detect_tar_wrap(0);
 	}
 
-	return 1;
+	return swd_tar_wrap(0);
 }
 
 // Read unaligned data from target memory.
 // size is in bytes.
 uint8_t swd_read_memory(uint32_t address, uint8_t *data, uint32_t size)
 {
+	uint32_t wrap = swd_mem_wrap();
 	uint32_t n;
 
 	// Read bytes until word aligned
@@ -491,8 +998,8 @@ uint8_t swd_read_memory(uint32_t address, uint8_t *data, uint32_t size)
 	// Read word aligned blocks
 	while (size > 3)
 	{
-		// Limit to auto increment page size
-		n = Flash_Page_Size - (address & (Flash_Page_Size - 1));
+		// Limit to the auto increment wrap
+		n = wrap - (address & (wrap - 1));
 
 		if (size < n)
 		{
@@ -529,6 +1036,7 @@ uint8_t swd_read_memory(uint32_t address, uint8_t *data, uint32_t size)
 // size is in bytes.
 uint8_t swd_write_memory(uint32_t address, uint8_t *data, uint32_t size)
 {
+	uint32_t wrap = swd_mem_wrap();
 	uint32_t n = 0;
 
 	// Write bytes until word aligned
@@ -547,8 +1055,8 @@ uint8_t swd_write_memory(uint32_t address, uint8_t *data, uint32_t size)
 	// Write word aligned blocks
 	while (size > 3)
 	{
-		// Limit to auto increment page size
-		n = Flash_Page_Size - (address & (Flash_Page_Size - 1));
+		// Limit to the auto increment wrap
+		n = wrap - (address & (wrap - 1));
 
 		if (size < n)
 		{
@@ -581,44 +1089,117 @@ uint8_t swd_write_memory(uint32_t address, uint8_t *data, uint32_t size)
 	return 1;
 }
 
-// Execute system call.
-static uint8_t swd_write_debug_state(DEBUG_STATE *state)
+// Core registers set up for a system call
+static const uint8_t debug_state_regs[] = {0, 1, 2, 3, 9, 13, 14, 15, 16};
+
+// Queue DCRSR/DCRDR transfers of core registers through the banked data
+// registers (TAR = DBG_Addr). DHCSR is read behind every DCRSR write and
+// S_REGRDY checked when the next transfer brings the value back, at SWD speed
+// the register transfer has finished by then unless the core clock is very
+// slow. A read needs four transfers per register, a write three and the
+// RDBUFF read of the previous DHCSR read.
+static void swd_batch_core_registers(const uint8_t *regs, uint32_t cnt, uint32_t *val, uint8_t write)
 {
-	uint32_t i, status;
+	uint32_t i;
 
-	if (!swd_write_dp(DP_SELECT, 0))
+	swd_batch_write_ap(AP_CSW, CSW_VALUE | CSW_SIZE32);
+	swd_batch_write_ap(AP_TAR, DBG_Addr);
+
+	for (i = 0; i < cnt; i++)
 	{
-		return 0;
+		if (write)
+		{
+			swd_batch_write_ap(BD_DCRDR, val[i]);
+			swd_batch_write_ap(BD_DCRSR, regs[i] | REGWnR);
+			swd_batch_check_ap(BD_DHCSR, S_REGRDY, S_REGRDY);
+		}
+		else
+		{
+			swd_batch_write_ap(BD_DCRSR, regs[i]);
+			swd_batch_check_ap(BD_DHCSR, S_REGRDY, S_REGRDY);
+			swd_batch_read_ap(BD_DCRDR, &val[i]);
+		}
+	}
+}
+
+// Read core registers of the halted core, regs are DCRSR REGSEL numbers
+uint8_t swd_read_core_registers(const uint8_t *regs, uint32_t cnt, uint32_t *val)
+{
+	uint32_t i;
+
+	swd_batch_start();
+	swd_batch_core_registers(regs, cnt, val, 0);
+
+	if (swd_batch_end())
+	{
+		return 1;
 	}
 
-	// R0, R1, R2, R3
-	for (i = 0; i < 4; i++)
+	// Register by register, polling S_REGRDY
+	for (i = 0; i < cnt; i++)
 	{
-		if (!swd_write_core_register(i, state->r[i]))
+		if (!swd_read_core_register(regs[i], &val[i]))
 		{
 			return 0;
 		}
 	}
 
-	// R9
-	if (!swd_write_core_register(9, state->r[9]))
+	return 1;
+}
+
+// Write core registers of the halted core, regs are DCRSR REGSEL numbers
+uint8_t swd_write_core_registers(const uint8_t *regs, uint32_t cnt, const uint32_t *val)
+{
+	uint32_t i;
+
+	swd_batch_start();
+	swd_batch_core_registers(regs, cnt, (uint32_t *)val, 1);
+
+	if (swd_batch_end())
 	{
-		return 0;
+		return 1;
 	}
 
-	// R13, R14, R15
-	for (i = 13; i < 16; i++)
+	// Register by register, polling S_REGRDY
+	for (i = 0; i < cnt; i++)
 	{
-		if (!swd_write_core_register(i, state->r[i]))
+		if (!swd_write_core_register(regs[i], val[i]))
 		{
 			return 0;
 		}
 	}
 
-	// xPSR
-	if (!swd_write_core_register(16, state->xpsr))
+	return 1;
+}
+
+// Execute system call.
+static uint8_t swd_write_debug_state(DEBUG_STATE *state)
+{
+	uint32_t val[sizeof(debug_state_regs)];
+	uint32_t i, status;
+
+	for (i = 0; i < sizeof(debug_state_regs); i++)
+	{
+		val[i] = (debug_state_regs[i] == 16) ? state->xpsr : state->r[debug_state_regs[i]];
+	}
+
+	// Registers and debug enable in one batch
+	swd_batch_start();
+	swd_batch_core_registers(debug_state_regs, sizeof(debug_state_regs), val, 1);
+	swd_batch_write_ap(BD_DHCSR, DBGKEY | C_DEBUGEN);
+
+	if (swd_batch_end())
 	{
-		return 0;
+		return 1;
+	}
+
+	// Register by register, polling S_REGRDY
+	for (i = 0; i < sizeof(debug_state_regs); i++)
+	{
+		if (!swd_write_core_register(debug_state_regs[i], val[i]))
+		{
+			return 0;
+		}
 	}
 
 	if (!swd_write_word(DBG_HCSR, DBGKEY | C_DEBUGEN))
@@ -632,7 +1213,7 @@ static uint8_t swd_write_debug_state(DEBUG_STATE *state)
 		return 0;
 	}
 
-	if (status & (STICKYERR | WDATAERR))
+	if (!swd_check(status, STICKYERR | WDATAERR, 0, 1))
 	{
 		return 0;
 	}
@@ -642,7 +1223,7 @@ static uint8_t swd_write_debug_state(DEBUG_STATE *state)
 
 static uint8_t swd_read_core_register(uint32_t n, uint32_t *val)
 {
-	int i = 0, timeout = 100;
+	int timeout = 100;
 
 	if (!swd_write_word(DCRSR, n))
 	{
@@ -650,20 +1231,7 @@ static uint8_t swd_read_core_register(uint32_t n, uint32_t *val)
 	}
 
 	// wait for S_REGRDY
-	for (i = 0; i < timeout; i++)
-	{
-		if (!swd_read_word(DHCSR, val))
-		{
-			return 0;
-		}
-
-		if (*val & S_REGRDY)
-		{
-			break;
-		}
-	}
-
-	if (i == timeout)
+	if (!swd_wait_word(DHCSR, S_REGRDY, timeout, val))
 	{
 		return 0;
 	}
@@ -678,7 +1246,7 @@ static uint8_t swd_read_core_register(uint32_t n, uint32_t *val)
 
 static uint8_t swd_write_core_register(uint32_t n, uint32_t val)
 {
-	int i = 0, timeout = 100;
+	int timeout = 100;
 
 	if (!swd_write_word(DCRDR, val))
 	{
@@ -691,47 +1259,23 @@ static uint8_t swd_write_core_register(uint32_t n, uint32_t val)
 	}
 
 	// wait for S_REGRDY
-	for (i = 0; i < timeout; i++)
-	{
-		if (!swd_read_word(DHCSR, &val))
-		{
-			return 0;
-		}
-
-		if (val & S_REGRDY)
-		{
-			return 1;
-		}
-	}
-
-	return 0;
+	return swd_wait_word(DHCSR, S_REGRDY, timeout, &val);
 }
 
 static uint8_t swd_wait_until_halted(void)
 {
 	// Wait for target to stop
-	uint32_t val, i, timeout = MAX_TIMEOUT;
-
-	for (i = 0; i < timeout; i++)
-	{
-		if (!swd_read_word(DBG_HCSR, &val))
-		{
-			return 0;
-		}
-
-		if (val & S_HALT)
-		{
-			return 1;
-		}
-	}
+	uint32_t val;
 
-	return 0;
+	return swd_wait_word(DBG_HCSR, S_HALT, MAX_TIMEOUT, &val);
 }
 
-uint8_t swd_flash_syscall_exec(const program_syscall_t *sysCallParam, uint32_t entry, uint32_t arg1, uint32_t arg2, uint32_t arg3, uint32_t arg4)
+// Start a flash algorithm function on the target, swd_flash_syscall_result
+// waits for it. The memory the function does not use may be accessed meanwhile.
+uint8_t swd_flash_syscall_start(const program_syscall_t *sysCallParam, uint32_t entry, uint32_t arg1, uint32_t arg2, uint32_t arg3, uint32_t arg4)
 {
 	DEBUG_STATE state = {{0}, 0};
-	// Call flash algorithm function on target and wait for result.
+	// Call flash algorithm function on target.
 	state.r[0] = arg1;						   // R0: Argument 1
 	state.r[1] = arg2;						   // R1: Argument 2
 	state.r[2] = arg3;						   // R2: Argument 3
@@ -742,23 +1286,48 @@ uint8_t swd_flash_syscall_exec(const program_syscall_t *sysCallParam, uint32_t e
 	state.r[15] = entry;					   // PC: Entry Point
 	state.xpsr = 0x01000000;				   // xPSR: T = 1, ISR = 0
 
-	if (!swd_write_debug_state(&state))
+	return swd_write_debug_state(&state);
+}
+
+// Check once whether the function started by swd_flash_syscall_start has returned
+uint8_t swd_flash_syscall_halted(uint8_t *halted)
+{
+	uint32_t val;
+
+	if (!swd_read_word(DBG_HCSR, &val))
 	{
 		return 0;
 	}
 
+	*halted = (val & S_HALT) ? 1 : 0;
+	return 1;
+}
+
+// Wait for the function started by swd_flash_syscall_start and read its return value
+uint8_t swd_flash_syscall_value(uint32_t *val)
+{
+	const uint8_t r0 = 0;
+
 	if (!swd_wait_until_halted())
 	{
 		return 0;
 	}
 
-	if (!swd_read_core_register(0, &state.r[0]))
+	return swd_read_core_registers(&r0, 1, val);
+}
+
+// Wait for the function started by swd_flash_syscall_start and check its result
+uint8_t swd_flash_syscall_result(void)
+{
+	uint32_t r0;
+
+	if (!swd_flash_syscall_value(&r0))
 	{
 		return 0;
 	}
 
 	// Flash functions return 0 if successful.
-	if (state.r[0] != 0)
+	if (!swd_check(r0, 0xFFFFFFFF, 0, 1))
 	{
 		return 0;
 	}
@@ -766,6 +1335,17 @@ uint8_t swd_flash_syscall_exec(const program_syscall_t *sysCallParam, uint32_t e
 	return 1;
 }
 
+uint8_t swd_flash_syscall_exec(const program_syscall_t *sysCallParam, uint32_t entry, uint32_t arg1, uint32_t arg2, uint32_t arg3, uint32_t arg4)
+{
+	// Call flash algorithm function on target and wait for result.
+	if (!swd_flash_syscall_start(sysCallParam, entry, arg1, arg2, arg3, arg4))
+	{
+		return 0;
+	}
+
+	return swd_flash_syscall_result();
+}
+
 // SWD Reset
 static uint8_t swd_reset(void)
 {
@@ -777,7 +1357,7 @@ static uint8_t swd_reset(void)
 		tmp_in[i] = 0xff;
 	}
 
-	SWJ_Sequence(51, tmp_in);
+	swd_sequence(51, tmp_in);
 	return 1;
 }
 
@@ -787,7 +1367,45 @@ static uint8_t swd_switch(uint16_t val)
 	uint8_t tmp_in[2];
 	tmp_in[0] = val & 0xff;
 	tmp_in[1] = (val >> 8) & 0xff;
-	SWJ_Sequence(16, tmp_in);
+	swd_sequence(16, tmp_in);
+	return 1;
+}
+
+// SWD Dormant to SWD: leave SWD and JTAG for the dormant state first, then
+// selection alert, SWD activation code and line reset (ADIv5.2 B5.3)
+static uint8_t swd_wakeup(void)
+{
+	static const uint8_t seq[] = {
+		// SWD to dormant: line reset and 0xE3BC
+		0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xbc, 0xe3,
+		// JTAG to dormant: TMS high and 0x33BBBBBA (ignored by a dormant DP)
+		0xff, 0xba, 0xbb, 0xbb, 0x33,
+		// Dormant to SWD: TMS high, selection alert, 4 cycles low, activation code 0x1A
+		0xff,
+		0x92, 0xf3, 0x09, 0x62, 0x95, 0x2d, 0x85, 0x86,
+		0xe9, 0xaf, 0xdd, 0xe3, 0xa2, 0x0e, 0xbc, 0x19,
+		0xa0, 0xf1};
+
+	swd_sequence(sizeof(seq) * 8, seq);
+	return 1;
+}
+
+// SWD Write TARGETSEL: header, five cycles nobody drives instead of
+// turnaround/ACK/turnaround, then the data phase
+static uint8_t swd_write_targetsel(uint32_t val)
+{
+	uint8_t tmp[5];
+
+	tmp[0] = 0x00; // Idle cycles after the line reset
+	SWD_Sequence(8, tmp, NULL);
+	tmp[0] = 0x99; // Start, DP, W, A[3:2] = 3, parity, stop, park
+	SWD_Sequence(8, tmp, NULL);
+	PIN_SWDIO_OUT_DISABLE();
+	SWD_Sequence(SWD_SEQUENCE_DIN | 5, NULL, tmp);
+	PIN_SWDIO_OUT_ENABLE();
+	int2array(tmp, val, 4);
+	tmp[4] = __builtin_parity(val);
+	SWD_Sequence(33, tmp, NULL);
 	return 1;
 }
 
@@ -797,7 +1415,7 @@ static uint8_t swd_read_idcode(uint32_t *id)
 	uint8_t tmp_in[1];
 	uint8_t tmp_out[4];
 	tmp_in[0] = 0x00;
-	SWJ_Sequence(8, tmp_in);
+	swd_sequence(8, tmp_in);
 
 	if (swd_read_dp(0, (uint32_t *)tmp_out) != 0x01)
 	{
@@ -812,6 +1430,15 @@ static uint8_t JTAG2SWD()
 {
 	uint32_t tmp = 0;
 
+	// Multi-drop targets wake up from dormant and are addressed by TARGETSEL
+	if (dap_targetsel)
+	{
+		swd_wakeup();
+		swd_reset();
+		swd_write_targetsel(dap_targetsel);
+		return swd_read_idcode(&tmp);
+	}
+
 	if (!swd_reset())
 	{
 		return 0;
@@ -835,6 +1462,98 @@ static uint8_t JTAG2SWD()
 	return 1;
 }
 
+// Cache slot of a multi-drop target
+static DAP_TARGET *swd_target_slot(uint32_t targetsel)
+{
+	uint32_t n;
+
+	for (n = 0; n < DAP_MULTIDROP_CNT; n++)
+	{
+		if (dap_targets[n].targetsel == targetsel)
+		{
+			return &dap_targets[n];
+		}
+	}
+
+	return NULL;
+}
+
+// Select the SW-DP of a multi-drop system for the following operations.
+//   targetsel: TINSTANCE[31:28] TPARTNO[27:12] TDESIGNER[11:1] 1, 0 = single-drop
+// A target seen before keeps its DP state and only takes a line reset,
+// TARGETSEL, an IDCODE and a CTRL/STAT read, a new one is brought up by
+// swd_init_debug. So is a target seen before that does not answer or lost
+// its debug power (power cycled, dormant again). A target failing
+// swd_init_debug gives up its slot.
+uint8_t swd_select_target(uint32_t targetsel)
+{
+	DAP_TARGET *slot;
+	uint32_t tmp;
+
+	if (targetsel == dap_targetsel)
+	{
+		return 1;
+	}
+
+	slot = swd_target_slot(dap_targetsel);
+
+	if ((dap_targetsel != 0) && (slot != NULL))
+	{
+		slot->state = dap_state;
+	}
+
+	dap_targetsel = targetsel;
+
+	if (targetsel == 0)
+	{
+		return swd_init_debug();
+	}
+
+	slot = swd_target_slot(targetsel);
+
+	if (slot != NULL)
+	{
+		dap_state = slot->state;
+		swd_reset();
+		swd_write_targetsel(targetsel);
+
+		// Awake and still powered up (DPBANKSEL is always 0 in the cached SELECT)
+		if (swd_read_idcode(&tmp) && swd_read_dp(DP_CTRL_STAT, &tmp) &&
+			((tmp & (CDBGPWRUPACK | CSYSPWRUPACK)) == (CDBGPWRUPACK | CSYSPWRUPACK)))
+		{
+			return 1;
+		}
+	}
+	else
+	{
+		// New target: take a free slot or replace one
+		slot = swd_target_slot(0);
+
+		if (slot == NULL)
+		{
+			slot = &dap_targets[dap_target_next];
+			dap_target_next = (dap_target_next + 1) % DAP_MULTIDROP_CNT;
+		}
+
+		slot->targetsel = targetsel;
+	}
+
+	if (!swd_init_debug())
+	{
+		slot->targetsel = 0;
+		return 0;
+	}
+
+	return 1;
+}
+
+// Forget the cached SELECT and CSW, the host may have changed them through DAP_Transfer
+void swd_invalidate_state(void)
+{
+	dap_state.select = 0xffffffff;
+	dap_state.csw = 0xffffffff;
+}
+
 uint8_t swd_init_debug(void)
 {
 	uint32_t tmp = 0;
@@ -843,6 +1562,7 @@ uint8_t swd_init_debug(void)
 	// init dap state with fake values
 	dap_state.select = 0xffffffff;
 	dap_state.csw = 0xffffffff;
+	memset(dap_state.wrap, 0, sizeof(dap_state.wrap));
 	swd_init();
 
 	// call a target dependant function
@@ -878,14 +1598,14 @@ uint8_t swd_init_debug(void)
 			return 0;
 		}
 
-		if ((tmp & (CDBGPWRUPACK | CSYSPWRUPACK)) == (CDBGPWRUPACK | CSYSPWRUPACK))
+		if (swd_check(tmp, CDBGPWRUPACK | CSYSPWRUPACK, CDBGPWRUPACK | CSYSPWRUPACK, 0))
 		{
 			// Break from loop if powerup is complete
 			break;
 		}
 	}
 
-	if (i == timeout)
+	if ((i == timeout) && !swd_check(tmp, CDBGPWRUPACK | CSYSPWRUPACK, CDBGPWRUPACK | CSYSPWRUPACK, 1))
 	{
 		// Unable to powerup DP
 		return 0;
@@ -923,6 +1643,25 @@ __attribute__((weak)) void swd_set_target_reset(uint8_t asserted)
 //     }
 // }
 
+// Connect to a running target and enable debug
+static uint8_t swd_enable_debug(void)
+{
+	if (!JTAG2SWD())
+	{
+		return 0;
+	}
+
+	swd_batch_start();
+	swd_batch_write_dp(DP_ABORT, STKCMPCLR | STKERRCLR | WDERRCLR | ORUNERRCLR);
+	// Ensure CTRL/STAT register selected in DPBANKSEL
+	swd_batch_write_dp(DP_SELECT, 0);
+	// Power up
+	swd_batch_write_dp(DP_CTRL_STAT, CSYSPWRUPREQ | CDBGPWRUPREQ);
+	// Enable debug
+	swd_batch_write_word(DBG_HCSR, DBGKEY | C_DEBUGEN);
+	return swd_batch_end();
+}
+
 uint8_t swd_set_target_state_hw(TARGET_RESET_STATE state)
 {
 	uint32_t val;
@@ -954,9 +1693,18 @@ uint8_t swd_set_target_state_hw(TARGET_RESET_STATE state)
 			return 0;
 		}
 
-		// Enable debug
-		while (swd_write_word(DBG_HCSR, DBGKEY | C_DEBUGEN) == 0)
+		// Enable debug and halt on reset
+		for (;;)
 		{
+			swd_batch_start();
+			swd_batch_write_word(DBG_HCSR, DBGKEY | C_DEBUGEN);
+			swd_batch_write_word(DBG_EMCR, VC_CORERESET);
+
+			if (swd_batch_end())
+			{
+				break;
+			}
+
 			if (--ap_retries <= 0)
 				return 0;
 
@@ -967,25 +1715,16 @@ uint8_t swd_set_target_state_hw(TARGET_RESET_STATE state)
 			delaymS(20);
 		}
 
-		// Enable halt on reset
-		if (!swd_write_word(DBG_EMCR, VC_CORERESET))
-		{
-			return 0;
-		}
-
 		// Reset again
 		swd_set_target_reset(1);
 		delaymS(20);
 		swd_set_target_reset(0);
 		delaymS(20);
 
-		do
+		if (!swd_wait_word(DBG_HCSR, S_HALT, MAX_TIMEOUT, &val))
 		{
-			if (!swd_read_word(DBG_HCSR, &val))
-			{
-				return 0;
-			}
-		} while ((val & S_HALT) == 0);
+			return 0;
+		}
 
 		// Disable halt on reset
 		if (!swd_write_word(DBG_EMCR, 0))
@@ -1004,30 +1743,7 @@ uint8_t swd_set_target_state_hw(TARGET_RESET_STATE state)
 		break;
 
 	case DEBUG:
-		if (!JTAG2SWD())
-		{
-			return 0;
-		}
-
-		if (!swd_write_dp(DP_ABORT, STKCMPCLR | STKERRCLR | WDERRCLR | ORUNERRCLR))
-		{
-			return 0;
-		}
-
-		// Ensure CTRL/STAT register selected in DPBANKSEL
-		if (!swd_write_dp(DP_SELECT, 0))
-		{
-			return 0;
-		}
-
-		// Power up
-		if (!swd_write_dp(DP_CTRL_STAT, CSYSPWRUPREQ | CDBGPWRUPREQ))
-		{
-			return 0;
-		}
-
-		// Enable debug
-		if (!swd_write_word(DBG_HCSR, DBGKEY | C_DEBUGEN))
+		if (!swd_enable_debug())
 		{
 			return 0;
 		}
@@ -1047,13 +1763,10 @@ uint8_t swd_set_target_state_hw(TARGET_RESET_STATE state)
 		}
 
 		// Wait until core is halted
-		do
+		if (!swd_wait_word(DBG_HCSR, S_HALT, MAX_TIMEOUT, &val))
 		{
-			if (!swd_read_word(DBG_HCSR, &val))
-			{
-				return 0;
-			}
-		} while ((val & S_HALT) == 0);
+			return 0;
+		}
 
 		break;
 
@@ -1074,7 +1787,7 @@ uint8_t swd_set_target_state_hw(TARGET_RESET_STATE state)
 
 uint8_t swd_set_target_state_sw(TARGET_RESET_STATE state)
 {
-	uint32_t val;
+	uint32_t val, aircr;
 
 	/* Calling swd_init prior to enterring RUN state causes operations to fail. */
 	if (state != RUN)
@@ -1102,47 +1815,36 @@ uint8_t swd_set_target_state_sw(TARGET_RESET_STATE state)
 			return 0;
 		}
 
-		// Enable debug and halt the core (DHCSR <- 0xA05F0003)
-		if (!swd_write_word(DBG_HCSR, DBGKEY | C_DEBUGEN | C_HALT))
+		// Enable debug and halt the core (DHCSR <- 0xA05F0003), enable halt
+		// on reset and read AIRCR for the soft reset
+		swd_batch_start();
+		swd_batch_write_word(DBG_HCSR, DBGKEY | C_DEBUGEN | C_HALT);
+		swd_batch_write_word(DBG_EMCR, VC_CORERESET);
+		swd_batch_read_word(NVIC_AIRCR, &aircr);
+
+		if (!swd_batch_end())
 		{
 			return 0;
 		}
 
 		// Wait until core is halted
-		do
-		{
-			if (!swd_read_word(DBG_HCSR, &val))
-			{
-				return 0;
-			}
-		} while ((val & S_HALT) == 0);
-
-		// Enable halt on reset
-		if (!swd_write_word(DBG_EMCR, VC_CORERESET))
+		if (!swd_wait_word(DBG_HCSR, S_HALT, MAX_TIMEOUT, &val))
 		{
 			return 0;
 		}
 
 		// Perform a soft reset
-		if (!swd_read_word(NVIC_AIRCR, &val))
-		{
-			return 0;
-		}
-
-		if (!swd_write_word(NVIC_AIRCR, VECTKEY | (val & SCB_AIRCR_PRIGROUP_Msk) | SYSRESETREQ))
+		if (!swd_write_word(NVIC_AIRCR, VECTKEY | (aircr & SCB_AIRCR_PRIGROUP_Msk) | SYSRESETREQ))
 		{
 			return 0;
 		}
 
 		delaymS(20);
 
-		do
+		if (!swd_wait_word(DBG_HCSR, S_HALT, MAX_TIMEOUT, &val))
 		{
-			if (!swd_read_word(DBG_HCSR, &val))
-			{
-				return 0;
-			}
-		} while ((val & S_HALT) == 0);
+			return 0;
+		}
 
 		// Disable halt on reset
 		if (!swd_write_word(DBG_EMCR, 0))
@@ -1161,30 +1863,7 @@ uint8_t swd_set_target_state_sw(TARGET_RESET_STATE state)
 		break;
 
 	case DEBUG:
-		if (!JTAG2SWD())
-		{
-			return 0;
-		}
-
-		if (!swd_write_dp(DP_ABORT, STKCMPCLR | STKERRCLR | WDERRCLR | ORUNERRCLR))
-		{
-			return 0;
-		}
-
-		// Ensure CTRL/STAT register selected in DPBANKSEL
-		if (!swd_write_dp(DP_SELECT, 0))
-		{
-			return 0;
-		}
-
-		// Power up
-		if (!swd_write_dp(DP_CTRL_STAT, CSYSPWRUPREQ | CDBGPWRUPREQ))
-		{
-			return 0;
-		}
-
-		// Enable debug
-		if (!swd_write_word(DBG_HCSR, DBGKEY | C_DEBUGEN))
+		if (!swd_enable_debug())
 		{
 			return 0;
 		}
@@ -1204,13 +1883,10 @@ uint8_t swd_set_target_state_sw(TARGET_RESET_STATE state)
 		}
 
 		// Wait until core is halted
-		do
+		if (!swd_wait_word(DBG_HCSR, S_HALT, MAX_TIMEOUT, &val))
 		{
-			if (!swd_read_word(DBG_HCSR, &val))
-			{
-				return 0;
-			}
-		} while ((val & S_HALT) == 0);
+			return 0;
+		}
 
 		break;
 
@@ -0,0 +1,377 @@
+/**
+ * @file    SWD_target.c
+ * @brief   Target identification: DP IDCODE, ROM table, STM32 DBGMCU and flash size
+ *
+ * The DEV_ID of the STM32 DBGMCU_IDCODE selects the family, its flash algorithm
+ * and the sector layout of the flash. An FLM named after the family and the flash
+ * size in KB (e.g. STM32F4xx_1024, as the CMSIS-Pack files) is preferred over the
+ * compiled-in algorithm of the family when the FLM store has it.
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include "SWD_host.h"
+#include "SWD_target.h"
+#include "DAP_config.h"
+#include "DAP.h"
+#include "debug_cm.h"
+#include "../algo/flm.h"
+
+#define CPUID_Addr 0xE000ED00
+
+// CoreSight component identification, at the end of the 4 KB of each component
+#define COMPONENT_ID_OFFSET 0xFD0 // PIDR4..7, PIDR0..3, CIDR0..3
+#define COMPONENT_ID_SIZE 0x30
+#define CIDR_PREAMBLE 0xB105000D
+#define CIDR_CLASS(cidr) (((cidr) >> 12) & 0xF)
+#define CIDR_CLASS_ROM 0x1
+
+#define ROM_ENTRY_MAX 960 // Entries in a 4 KB ROM table
+#define ROM_DEPTH_MAX 2	  // Nested ROM tables followed below the top one
+
+#define JEP106_ST 0x020 // STMicroelectronics
+
+#define FLASH_START 0x08000000
+
+typedef struct
+{
+	const char *name;
+	const char *flm; // FLM name prefix, followed by the flash size in KB
+	uint32_t dbgmcu; // DBGMCU_IDCODE address
+	uint8_t algo;	 // Compiled-in algorithm
+} target_family_t;
+
+typedef struct
+{
+	uint16_t dev_id;
+	uint8_t family;
+	uint8_t sector_cnt;
+	const sector_info_t *sectors;
+} target_part_t;
+
+static const target_family_t target_family[] = {
+	[F0] = {"STM32F0", "STM32F0xx_", 0x40015800, F0},
+	[F1] = {"STM32F1", "STM32F10x_", 0xE0042000, F1},
+	[F3] = {"STM32F3", "STM32F3xx_", 0xE0042000, F3},
+	[F4] = {"STM32F4", "STM32F4xx_", 0xE0042000, F4},
+	[F7] = {"STM32F7", "STM32F7x_", 0xE0042000, F7},
+	[H7] = {"STM32H7", "STM32H7x_", 0x5C001000, H7},
+};
+
+// Sector groups: first sector address and size of the sectors from there
+static const sector_info_t sectors_1k[] = {{FLASH_START, 0x400}};
+static const sector_info_t sectors_2k[] = {{FLASH_START, 0x800}};
+static const sector_info_t sectors_8k[] = {{FLASH_START, 0x2000}};
+static const sector_info_t sectors_128k[] = {{FLASH_START, 0x20000}};
+static const sector_info_t sectors_f4[] = {
+	{FLASH_START, 0x4000},
+	{FLASH_START + 0x10000, 0x10000},
+	{FLASH_START + 0x20000, 0x20000},
+	{FLASH_START + 0x100000, 0x4000}, // Second bank of the 2 MB parts
+	{FLASH_START + 0x110000, 0x10000},
+	{FLASH_START + 0x120000, 0x20000},
+};
+static const sector_info_t sectors_f7[] = {
+	{FLASH_START, 0x8000},
+	{FLASH_START + 0x20000, 0x20000},
+	{FLASH_START + 0x40000, 0x40000},
+};
+
+#define SECTORS(s) (sizeof(s) / sizeof(s[0])), s
+
+static const target_part_t target_part[] = {
+	{0x440, F0, SECTORS(sectors_1k)},
+	{0x442, F0, SECTORS(sectors_2k)},
+	{0x444, F0, SECTORS(sectors_1k)},
+	{0x445, F0, SECTORS(sectors_1k)},
+	{0x448, F0, SECTORS(sectors_2k)},
+	{0x410, F1, SECTORS(sectors_1k)},
+	{0x412, F1, SECTORS(sectors_1k)},
+	{0x414, F1, SECTORS(sectors_2k)},
+	{0x418, F1, SECTORS(sectors_2k)},
+	{0x420, F1, SECTORS(sectors_1k)},
+	{0x428, F1, SECTORS(sectors_2k)},
+	{0x430, F1, SECTORS(sectors_2k)},
+	{0x422, F3, SECTORS(sectors_2k)},
+	{0x432, F3, SECTORS(sectors_2k)},
+	{0x438, F3, SECTORS(sectors_2k)},
+	{0x439, F3, SECTORS(sectors_2k)},
+	{0x446, F3, SECTORS(sectors_2k)},
+	{0x413, F4, SECTORS(sectors_f4)},
+	{0x419, F4, SECTORS(sectors_f4)},
+	{0x421, F4, SECTORS(sectors_f4)},
+	{0x423, F4, SECTORS(sectors_f4)},
+	{0x431, F4, SECTORS(sectors_f4)},
+	{0x433, F4, SECTORS(sectors_f4)},
+	{0x434, F4, SECTORS(sectors_f4)},
+	{0x441, F4, SECTORS(sectors_f4)},
+	{0x458, F4, SECTORS(sectors_f4)},
+	{0x463, F4, SECTORS(sectors_f4)},
+	{0x449, F7, SECTORS(sectors_f7)},
+	{0x451, F7, SECTORS(sectors_f7)},
+	{0x452, F7, SECTORS(sectors_f4)},
+	{0x450, H7, SECTORS(sectors_128k)},
+	{0x480, H7, SECTORS(sectors_8k)},
+	{0x483, H7, SECTORS(sectors_128k)},
+};
+
+// Flash size register (KB, 16 bits) of a part
+static uint32_t target_flash_reg(const target_part_t *part)
+{
+	switch (part->dev_id)
+	{
+	case 0x452:
+		return 0x1FF07A22;
+	case 0x449:
+	case 0x451:
+		return 0x1FF0F442;
+	case 0x480:
+		return 0x08FFF80C;
+	}
+
+	switch (part->family)
+	{
+	case F0:
+	case F3:
+		return 0x1FFFF7CC;
+	case F1:
+		return 0x1FFFF7E0;
+	case F4:
+		return 0x1FFF7A22;
+	}
+
+	return 0x1FF1E880;
+}
+
+// Identification of the last target, checked against DP IDCODE and DBGMCU_IDCODE
+static target_id_t target_cache;
+
+static uint32_t get32(const uint8_t *p)
+{
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// Read a word, a bus fault is cleared so the next access works
+static uint8_t target_read_word(uint32_t addr, uint32_t *val)
+{
+	uint8_t buf[4];
+
+	if (!swd_read_memory(addr, buf, 4))
+	{
+		swd_write_dp(DP_ABORT, STKCMPCLR | STKERRCLR | WDERRCLR | ORUNERRCLR);
+		return 0;
+	}
+
+	*val = get32(buf);
+	return 1;
+}
+
+// CIDR and PIDR of a component, PIDR as designer (bits 22:12) and part number (bits 11:0)
+static uint8_t target_component_id(uint32_t base, uint32_t *cidr, uint32_t *pidr)
+{
+	uint8_t buf[COMPONENT_ID_SIZE];
+
+	if (!swd_read_memory(base + COMPONENT_ID_OFFSET, buf, sizeof(buf)))
+	{
+		swd_write_dp(DP_ABORT, STKCMPCLR | STKERRCLR | WDERRCLR | ORUNERRCLR);
+		return 0;
+	}
+
+	// Only the low byte of each ID register is used
+	*cidr = buf[0x20] | (buf[0x24] << 8) | (buf[0x28] << 16) | ((uint32_t)buf[0x2C] << 24);
+	*pidr = buf[0x10] | ((buf[0x14] & 0x0F) << 8) |				 // PART
+			(((buf[0x14] >> 4) | ((buf[0x18] & 0x07) << 4)) << 12) | // JEP106 identity
+			((buf[0x00] & 0x0F) << 19);								 // JEP106 continuation
+	return ((*cidr & ~0xF000U) == CIDR_PREAMBLE);
+}
+
+// Count the components of a ROM table, nested tables are followed
+static void target_rom_walk(uint32_t base, uint32_t depth, target_id_t *id)
+{
+	uint32_t entry, comp, cidr, pidr;
+	uint32_t n;
+
+	for (n = 0; n < ROM_ENTRY_MAX; n++)
+	{
+		if (!target_read_word(base + (n * 4), &entry) || (entry == 0))
+		{
+			return;
+		}
+		if (!(entry & 1))
+		{
+			continue; // Not present
+		}
+
+		comp = base + (entry & 0xFFFFF000);
+		if (!target_component_id(comp, &cidr, &pidr))
+		{
+			continue;
+		}
+		if ((CIDR_CLASS(cidr) == CIDR_CLASS_ROM) && (depth < ROM_DEPTH_MAX) && (comp != base))
+		{
+			target_rom_walk(comp, depth + 1, id);
+		}
+		else
+		{
+			id->components++;
+		}
+	}
+}
+
+static const target_part_t *target_find_part(uint32_t dev_id)
+{
+	uint32_t n;
+
+	for (n = 0; n < (sizeof(target_part) / sizeof(target_part[0])); n++)
+	{
+		if (target_part[n].dev_id == dev_id)
+		{
+			return &target_part[n];
+		}
+	}
+
+	return NULL;
+}
+
+// STM32 part from DBGMCU_IDCODE. The ROM table of ST parts carries the DEV_ID as
+// part number, the DBGMCU addresses of all families are tried when it does not.
+static const target_part_t *target_dbgmcu(target_id_t *id)
+{
+	const target_part_t *part;
+	uint32_t n;
+
+	if (((id->rom_pidr >> 12) == JEP106_ST) && ((part = target_find_part(id->rom_pidr & 0xFFF)) != NULL))
+	{
+		id->dbgmcu = target_family[part->family].dbgmcu;
+		if (target_read_word(id->dbgmcu, &id->idcode) && ((id->idcode & 0xFFF) == part->dev_id))
+		{
+			return part;
+		}
+	}
+
+	for (n = 0; n < (sizeof(target_family) / sizeof(target_family[0])); n++)
+	{
+		if ((n > 0) && (target_family[n].dbgmcu == target_family[n - 1].dbgmcu))
+		{
+			continue;
+		}
+		id->dbgmcu = target_family[n].dbgmcu;
+		if (target_read_word(id->dbgmcu, &id->idcode) && ((part = target_find_part(id->idcode & 0xFFF)) != NULL) &&
+			(target_family[part->family].dbgmcu == id->dbgmcu))
+		{
+			return part;
+		}
+	}
+
+	id->dbgmcu = 0;
+	id->idcode = 0;
+	return NULL;
+}
+
+/** Identify the target behind the SW-DP. The debug port has to be powered up
+(swd_init_debug). The previous result is reused when DP IDCODE and DBGMCU_IDCODE
+are unchanged, this skips the ROM table walk, the flash size and the FLM store.
+\param id identification.
+\return 1 when the debug port answered, id->family is NULL for an unknown part.
+*/
+uint8_t target_identify(target_id_t *id)
+{
+	const target_part_t *part;
+	const target_family_t *family;
+	uint32_t base, cidr, idcode;
+	uint8_t size[2];
+	char name[FLM_NAME_SIZE];
+	int algo;
+
+	memset(id, 0, sizeof(*id));
+	if (!swd_read_dp(DP_IDCODE, &id->dp_idcode))
+	{
+		return 0;
+	}
+
+	if ((target_cache.family != NULL) && (target_cache.dp_idcode == id->dp_idcode) &&
+		target_read_word(target_cache.dbgmcu, &idcode) && (idcode == target_cache.idcode))
+	{
+		*id = target_cache;
+		id->cached = 1;
+		return 1;
+	}
+	target_cache.family = NULL;
+
+	if (!swd_read_ap(AP_IDR, &id->ap_idr) || !swd_read_ap(AP_ROM, &base))
+	{
+		return 0;
+	}
+
+	// BASE: bit 1 = ADIv5 format with bit 0 = ROM table present, 0xFFFFFFFF = none (legacy)
+	if ((base != 0xFFFFFFFF) && (((base & 3) == 3) || !(base & 2)))
+	{
+		id->rom_base = base & 0xFFFFF000;
+		if (target_component_id(id->rom_base, &cidr, &id->rom_pidr) && (CIDR_CLASS(cidr) == CIDR_CLASS_ROM))
+		{
+			target_rom_walk(id->rom_base, 0, id);
+		}
+	}
+
+	target_read_word(CPUID_Addr, &id->cpuid);
+
+	part = target_dbgmcu(id);
+	if (part == NULL)
+	{
+		return 1;
+	}
+
+	family = &target_family[part->family];
+	id->family = family->name;
+	id->sectors = part->sectors;
+	id->sector_cnt = part->sector_cnt;
+	id->flash_start = FLASH_START;
+	if (swd_read_memory(target_flash_reg(part), size, 2) && ((size[0] != 0xFF) || (size[1] != 0xFF)))
+	{
+		id->flash_size = (size[0] | (size[1] << 8)) * 1024U;
+	}
+	else
+	{
+		swd_write_dp(DP_ABORT, STKCMPCLR | STKERRCLR | WDERRCLR | ORUNERRCLR);
+	}
+
+	// A matching FLM before the compiled-in algorithm
+	snprintf(name, sizeof(name), "%s%u", family->flm, (unsigned)(id->flash_size / 1024U));
+	algo = (id->flash_size != 0) ? algo_load(name) : -1;
+	id->algo = (algo >= 0) ? (uint8_t)algo : family->algo;
+
+	target_cache = *id;
+	return 1;
+}
+
+/** Sector size of a flash range.
+\param id identification.
+\param addr start of the range, on a sector boundary.
+\param size bytes in the range.
+\return size of the sectors when the range is in one sector group, else 0.
+*/
+uint32_t target_sector_size(const target_id_t *id, uint32_t addr, uint32_t size)
+{
+	uint32_t end = id->flash_start + id->flash_size;
+	uint32_t n;
+
+	for (n = id->sector_cnt; n > 0; n--)
+	{
+		const sector_info_t *s = &id->sectors[n - 1];
+
+		if (addr >= s->start)
+		{
+			if (n < id->sector_cnt)
+			{
+				end = (id->sectors[n].start < end) ? id->sectors[n].start : end;
+			}
+			if ((addr >= end) || (size > (end - addr)) || (((addr - s->start) % s->size) != 0))
+			{
+				return 0;
+			}
+			return s->size;
+		}
+	}
+
+	return 0;
+}
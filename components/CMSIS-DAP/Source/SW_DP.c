@@ -30,92 +30,301 @@
 
 #define SW_CLOCK_CYCLE() \
 	PIN_SWCLK_CLR();     \
-	PIN_SWCLK_SET();
+	PIN_DELAY();         \
+	PIN_SWCLK_SET();     \
+	PIN_DELAY();
 
 #define SW_WRITE_BIT(bit) \
 	PIN_SWDIO_OUT(bit);   \
 	PIN_SWCLK_CLR();      \
-	PIN_SWCLK_SET();
+	PIN_DELAY();          \
+	PIN_SWCLK_SET();      \
+	PIN_DELAY();
 
 #define SW_READ_BIT(bit)  \
 	PIN_SWCLK_CLR();      \
+	PIN_DELAY();          \
 	bit = PIN_SWDIO_IN(); \
-	PIN_SWCLK_SET();
+	PIN_SWCLK_SET();      \
+	PIN_DELAY();
 
 #define PIN_DELAY() PIN_DELAY_SLOW(DAP_Data.clock_delay)
 
-// Generate SWJ Sequence
+// Write 8 sequence bits val[7:0] on SWDIO/TMS, LSB first
+#define SWJ_SEQUENCE_BYTE(val) \
+	PIN_SWDIO_OUT((val) >> 0); \
+	SW_CLOCK_CYCLE();          \
+	PIN_SWDIO_OUT((val) >> 1); \
+	SW_CLOCK_CYCLE();          \
+	PIN_SWDIO_OUT((val) >> 2); \
+	SW_CLOCK_CYCLE();          \
+	PIN_SWDIO_OUT((val) >> 3); \
+	SW_CLOCK_CYCLE();          \
+	PIN_SWDIO_OUT((val) >> 4); \
+	SW_CLOCK_CYCLE();          \
+	PIN_SWDIO_OUT((val) >> 5); \
+	SW_CLOCK_CYCLE();          \
+	PIN_SWDIO_OUT((val) >> 6); \
+	SW_CLOCK_CYCLE();          \
+	PIN_SWDIO_OUT((val) >> 7); \
+	SW_CLOCK_CYCLE();
+
+// SWJ Sequence kernel: whole bytes unrolled, PIN_SWDIO_OUT drives TMS as well
 //   count:  sequence bit count
 //   data:   pointer to sequence bit data
 //   return: none
+#define SWJ_SequenceFunction(speed) /**/                                \
+	static void SWJ_Sequence##speed(uint32_t count, const uint8_t *data) \
+	{                                                                   \
+		const uint32_t delay = DAP_Data.clock_delay;                    \
+		uint32_t val;                                                   \
+                                                                        \
+		(void)delay;                                                    \
+		for (; count >= 8U; count -= 8U)                                \
+		{                                                               \
+			val = *data++;                                              \
+			SWJ_SEQUENCE_BYTE(val);                                     \
+		}                                                               \
+		if (count)                                                      \
+		{                                                               \
+			val = *data;                                                \
+			for (; count; count--)                                      \
+			{                                                           \
+				PIN_SWDIO_OUT(val);                                     \
+				SW_CLOCK_CYCLE();                                       \
+				val >>= 1;                                              \
+			}                                                           \
+		}                                                               \
+	}
+
 #if ((DAP_SWD != 0) || (DAP_JTAG != 0))
+#undef PIN_DELAY
+#define PIN_DELAY() PIN_DELAY_FAST()
+SWJ_SequenceFunction(Fast);
+
+#undef PIN_DELAY
+#define PIN_DELAY() PIN_DELAY_SLOW(delay)
+SWJ_SequenceFunction(Slow);
+
+#undef PIN_DELAY
+#define PIN_DELAY() PIN_DELAY_SLOW(DAP_Data.clock_delay)
+
+// Generate SWJ Sequence
+//   count:  sequence bit count
+//   data:   pointer to sequence bit data
+//   return: none
 void SWJ_Sequence(uint32_t count, const uint8_t *data)
 {
-	uint32_t val;
+#if (DAP_SPI != 0)
 	uint32_t n;
 
-	val = 0U;
-	n = 0U;
-	while (count--)
+	if (DAP_Data.spi_clock && (count >= 8U))
 	{
-		if (n == 0U)
-		{
-			val = *data++;
-			n = 8U;
-		}
-		if (val & 1U)
+		// Whole bytes through the SPI, the remaining bits below
+		n = count & ~7U;
+		SPI_SWD_Write(data, n);
+		data += n / 8U;
+		count -= n;
+	}
+#endif
+
+	if (DAP_Data.fast_clock)
+	{
+		SWJ_SequenceFast(count, data);
+	}
+	else
+	{
+		SWJ_SequenceSlow(count, data);
+	}
+}
+
+// Measure the SWCLK/TCK period generated with a clock delay
+//   delay:  PIN_DELAY_SLOW count (0 = fast clock without delay)
+//   return: CPU cycles per clock period
+uint32_t SWJ_ClockPeriod(uint32_t delay)
+{
+	uint32_t start;
+	uint32_t n;
+
+	start = CYCLE_COUNT_GET();
+	if (delay == 0U)
+	{
+		for (n = 32U; n; n--)
 		{
-			PIN_SWDIO_TMS_SET();
+			PIN_SWCLK_CLR();
+			PIN_DELAY_FAST();
+			PIN_SWCLK_SET();
+			PIN_DELAY_FAST();
 		}
-		else
+	}
+	else
+	{
+		for (n = 32U; n; n--)
 		{
-			PIN_SWDIO_TMS_CLR();
+			PIN_SWCLK_CLR();
+			PIN_DELAY_SLOW(delay);
+			PIN_SWCLK_SET();
+			PIN_DELAY_SLOW(delay);
 		}
-		SW_CLOCK_CYCLE();
-		val >>= 1;
-		n--;
 	}
+	return (CYCLE_COUNT_GET() - start + 16U) / 32U;
 }
 #endif
 
 #if (DAP_SWD != 0)
 
+// SWD Sequence kernel, SWDIO direction is set up by the caller
+//   info:   sequence information
+//   swdo:   pointer to SWDIO generated data
+//   swdi:   pointer to SWDIO captured data
+//   return: none
+#define SWD_SequenceFunction(speed) /**/                                                   \
+	static void SWD_Sequence##speed(uint32_t info, const uint8_t *swdo, uint8_t *swdi)      \
+	{                                                                                      \
+		const uint32_t delay = DAP_Data.clock_delay;                                       \
+		uint32_t val;                                                                      \
+		uint32_t bit;                                                                      \
+		uint32_t n, k;                                                                     \
+                                                                                           \
+		(void)delay;                                                                       \
+		n = info & SWD_SEQUENCE_CLK;                                                       \
+		if (n == 0U)                                                                       \
+		{                                                                                  \
+			n = 64U;                                                                       \
+		}                                                                                  \
+		if (info & SWD_SEQUENCE_DIN)                                                       \
+		{                                                                                  \
+			while (n)                                                                      \
+			{                                                                              \
+				val = 0U;                                                                  \
+				for (k = 8U; k && n; k--, n--)                                             \
+				{                                                                          \
+					SW_READ_BIT(bit);                                                      \
+					val >>= 1;                                                             \
+					val |= bit << 7;                                                       \
+				}                                                                          \
+				val >>= k;                                                                 \
+				*swdi++ = (uint8_t)val;                                                    \
+			}                                                                              \
+		}                                                                                  \
+		else                                                                               \
+		{                                                                                  \
+			while (n)                                                                      \
+			{                                                                              \
+				val = *swdo++;                                                             \
+				for (k = 8U; k && n; k--, n--)                                             \
+				{                                                                          \
+					SW_WRITE_BIT(val);                                                     \
+					val >>= 1;                                                             \
+				}                                                                          \
+			}                                                                              \
+		}                                                                                  \
+	}
+
+#undef PIN_DELAY
+#define PIN_DELAY() PIN_DELAY_FAST()
+SWD_SequenceFunction(Fast);
+
+#undef PIN_DELAY
+#define PIN_DELAY() PIN_DELAY_SLOW(delay)
+SWD_SequenceFunction(Slow);
+
+#undef PIN_DELAY
+#define PIN_DELAY() PIN_DELAY_SLOW(DAP_Data.clock_delay)
+
+// Generate SWD Sequence (multi-drop TARGETSEL and other sequences with
+// SWDIO released), SWDIO direction is set up by the caller
+//   info:   sequence information
+//   swdo:   pointer to SWDIO generated data
+//   swdi:   pointer to SWDIO captured data
+//   return: none
+void SWD_Sequence(uint32_t info, const uint8_t *swdo, uint8_t *swdi)
+{
+	if (DAP_Data.fast_clock)
+	{
+		SWD_SequenceFast(info, swdo, swdi);
+	}
+	else
+	{
+		SWD_SequenceSlow(info, swdo, swdi);
+	}
+}
+
+// SWD request header (Start, APnDP, RnW, A2, A3, Parity, Stop, Park)
+// indexed by request bits A[3:2] RnW APnDP
+static const uint8_t SWD_RequestHeader[16] = {
+	0x81U, 0xA3U, 0xA5U, 0x87U,
+	0xA9U, 0x8BU, 0x8DU, 0xAFU,
+	0xB1U, 0x93U, 0x95U, 0xB7U,
+	0x99U, 0xBBU, 0xBDU, 0x9FU};
+
+// Parity of a 32-bit word
+static inline uint32_t SWD_Parity(uint32_t val)
+{
+	val ^= val >> 16;
+	val ^= val >> 8;
+	val ^= val >> 4;
+	return (0x6996U >> (val & 0x0FU)) & 1U;
+}
+
+// Write 8 bits, LSB first
+#define SW_WRITE_BYTE(val) \
+	SW_WRITE_BIT((val) >> 0); \
+	SW_WRITE_BIT((val) >> 1); \
+	SW_WRITE_BIT((val) >> 2); \
+	SW_WRITE_BIT((val) >> 3); \
+	SW_WRITE_BIT((val) >> 4); \
+	SW_WRITE_BIT((val) >> 5); \
+	SW_WRITE_BIT((val) >> 6); \
+	SW_WRITE_BIT((val) >> 7);
+
+// Read 8 bits into val[pos+7:pos], LSB first
+#define SW_READ_BYTE(val, pos) \
+	SW_READ_BIT(bit);          \
+	val |= bit << ((pos) + 0); \
+	SW_READ_BIT(bit);          \
+	val |= bit << ((pos) + 1); \
+	SW_READ_BIT(bit);          \
+	val |= bit << ((pos) + 2); \
+	SW_READ_BIT(bit);          \
+	val |= bit << ((pos) + 3); \
+	SW_READ_BIT(bit);          \
+	val |= bit << ((pos) + 4); \
+	SW_READ_BIT(bit);          \
+	val |= bit << ((pos) + 5); \
+	SW_READ_BIT(bit);          \
+	val |= bit << ((pos) + 6); \
+	SW_READ_BIT(bit);          \
+	val |= bit << ((pos) + 7);
+
 // SWD Transfer I/O
 //   request: A[3:2] RnW APnDP
 //   data:    DATA[31:0]
 //   return:  ACK[2:0]
-#define SWD_TransferFunction(speed) /**/                                              \
-	uint8_t SWD_Transfer##speed(uint32_t request, uint32_t *data)                     \
+// Variants are specialized on the delay class (PIN_DELAY) and on the
+// turnaround, data_phase and idle_cycles expressions, which are either
+// constants or read from DAP_Data once per transfer.
+#define SWD_TransferFunction(name, turnaround, data_phase, idle_cycles) /**/          \
+	static uint8_t SWD_Transfer##name(uint32_t request, uint32_t *data)               \
 	{                                                                                 \
+		const uint32_t trn = (turnaround);                                            \
+		const uint32_t phase = (data_phase);                                          \
+		const uint32_t idle = (idle_cycles);                                          \
+		const uint32_t delay = DAP_Data.clock_delay;                                  \
 		uint32_t ack;                                                                 \
 		uint32_t bit;                                                                 \
 		uint32_t val;                                                                 \
-		uint32_t parity;                                                              \
-                                                                                      \
 		uint32_t n;                                                                   \
                                                                                       \
+		(void)delay;                                                                  \
+                                                                                      \
 		/* Packet Request */                                                          \
-		parity = 0U;                                                                  \
-		SW_WRITE_BIT(1U); /* Start Bit */                                             \
-		bit = request >> 0;                                                           \
-		SW_WRITE_BIT(bit); /* APnDP Bit */                                            \
-		parity += bit;                                                                \
-		bit = request >> 1;                                                           \
-		SW_WRITE_BIT(bit); /* RnW Bit */                                              \
-		parity += bit;                                                                \
-		bit = request >> 2;                                                           \
-		SW_WRITE_BIT(bit); /* A2 Bit */                                               \
-		parity += bit;                                                                \
-		bit = request >> 3;                                                           \
-		SW_WRITE_BIT(bit); /* A3 Bit */                                               \
-		parity += bit;                                                                \
-		SW_WRITE_BIT(parity); /* Parity Bit */                                        \
-		SW_WRITE_BIT(0U);	  /* Stop Bit */                                          \
-		SW_WRITE_BIT(1U);	  /* Park Bit */                                          \
+		val = SWD_RequestHeader[request & 0x0FU];                                     \
+		SW_WRITE_BYTE(val);                                                           \
                                                                                       \
 		/* Turnaround */                                                              \
 		PIN_SWDIO_OUT_DISABLE();                                                      \
-		for (n = DAP_Data.swd_conf.turnaround; n; n--)                                \
+		for (n = trn; n; n--)                                                         \
 		{                                                                             \
 			SW_CLOCK_CYCLE();                                                         \
 		}                                                                             \
@@ -135,16 +344,12 @@ void SWJ_Sequence(uint32_t count, const uint8_t *data)
 			{                                                                         \
 				/* Read data */                                                       \
 				val = 0U;                                                             \
-				parity = 0U;                                                          \
-				for (n = 32U; n; n--)                                                 \
-				{                                                                     \
-					SW_READ_BIT(bit); /* Read RDATA[0:31] */                          \
-					parity += bit;                                                    \
-					val >>= 1;                                                        \
-					val |= bit << 31;                                                 \
-				}                                                                     \
-				SW_READ_BIT(bit); /* Read Parity */                                   \
-				if ((parity ^ bit) & 1U)                                              \
+				SW_READ_BYTE(val, 0);  /* Read RDATA[0:7] */                          \
+				SW_READ_BYTE(val, 8);  /* Read RDATA[8:15] */                         \
+				SW_READ_BYTE(val, 16); /* Read RDATA[16:23] */                        \
+				SW_READ_BYTE(val, 24); /* Read RDATA[24:31] */                        \
+				SW_READ_BIT(bit);	   /* Read Parity */                              \
+				if (SWD_Parity(val) ^ bit)                                            \
 				{                                                                     \
 					ack = DAP_TRANSFER_ERROR;                                         \
 				}                                                                     \
@@ -153,7 +358,7 @@ void SWJ_Sequence(uint32_t count, const uint8_t *data)
 					*data = val;                                                      \
 				}                                                                     \
 				/* Turnaround */                                                      \
-				for (n = DAP_Data.swd_conf.turnaround; n; n--)                        \
+				for (n = trn; n; n--)                                                 \
 				{                                                                     \
 					SW_CLOCK_CYCLE();                                                 \
 				}                                                                     \
@@ -162,24 +367,21 @@ void SWJ_Sequence(uint32_t count, const uint8_t *data)
 			else                                                                      \
 			{                                                                         \
 				/* Turnaround */                                                      \
-				for (n = DAP_Data.swd_conf.turnaround; n; n--)                        \
+				for (n = trn; n; n--)                                                 \
 				{                                                                     \
 					SW_CLOCK_CYCLE();                                                 \
 				}                                                                     \
 				PIN_SWDIO_OUT_ENABLE();                                               \
 				/* Write data */                                                      \
 				val = *data;                                                          \
-				parity = 0U;                                                          \
-				for (n = 32U; n; n--)                                                 \
-				{                                                                     \
-					SW_WRITE_BIT(val); /* Write WDATA[0:31] */                        \
-					parity += val;                                                    \
-					val >>= 1;                                                        \
-				}                                                                     \
-				SW_WRITE_BIT(parity); /* Write Parity Bit */                          \
+				SW_WRITE_BYTE(val);		  /* Write WDATA[0:7] */                      \
+				SW_WRITE_BYTE(val >> 8);  /* Write WDATA[8:15] */                     \
+				SW_WRITE_BYTE(val >> 16); /* Write WDATA[16:23] */                    \
+				SW_WRITE_BYTE(val >> 24); /* Write WDATA[24:31] */                    \
+				SW_WRITE_BIT(SWD_Parity(val)); /* Write Parity Bit */                 \
 			}                                                                         \
 			/* Idle cycles */                                                         \
-			n = DAP_Data.transfer.idle_cycles;                                        \
+			n = idle;                                                                 \
 			if (n)                                                                    \
 			{                                                                         \
 				PIN_SWDIO_OUT(0U);                                                    \
@@ -195,7 +397,7 @@ void SWJ_Sequence(uint32_t count, const uint8_t *data)
 		if ((ack == DAP_TRANSFER_WAIT) || (ack == DAP_TRANSFER_FAULT))                \
 		{                                                                             \
 			/* WAIT or FAULT response */                                              \
-			if (DAP_Data.swd_conf.data_phase && ((request & DAP_TRANSFER_RnW) != 0U)) \
+			if (phase && ((request & DAP_TRANSFER_RnW) != 0U))                        \
 			{                                                                         \
 				for (n = 32U + 1U; n; n--)                                            \
 				{                                                                     \
@@ -203,12 +405,12 @@ void SWJ_Sequence(uint32_t count, const uint8_t *data)
 				}                                                                     \
 			}                                                                         \
 			/* Turnaround */                                                          \
-			for (n = DAP_Data.swd_conf.turnaround; n; n--)                            \
+			for (n = trn; n; n--)                                                     \
 			{                                                                         \
 				SW_CLOCK_CYCLE();                                                     \
 			}                                                                         \
 			PIN_SWDIO_OUT_ENABLE();                                                   \
-			if (DAP_Data.swd_conf.data_phase && ((request & DAP_TRANSFER_RnW) == 0U)) \
+			if (phase && ((request & DAP_TRANSFER_RnW) == 0U))                        \
 			{                                                                         \
 				PIN_SWDIO_OUT(0U);                                                    \
 				for (n = 32U + 1U; n; n--)                                            \
@@ -221,7 +423,7 @@ void SWJ_Sequence(uint32_t count, const uint8_t *data)
 		}                                                                             \
                                                                                       \
 		/* Protocol error */                                                          \
-		for (n = DAP_Data.swd_conf.turnaround + 32U + 1U; n; n--)                     \
+		for (n = trn + 32U + 1U     ; n; n--)                                         \
 		{                                                                             \
 			SW_CLOCK_CYCLE(); /* Back off data phase */                               \
 		}                                                                             \
@@ -230,28 +432,441 @@ void SWJ_Sequence(uint32_t count, const uint8_t *data)
 		return ((uint8_t)ack);                                                        \
 	}
 
+// One turnaround cycle, the SWD default every debugger keeps: without idle cycles
+// and data phase as after DAP_Connect (T1), with idle cycles (T1Idle, set by some
+// IDEs for slow targets) and with the data phase on WAIT/FAULT (T1Data, the idle
+// cycles still read from DAP_Data). The generic variants take turnarounds of 2 to 4.
 #undef PIN_DELAY
 #define PIN_DELAY() PIN_DELAY_FAST()
-SWD_TransferFunction(Fast);
+SWD_TransferFunction(FastT1, 1U, 0U, 0U);
+SWD_TransferFunction(FastT1Idle, 1U, 0U, DAP_Data.transfer.idle_cycles);
+SWD_TransferFunction(FastT1Data, 1U, 1U, DAP_Data.transfer.idle_cycles);
+SWD_TransferFunction(Fast, DAP_Data.swd_conf.turnaround, DAP_Data.swd_conf.data_phase, DAP_Data.transfer.idle_cycles);
+
+#undef PIN_DELAY
+#define PIN_DELAY() PIN_DELAY_SLOW(delay)
+SWD_TransferFunction(SlowT1, 1U, 0U, 0U);
+SWD_TransferFunction(SlowT1Idle, 1U, 0U, DAP_Data.transfer.idle_cycles);
+SWD_TransferFunction(SlowT1Data, 1U, 1U, DAP_Data.transfer.idle_cycles);
+SWD_TransferFunction(Slow, DAP_Data.swd_conf.turnaround, DAP_Data.swd_conf.data_phase, DAP_Data.transfer.idle_cycles);
 
 #undef PIN_DELAY
 #define PIN_DELAY() PIN_DELAY_SLOW(DAP_Data.clock_delay)
-SWD_TransferFunction(Slow);
 
-// SWD Transfer I/O
+#if (DAP_SPI != 0)
+// SWD Transfer I/O with the request and data phases shifted by the SPI,
+// turnaround, acknowledge and the rarely used phases are bit-banged
 //   request: A[3:2] RnW APnDP
 //   data:    DATA[31:0]
 //   return:  ACK[2:0]
-uint8_t SWD_Transfer(uint32_t request, uint32_t *data)
+static uint8_t SWD_TransferSPI(uint32_t request, uint32_t *data)
 {
-	if (DAP_Data.fast_clock)
+	uint8_t buf[5];
+	uint32_t ack;
+	uint32_t bit;
+	uint32_t val;
+	uint32_t n;
+
+	/* Packet Request */
+	buf[0] = SWD_RequestHeader[request & 0x0FU];
+	SPI_SWD_Write(buf, 8U);
+
+	/* Turnaround */
+	PIN_SWDIO_OUT_DISABLE();
+	for (n = DAP_Data.swd_conf.turnaround; n; n--)
+	{
+		SW_CLOCK_CYCLE();
+	}
+
+	/* Acknowledge response */
+	SW_READ_BIT(bit);
+	ack = bit << 0;
+	SW_READ_BIT(bit);
+	ack |= bit << 1;
+	SW_READ_BIT(bit);
+	ack |= bit << 2;
+
+	if (ack == DAP_TRANSFER_OK)
+	{ /* OK response */
+		/* Data transfer */
+		if (request & DAP_TRANSFER_RnW)
+		{
+			/* Read data and parity */
+			SPI_SWD_Read(buf, 32U + 1U);
+			val = ((uint32_t)buf[0] << 0) |
+				  ((uint32_t)buf[1] << 8) |
+				  ((uint32_t)buf[2] << 16) |
+				  ((uint32_t)buf[3] << 24);
+			if (SWD_Parity(val) ^ (buf[4] & 1U))
+			{
+				ack = DAP_TRANSFER_ERROR;
+			}
+			if (data)
+			{
+				*data = val;
+			}
+			/* Turnaround */
+			for (n = DAP_Data.swd_conf.turnaround; n; n--)
+			{
+				SW_CLOCK_CYCLE();
+			}
+			PIN_SWDIO_OUT_ENABLE();
+		}
+		else
+		{
+			/* Turnaround */
+			for (n = DAP_Data.swd_conf.turnaround; n; n--)
+			{
+				SW_CLOCK_CYCLE();
+			}
+			PIN_SWDIO_OUT_ENABLE();
+			/* Write data and parity */
+			val = *data;
+			buf[0] = (uint8_t)(val >> 0);
+			buf[1] = (uint8_t)(val >> 8);
+			buf[2] = (uint8_t)(val >> 16);
+			buf[3] = (uint8_t)(val >> 24);
+			buf[4] = (uint8_t)SWD_Parity(val);
+			SPI_SWD_Write(buf, 32U + 1U);
+		}
+		/* Idle cycles */
+		n = DAP_Data.transfer.idle_cycles;
+		if (n)
+		{
+			PIN_SWDIO_OUT(0U);
+			for (; n; n--)
+			{
+				SW_CLOCK_CYCLE();
+			}
+		}
+		PIN_SWDIO_OUT(1U);
+		return ((uint8_t)ack);
+	}
+
+	if ((ack == DAP_TRANSFER_WAIT) || (ack == DAP_TRANSFER_FAULT))
+	{
+		/* WAIT or FAULT response */
+		if (DAP_Data.swd_conf.data_phase && ((request & DAP_TRANSFER_RnW) != 0U))
+		{
+			for (n = 32U + 1U; n; n--)
+			{
+				SW_CLOCK_CYCLE(); /* Dummy Read RDATA[0:31] + Parity */
+			}
+		}
+		/* Turnaround */
+		for (n = DAP_Data.swd_conf.turnaround; n; n--)
+		{
+			SW_CLOCK_CYCLE();
+		}
+		PIN_SWDIO_OUT_ENABLE();
+		if (DAP_Data.swd_conf.data_phase && ((request & DAP_TRANSFER_RnW) == 0U))
+		{
+			PIN_SWDIO_OUT(0U);
+			for (n = 32U + 1U; n; n--)
+			{
+				SW_CLOCK_CYCLE(); /* Dummy Write WDATA[0:31] + Parity */
+			}
+		}
+		PIN_SWDIO_OUT(1U);
+		return ((uint8_t)ack);
+	}
+
+	/* Protocol error */
+	for (n = DAP_Data.swd_conf.turnaround + 32U + 1U; n; n--)
+	{
+		SW_CLOCK_CYCLE(); /* Back off data phase */
+	}
+	PIN_SWDIO_OUT_ENABLE();
+	PIN_SWDIO_OUT(1U);
+	return ((uint8_t)ack);
+}
+#endif
+
+// SWD_Transfer variant installed by SWD_TransferSelect
+SWD_Transfer_t SWD_TransferIO = SWD_TransferSlow;
+
+// SWD_Transfer variants by delay class (slow, fast) and configuration: T1,
+// T1Idle, T1Data and generic
+static const SWD_Transfer_t SWD_TransferVariant[2][4] = {
+	{SWD_TransferSlowT1, SWD_TransferSlowT1Idle, SWD_TransferSlowT1Data, SWD_TransferSlow},
+	{SWD_TransferFastT1, SWD_TransferFastT1Idle, SWD_TransferFastT1Data, SWD_TransferFast},
+};
+
+// Install the SWD_Transfer variant matching the SWJ clock and the SWD and
+// transfer configuration, called whenever one of them changes
+void SWD_TransferSelect(void)
+{
+	uint32_t variant;
+
+#if (DAP_SPI != 0)
+	if (DAP_Data.spi_clock)
+	{
+		SWD_TransferIO = SWD_TransferSPI;
+		return;
+	}
+#endif
+
+	if (DAP_Data.swd_conf.turnaround != 1U)
+	{
+		variant = 3U;
+	}
+	else if (DAP_Data.swd_conf.data_phase != 0U)
+	{
+		variant = 2U;
+	}
+	else if (DAP_Data.transfer.idle_cycles != 0U)
+	{
+		variant = 1U;
+	}
+	else
+	{
+		variant = 0U;
+	}
+	SWD_TransferIO = SWD_TransferVariant[DAP_Data.fast_clock ? 1U : 0U][variant];
+}
+
+#if (DAP_GANG != 0)
+
+// Gang clock cycle with the SWDIO outputs already set up
+//   delay:  PIN_DELAY_SLOW delay, 0 = PIN_DELAY_FAST
+//   return: SWDIO inputs of all targets, sampled before the rising edge like SW_READ_BIT
+static inline uint32_t SWD_GangCycle(uint32_t delay)
+{
+	uint32_t in;
+
+	PIN_SWCLK_CLR();
+	if (delay)
+	{
+		PIN_DELAY_SLOW(delay);
+	}
+	else
+	{
+		PIN_DELAY_FAST();
+	}
+	in = PIN_GANG_SWDIO_IN();
+	PIN_SWCLK_SET();
+	if (delay)
+	{
+		PIN_DELAY_SLOW(delay);
+	}
+	else
+	{
+		PIN_DELAY_FAST();
+	}
+	return in;
+}
+
+// GPIO mask of the SWDIO pins of a set of gang targets
+static uint32_t SWD_GangPins(uint32_t targets)
+{
+	uint32_t pins = 0U;
+	uint32_t n;
+
+	for (n = 0U; n < DAP_GANG_CNT; n++)
+	{
+		if (targets & (1U << n))
+		{
+			pins |= PIN_GANG_SWDIO_MASK(n);
+		}
+	}
+	return pins;
+}
+
+// Gang SWJ Sequence: the sequence goes out on the SWDIO of the selected
+// targets, the other targets see SWDIO low (idle)
+//   targets: gang target mask, bit n = target n
+//   count:   sequence bit count
+//   data:    pointer to sequence bit data
+//   return:  none
+void SWD_GangSequence(uint32_t targets, uint32_t count, const uint8_t *data)
+{
+	const uint32_t delay = DAP_Data.fast_clock ? 0U : DAP_Data.clock_delay;
+	const uint32_t all = SWD_GangPins((1U << DAP_GANG_CNT) - 1U);
+	const uint32_t pins = SWD_GangPins(targets);
+	uint32_t set;
+	uint32_t n;
+
+	PIN_GANG_SWDIO_OUT_ENABLE(all);
+	for (n = 0U; n < count; n++)
+	{
+		set = ((data[n / 8U] >> (n % 8U)) & 1U) ? pins : 0U;
+		PIN_GANG_SWDIO_OUT(set, all & ~set);
+		SWD_GangCycle(delay);
+	}
+}
+
+// Gang SWD Transfer I/O: one transfer on all selected targets in lockstep.
+// Every target is clocked by the shared SWCLK, all SWDIO lines are written
+// with one set/clear and read with one input register access per bit. The
+// targets that are not selected, and the selected ones once they answered
+// WAIT or FAULT, see SWDIO low (idle cycles) whenever the probe drives it.
+//   targets: gang target mask, bit n = target n
+//   request: A[3:2] RnW APnDP
+//   data:    DATA[31:0] per target, write data in or read data out
+//   ack:     ACK[2:0] per target, DAP_TRANSFER_ERROR on a read parity error
+//   return:  none
+void SWD_GangTransfer(uint32_t targets, uint32_t request, uint32_t *data, uint8_t *ack)
+{
+	const uint32_t delay = DAP_Data.fast_clock ? 0U : DAP_Data.clock_delay;
+	const uint32_t trn = DAP_Data.swd_conf.turnaround;
+	uint32_t pin[DAP_GANG_CNT];
+	uint32_t val[DAP_GANG_CNT];
+	uint32_t all;
+	uint32_t active;
+	uint32_t data_pins; // Targets in the data phase (OK response)
+	uint32_t late;		// Targets driven only after the data phase
+	uint32_t parity;
+	uint32_t header;
+	uint32_t set;
+	uint32_t in;
+	uint32_t n;
+	uint32_t k;
+
+	all = 0U;
+	active = 0U;
+	for (n = 0U; n < DAP_GANG_CNT; n++)
+	{
+		pin[n] = PIN_GANG_SWDIO_MASK(n);
+		all |= pin[n];
+		if (targets & (1U << n))
+		{
+			active |= pin[n];
+			ack[n] = 0U;
+			val[n] = 0U;
+		}
+	}
+
+	// Packet Request
+	header = SWD_RequestHeader[request & 0x0FU];
+	PIN_GANG_SWDIO_OUT_ENABLE(all);
+	for (k = 0U; k < 8U; k++)
+	{
+		set = ((header >> k) & 1U) ? active : 0U;
+		PIN_GANG_SWDIO_OUT(set, all & ~set);
+		SWD_GangCycle(delay);
+	}
+
+	// Turnaround, the output latches go low for the idle cycles of targets
+	// that do not enter the data phase
+	PIN_GANG_SWDIO_OUT_DISABLE(active);
+	PIN_GANG_SWDIO_OUT(0U, all);
+	for (k = trn; k; k--)
+	{
+		SWD_GangCycle(delay);
+	}
+
+	// Acknowledge response
+	for (k = 0U; k < 3U; k++)
+	{
+		in = SWD_GangCycle(delay);
+		for (n = 0U; n < DAP_GANG_CNT; n++)
+		{
+			if ((active & pin[n]) && (in & pin[n]))
+			{
+				ack[n] |= (uint8_t)(1U << k);
+			}
+		}
+	}
+
+	data_pins = 0U;
+	late = 0U;
+	for (n = 0U; n < DAP_GANG_CNT; n++)
 	{
-		return SWD_TransferFast(request, data);
+		if ((active & pin[n]) == 0U)
+		{
+			continue;
+		}
+		if (ack[n] == DAP_TRANSFER_OK)
+		{
+			data_pins |= pin[n];
+		}
+		else if ((ack[n] == DAP_TRANSFER_WAIT) || (ack[n] == DAP_TRANSFER_FAULT))
+		{
+			if (DAP_Data.swd_conf.data_phase && (request & DAP_TRANSFER_RnW))
+			{
+				late |= pin[n]; // Dummy read data phase
+			}
+		}
+		else
+		{
+			late |= pin[n]; // Protocol error: back off data phase
+		}
+	}
+
+	if (request & DAP_TRANSFER_RnW)
+	{
+		// Read data, WAIT/FAULT targets get their turnaround and then idle cycles
+		for (k = 0U; k < 33U; k++)
+		{
+			if (k == trn)
+			{
+				PIN_GANG_SWDIO_OUT_ENABLE(active & ~(data_pins | late));
+			}
+			in = SWD_GangCycle(delay);
+			if (k == 32U)
+			{
+				parity = in; // Parity bits
+				break;
+			}
+			for (n = 0U; n < DAP_GANG_CNT; n++)
+			{
+				if (in & pin[n])
+				{
+					val[n] |= 1U << k;
+				}
+			}
+		}
+		// Turnaround of the targets that sent data
+		for (k = trn; k; k--)
+		{
+			SWD_GangCycle(delay);
+		}
+		for (n = 0U; n < DAP_GANG_CNT; n++)
+		{
+			if (data_pins & pin[n])
+			{
+				data[n] = val[n];
+				if (SWD_Parity(val[n]) != ((parity & pin[n]) ? 1U : 0U))
+				{
+					ack[n] = DAP_TRANSFER_ERROR;
+				}
+			}
+		}
 	}
 	else
 	{
-		return SWD_TransferSlow(request, data);
+		// Turnaround, then write data to the OK targets and idle cycles to the others
+		for (k = trn; k; k--)
+		{
+			SWD_GangCycle(delay);
+		}
+		PIN_GANG_SWDIO_OUT_ENABLE(active & ~late);
+		for (k = 0U; k < 33U; k++)
+		{
+			set = 0U;
+			for (n = 0U; n < DAP_GANG_CNT; n++)
+			{
+				if ((data_pins & pin[n]) &&
+					(((k < 32U) ? (data[n] >> k) : SWD_Parity(data[n])) & 1U))
+				{
+					set |= pin[n];
+				}
+			}
+			PIN_GANG_SWDIO_OUT(set, all & ~set);
+			SWD_GangCycle(delay);
+		}
+	}
+
+	// Idle cycles
+	PIN_GANG_SWDIO_OUT_ENABLE(all);
+	PIN_GANG_SWDIO_OUT(0U, all);
+	for (k = DAP_Data.transfer.idle_cycles; k; k--)
+	{
+		SWD_GangCycle(delay);
 	}
+	PIN_GANG_SWDIO_OUT(all, 0U);
 }
 
+#endif /* (DAP_GANG != 0) */
+
 #endif /* (DAP_SWD != 0) */
@@ -38,6 +38,8 @@ static const char *const error_message[] =
     "Flash algorithm erase all command FAILURE",
     // ERROR_WRITE
     "Flash algorithm write command FAILURE",
+    // ERROR_VERIFY
+    "The interface firmware FAILED to read back the target flash contents",
 };
 
 static error_type_t error_type[] =
@@ -73,6 +75,8 @@ static error_type_t error_type[] =
     ERROR_TYPE_TARGET,
     // ERROR_WRITE
     ERROR_TYPE_TARGET,
+    // ERROR_VERIFY
+    ERROR_TYPE_TARGET,
 };
 
 const char *error_get_string(error_tt error)
@@ -43,4 +43,5 @@ const program_target_t flash_algo_F1 =
 	sizeof(flash_code_F1),  // prog_blob size
 	flash_code_F1,  // address of prog_blob
 	0x00000400,  // ram_to_flash_bytes_to_be_written
+	0x20000800,  // second mem buffer location
 };
@@ -39,4 +39,5 @@ const program_target_t flash_algo_F3 = {
     sizeof(flash_code_F3),  // prog_blob size
     flash_code_F3,  // address of prog_blob
     0x00000010,  // ram_to_flash_bytes_to_be_written
+    0x20000800,  // second mem buffer location
 };
@@ -39,4 +39,5 @@ const program_target_t flash_algo = {
     sizeof(flash_code),  // prog_blob size
     flash_code,  // address of prog_blob
     0x00000400,  // ram_to_flash_bytes_to_be_written
+    0x20000800,  // second mem buffer location
 };
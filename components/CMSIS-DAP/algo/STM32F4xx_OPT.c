@@ -35,4 +35,5 @@ const program_target_t flash_algo_F4 = {
     sizeof(flash_code_F4),  // prog_blob size
     flash_code_F4,  // address of prog_blob
     0x00000210,  // ram_to_flash_bytes_to_be_written
+    0x20000800,  // second mem buffer location
 };
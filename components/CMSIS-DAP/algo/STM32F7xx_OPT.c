@@ -37,4 +37,5 @@ const program_target_t flash_algo_F7 = {
     sizeof(flash_code_F7),  // prog_blob size
     flash_code_F7,  // address of prog_blob
     0x00000008,  // ram_to_flash_bytes_to_be_written
+    0x20000800,  // second mem buffer location
 };
@@ -57,4 +57,5 @@ const program_target_t flash_algo_H7 = {
     sizeof(flash_code_H7),  // prog_blob size
     flash_code_H7,  // address of prog_blob
     0x00000400,  // ram_to_flash_bytes_to_be_written
+    0x20000800,  // second mem buffer location
 };
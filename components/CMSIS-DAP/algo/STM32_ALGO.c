@@ -2,13 +2,27 @@
  * Copyright (c) 2009-2015 ARM Limited
  */
 #include "flash_blob.h"
+#include "flm.h"
 #include "stdlib.h"
 #include "string.h"
+#include "DAP_config.h"
+
+// Stack of a loaded algorithm, right behind its blob
+#define FLM_STACK_SIZE 0x200
+
+static const char *TAG = "algo";
+
+algo_info_t STM32_ALGO[ALGO_CNT]={0};
+
+// FLM cache behind the compiled-in algorithms, slots are reused round robin
+static flm_t algo_flm[ALGO_CACHE_CNT];
+static char algo_name[ALGO_CACHE_CNT][FLM_NAME_SIZE];
+static uint32_t algo_next;
 
-algo_info_t STM32_ALGO[6]={0};
 void algo_init(void)
 {
-	memset(STM32_ALGO,0,sizeof(STM32_ALGO));
+	// The FLM cache is kept
+	memset(STM32_ALGO,0,ALGO_BUILTIN_CNT * sizeof(STM32_ALGO[0]));
 	STM32_ALGO[0].name="STM32F0XX";
 	STM32_ALGO[1].name="STM32F1XX";
 	STM32_ALGO[2].name="STM32F3XX";
@@ -23,3 +37,122 @@ void algo_init(void)
 	memcpy(&STM32_ALGO[4].algo,&flash_algo_F7,sizeof(flash_algo_F7));
 	memcpy(&STM32_ALGO[5].algo,&flash_algo_H7,sizeof(flash_algo_H7));
 }
+
+// Registry index of an algorithm by name, -1 when it is neither compiled in nor cached
+int algo_find(const char *name)
+{
+	int i;
+
+	if (STM32_ALGO[0].algo.algo_blob == NULL)
+	{
+		algo_init();
+	}
+	for (i = 0; i < ALGO_CNT; i++)
+	{
+		if ((STM32_ALGO[i].algo.algo_blob != NULL) && (strcmp(STM32_ALGO[i].name, name) == 0))
+		{
+			return i;
+		}
+	}
+	return -1;
+}
+
+// Lay out a parsed FLM in target RAM: blob (with the static data), stack, program buffer
+// and the second program buffer when it fits
+static int algo_place(const flm_t *flm, algo_info_t *info)
+{
+	uint32_t start = CONFIG_DAP_FLM_RAM_START;
+	uint32_t sp = (start + flm->blob_size + FLM_STACK_SIZE + 7U) & ~7U;
+	uint32_t page = (flm->page_size + 3U) & ~3U;
+	uint32_t room = CONFIG_DAP_FLM_RAM_SIZE - (sp - start);
+
+	if (((sp - start) > CONFIG_DAP_FLM_RAM_SIZE) || (flm->page_size > room))
+	{
+		return 0;
+	}
+
+	program_target_t algo = {
+		start + flm->entry[FLM_INIT] + 1,  // Init
+		start + flm->entry[FLM_UNINIT] + 1,  // UnInit
+		flm->entry[FLM_ERASE_CHIP] ? (start + flm->entry[FLM_ERASE_CHIP] + 1) : 0,  // EraseChip
+		start + flm->entry[FLM_ERASE_SECTOR] + 1,  // EraseSector
+		start + flm->entry[FLM_PROGRAM_PAGE] + 1,  // ProgramPage
+
+		// BKPT : start of blob + 1
+		// RSB  : address to access global/static data
+		// RSP  : stack pointer
+		{
+			start + 1,
+			start + flm->data,
+			sp
+		},
+
+		sp,  // mem buffer location
+		start,  // location to write prog_blob in target RAM
+		flm->blob_size,  // prog_blob size
+		flm->blob,  // address of prog_blob
+		flm->page_size,  // ram_to_flash_bytes_to_be_written
+		(room >= (2U * page)) ? (sp + page) : 0,  // second mem buffer location
+	};
+	memcpy(&info->algo, &algo, sizeof(algo));
+	info->sectors = flm->sectors;
+	info->sector_cnt = flm->sector_cnt;
+	info->flash_start = flm->dev_addr;
+	info->flash_size = flm->dev_size;
+	return 1;
+}
+
+// Registry index of an algorithm, an FLM not in the cache is parsed from the
+// FLM store of the pin driver (storage partition). Negative when it cannot be loaded.
+int algo_load(const char *name)
+{
+	const void *store;
+	const uint8_t *elf;
+	uint32_t store_size;
+	uint32_t elf_size;
+	uint32_t slot;
+	flm_t flm;
+	int result;
+
+	result = algo_find(name);
+	if (result >= 0)
+	{
+		return result;
+	}
+	if (strlen(name) >= FLM_NAME_SIZE)
+	{
+		return FLM_ERROR_ELF;
+	}
+
+	store = DAP_FlmStoreMap(&store_size);
+	if (store == NULL)
+	{
+		ESP_LOGE(TAG, "storage partition not mapped");
+		return FLM_ERROR_ELF;
+	}
+	elf = flm_store_find(store, store_size, name, &elf_size);
+	result = (elf != NULL) ? flm_parse(elf, elf_size, &flm) : FLM_ERROR_ELF;
+	DAP_FlmStoreUnmap();
+	if (result != FLM_OK)
+	{
+		ESP_LOGE(TAG, "%s: not loaded (%d)", name, result);
+		return result;
+	}
+
+	slot = algo_next;
+	algo_next = (algo_next + 1U) % ALGO_CACHE_CNT;
+	flm_free(&algo_flm[slot]);
+	memset(&STM32_ALGO[ALGO_BUILTIN_CNT + slot], 0, sizeof(STM32_ALGO[0]));
+	algo_flm[slot] = flm;
+	if (!algo_place(&algo_flm[slot], &STM32_ALGO[ALGO_BUILTIN_CNT + slot]))
+	{
+		ESP_LOGE(TAG, "%s: does not fit in target RAM", name);
+		flm_free(&algo_flm[slot]);
+		memset(&STM32_ALGO[ALGO_BUILTIN_CNT + slot], 0, sizeof(STM32_ALGO[0]));
+		return FLM_ERROR_MEMORY;
+	}
+	strcpy(algo_name[slot], name);
+	STM32_ALGO[ALGO_BUILTIN_CNT + slot].name = algo_name[slot];
+	ESP_LOGI(TAG, "%s: %s, %u sector groups", name, flm.dev_name, flm.sector_cnt);
+	return ALGO_BUILTIN_CNT + slot;
+}
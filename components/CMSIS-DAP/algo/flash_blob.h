@@ -22,6 +22,7 @@ typedef struct {
     const uint32_t  algo_size;
     const uint32_t *algo_blob;
     const uint32_t  program_buffer_size;
+    const uint32_t  program_buffer2;     // second buffer for double buffering, 0 = none
 } program_target_t;
 
 typedef struct {
@@ -33,8 +34,18 @@ typedef struct {
 
 	char * name;
     program_target_t algo;
+    const sector_info_t *sectors;   // sector groups of a loaded FLM, NULL = not known
+    uint32_t sector_cnt;
+    uint32_t flash_start;           // flash described by a loaded FLM, 0 = not known
+    uint32_t flash_size;
 } algo_info_t;
 
+// Algorithm registry: the compiled-in algorithms, then the cache of FLM files
+// loaded from the storage partition
+#define ALGO_BUILTIN_CNT 6
+#define ALGO_CACHE_CNT 4
+#define ALGO_CNT (ALGO_BUILTIN_CNT + ALGO_CACHE_CNT)
+
 enum 
 {
 	F0 = 0,
@@ -51,6 +62,8 @@ extern const program_target_t flash_algo_F3;
 extern const program_target_t flash_algo_F4;
 extern const program_target_t flash_algo_F7;
 extern const program_target_t flash_algo_H7;
-extern algo_info_t STM32_ALGO[6];
+extern algo_info_t STM32_ALGO[ALGO_CNT];
 void algo_init(void);
+int algo_find(const char *name);
+int algo_load(const char *name);
 #endif
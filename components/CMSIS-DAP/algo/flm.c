@@ -0,0 +1,378 @@
+/**
+ * @file    flm.c
+ * @brief   Keil/CMSIS-Pack flash algorithm (.FLM) loader
+ *
+ * Parses the ELF file from memory (a mapped partition), every offset and size
+ * taken from the file is checked against its size.
+ */
+#include <stdlib.h>
+#include <string.h>
+
+#include "flm.h"
+
+// ELF32 constants and field offsets
+#define ELF_MACHINE_ARM 40
+#define ELF_SHT_PROGBITS 1
+#define ELF_SHT_SYMTAB 2
+#define ELF_SHT_NOBITS 8
+#define ELF_SHDR_SIZE 40
+#define ELF_SYM_SIZE 16
+
+// FlashDevice (FlashOS.h) field offsets
+#define DEV_NAME 2
+#define DEV_ADR 132
+#define DEV_SIZE 136
+#define DEV_PAGE 140
+#define DEV_EMPTY 148
+#define DEV_SECTORS 160
+#define DEV_SECTOR_END 0xFFFFFFFF
+
+// Breakpoint header of the blob, the same as in front of the compiled-in algorithms
+static const uint32_t flm_header[FLM_HEADER_SIZE / 4] = {
+	0xE00ABE00, 0x062D780D, 0x24084068, 0xD3000040, 0x1E644058, 0x1C49D1FA, 0x2A001E52, 0x4770D1F2};
+
+// Symbols of the entry points, in the order of FLM_INIT ...
+static const char *const flm_symbol[FLM_ENTRY_CNT] = {
+	"Init", "UnInit", "EraseChip", "EraseSector", "ProgramPage"};
+
+typedef struct
+{
+	const uint8_t *elf;
+	uint32_t size;
+	uint32_t shoff; // Section header table
+	uint32_t shnum;
+	uint32_t shstr; // Section name string table offset and size
+	uint32_t shstr_size;
+} flm_elf_t;
+
+typedef struct
+{
+	uint32_t name;
+	uint32_t type;
+	uint32_t addr;
+	uint32_t offset;
+	uint32_t size;
+	uint32_t link;
+} flm_section_t;
+
+static uint32_t get16(const uint8_t *p)
+{
+	return p[0] | (p[1] << 8);
+}
+
+static uint32_t get32(const uint8_t *p)
+{
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// Range [offset, offset + size) inside the file
+static int flm_in_file(const flm_elf_t *e, uint32_t offset, uint32_t size)
+{
+	return (offset <= e->size) && (size <= (e->size - offset));
+}
+
+static int flm_section(const flm_elf_t *e, uint32_t n, flm_section_t *s)
+{
+	const uint8_t *h;
+
+	if (n >= e->shnum)
+	{
+		return 0;
+	}
+	h = e->elf + e->shoff + (n * ELF_SHDR_SIZE);
+	s->name = get32(h + 0);
+	s->type = get32(h + 4);
+	s->addr = get32(h + 12);
+	s->offset = get32(h + 16);
+	s->size = get32(h + 20);
+	s->link = get32(h + 24);
+
+	// NOBITS sections have no contents in the file
+	return (s->type == ELF_SHT_NOBITS) || flm_in_file(e, s->offset, s->size);
+}
+
+// NUL terminated string in a string table, NULL when it runs past the table
+static const char *flm_string(const flm_elf_t *e, uint32_t table, uint32_t table_size, uint32_t n)
+{
+	const char *str = (const char *)e->elf + table + n;
+
+	if ((n >= table_size) || (memchr(str, 0, table_size - n) == NULL))
+	{
+		return NULL;
+	}
+	return str;
+}
+
+static int flm_section_is(const flm_elf_t *e, const flm_section_t *s, const char *name)
+{
+	const char *str = flm_string(e, e->shstr, e->shstr_size, s->name);
+
+	return (str != NULL) && (strcmp(str, name) == 0);
+}
+
+static int flm_open(flm_elf_t *e, const uint8_t *elf, uint32_t size)
+{
+	flm_section_t s;
+
+	e->elf = elf;
+	e->size = size;
+	if ((size < 52) || (get32(elf) != 0x464C457F) || (elf[4] != 1) || (elf[5] != 1) ||
+		(get16(elf + 18) != ELF_MACHINE_ARM) || (get16(elf + 46) != ELF_SHDR_SIZE))
+	{
+		return 0;
+	}
+	e->shoff = get32(elf + 32);
+	e->shnum = get16(elf + 48);
+	if ((e->shnum > (0xFFFFFFFF / ELF_SHDR_SIZE)) || !flm_in_file(e, e->shoff, e->shnum * ELF_SHDR_SIZE))
+	{
+		return 0;
+	}
+	if (!flm_section(e, get16(elf + 50), &s) || (s.type == ELF_SHT_NOBITS))
+	{
+		return 0;
+	}
+	e->shstr = s.offset;
+	e->shstr_size = s.size;
+	return 1;
+}
+
+// Copy PrgCode and PrgData into the blob behind the header
+static int flm_load_code(const flm_elf_t *e, flm_t *flm)
+{
+	flm_section_t s;
+	uint32_t end = 0;
+	uint32_t n;
+	int code = 0;
+
+	flm->data = 0;
+	for (n = 0; n < e->shnum; n++)
+	{
+		if (!flm_section(e, n, &s) || !(flm_section_is(e, &s, "PrgCode") || flm_section_is(e, &s, "PrgData")))
+		{
+			continue;
+		}
+		if ((s.addr > (FLM_BLOB_MAX - FLM_HEADER_SIZE)) || (s.size > (FLM_BLOB_MAX - FLM_HEADER_SIZE - s.addr)))
+		{
+			return FLM_ERROR_CODE;
+		}
+		if (s.addr + s.size > end)
+		{
+			end = s.addr + s.size;
+		}
+		if (flm_section_is(e, &s, "PrgCode"))
+		{
+			code = 1;
+		}
+		else if ((flm->data == 0) || (FLM_HEADER_SIZE + s.addr < flm->data))
+		{
+			flm->data = FLM_HEADER_SIZE + s.addr;
+		}
+	}
+	if (!code)
+	{
+		return FLM_ERROR_CODE;
+	}
+
+	flm->blob_size = (FLM_HEADER_SIZE + end + 3) & ~3U;
+	flm->blob = calloc(1, flm->blob_size);
+	if (flm->blob == NULL)
+	{
+		return FLM_ERROR_MEMORY;
+	}
+	memcpy(flm->blob, flm_header, FLM_HEADER_SIZE);
+
+	// ZI data stays cleared
+	for (n = 0; n < e->shnum; n++)
+	{
+		if (flm_section(e, n, &s) && (s.type == ELF_SHT_PROGBITS) &&
+			(flm_section_is(e, &s, "PrgCode") || flm_section_is(e, &s, "PrgData")))
+		{
+			memcpy((uint8_t *)flm->blob + FLM_HEADER_SIZE + s.addr, e->elf + s.offset, s.size);
+		}
+	}
+	if (flm->data == 0)
+	{
+		flm->data = flm->blob_size;
+	}
+	return FLM_OK;
+}
+
+// Copy the FlashDevice description at file offset dev (size bytes up to the section end)
+static int flm_load_device(const uint8_t *dev, uint32_t size, flm_t *flm)
+{
+	sector_info_t *sectors;
+	uint32_t cnt;
+	uint32_t n;
+
+	if (size < DEV_SECTORS + 8)
+	{
+		return FLM_ERROR_DEVICE;
+	}
+	memcpy(flm->dev_name, dev + DEV_NAME, sizeof(flm->dev_name));
+	flm->dev_name[sizeof(flm->dev_name) - 1] = 0;
+	flm->dev_addr = get32(dev + DEV_ADR);
+	flm->dev_size = get32(dev + DEV_SIZE);
+	flm->page_size = get32(dev + DEV_PAGE);
+	flm->empty = dev[DEV_EMPTY];
+
+	for (cnt = 0; (DEV_SECTORS + (cnt * 8) + 8) <= size; cnt++)
+	{
+		if (get32(dev + DEV_SECTORS + (cnt * 8)) == DEV_SECTOR_END)
+		{
+			break;
+		}
+	}
+	if ((cnt == 0) || (flm->page_size == 0))
+	{
+		return FLM_ERROR_DEVICE;
+	}
+
+	sectors = malloc(cnt * sizeof(sector_info_t));
+	if (sectors == NULL)
+	{
+		return FLM_ERROR_MEMORY;
+	}
+	for (n = 0; n < cnt; n++)
+	{
+		// FlashSectors: szSector, AddrSector (offset from DevAdr)
+		sector_info_t s = {flm->dev_addr + get32(dev + DEV_SECTORS + (n * 8) + 4), get32(dev + DEV_SECTORS + (n * 8))};
+
+		memcpy(&sectors[n], &s, sizeof(s));
+	}
+	flm->sectors = sectors;
+	flm->sector_cnt = cnt;
+	return FLM_OK;
+}
+
+// Entry points and FlashDevice from the symbol table
+static int flm_load_symbols(const flm_elf_t *e, flm_t *flm)
+{
+	flm_section_t symtab, strtab, s;
+	const uint8_t *sym;
+	const char *name;
+	uint32_t found = 0;
+	uint32_t n, i;
+	int dev = 0;
+	int result;
+
+	for (n = 0; n < e->shnum; n++)
+	{
+		if (flm_section(e, n, &symtab) && (symtab.type == ELF_SHT_SYMTAB))
+		{
+			break;
+		}
+	}
+	if ((n == e->shnum) || !flm_section(e, symtab.link, &strtab) || (strtab.type == ELF_SHT_NOBITS))
+	{
+		return FLM_ERROR_SYMBOL;
+	}
+
+	for (n = 0; n < (symtab.size / ELF_SYM_SIZE); n++)
+	{
+		sym = e->elf + symtab.offset + (n * ELF_SYM_SIZE);
+		name = flm_string(e, strtab.offset, strtab.size, get32(sym));
+		if (name == NULL)
+		{
+			continue;
+		}
+		for (i = 0; i < FLM_ENTRY_CNT; i++)
+		{
+			if (strcmp(name, flm_symbol[i]) == 0)
+			{
+				// Thumb bit is set by the caller of the entry point
+				flm->entry[i] = FLM_HEADER_SIZE + (get32(sym + 4) & ~1U);
+				found |= 1U << i;
+			}
+		}
+		if ((strcmp(name, "FlashDevice") == 0) && flm_section(e, get16(sym + 14), &s) &&
+			(s.type != ELF_SHT_NOBITS) && (get32(sym + 4) >= s.addr) && ((get32(sym + 4) - s.addr) < s.size))
+		{
+			// A second description would replace the sectors of the first one
+			if (dev)
+			{
+				return FLM_ERROR_SYMBOL;
+			}
+			result = flm_load_device(e->elf + s.offset + (get32(sym + 4) - s.addr), s.size - (get32(sym + 4) - s.addr), flm);
+			if (result != FLM_OK)
+			{
+				return result;
+			}
+			dev = 1;
+		}
+	}
+
+	// EraseChip is optional
+	if (!dev || ((found | (1U << FLM_ERASE_CHIP)) != ((1U << FLM_ENTRY_CNT) - 1)))
+	{
+		return FLM_ERROR_SYMBOL;
+	}
+	for (i = 0; i < FLM_ENTRY_CNT; i++)
+	{
+		if (flm->entry[i] >= flm->blob_size)
+		{
+			return FLM_ERROR_SYMBOL;
+		}
+	}
+	return FLM_OK;
+}
+
+int flm_parse(const uint8_t *elf, uint32_t size, flm_t *flm)
+{
+	flm_elf_t e;
+	int result;
+
+	memset(flm, 0, sizeof(*flm));
+	if (!flm_open(&e, elf, size))
+	{
+		return FLM_ERROR_ELF;
+	}
+
+	result = flm_load_code(&e, flm);
+	if (result == FLM_OK)
+	{
+		result = flm_load_symbols(&e, flm);
+	}
+	if (result != FLM_OK)
+	{
+		flm_free(flm);
+	}
+	return result;
+}
+
+void flm_free(flm_t *flm)
+{
+	free(flm->blob);
+	free(flm->sectors);
+	flm->blob = NULL;
+	flm->sectors = NULL;
+}
+
+const uint8_t *flm_store_find(const uint8_t *store, uint32_t size, const char *name, uint32_t *elf_size)
+{
+	uint32_t pos = 0;
+	uint32_t len;
+
+	while ((size - pos) >= 32)
+	{
+		if (get32(store + pos) != FLM_STORE_MAGIC)
+		{
+			break;
+		}
+		len = get32(store + pos + 4);
+		if (len > (size - pos - 32))
+		{
+			break;
+		}
+		if ((strlen(name) < FLM_NAME_SIZE) && (strncmp((const char *)store + pos + 8, name, FLM_NAME_SIZE) == 0))
+		{
+			*elf_size = len;
+			return store + pos + 32;
+		}
+		pos += 32 + ((len + 3) & ~3U);
+		if (pos > size)
+		{
+			break;
+		}
+	}
+	return NULL;
+}
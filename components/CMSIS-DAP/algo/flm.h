@@ -0,0 +1,87 @@
+/**
+ * @file    flm.h
+ * @brief   Keil/CMSIS-Pack flash algorithm (.FLM) loader
+ *
+ * An FLM is an ARM ELF file with the position independent algorithm in the
+ * sections PrgCode and PrgData (RW and ZI), the FlashDevice description in
+ * DevDscr and the entry points Init, UnInit, EraseChip, EraseSector and
+ * ProgramPage in the symbol table. flm_parse turns it into a blob in the
+ * layout of the compiled-in algorithms: the 32 byte breakpoint header, then
+ * PrgCode and PrgData at their link addresses, ZI data cleared.
+ *
+ * FLM store in the storage partition: a list of records, each a 32 byte
+ * header (magic FLM_STORE_MAGIC, ELF size and a NUL padded name, all words
+ * little endian) followed by the ELF file. A record starts on the next 4 byte
+ * boundary after the previous one, the list ends at an erased word or the end
+ * of the partition.
+ */
+#ifndef FLM_H
+#define FLM_H
+
+#include <stdint.h>
+
+#include "flash_blob.h"
+
+#define FLM_STORE_MAGIC 0x314D4C46 // "FLM1"
+#define FLM_NAME_SIZE 24		   // Name in a store record, NUL padded
+
+// Size of the breakpoint header in front of PrgCode
+#define FLM_HEADER_SIZE 32
+
+// Results of flm_parse
+#define FLM_OK 0
+#define FLM_ERROR_ELF -1	 // Not a 32-bit little endian ARM ELF file, or a bad offset in it
+#define FLM_ERROR_CODE -2	 // PrgCode missing, or the algorithm does not fit FLM_BLOB_MAX
+#define FLM_ERROR_SYMBOL -3	 // Init, UnInit, EraseSector, ProgramPage or FlashDevice missing, FlashDevice twice
+#define FLM_ERROR_DEVICE -4	 // FlashDevice cut short or without sectors
+#define FLM_ERROR_MEMORY -5	 // Out of memory
+
+#define FLM_BLOB_MAX 0x4000 // Largest algorithm (header, code and data)
+
+// Entry points, offsets into the blob
+enum
+{
+	FLM_INIT = 0,
+	FLM_UNINIT,
+	FLM_ERASE_CHIP, // 0 = not provided by the algorithm
+	FLM_ERASE_SECTOR,
+	FLM_PROGRAM_PAGE,
+	FLM_ENTRY_CNT
+};
+
+typedef struct
+{
+	uint32_t *blob;			  // Header, PrgCode and PrgData, allocated by flm_parse
+	uint32_t blob_size;		  // Bytes in the blob
+	uint32_t data;			  // Offset of PrgData in the blob (static base)
+	uint32_t entry[FLM_ENTRY_CNT]; // Offsets of the entry points in the blob
+	char dev_name[128];		  // FlashDevice.DevName
+	uint32_t dev_addr;		  // FlashDevice.DevAdr, start of the flash
+	uint32_t dev_size;		  // FlashDevice.szDev
+	uint32_t page_size;		  // FlashDevice.szPage, ProgramPage size
+	uint8_t empty;			  // FlashDevice.valEmpty, erased byte value
+	sector_info_t *sectors;	  // Sector groups: first sector address and size of the sectors from there
+	uint32_t sector_cnt;	  // Entries in sectors
+} flm_t;
+
+/** Parse an FLM file.
+\param elf the file contents.
+\param size size of the file.
+\param flm parsed algorithm, blob and sectors are allocated, released by flm_free.
+\return FLM_OK or an FLM_ERROR_* value (nothing allocated).
+*/
+int flm_parse(const uint8_t *elf, uint32_t size, flm_t *flm);
+
+/** Release what flm_parse allocated. */
+void flm_free(flm_t *flm);
+
+/** Look up an FLM file by name in an FLM store.
+\param store store contents (mapped storage partition).
+\param size size of the store.
+\param name name of the algorithm.
+\param elf_size size of the file found.
+\return the file, NULL when it is not in the store.
+*/
+const uint8_t *flm_store_find(const uint8_t *store, uint32_t size, const char *name, uint32_t *elf_size);
+
+#endif
@@ -24,6 +24,7 @@
 #include "freertos/event_groups.h"
 #include "esp_wifi.h"
 #include "esp_event.h"
+#include "esp_timer.h"
 #include "event_groups.h"
 #include "esp_log.h"
 #include "lwip/api.h"
@@ -34,41 +35,290 @@
 #include "sdkconfig.h"
 #include "tinyusb.h"
 #include "cdc_task.h"
+#include "DAP_config.h"
 #include "DAP.h"
 #include "SWD_flash.h"
 #include "SWD_host.h"
+#include "hid_task.h"
+#include "webusb_task.h"
 static const char *TAG = "HID_TASK";
 
-uint8_t MYUSB_Request[64 + 1];	// Request  Buffer
-uint8_t MYUSB_Response[64 + 1]; // Response Buffer
-extern uint8_t WINUSB_Request[64];	// Request  Buffer
-extern uint8_t WINUSB_Response[64]; // Response Buffer
-uint8_t dealing_data = 0;
-int hid_len;
+// Vendor command answered by the transport, DAP_vendor.c leaves this ID free
+#define ID_DAP_Vendor_Latency ID_DAP_Vendor16 // Command turnaround statistics
+
+// DAP request/response packet ring shared by all USB transports.
+// The USB callbacks (and the bulk receive path) fill USB_Request, the DAP worker
+// drains it into USB_Response and sends each response back on the transport the
+// request came from. Producers are serialized by USB_RequestLock.
+static uint8_t USB_Request[DAP_PACKET_COUNT][DAP_PACKET_SIZE];	// Request  Buffer
+static uint8_t USB_Response[DAP_PACKET_COUNT][DAP_PACKET_SIZE]; // Response Buffer
+
+static volatile uint32_t USB_RequestIndexI;	 // Request  Index In
+static volatile uint32_t USB_RequestIndexO;	 // Request  Index Out
+static volatile uint32_t USB_RequestCountI;	 // Request  Count In
+static volatile uint32_t USB_RequestCountO;	 // Request  Count Out
+
+static volatile uint32_t USB_ResponseIndexI; // Response Index In
+static volatile uint32_t USB_ResponseIndexO; // Response Index Out
+static volatile uint32_t USB_ResponseCountI; // Response Count In
+static volatile uint32_t USB_ResponseCountO; // Response Count Out
+
+static uint8_t USB_RequestPort[DAP_PACKET_COUNT];	 // Request  transport
+static uint8_t USB_ResponsePort[DAP_PACKET_COUNT];	 // Response transport
+static uint16_t USB_ResponseSize[DAP_PACKET_COUNT]; // Response length in bytes
+
+static uint32_t USB_RequestTime[DAP_PACKET_COUNT];	// Request  arrival time (us)
+static uint32_t USB_ResponseTime[DAP_PACKET_COUNT]; // Response arrival time of its request (us)
+
+static portMUX_TYPE USB_RequestLock = portMUX_INITIALIZER_UNLOCKED;
+
+static TaskHandle_t hid_task_handle;
+static dap_latency_t dap_latency;
+
 extern bool connect_success;
 extern int connect_socket;
+
+// Store a received DAP request in the request ring
+//   port:   transport the request arrived on (DAP_TRANSPORT_xxx)
+//   return: false when the ring is full
+bool dap_queue_request(uint8_t port, const uint8_t *buf, uint32_t len)
+{
+	if (len > DAP_PACKET_SIZE)
+	{
+		len = DAP_PACKET_SIZE;
+	}
+
+	portENTER_CRITICAL(&USB_RequestLock);
+	if ((USB_RequestCountI - USB_RequestCountO) == DAP_PACKET_COUNT)
+	{
+		portEXIT_CRITICAL(&USB_RequestLock);
+		return false;
+	}
+	memcpy(USB_Request[USB_RequestIndexI], buf, len);
+	USB_RequestPort[USB_RequestIndexI] = port;
+	USB_RequestTime[USB_RequestIndexI] = (uint32_t)esp_timer_get_time();
+	if (++USB_RequestIndexI == DAP_PACKET_COUNT)
+	{
+		USB_RequestIndexI = 0U;
+	}
+	USB_RequestCountI++;
+	portEXIT_CRITICAL(&USB_RequestLock);
+
+	return true;
+}
+
+// Check if the request ring can take another packet
+bool dap_queue_free(void)
+{
+	return (USB_RequestCountI - USB_RequestCountO) != DAP_PACKET_COUNT;
+}
+
+// Wake up the DAP worker
+void dap_queue_notify(void)
+{
+	if (hid_task_handle != NULL)
+	{
+		xTaskNotifyGive(hid_task_handle);
+	}
+}
+
+// Send pending responses as long as their endpoint accepts them
+static void hid_send_responses(void)
+{
+	uint32_t index;
+	uint32_t time;
+
+	while (USB_ResponseCountI != USB_ResponseCountO)
+	{
+		index = USB_ResponseIndexO;
+#if CONFIG_DAP_USE_BULK
+		if (USB_ResponsePort[index] == DAP_TRANSPORT_BULK)
+		{
+			if (!webusb_send_response(USB_Response[index], USB_ResponseSize[index]))
+			{
+				break;
+			}
+		}
+		else
+#endif
+		{
+			if (!tud_hid_ready() || !tud_hid_report(0, USB_Response[index], DAP_PACKET_SIZE))
+			{
+				break;
+			}
+		}
+
+		// Update turnaround statistics
+		time = (uint32_t)esp_timer_get_time() - USB_ResponseTime[index];
+		dap_latency.last_us = time;
+		if (time > dap_latency.max_us)
+		{
+			dap_latency.max_us = time;
+		}
+		dap_latency.total_us += time;
+		dap_latency.count++;
+
+		if (++USB_ResponseIndexO == DAP_PACKET_COUNT)
+		{
+			USB_ResponseIndexO = 0U;
+		}
+		USB_ResponseCountO++;
+	}
+}
+
+// Answer the Latency vendor command from the turnaround statistics
+//   Request:  flags (1 byte, bit 0 = clear the statistics after reading them)
+//   Response: commands (4 bytes), last, max and average turnaround in us (4 bytes each)
+static uint32_t hid_latency_command(const uint8_t *request, uint8_t *response)
+{
+	dap_latency_t latency;
+	uint32_t value[4];
+	uint32_t n;
+
+	hid_get_latency(&latency);
+	value[0] = latency.count;
+	value[1] = latency.last_us;
+	value[2] = latency.max_us;
+	value[3] = latency.count ? (uint32_t)(latency.total_us / latency.count) : 0U;
+	if (request[1] & 0x01U)
+	{
+		hid_reset_latency();
+	}
+
+	*response++ = ID_DAP_Vendor_Latency;
+	for (n = 0U; n < 4U; n++)
+	{
+		*response++ = (uint8_t)(value[n] >> 0);
+		*response++ = (uint8_t)(value[n] >> 8);
+		*response++ = (uint8_t)(value[n] >> 16);
+		*response++ = (uint8_t)(value[n] >> 24);
+	}
+	return (1U + 16U);
+}
+
+// Check if the request at the ring output can be executed.
+// A run of ID_DAP_QueueCommands packets is held back until the packet that ends
+// it (any other command) has arrived, then the whole run is rewritten to
+// ID_DAP_ExecuteCommands so it executes back to back. A run that fills the
+// whole ring is released as well since nothing else could arrive.
+static bool hid_request_ready(void)
+{
+	uint32_t pending;
+	uint32_t index;
+	uint32_t n;
+
+	pending = USB_RequestCountI - USB_RequestCountO;
+	index = USB_RequestIndexO;
+	for (n = 0U; n < pending; n++)
+	{
+		if (USB_Request[index][0] != ID_DAP_QueueCommands)
+		{
+			break;
+		}
+		if (++index == DAP_PACKET_COUNT)
+		{
+			index = 0U;
+		}
+	}
+	if ((n == pending) && (pending != DAP_PACKET_COUNT))
+	{
+		return false; // Batch not complete yet
+	}
+
+	index = USB_RequestIndexO;
+	while (n--)
+	{
+		USB_Request[index][0] = ID_DAP_ExecuteCommands;
+		if (++index == DAP_PACKET_COUNT)
+		{
+			index = 0U;
+		}
+	}
+	return true;
+}
+
 void hid_task(void *params)
 {
+	uint32_t num;
+	uint8_t port = DAP_TRANSPORT_HID;
+	uint32_t time = 0U;
+
 	(void)params;
+
+	hid_task_handle = xTaskGetCurrentTaskHandle();
 	while (1)
 	{
-	
-		if (dealing_data)
+		// Sleep until a USB callback signals a request or a completed IN transfer
+		// that makes room for the next response
+		ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+#if CONFIG_DAP_USE_BULK
+		webusb_receive_request();
+#endif
+
+		// Process pending requests while there is room for the response. The further
+		// response packets of a streaming vendor command go out before the next request.
+		while (((USB_ResponseCountI - USB_ResponseCountO) < DAP_PACKET_COUNT) &&
+			   (DAP_VendorStreamPending() ||
+				((USB_RequestCountI != USB_RequestCountO) && hid_request_ready())))
 		{
-			DAP_ProcessCommand(MYUSB_Request, MYUSB_Response);
-			tud_hid_report(0, MYUSB_Response, 64);
-			dealing_data = 0;
+			if (DAP_VendorStreamPending())
+			{
+				num = DAP_ProcessVendorStream(USB_Response[USB_ResponseIndexI]);
+			}
+			else
+			{
+				if (USB_Request[USB_RequestIndexO][0] == ID_DAP_Vendor_Latency)
+				{
+					num = hid_latency_command(USB_Request[USB_RequestIndexO], USB_Response[USB_ResponseIndexI]);
+				}
+				else
+				{
+					num = DAP_ExecuteCommand(USB_Request[USB_RequestIndexO], USB_Response[USB_ResponseIndexI]);
+				}
+				port = USB_RequestPort[USB_RequestIndexO];
+				time = USB_RequestTime[USB_RequestIndexO];
+
+				// Update request index and counter
+				if (++USB_RequestIndexO == DAP_PACKET_COUNT)
+				{
+					USB_RequestIndexO = 0U;
+				}
+				USB_RequestCountO++;
+			}
+			USB_ResponseSize[USB_ResponseIndexI] = (uint16_t)num;
+			USB_ResponsePort[USB_ResponseIndexI] = port;
+			USB_ResponseTime[USB_ResponseIndexI] = time;
+
+			// Update response index and counter
+			if (++USB_ResponseIndexI == DAP_PACKET_COUNT)
+			{
+				USB_ResponseIndexI = 0U;
+			}
+			USB_ResponseCountI++;
+
+			hid_send_responses();
+#if CONFIG_DAP_USE_BULK
+			// A slot was freed, pull a bulk packet that waited for room
+			webusb_receive_request();
+#endif
 		}
-		// if (tud_vendor_available())
-		// {
-		// 	uint32_t count = tud_vendor_read(WINUSB_Request, 64);
-		// 	DAP_ProcessCommand(WINUSB_Request, WINUSB_Response);
-		// 	tud_vendor_write(WINUSB_Response, 63);
-		// }
-		// For ESP32-S2 this delay is essential to allow idle how to run and reset wdt
-		vTaskDelay(pdMS_TO_TICKS(1));
+
+		hid_send_responses();
 	}
 }
+
+// Get command turnaround statistics (request received to response sent)
+void hid_get_latency(dap_latency_t *latency)
+{
+	*latency = dap_latency;
+}
+
+// Clear command turnaround statistics
+void hid_reset_latency(void)
+{
+	memset(&dap_latency, 0, sizeof(dap_latency));
+}
 #if CFG_TUD_HID
 
 // Invoked when received GET_REPORT control request
@@ -92,19 +342,30 @@ void tud_hid_set_report_cb(uint8_t report_id, hid_report_type_t report_type, uin
 	// This example doesn't use multiple report and report ID
 	(void)report_id;
 	(void)report_type;
-	ESP_LOGI(TAG, "%s", buffer);
+
+	// Abort is handled out of band so it reaches a transfer that is already running
 	if (buffer[0] == ID_DAP_TransferAbort)
 	{
 		DAP_TransferAbort = 1;
 		return;
 	}
-	//没有在处理数据过程中才会接收 不然直接退出
-	if (dealing_data)
+#if CONFIG_DAP_USE_HID
+	if (!dap_queue_request(DAP_TRANSPORT_HID, buffer, bufsize))
+	{
+		ESP_LOGW(TAG, "request queue full, packet dropped");
 		return; // Discard packet when buffer is full
-	memcpy(MYUSB_Request, buffer, bufsize);
-	dealing_data = 1;
-	
-	// echo back anything we received from host
-	// tud_hid_report(0, buffer, bufsize);
+	}
+	dap_queue_notify();
+#endif
+}
+
+// Invoked when a report has been sent, the IN endpoint takes the next response
+void tud_hid_report_complete_cb(uint8_t itf, uint8_t const *report, uint8_t len)
+{
+	(void)itf;
+	(void)report;
+	(void)len;
+
+	dap_queue_notify();
 }
 #endif
@@ -26,9 +26,33 @@
 #define _HID_TASK_H
 
 #include "stdint.h"
+#include "stdbool.h"
+
+// Transports a DAP request can arrive on
+#define DAP_TRANSPORT_HID 0U  // CMSIS-DAP v1 HID reports
+#define DAP_TRANSPORT_BULK 1U // CMSIS-DAP v2 WinUSB bulk endpoints
+
 // Invoked when received SCSI_CMD_INQUIRY
 // Application fill vendor id, product id and revision with string up to 8, 16, 4 characters respectively
 void hid_task(void *params);
+
+bool dap_queue_request(uint8_t port, const uint8_t *buf, uint32_t len);
+bool dap_queue_free(void);
+void dap_queue_notify(void);
+
+// DAP command turnaround statistics, measured from the USB OUT callback
+// until the response has been handed to the IN endpoint. Hosts read them
+// with the Latency vendor command (ID_DAP_Vendor16).
+typedef struct
+{
+	uint32_t count;    // Number of completed commands
+	uint32_t last_us;  // Turnaround of the last command
+	uint32_t max_us;   // Worst turnaround seen
+	uint64_t total_us; // Sum of all turnarounds (average = total_us / count)
+} dap_latency_t;
+
+void hid_get_latency(dap_latency_t *latency);
+void hid_reset_latency(void);
  #endif
 
  
\ No newline at end of file
@@ -62,16 +62,7 @@ void app_main(void)
 	gpio_pad_select_gpio(3);
 	gpio_set_direction(3, GPIO_MODE_INPUT);
 
-	gpio_pad_select_gpio(9);
-	gpio_set_direction(9, GPIO_MODE_INPUT_OUTPUT);
-
-	DAP_SETUP();
-	ESP_LOGI(TAG, "USB initialization");
-
-	tinyusb_config_t tusb_cfg = {0};
-
-	ESP_ERROR_CHECK(tinyusb_driver_install(&tusb_cfg));
-	ESP_LOGI(TAG, "USB initialization DONE");
+	// NVS first, the pin map is read from it
 	esp_err_t ret = nvs_flash_init();
 	if (ret == ESP_ERR_NVS_NO_FREE_PAGES)
 	{
@@ -80,6 +71,15 @@ void app_main(void)
 	}
 	ESP_ERROR_CHECK(ret);
 
+	DAP_PinsLoad(); // Once, DAP_Setup runs again on every connect
+	DAP_Setup();	// Pins, default settings and SWJ clock calibration
+	ESP_LOGI(TAG, "USB initialization");
+
+	tinyusb_config_t tusb_cfg = {0};
+
+	ESP_ERROR_CHECK(tinyusb_driver_install(&tusb_cfg));
+	ESP_LOGI(TAG, "USB initialization DONE");
+
 	// #if TCP_SERVER_CLIENT_OPTION
 	//     ESP_LOGI(TAG, "As a Tcp Server , will start wifi_init_softap...");
 	//     wifi_init_softap();
@@ -95,7 +95,6 @@ void app_main(void)
 	xTaskCreate(hid_task, "hid", 4096, NULL, configMAX_PRIORITIES, NULL);
 	xTaskCreate(cdc_task, "cdc", 4096, NULL, 8, NULL);
 	xTaskCreate(msc_task, "msc", 4096, NULL, 8, NULL);
-	xTaskCreate(webusb_task, "web", 4096, NULL, configMAX_PRIORITIES - 1, NULL);
 	//	xTaskCreate(led_task, "led", 4096, NULL, 20, NULL);
 
 	return;
@@ -16,6 +16,8 @@
 #include "tinyusb.h"
 #include "webusb_task.h"
 #include "DAP.h"
+#include "DAP_config.h"
+#include "hid_task.h"
 
 static const char *TAG = "WEB_TASK";
 
@@ -91,7 +93,6 @@ static bool web_serial_connected = false;
 
 //------------- prototypes -------------//
 void cdc_task(void *);
-void webusb_task(void *p);
 
 //--------------------------------------------------------------------+
 // Device callbacks
@@ -124,31 +125,6 @@ void tud_resume_cb(void)
 	ESP_LOGI(TAG, "%s", __func__);
 }
 
-// send characters to both CDC and WebUSB
-static void echo_all(uint8_t buf[], uint32_t count)
-{
-	// echo to web serial
-	if (tud_vendor_write_available())
-	{
-		tud_vendor_write(buf, count);
-	}
-	else
-		ESP_LOGI(TAG, "%s", __func__);
-
-	// // echo to cdc
-	// if (tud_cdc_connected())
-	// {
-	// 	for (uint32_t i = 0; i < count; i++)
-	// 	{
-	// 		tud_cdc_write_char(buf[i]);
-
-	// 		if (buf[i] == '\r')
-	// 			tud_cdc_write_char('\n');
-	// 	}
-	// 	tud_cdc_write_flush();
-	// }
-}
-
 //--------------------------------------------------------------------+
 // WebUSB use vendor class
 //--------------------------------------------------------------------+
@@ -183,12 +159,6 @@ bool tud_vendor_control_request_cb(uint8_t rhport, tusb_control_request_t const
 		// connect and disconnect.
 		web_serial_connected = (request->wValue != 0);
 
-		// Always lit LED if connected
-		if (web_serial_connected)
-		{
-			tud_vendor_write_str("\r\nTinyUSB WebUSB device example\r\n");
-		}
-
 		// response with status OK
 		return tud_control_status(rhport, request);
 
@@ -211,28 +181,70 @@ bool tud_vendor_control_complete_cb(uint8_t rhport, tusb_control_request_t const
 	// nothing to do
 	return true;
 }
-#endif
-uint8_t WINUSB_Request[64] = {0};  // Request  Buffer
-uint8_t WINUSB_Response[64] = {0}; // Response Buffer
-uint8_t WINUSB_data = 0;
-int WINUSB_len;
-void webusb_task(void *p)
+
+#if CONFIG_DAP_USE_BULK
+//--------------------------------------------------------------------+
+// CMSIS-DAP v2 bulk transport
+//--------------------------------------------------------------------+
+// The vendor RX/TX FIFOs hold two packets (CFG_TUD_VENDOR_TX/RX_BUFSIZE) and run
+// in packet mode (CFG_TUD_VENDOR_PACKETS), so every OUT transfer stays a separate
+// DAP request and every response goes out as its own IN transfer. The OUT
+// endpoint is re-armed as soon as a packet fits into the RX FIFO again.
+
+// Invoked when an OUT transfer has been stored in the vendor RX FIFO. Abort is handled out
+// of band so it reaches a transfer that is already running, also when the request ring is
+// full and the packet waits in the RX FIFO behind others.
+void tud_vendor_rx_cb(uint8_t itf)
 {
-	uint32_t time;
-	while (1)
+	uint8_t cmd;
+
+	if (tud_vendor_n_peek_received(itf, &cmd) && (cmd == ID_DAP_TransferAbort))
 	{
-#if CFG_TUD_VENDOR
-	
-		// if (tud_vendor_available())
-		// {
-		// 	time = xTaskGetTickCount();
-		// 	uint32_t count = tud_vendor_read(WINUSB_Request, 64);
-		// 	DAP_ProcessCommand(WINUSB_Request, WINUSB_Response);
-		// 	tud_vendor_write(WINUSB_Response, 63);
-		// 	ESP_LOGI(TAG, "%d %d", count, xTaskGetTickCount() - time);
-		// }
-#endif
-		vTaskDelay(pdMS_TO_TICKS(10));
-		
+		DAP_TransferAbort = 1;
+	}
+	dap_queue_notify();
+}
+
+// Invoked when an IN transfer has completed and the TX FIFO has room again
+void tud_vendor_tx_cb(uint8_t itf, uint32_t sent_bytes)
+{
+	(void)itf;
+	(void)sent_bytes;
+	dap_queue_notify();
+}
+
+// Move received bulk packets into the DAP request ring, called by the DAP worker
+void webusb_receive_request(void)
+{
+	uint8_t buf[DAP_PACKET_SIZE];
+	uint32_t len;
+
+	while (tud_vendor_available() && dap_queue_free())
+	{
+		len = tud_vendor_read(buf, sizeof(buf));
+		if (len == 0U)
+		{
+			break;
+		}
+		// Abort was taken when it arrived (tud_vendor_rx_cb), setting it again here would
+		// abort a later transfer
+		if (buf[0] == ID_DAP_TransferAbort)
+		{
+			continue;
+		}
+		dap_queue_request(DAP_TRANSPORT_BULK, buf, len);
 	}
 }
+
+// Send a DAP response on the bulk IN endpoint
+//   return: false when the TX FIFO has no room for the response yet
+bool webusb_send_response(const uint8_t *buf, uint32_t len)
+{
+	if (tud_vendor_write_available() < len)
+	{
+		return false;
+	}
+	return (tud_vendor_write(buf, len) == len);
+}
+#endif
+#endif
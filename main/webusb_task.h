@@ -26,9 +26,11 @@
 #define _WEBUSB_TASK_H
 
 #include "stdint.h"
-// Invoked when received SCSI_CMD_INQUIRY
-// Application fill vendor id, product id and revision with string up to 8, 16, 4 characters respectively
-void webusb_task(void *p);
+#include "stdbool.h"
+
+// CMSIS-DAP v2 bulk transport, serviced from the DAP worker
+void webusb_receive_request(void);
+bool webusb_send_response(const uint8_t *buf, uint32_t len);
  #endif
 
  
\ No newline at end of file
@@ -0,0 +1,82 @@
+/*---------------------------------------------------------------------------
+ * dap_test.h  Checks and helpers shared by the host tests
+ *
+ * Every test is a program linked against a host build of the component
+ * (DAP_PIN_DRIVER=1). Failed checks are printed and counted, the exit code
+ * tells ctest whether any check failed.
+ *---------------------------------------------------------------------------*/
+#ifndef __DAP_TEST_H__
+#define __DAP_TEST_H__
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "DAP_config.h"
+#include "DAP.h"
+
+static int dap_test_failed;
+
+// Response of the last dap_test_command
+static uint8_t dap_test_response[DAP_PACKET_SIZE];
+
+// Check a condition, a failure is reported and the test carries on
+#define CHECK(cond) dap_test_check((cond) != 0, #cond, __FILE__, __LINE__)
+
+static inline void dap_test_check(int ok, const char *cond, const char *file, int line)
+{
+	if (!ok)
+	{
+		printf("%s:%d: check failed: %s\n", file, line, cond);
+		dap_test_failed++;
+	}
+}
+
+// Exit code of the test program
+static inline int dap_test_result(const char *name)
+{
+	printf("%s: %s\n", name, dap_test_failed ? "FAIL" : "PASS");
+	return (dap_test_failed != 0) ? 1 : 0;
+}
+
+// Little endian word in a request or response
+static inline uint32_t dap_test_get32(const uint8_t *p)
+{
+	return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline void dap_test_put32(uint8_t *p, uint32_t val)
+{
+	p[0] = (uint8_t)(val >> 0);
+	p[1] = (uint8_t)(val >> 8);
+	p[2] = (uint8_t)(val >> 16);
+	p[3] = (uint8_t)(val >> 24);
+}
+
+// Execute a DAP command into dap_test_response
+//   return: number of bytes in the response
+static inline uint32_t dap_test_command(const uint8_t *request)
+{
+	return DAP_ExecuteCommand(request, dap_test_response) & 0xFFFFU;
+}
+
+// Connect the SWD port, reset the line and read IDCODE
+//   return: IDCODE, 0 when the target did not answer
+static inline uint32_t dap_test_swd_connect(void)
+{
+	static const uint8_t connect[] = {ID_DAP_Connect, DAP_PORT_SWD};
+	static const uint8_t line_reset[] = {ID_DAP_SWJ_Sequence, 56, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+	static const uint8_t idle[] = {ID_DAP_SWJ_Sequence, 8, 0x00};
+	static const uint8_t idcode[] = {ID_DAP_Transfer, 0, 1, 0x02};
+
+	dap_test_command(connect);
+	dap_test_command(line_reset);
+	dap_test_command(idle);
+	dap_test_command(idcode);
+	if ((dap_test_response[1] != 1U) || (dap_test_response[2] != DAP_TRANSFER_OK))
+	{
+		return 0U;
+	}
+	return dap_test_get32(&dap_test_response[3]);
+}
+
+#endif /* __DAP_TEST_H__ */
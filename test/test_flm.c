@@ -0,0 +1,434 @@
+/*---------------------------------------------------------------------------
+ * test_flm.c  FLM loader and algorithm registry
+ *
+ * flm_parse on FLM files built here: a valid algorithm, every truncation of
+ * it, bad section offsets, missing and duplicate symbols and broken
+ * FlashDevice descriptions. flm_store_find on a store of several records and
+ * algo_load placing a stored FLM in target RAM through the simulated storage
+ * partition.
+ *---------------------------------------------------------------------------*/
+#include <stdlib.h>
+#include "dap_test.h"
+#include "flash_blob.h"
+#include "flm.h"
+
+// File layout of the test FLM: ELF header, sections, symbols, strings, section headers
+#define ELF_CODE 52U				   // PrgCode, CODE_SIZE bytes linked at 0
+#define ELF_DATA (ELF_CODE + CODE_SIZE) // PrgData, DATA_SIZE bytes linked behind PrgCode
+#define ELF_DEV (ELF_DATA + DATA_SIZE)	 // DevDscr, FlashDevice at DEV_ADDR
+#define ELF_SYMTAB (ELF_DEV + DEV_SIZE)
+
+#define CODE_SIZE 64U
+#define DATA_SIZE 16U
+#define DEV_SIZE (160U + (3U * 8U)) // Two sector groups and the end marker
+#define DEV_ADDR 0x1000U
+
+// Section indices
+enum
+{
+	SEC_NULL = 0,
+	SEC_CODE,
+	SEC_DATA,
+	SEC_DEV,
+	SEC_SYMTAB,
+	SEC_STRTAB,
+	SEC_SHSTRTAB,
+	SEC_CNT
+};
+
+typedef struct
+{
+	const char *name;
+	uint32_t value;
+	uint16_t shndx;
+} test_sym_t;
+
+// Entry points with the Thumb bit, as linked
+static const test_sym_t test_syms[] = {
+	{"Init", 0x01U, SEC_CODE},
+	{"UnInit", 0x09U, SEC_CODE},
+	{"EraseChip", 0x11U, SEC_CODE},
+	{"EraseSector", 0x19U, SEC_CODE},
+	{"ProgramPage", 0x21U, SEC_CODE},
+	{"FlashDevice", DEV_ADDR, SEC_DEV},
+};
+
+#define SYM_CNT (sizeof(test_syms) / sizeof(test_syms[0]))
+
+static const char shstrtab[] = "\0PrgCode\0PrgData\0DevDscr\0.symtab\0.strtab\0.shstrtab";
+
+static uint8_t elf[1024];
+static uint32_t elf_shoff; // Section header table of the last built file
+
+static void put16(uint8_t *p, uint32_t val)
+{
+	p[0] = (uint8_t)val;
+	p[1] = (uint8_t)(val >> 8);
+}
+
+// Offset of a field in the section header of section n
+static uint8_t *elf_shdr(uint32_t n, uint32_t field)
+{
+	return &elf[elf_shoff + (n * 40U) + field];
+}
+
+static void elf_section(uint32_t n, uint32_t name, uint32_t type, uint32_t addr, uint32_t offset, uint32_t size, uint32_t link)
+{
+	dap_test_put32(elf_shdr(n, 0), name);
+	dap_test_put32(elf_shdr(n, 4), type);
+	dap_test_put32(elf_shdr(n, 12), addr);
+	dap_test_put32(elf_shdr(n, 16), offset);
+	dap_test_put32(elf_shdr(n, 20), size);
+	dap_test_put32(elf_shdr(n, 24), link);
+}
+
+// Build an FLM with the symbols sym (without the null symbol) into elf
+//   page: FlashDevice.szPage
+//   return: file size
+static uint32_t elf_build(const test_sym_t *sym, uint32_t sym_cnt, uint32_t page)
+{
+	uint32_t strtab = ELF_SYMTAB + ((sym_cnt + 1U) * 16U);
+	uint32_t strtab_size = 1U;
+	uint32_t shstr;
+	uint32_t n;
+
+	memset(elf, 0, sizeof(elf));
+
+	// ELF header: 32-bit, little endian, ARM
+	memcpy(elf, "\177ELF\1\1\1", 7);
+	put16(&elf[16], 2U);
+	put16(&elf[18], 40U);
+	dap_test_put32(&elf[20], 1U);
+	put16(&elf[40], 52U);
+	put16(&elf[46], 40U);
+	put16(&elf[48], SEC_CNT);
+	put16(&elf[50], SEC_SHSTRTAB);
+
+	for (n = 0U; n < CODE_SIZE; n++)
+	{
+		elf[ELF_CODE + n] = (uint8_t)(0xA0U + n);
+	}
+	for (n = 0U; n < DATA_SIZE; n++)
+	{
+		elf[ELF_DATA + n] = (uint8_t)(0x50U + n);
+	}
+
+	// FlashDevice: 1 KB sectors from 0, 32 KB sectors from 32 KB
+	put16(&elf[ELF_DEV], 0x0101U);
+	strcpy((char *)&elf[ELF_DEV + 2U], "Test Flash 64KB");
+	dap_test_put32(&elf[ELF_DEV + 132U], 0x08000000U);
+	dap_test_put32(&elf[ELF_DEV + 136U], 0x10000U);
+	dap_test_put32(&elf[ELF_DEV + 140U], page);
+	elf[ELF_DEV + 148U] = 0xFFU;
+	dap_test_put32(&elf[ELF_DEV + 160U], 0x400U);
+	dap_test_put32(&elf[ELF_DEV + 164U], 0x0U);
+	dap_test_put32(&elf[ELF_DEV + 168U], 0x8000U);
+	dap_test_put32(&elf[ELF_DEV + 172U], 0x8000U);
+	dap_test_put32(&elf[ELF_DEV + 176U], 0xFFFFFFFFU);
+	dap_test_put32(&elf[ELF_DEV + 180U], 0xFFFFFFFFU);
+
+	for (n = 0U; n < sym_cnt; n++)
+	{
+		uint8_t *p = &elf[ELF_SYMTAB + ((n + 1U) * 16U)];
+
+		dap_test_put32(p, strtab_size);
+		dap_test_put32(p + 4, sym[n].value);
+		put16(p + 14, sym[n].shndx);
+		strcpy((char *)&elf[strtab + strtab_size], sym[n].name);
+		strtab_size += strlen(sym[n].name) + 1U;
+	}
+	shstr = strtab + strtab_size;
+	memcpy(&elf[shstr], shstrtab, sizeof(shstrtab));
+	elf_shoff = (shstr + sizeof(shstrtab) + 3U) & ~3U;
+	dap_test_put32(&elf[32], elf_shoff);
+
+	elf_section(SEC_CODE, 1U, 1U, 0U, ELF_CODE, CODE_SIZE, 0U);
+	elf_section(SEC_DATA, 9U, 1U, CODE_SIZE, ELF_DATA, DATA_SIZE, 0U);
+	elf_section(SEC_DEV, 17U, 1U, DEV_ADDR, ELF_DEV, DEV_SIZE, 0U);
+	elf_section(SEC_SYMTAB, 25U, 2U, 0U, ELF_SYMTAB, (sym_cnt + 1U) * 16U, SEC_STRTAB);
+	elf_section(SEC_STRTAB, 33U, 3U, 0U, strtab, strtab_size, 0U);
+	elf_section(SEC_SHSTRTAB, 41U, 3U, 0U, shstr, sizeof(shstrtab), 0U);
+
+	return elf_shoff + (SEC_CNT * 40U);
+}
+
+// flm_parse of the file in elf, nothing may stay allocated on an error
+static int parse(uint32_t size, flm_t *flm)
+{
+	int result = flm_parse(elf, size, flm);
+
+	if (result != FLM_OK)
+	{
+		CHECK((flm->blob == NULL) && (flm->sectors == NULL));
+	}
+	return result;
+}
+
+static void test_valid(void)
+{
+	uint32_t size = elf_build(test_syms, SYM_CNT, 0x400U);
+	flm_t flm;
+
+	CHECK(parse(size, &flm) == FLM_OK);
+	CHECK(flm.blob_size == FLM_HEADER_SIZE + CODE_SIZE + DATA_SIZE);
+	CHECK(flm.blob[0] == 0xE00ABE00U);
+	CHECK(memcmp((uint8_t *)flm.blob + FLM_HEADER_SIZE, &elf[ELF_CODE], CODE_SIZE + DATA_SIZE) == 0);
+	CHECK(flm.data == FLM_HEADER_SIZE + CODE_SIZE);
+	CHECK(flm.entry[FLM_INIT] == FLM_HEADER_SIZE + 0x00U);
+	CHECK(flm.entry[FLM_UNINIT] == FLM_HEADER_SIZE + 0x08U);
+	CHECK(flm.entry[FLM_ERASE_CHIP] == FLM_HEADER_SIZE + 0x10U);
+	CHECK(flm.entry[FLM_ERASE_SECTOR] == FLM_HEADER_SIZE + 0x18U);
+	CHECK(flm.entry[FLM_PROGRAM_PAGE] == FLM_HEADER_SIZE + 0x20U);
+	CHECK(strcmp(flm.dev_name, "Test Flash 64KB") == 0);
+	CHECK(flm.dev_addr == 0x08000000U);
+	CHECK(flm.dev_size == 0x10000U);
+	CHECK(flm.page_size == 0x400U);
+	CHECK(flm.empty == 0xFFU);
+	CHECK(flm.sector_cnt == 2U);
+	CHECK((flm.sectors[0].start == 0x08000000U) && (flm.sectors[0].size == 0x400U));
+	CHECK((flm.sectors[1].start == 0x08008000U) && (flm.sectors[1].size == 0x8000U));
+	flm_free(&flm);
+	CHECK((flm.blob == NULL) && (flm.sectors == NULL));
+
+	// EraseChip is optional
+	size = elf_build(test_syms, SYM_CNT, 0x400U);
+	put16(&elf[ELF_SYMTAB + (3U * 16U) + 14U], 0U);
+	dap_test_put32(&elf[ELF_SYMTAB + (3U * 16U)], 0U);
+	CHECK(parse(size, &flm) == FLM_OK);
+	CHECK(flm.entry[FLM_ERASE_CHIP] == 0U);
+	flm_free(&flm);
+}
+
+// Every offset and size is checked against the file size
+static void test_truncated(void)
+{
+	uint32_t size = elf_build(test_syms, SYM_CNT, 0x400U);
+	uint32_t n;
+	flm_t flm;
+
+	for (n = 0U; n < size; n++)
+	{
+		uint8_t *cut = malloc(n + 1U);
+
+		memcpy(cut, elf, n);
+		CHECK(flm_parse(cut, n, &flm) != FLM_OK);
+		CHECK((flm.blob == NULL) && (flm.sectors == NULL));
+		free(cut);
+	}
+}
+
+static void test_bad_offsets(void)
+{
+	uint32_t size;
+	flm_t flm;
+
+	size = elf_build(test_syms, SYM_CNT, 0x400U);
+	put16(&elf[18], 3U); // x86
+	CHECK(parse(size, &flm) == FLM_ERROR_ELF);
+
+	size = elf_build(test_syms, SYM_CNT, 0x400U);
+	dap_test_put32(&elf[32], size - 40U);
+	CHECK(parse(size, &flm) == FLM_ERROR_ELF);
+
+	size = elf_build(test_syms, SYM_CNT, 0x400U);
+	put16(&elf[50], SEC_CNT);
+	CHECK(parse(size, &flm) == FLM_ERROR_ELF);
+
+	size = elf_build(test_syms, SYM_CNT, 0x400U);
+	dap_test_put32(elf_shdr(SEC_SHSTRTAB, 16), size);
+	CHECK(parse(size, &flm) == FLM_ERROR_ELF);
+
+	// PrgCode outside the file, or linked beyond FLM_BLOB_MAX
+	size = elf_build(test_syms, SYM_CNT, 0x400U);
+	dap_test_put32(elf_shdr(SEC_CODE, 16), 0xFFFFFFF0U);
+	CHECK(parse(size, &flm) == FLM_ERROR_CODE);
+
+	size = elf_build(test_syms, SYM_CNT, 0x400U);
+	dap_test_put32(elf_shdr(SEC_CODE, 20), size);
+	CHECK(parse(size, &flm) == FLM_ERROR_CODE);
+
+	size = elf_build(test_syms, SYM_CNT, 0x400U);
+	dap_test_put32(elf_shdr(SEC_DATA, 12), FLM_BLOB_MAX);
+	CHECK(parse(size, &flm) == FLM_ERROR_CODE);
+
+	// Symbol table outside the file or without a string table
+	size = elf_build(test_syms, SYM_CNT, 0x400U);
+	dap_test_put32(elf_shdr(SEC_SYMTAB, 16), size);
+	CHECK(parse(size, &flm) == FLM_ERROR_SYMBOL);
+
+	size = elf_build(test_syms, SYM_CNT, 0x400U);
+	dap_test_put32(elf_shdr(SEC_SYMTAB, 24), SEC_CNT);
+	CHECK(parse(size, &flm) == FLM_ERROR_SYMBOL);
+
+	size = elf_build(test_syms, SYM_CNT, 0x400U);
+	dap_test_put32(elf_shdr(SEC_STRTAB, 20), 0xFFFFFFFFU);
+	CHECK(parse(size, &flm) == FLM_ERROR_SYMBOL);
+
+	// Entry point beyond the blob
+	size = elf_build(test_syms, SYM_CNT, 0x400U);
+	dap_test_put32(&elf[ELF_SYMTAB + 16U + 4U], 0x1001U);
+	CHECK(parse(size, &flm) == FLM_ERROR_SYMBOL);
+
+	// FlashDevice outside DevDscr
+	size = elf_build(test_syms, SYM_CNT, 0x400U);
+	dap_test_put32(&elf[ELF_SYMTAB + (SYM_CNT * 16U) + 4U], DEV_ADDR + DEV_SIZE);
+	CHECK(parse(size, &flm) == FLM_ERROR_SYMBOL);
+}
+
+// Each required symbol left out, and a second FlashDevice
+static void test_symbols(void)
+{
+	test_sym_t sym[SYM_CNT + 1U];
+	uint32_t size;
+	uint32_t n;
+	flm_t flm;
+
+	for (n = 0U; n < SYM_CNT; n++)
+	{
+		if (strcmp(test_syms[n].name, "EraseChip") == 0)
+		{
+			continue;
+		}
+		memcpy(sym, test_syms, sizeof(test_syms));
+		sym[n].name = "Unrelated";
+		size = elf_build(sym, SYM_CNT, 0x400U);
+		CHECK(parse(size, &flm) == FLM_ERROR_SYMBOL);
+	}
+
+	memcpy(sym, test_syms, sizeof(test_syms));
+	sym[SYM_CNT] = test_syms[SYM_CNT - 1U];
+	size = elf_build(sym, SYM_CNT + 1U, 0x400U);
+	CHECK(parse(size, &flm) == FLM_ERROR_SYMBOL);
+
+	// Broken FlashDevice: cut short, no sectors, no page size
+	size = elf_build(test_syms, SYM_CNT, 0x400U);
+	dap_test_put32(elf_shdr(SEC_DEV, 20), 160U);
+	CHECK(parse(size, &flm) == FLM_ERROR_DEVICE);
+
+	size = elf_build(test_syms, SYM_CNT, 0x400U);
+	dap_test_put32(&elf[ELF_DEV + 160U], 0xFFFFFFFFU);
+	CHECK(parse(size, &flm) == FLM_ERROR_DEVICE);
+
+	size = elf_build(test_syms, SYM_CNT, 0U);
+	CHECK(parse(size, &flm) == FLM_ERROR_DEVICE);
+}
+
+// Store record: header and the FLM, padded to 4 bytes
+//   return: bytes added at store + pos
+static uint32_t store_add(uint8_t *store, uint32_t pos, const char *name, uint32_t size)
+{
+	dap_test_put32(&store[pos], FLM_STORE_MAGIC);
+	dap_test_put32(&store[pos + 4U], size);
+	memset(&store[pos + 8U], 0, FLM_NAME_SIZE);
+	strcpy((char *)&store[pos + 8U], name);
+	memcpy(&store[pos + 32U], elf, size);
+	return 32U + ((size + 3U) & ~3U);
+}
+
+static uint8_t store[8192];
+
+static void test_store(void)
+{
+	uint32_t size = elf_build(test_syms, SYM_CNT, 0x400U);
+	uint32_t pos = 0U;
+	uint32_t second;
+	uint32_t found;
+
+	memset(store, 0xFF, sizeof(store));
+	pos += store_add(store, pos, "FIRST", size - 1U);
+	second = pos;
+	pos += store_add(store, pos, "SECOND", size);
+
+	CHECK(flm_store_find(store, sizeof(store), "FIRST", &found) == &store[32]);
+	CHECK(found == size - 1U);
+	CHECK(flm_store_find(store, sizeof(store), "SECOND", &found) == &store[second + 32U]);
+	CHECK(found == size);
+	CHECK(flm_store_find(store, sizeof(store), "THIRD", &found) == NULL);
+	CHECK(flm_store_find(store, sizeof(store), "SECONDARY_NAME_TOO_LONG_", &found) == NULL);
+
+	// A record running past the end of the store ends the list
+	CHECK(flm_store_find(store, pos - 4U, "SECOND", &found) == NULL);
+	CHECK(flm_store_find(store, pos - 4U, "FIRST", &found) == &store[32]);
+	CHECK(flm_store_find(store, 16U, "FIRST", &found) == NULL);
+}
+
+static void test_algo_load(void)
+{
+	static const char *const names[] = {"A", "B", "C", "D", "E"};
+	const algo_info_t *info;
+	uint32_t start = CONFIG_DAP_FLM_RAM_START;
+	uint32_t sp = (start + FLM_HEADER_SIZE + CODE_SIZE + DATA_SIZE + 0x200U + 7U) & ~7U;
+	uint32_t size;
+	uint32_t pos = 0U;
+	uint32_t n;
+	int index;
+
+	dap_sim_flm_store(NULL, 0U);
+	CHECK(algo_load("TEST") < 0);
+	CHECK(algo_load("STM32F4XX") == F4);
+
+	memset(store, 0xFF, sizeof(store));
+	size = elf_build(test_syms, SYM_CNT, 0x400U);
+	pos += store_add(store, pos, "TEST", size);
+	for (n = 0U; n < (sizeof(names) / sizeof(names[0])); n++)
+	{
+		pos += store_add(store, pos, names[n], size);
+	}
+	size = elf_build(test_syms, SYM_CNT, CONFIG_DAP_FLM_RAM_SIZE);
+	pos += store_add(store, pos, "BIG", size);
+	size = elf_build(test_syms, SYM_CNT - 1U, 0x400U);
+	pos += store_add(store, pos, "BROKEN", size);
+	dap_sim_flm_store(store, sizeof(store));
+
+	index = algo_load("TEST");
+	CHECK(index == ALGO_BUILTIN_CNT);
+	CHECK(algo_load("TEST") == index);
+	CHECK(algo_find("TEST") == index);
+	info = &STM32_ALGO[index];
+	CHECK(info->algo.algo_start == start);
+	CHECK(info->algo.algo_size == FLM_HEADER_SIZE + CODE_SIZE + DATA_SIZE);
+	CHECK(info->algo.init == start + FLM_HEADER_SIZE + 0x00U + 1U);
+	CHECK(info->algo.uninit == start + FLM_HEADER_SIZE + 0x08U + 1U);
+	CHECK(info->algo.erase_chip == start + FLM_HEADER_SIZE + 0x10U + 1U);
+	CHECK(info->algo.erase_sector == start + FLM_HEADER_SIZE + 0x18U + 1U);
+	CHECK(info->algo.program_page == start + FLM_HEADER_SIZE + 0x20U + 1U);
+	CHECK(info->algo.sys_call_s.breakpoint == start + 1U);
+	CHECK(info->algo.sys_call_s.static_base == start + FLM_HEADER_SIZE + CODE_SIZE);
+	CHECK(info->algo.sys_call_s.stack_pointer == sp);
+	CHECK(info->algo.program_buffer == sp);
+	CHECK(info->algo.program_buffer_size == 0x400U);
+	CHECK(info->algo.program_buffer2 == sp + 0x400U);
+	CHECK(info->flash_start == 0x08000000U);
+	CHECK(info->flash_size == 0x10000U);
+	CHECK(info->sector_cnt == 2U);
+	CHECK(info->sectors[1].start == 0x08008000U);
+
+	CHECK(algo_load("NONE") < 0);
+	CHECK(algo_load("BROKEN") == FLM_ERROR_SYMBOL);
+	CHECK(algo_load("BIG") == FLM_ERROR_MEMORY);
+	CHECK(algo_find("BIG") < 0);
+
+	// The cache is reused round robin, the oldest FLM is dropped
+	for (n = 0U; n < (sizeof(names) / sizeof(names[0])); n++)
+	{
+		CHECK(algo_load(names[n]) >= ALGO_BUILTIN_CNT);
+	}
+	CHECK(algo_find("TEST") < 0);
+	CHECK(algo_find("A") < 0);
+	CHECK(algo_find("E") >= ALGO_BUILTIN_CNT);
+	CHECK(algo_find("STM32H7XX") == H7);
+
+	dap_sim_flm_store(NULL, 0U);
+}
+
+int main(void)
+{
+	test_valid();
+	test_truncated();
+	test_bad_offsets();
+	test_symbols();
+	test_store();
+	test_algo_load();
+
+	return dap_test_result("test_flm");
+}
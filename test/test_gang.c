@@ -0,0 +1,249 @@
+/*---------------------------------------------------------------------------
+ * test_gang.c  Gang programming (DAP_GANG)
+ *
+ * Four targets on their own SWDIO lines programmed in lockstep through the
+ * Gang, FlashStart to FlashEnd and GangStatus vendor commands. The flash
+ * algorithm is emulated per target by the run hook of the target model.
+ * WAIT responses, a bus fault and a failing ProgramPage are injected on
+ * single targets: the slow one keeps up, the failing ones drop out with the
+ * error of their step and the others are programmed.
+ *---------------------------------------------------------------------------*/
+#include "dap_test.h"
+#include "DAP_target_sim.h"
+#include "SWD_flash.h"
+#include "flash_blob.h"
+
+#define ID_DAP_Vendor_FlashStart ID_DAP_Vendor8
+#define ID_DAP_Vendor_FlashData ID_DAP_Vendor9
+#define ID_DAP_Vendor_FlashEnd ID_DAP_Vendor11
+#define ID_DAP_Vendor_Gang ID_DAP_Vendor17
+#define ID_DAP_Vendor_GangStatus ID_DAP_Vendor18
+
+#define RAM_BASE 0x20000000U
+#define FLASH_BASE 0x08000000U
+#define IMAGE_SIZE 0x1000U
+
+// Algorithm slot of the emulated flash algorithm (first FLM cache slot)
+#define ALGO_SIM ALGO_BUILTIN_CNT
+
+// Entry points of the emulated algorithm (Thumb addresses in RAM)
+#define ALGO_INIT (RAM_BASE + 1U)
+#define ALGO_UNINIT (RAM_BASE + 3U)
+#define ALGO_ERASE_CHIP (RAM_BASE + 5U)
+#define ALGO_ERASE_SECTOR (RAM_BASE + 7U)
+#define ALGO_PROGRAM_PAGE (RAM_BASE + 9U)
+
+typedef struct
+{
+	dap_target_sim_t sim;
+	uint8_t ram[0x2000];
+	uint8_t flash[0x2000];
+	uint32_t programs;	// ProgramPage calls
+	uint32_t fail_page; // ProgramPage call returning an error, 0 = none
+} gang_target_t;
+
+static gang_target_t targets[DAP_GANG_CNT];
+static uint8_t image[IMAGE_SIZE];
+
+static const uint32_t algo_blob[4] = {0xBE00BE00U, 0xBE00BE00U, 0xBE00BE00U, 0xBE00BE00U};
+
+static const algo_info_t algo_sim = {
+	"sim",
+	{ALGO_INIT, ALGO_UNINIT, ALGO_ERASE_CHIP, ALGO_ERASE_SECTOR, ALGO_PROGRAM_PAGE,
+	 {RAM_BASE + 0x21U, RAM_BASE + 0xC00U, RAM_BASE + 0x1000U},
+	 RAM_BASE + 0x400U, RAM_BASE, sizeof(algo_blob), algo_blob, 256U, 0U},
+};
+
+// Flash algorithm of a target, called when the core is resumed at an entry point
+static uint32_t algo_run(dap_target_sim_t *sim)
+{
+	gang_target_t *t = (gang_target_t *)sim->user;
+	uint32_t addr = sim->reg[0] - FLASH_BASE;
+	uint32_t size = sim->reg[1];
+	uint32_t i;
+
+	sim->reg[0] = 0U;
+	switch (sim->reg[15])
+	{
+	case ALGO_ERASE_CHIP:
+		memset(t->flash, 0xFF, sizeof(t->flash));
+		break;
+
+	case ALGO_PROGRAM_PAGE:
+		if (++t->programs == t->fail_page)
+		{
+			sim->reg[0] = 1U;
+			break;
+		}
+		for (i = 0U; i < size; i++)
+		{
+			t->flash[addr + i] &= t->ram[sim->reg[2] - RAM_BASE + i];
+		}
+		break;
+
+	default:
+		break;
+	}
+	return 1U;
+}
+
+static void setup(void)
+{
+	static const uint8_t connect[] = {ID_DAP_Connect, DAP_PORT_SWD};
+	uint32_t n;
+
+	DAP_Setup();
+	memcpy(&STM32_ALGO[ALGO_SIM], &algo_sim, sizeof(algo_sim));
+	for (n = 0U; n < DAP_GANG_CNT; n++)
+	{
+		gang_target_t *t = &targets[n];
+
+		memset(t->flash, 0x00, sizeof(t->flash));
+		t->programs = 0U;
+		t->fail_page = 0U;
+		dap_target_sim_init(&t->sim);
+		dap_target_sim_add_region(&t->sim, RAM_BASE, sizeof(t->ram), t->ram, 1U);
+		dap_target_sim_add_region(&t->sim, FLASH_BASE, sizeof(t->flash), t->flash, 0U);
+		t->sim.run = algo_run;
+		t->sim.user = t;
+		dap_target_sim_gang_attach(&t->sim, n);
+	}
+	dap_test_command(connect);
+}
+
+// Gang vendor command with the target mask
+//   return: status
+static uint8_t gang_select(uint32_t mask)
+{
+	uint8_t request[] = {ID_DAP_Vendor_Gang, (uint8_t)mask, (uint8_t)(mask >> 8)};
+
+	CHECK(DAP_ExecuteCommand(request, dap_test_response) == ((3U << 16) | 2U));
+	return dap_test_response[1];
+}
+
+// GangStatus vendor command, the error per target in errors
+//   return: live targets
+static uint32_t gang_status(uint8_t *errors)
+{
+	static const uint8_t request[] = {ID_DAP_Vendor_GangStatus};
+
+	CHECK(DAP_ExecuteCommand(request, dap_test_response) == ((1U << 16) | (4U + DAP_GANG_CNT)));
+	CHECK(dap_test_response[1] == DAP_OK);
+	memcpy(errors, &dap_test_response[4], DAP_GANG_CNT);
+	return dap_test_response[2] | (dap_test_response[3] << 8);
+}
+
+// Chip erase session programming the image at the start of the flash
+//   return: status of FlashEnd
+static uint8_t program(void)
+{
+	uint8_t request[DAP_PACKET_SIZE] = {ID_DAP_Vendor_FlashStart, ALGO_SIM, 2U};
+	uint32_t sent;
+	uint32_t n;
+
+	dap_test_put32(&request[2 + 1], FLASH_BASE);
+	dap_test_put32(&request[6 + 1], IMAGE_SIZE);
+	dap_test_command(request);
+	for (sent = 0U; sent < IMAGE_SIZE; sent += n)
+	{
+		request[0] = ID_DAP_Vendor_FlashData;
+		n = ((IMAGE_SIZE - sent) < (DAP_PACKET_SIZE - 1U)) ? (IMAGE_SIZE - sent) : (DAP_PACKET_SIZE - 1U);
+		memcpy(&request[1], &image[sent], n);
+		dap_test_command(request);
+	}
+	request[0] = ID_DAP_Vendor_FlashEnd;
+	dap_test_command(request);
+	return dap_test_response[1];
+}
+
+// All targets in lockstep, one of them slowed down by WAIT responses
+static void test_lockstep(void)
+{
+	uint8_t errors[DAP_GANG_CNT];
+	uint32_t n;
+
+	setup();
+	targets[1].sim.ap_wait = 3U;
+	CHECK(gang_select(0x0FU) == DAP_OK);
+	CHECK(program() == DAP_OK);
+	CHECK(gang_status(errors) == 0x0FU);
+	for (n = 0U; n < DAP_GANG_CNT; n++)
+	{
+		CHECK(errors[n] == ERROR_SUCCESS);
+		CHECK(targets[n].programs == (IMAGE_SIZE / 256U));
+		CHECK(memcmp(targets[n].flash, image, IMAGE_SIZE) == 0);
+	}
+	CHECK(targets[1].sim.stats.wait != 0U);
+	CHECK(targets[0].sim.stats.wait == 0U);
+}
+
+// A bus fault and a failing ProgramPage drop single targets, the others are programmed
+static void test_drop_out(void)
+{
+	uint8_t errors[DAP_GANG_CNT];
+
+	setup();
+	targets[1].sim.ap_wait = 2U;
+	targets[2].sim.fault_after = 200U;
+	targets[3].fail_page = 5U;
+	CHECK(gang_select(0x0FU) == DAP_OK);
+	CHECK(program() == DAP_OK);
+	CHECK(gang_status(errors) == 0x03U);
+	CHECK(errors[0] == ERROR_SUCCESS);
+	CHECK(errors[1] == ERROR_SUCCESS);
+	CHECK(errors[2] == ERROR_ALGO_DATA_SEQ);
+	CHECK(errors[3] == ERROR_WRITE);
+	CHECK(memcmp(targets[0].flash, image, IMAGE_SIZE) == 0);
+	CHECK(memcmp(targets[1].flash, image, IMAGE_SIZE) == 0);
+	CHECK(memcmp(targets[2].flash, image, IMAGE_SIZE) != 0);
+	CHECK(targets[3].programs == 5U);
+	CHECK(targets[2].sim.stats.fault != 0U);
+
+	// Without a target left the session fails
+	setup();
+	targets[0].fail_page = 2U;
+	targets[2].fail_page = 3U;
+	CHECK(gang_select(0x05U) == DAP_OK);
+	CHECK(program() == DAP_ERROR);
+	CHECK(gang_status(errors) == 0U);
+	CHECK(errors[0] == ERROR_WRITE);
+	CHECK(errors[2] == ERROR_WRITE);
+	CHECK(targets[1].programs == 0U);
+}
+
+// Target masks: unselected targets report ERROR_FAILURE, 0 ends gang mode
+static void test_select(void)
+{
+	uint8_t errors[DAP_GANG_CNT];
+
+	setup();
+	CHECK(gang_select(1U << DAP_GANG_CNT) == DAP_ERROR);
+	CHECK(gang_select(0x06U) == DAP_OK);
+	CHECK(gang_status(errors) == 0x06U);
+	CHECK(errors[0] == ERROR_FAILURE);
+	CHECK(errors[1] == ERROR_SUCCESS);
+	CHECK(errors[2] == ERROR_SUCCESS);
+	CHECK(errors[3] == ERROR_FAILURE);
+	CHECK(program() == DAP_OK);
+	CHECK(targets[0].programs == 0U);
+	CHECK(memcmp(targets[2].flash, image, IMAGE_SIZE) == 0);
+
+	CHECK(gang_select(0U) == DAP_OK);
+	CHECK(gang_status(errors) == 0U);
+}
+
+int main(void)
+{
+	uint32_t i;
+
+	for (i = 0U; i < IMAGE_SIZE; i++)
+	{
+		image[i] = (uint8_t)((i * 13U) + 5U);
+	}
+
+	test_lockstep();
+	test_drop_out();
+	test_select();
+
+	return dap_test_result("test_gang");
+}
@@ -0,0 +1,61 @@
+/*---------------------------------------------------------------------------
+ * test_identify.c  Identify vendor command and the DAP settings
+ *
+ * The identification runs SWD_host, which sets up the DAP with its default
+ * settings. Idle cycles, the SWD data phase and the SWJ clock configured by
+ * the debugger must be in effect again for the next DAP_Transfer.
+ *---------------------------------------------------------------------------*/
+#include "dap_test.h"
+#include "DAP_target_sim.h"
+
+#define ID_DAP_Vendor_Identify ID_DAP_Vendor13
+
+#define RAM_BASE 0x20000000U
+
+static dap_target_sim_t target;
+static uint8_t ram[0x1000];
+
+// SWCLK cycles of a DP IDCODE read through DAP_Transfer
+static uint32_t idcode_cycles(void)
+{
+	static const uint8_t request[] = {ID_DAP_Transfer, 0, 1, 0x02};
+	uint32_t edges = dap_sim_pins.edges;
+
+	dap_test_command(request);
+	CHECK(dap_test_response[2] == DAP_TRANSFER_OK);
+	CHECK(dap_test_get32(&dap_test_response[3]) == target.idcode);
+	return dap_sim_pins.edges - edges;
+}
+
+int main(void)
+{
+	static const uint8_t clock[] = {ID_DAP_SWJ_Clock, 0xA0, 0x86, 0x01, 0x00};
+	static const uint8_t idle[] = {ID_DAP_TransferConfigure, 8, 0x40, 0x00, 0x00, 0x00};
+	static const uint8_t data_phase[] = {ID_DAP_SWD_Configure, 0x04};
+	static const uint8_t identify[] = {ID_DAP_Vendor_Identify};
+	uint32_t clock_freq;
+	uint32_t cycles;
+
+	DAP_Setup();
+	dap_target_sim_init(&target);
+	dap_target_sim_add_region(&target, RAM_BASE, sizeof(ram), ram, 1U);
+	dap_target_sim_attach(&target);
+	CHECK(dap_test_swd_connect() == target.idcode);
+
+	dap_test_command(clock);
+	dap_test_command(idle);
+	dap_test_command(data_phase);
+	clock_freq = DAP_Data.clock_freq;
+	cycles = idcode_cycles();
+
+	dap_test_command(identify);
+	CHECK(dap_test_response[0] == ID_DAP_Vendor_Identify);
+
+	CHECK(DAP_Data.clock_freq == clock_freq);
+	CHECK(DAP_Data.fast_clock == 0U);
+	CHECK(DAP_Data.transfer.idle_cycles == 8U);
+	CHECK(DAP_Data.swd_conf.data_phase == 1U);
+	CHECK(idcode_cycles() == cycles);
+
+	return dap_test_result("test_identify");
+}
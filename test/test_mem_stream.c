@@ -0,0 +1,267 @@
+/*---------------------------------------------------------------------------
+ * test_mem_stream.c  MemRead/MemWrite vendor streams
+ *
+ * Unaligned reads and writes across the TAR wrap, a failing access, and the
+ * cost of a 64 KB read: request and response packets and SWCLK cycles of the
+ * MemRead stream against DAP_Transfer/DAP_TransferBlock. The KB/s figures are
+ * modelled from these counts (see report), not measured on a probe.
+ *---------------------------------------------------------------------------*/
+#include "dap_test.h"
+#include "DAP_target_sim.h"
+
+#define ID_DAP_Vendor_MemRead ID_DAP_Vendor5
+#define ID_DAP_Vendor_MemWrite ID_DAP_Vendor6
+#define ID_DAP_Vendor_MemWriteData ID_DAP_Vendor7
+
+#define RAM_BASE 0x20000000U
+#define DUMP_SIZE 0x10000U
+
+// Model of the report: SWCLK and the USB full speed HID interval (one 64 byte
+// report per direction and millisecond)
+#define MODEL_SWCLK_HZ 4000000.0
+#define MODEL_HID_REPORT_S 0.001
+
+static dap_target_sim_t target;
+static uint8_t ram[0x20000];
+static uint8_t expect[0x20000];
+static uint8_t buf[DUMP_SIZE + 4U];
+
+// Packets exchanged since the last reset of the counters
+static uint32_t requests;
+static uint32_t responses;
+
+static uint32_t command(const uint8_t *request)
+{
+	requests++;
+	responses++;
+	return dap_test_command(request);
+}
+
+// MemRead of size bytes at addr into data, all packets of the stream
+//   return: status of the last packet
+static uint8_t mem_read(uint32_t addr, uint32_t size, uint8_t *data)
+{
+	uint8_t request[9] = {ID_DAP_Vendor_MemRead};
+	uint32_t count = 0U;
+	uint32_t num;
+
+	dap_test_put32(&request[1], addr);
+	dap_test_put32(&request[5], size);
+	num = command(request);
+	while (1)
+	{
+		CHECK(dap_test_response[0] == ID_DAP_Vendor_MemRead);
+		CHECK((num >= 2U) && (num <= DAP_PACKET_SIZE));
+		if (dap_test_response[1] != DAP_OK)
+		{
+			break;
+		}
+		CHECK(count + (num - 2U) <= size);
+		memcpy(&data[count], &dap_test_response[2], num - 2U);
+		count += num - 2U;
+		if (!DAP_VendorStreamPending())
+		{
+			break;
+		}
+		responses++;
+		num = DAP_ProcessVendorStream(dap_test_response);
+	}
+	CHECK(!DAP_VendorStreamPending());
+	if (dap_test_response[1] == DAP_OK)
+	{
+		CHECK(count == size);
+	}
+	return dap_test_response[1];
+}
+
+// MemWrite of size bytes at addr, then MemWriteData packets
+//   return: status of the last packet
+static uint8_t mem_write(uint32_t addr, uint32_t size, const uint8_t *data)
+{
+	uint8_t request[DAP_PACKET_SIZE] = {ID_DAP_Vendor_MemWrite};
+	uint32_t sent;
+	uint32_t n;
+
+	dap_test_put32(&request[1], addr);
+	dap_test_put32(&request[5], size);
+	n = (size < (DAP_PACKET_SIZE - 9U)) ? size : (DAP_PACKET_SIZE - 9U);
+	memcpy(&request[9], data, n);
+	command(request);
+	for (sent = n; sent < size; sent += n)
+	{
+		request[0] = ID_DAP_Vendor_MemWriteData;
+		n = ((size - sent) < (DAP_PACKET_SIZE - 1U)) ? (size - sent) : (DAP_PACKET_SIZE - 1U);
+		memcpy(&request[1], &data[sent], n);
+		command(request);
+	}
+	return dap_test_response[1];
+}
+
+// The same dump through DAP_Transfer (TAR) and DAP_TransferBlock (DRW), each block
+// ending at the 1 KB TAR wrap as a debugger without the wrap continuation does it
+static void block_read(uint32_t addr, uint32_t size, uint8_t *data)
+{
+	uint8_t tar[] = {ID_DAP_Transfer, 0, 1, 0x05, 0, 0, 0, 0};
+	uint8_t block[] = {ID_DAP_TransferBlock, 0, 0, 0, 0x0F};
+	uint32_t count = 0U;
+	uint32_t words;
+	uint32_t wrap;
+
+	while (count < size)
+	{
+		words = (size - count) / 4U;
+		wrap = (1024U - ((addr + count) & 1023U)) / 4U;
+		words = (words < wrap) ? words : wrap;
+		words = (words < ((DAP_PACKET_SIZE - 4U) / 4U)) ? words : ((DAP_PACKET_SIZE - 4U) / 4U);
+
+		dap_test_put32(&tar[4], addr + count);
+		command(tar);
+		CHECK(dap_test_response[2] == DAP_TRANSFER_OK);
+		block[2] = (uint8_t)words;
+		command(block);
+		CHECK(dap_test_response[3] == DAP_TRANSFER_OK);
+		memcpy(&data[count], &dap_test_response[4], words * 4U);
+		count += words * 4U;
+	}
+}
+
+static void test_unaligned(void)
+{
+	static const uint32_t cases[][2] = {
+		{0x20000001U, 1U},
+		{0x20000003U, 6U},
+		{0x200003FEU, 9U},
+		{0x20000401U, 1500U},
+		{0x200007FFU, 2U},
+		{0x20001000U, 0U},
+		{0x20000002U, 4097U},
+	};
+	uint32_t k, i;
+
+	for (k = 0U; k < (sizeof(cases) / sizeof(cases[0])); k++)
+	{
+		uint32_t addr = cases[k][0];
+		uint32_t size = cases[k][1];
+
+		memset(buf, 0xEE, size + 4U);
+		CHECK(mem_read(addr, size, buf) == DAP_OK);
+		CHECK(memcmp(buf, &ram[addr - RAM_BASE], size) == 0);
+
+		for (i = 0U; i < size; i++)
+		{
+			buf[i] = (uint8_t)((i * 13U) + k);
+		}
+		memcpy(expect, ram, sizeof(ram));
+		memcpy(&expect[addr - RAM_BASE], buf, size);
+		CHECK(mem_write(addr, size, buf) == DAP_OK);
+		CHECK(memcmp(expect, ram, sizeof(ram)) == 0);
+	}
+}
+
+// A failed access ends the stream with a DAP_ERROR packet
+static void test_fault(void)
+{
+	static const uint8_t abort[] = {ID_DAP_WriteABORT, 0, 0x1E, 0, 0, 0};
+
+	CHECK(mem_read(0x30000000U, 100U, buf) == DAP_ERROR);
+	CHECK(mem_write(0x30000000U, 100U, buf) == DAP_ERROR);
+	command(abort);
+	CHECK(mem_read(RAM_BASE, 100U, buf) == DAP_OK);
+}
+
+// MemWriteData is refused unless MemWrite opened a stream: the buffer state a
+// read stream leaves behind must not take write data
+static void test_no_write_stream(void)
+{
+	uint8_t request[DAP_PACKET_SIZE] = {ID_DAP_Vendor_MemWriteData};
+
+	memset(&request[1], 0xA5, DAP_PACKET_SIZE - 1U);
+	memcpy(expect, ram, sizeof(ram));
+
+	CHECK(mem_read(RAM_BASE, 1024U, buf) == DAP_OK);
+	CHECK(command(request) == 2U);
+	CHECK(dap_test_response[1] == DAP_ERROR);
+
+	CHECK(mem_read(RAM_BASE + 0x3F0U, 0x20U, buf) == DAP_OK);
+	CHECK(command(request) == 2U);
+	CHECK(dap_test_response[1] == DAP_ERROR);
+	CHECK(memcmp(expect, ram, sizeof(ram)) == 0);
+
+	// A stream written to its end takes no further data
+	CHECK(mem_write(RAM_BASE + 0x100U, 70U, &expect[0x100]) == DAP_OK);
+	CHECK(command(request) == 2U);
+	CHECK(memcmp(expect, ram, sizeof(ram)) == 0);
+}
+
+// Modelled transfer rate: SWD time at MODEL_SWCLK_HZ and USB time of one HID
+// interval per response report (a request goes out in the same interval at
+// best). The stream keeps DAP_PACKET_COUNT responses queued, so the probe reads
+// the target while the reports go out and the slower of the two counts. A
+// command waits for the response of the previous one, both add up.
+static double report(const char *name, uint32_t cycles, uint32_t stream)
+{
+	double swd = cycles / MODEL_SWCLK_HZ;
+	double usb = responses * MODEL_HID_REPORT_S;
+	double time = stream ? ((swd > usb) ? swd : usb) : (swd + usb);
+	double rate = (DUMP_SIZE / 1024.0) / time;
+
+	printf("%-13s 64 KB: %5u requests %5u responses %7u SWCLK cycles, "
+		   "%6.1f KB/s SWD only, %5.1f KB/s over HID (model)\n",
+		   name, requests, responses, cycles, (DUMP_SIZE / 1024.0) / swd, rate);
+	return rate;
+}
+
+static void test_throughput(void)
+{
+	uint32_t edges;
+	double stream;
+	double block;
+
+	requests = 0U;
+	responses = 0U;
+	edges = dap_sim_pins.edges;
+	CHECK(mem_read(RAM_BASE, DUMP_SIZE, buf) == DAP_OK);
+	CHECK(memcmp(buf, ram, DUMP_SIZE) == 0);
+	CHECK(requests == 1U);
+	CHECK(responses == (DUMP_SIZE + (DAP_PACKET_SIZE - 3U)) / (DAP_PACKET_SIZE - 2U));
+	stream = report("MemRead", dap_sim_pins.edges - edges, 1U);
+
+	requests = 0U;
+	responses = 0U;
+	edges = dap_sim_pins.edges;
+	block_read(RAM_BASE, DUMP_SIZE, buf);
+	CHECK(memcmp(buf, ram, DUMP_SIZE) == 0);
+	block = report("TransferBlock", dap_sim_pins.edges - edges, 0U);
+
+	CHECK(stream > block);
+}
+
+int main(void)
+{
+	static const uint8_t power_up[] = {ID_DAP_Transfer, 0, 4,
+									   0x04, 0x00, 0x00, 0x00, 0x50,
+									   0x08, 0x00, 0x00, 0x00, 0x00,
+									   0x01, 0x12, 0x00, 0x00, 0x23,
+									   0x06};
+	uint32_t i;
+
+	DAP_Setup();
+	dap_target_sim_init(&target);
+	dap_target_sim_add_region(&target, RAM_BASE, sizeof(ram), ram, 1U);
+	dap_target_sim_attach(&target);
+	for (i = 0U; i < sizeof(ram); i++)
+	{
+		ram[i] = (uint8_t)((i * 7U) ^ (i >> 8));
+	}
+
+	CHECK(dap_test_swd_connect() == target.idcode);
+	dap_test_command(power_up);
+	CHECK(dap_test_response[2] == DAP_TRANSFER_OK);
+
+	test_unaligned();
+	test_fault();
+	test_no_write_stream();
+	test_throughput();
+
+	return dap_test_result("test_mem_stream");
+}
@@ -0,0 +1,181 @@
+/*---------------------------------------------------------------------------
+ * test_multidrop.c  SWD multi-drop (DPv2 TARGETSEL)
+ *
+ * Two dormant DPv2 targets share the SWDIO line. SWD_host selects them in
+ * turn through swd_select_target: the first selection wakes a target up, a
+ * target seen before only takes a line reset and TARGETSEL and keeps the DP
+ * state (SELECT, CSW) cached in its DAP_MULTIDROP_CNT slot. A TARGETSEL no
+ * target answers and a power cycled target are recovered from.
+ *---------------------------------------------------------------------------*/
+#include "dap_test.h"
+#include "DAP_target_sim.h"
+#include "SWD_host.h"
+
+#define RAM_BASE 0x20000000U
+
+#define TARGETSEL_0 0x01002927U
+#define TARGETSEL_1 0x11002927U
+#define TARGETSEL_NONE 0x21002927U // TINSTANCE 2 and up: no target
+
+static dap_target_sim_t targets[2];
+static uint8_t ram[2][0x1000];
+
+static void setup(void)
+{
+	static const uint8_t connect[] = {ID_DAP_Connect, DAP_PORT_SWD};
+	static dap_target_sim_t *bus[2] = {&targets[0], &targets[1]};
+	uint32_t n;
+
+	DAP_Setup();
+	for (n = 0U; n < 2U; n++)
+	{
+		dap_target_sim_init(&targets[n]);
+		targets[n].idcode = 0x0BC12477U;
+		targets[n].dormant = 1U;
+		dap_target_sim_add_region(&targets[n], RAM_BASE, sizeof(ram[n]), ram[n], 1U);
+		memset(ram[n], 0, sizeof(ram[n]));
+	}
+	targets[0].targetsel = TARGETSEL_0;
+	targets[1].targetsel = TARGETSEL_1;
+	dap_target_sim_attach_bus(bus, 2U);
+	dap_test_command(connect);
+
+	// SWD_host keeps its slots from the previous test, the targets are new: start single-drop
+	swd_select_target(0U);
+}
+
+// Word access through the selected target
+static void write_word(uint32_t offset, uint32_t val)
+{
+	uint8_t data[4];
+
+	dap_test_put32(data, val);
+	CHECK(swd_write_memory(RAM_BASE + offset, data, 4U));
+}
+
+static uint32_t read_word(uint32_t offset)
+{
+	uint8_t data[4] = {0};
+
+	CHECK(swd_read_memory(RAM_BASE + offset, data, 4U));
+	return dap_test_get32(data);
+}
+
+// TARGETSEL switches the target the transfers go to
+static void test_switch(void)
+{
+	setup();
+	CHECK(swd_select_target(TARGETSEL_0));
+	CHECK(!targets[0].dormant && targets[0].selected);
+	CHECK(!targets[1].selected);
+	write_word(0x10U, 0xA5A5A5A5U);
+
+	CHECK(swd_select_target(TARGETSEL_1));
+	CHECK(targets[1].selected && !targets[0].selected);
+	write_word(0x10U, 0x5A5A5A5AU);
+
+	CHECK(dap_test_get32(&ram[0][0x10]) == 0xA5A5A5A5U);
+	CHECK(dap_test_get32(&ram[1][0x10]) == 0x5A5A5A5AU);
+
+	CHECK(swd_select_target(TARGETSEL_0));
+	CHECK(read_word(0x10U) == 0xA5A5A5A5U);
+	CHECK(swd_select_target(TARGETSEL_1));
+	CHECK(read_word(0x10U) == 0x5A5A5A5AU);
+}
+
+// A target seen before keeps its DP state: no power-up, SELECT and CSW are not written again
+static void test_cached_state(void)
+{
+	uint32_t bring_up;
+	uint32_t edges;
+	uint32_t ap_wr;
+	uint32_t ok;
+
+	setup();
+	edges = dap_sim_pins.edges;
+	CHECK(swd_select_target(TARGETSEL_0));
+	bring_up = dap_sim_pins.edges - edges;
+	write_word(0x20U, 1U);
+	CHECK(swd_select_target(TARGETSEL_1));
+	write_word(0x20U, 2U);
+
+	edges = dap_sim_pins.edges;
+	ok = targets[0].stats.ok;
+	CHECK(swd_select_target(TARGETSEL_0));
+	CHECK((dap_sim_pins.edges - edges) * 2U < bring_up);
+	CHECK(targets[0].stats.ok - ok == 2U); // IDCODE and CTRL/STAT
+
+	// TAR only, CSW is still the cached one
+	ap_wr = targets[0].stats.ap_wr;
+	CHECK(read_word(0x20U) == 1U);
+	CHECK(targets[0].stats.ap_wr - ap_wr == 1U);
+
+	// Selecting the target already selected does nothing
+	edges = dap_sim_pins.edges;
+	CHECK(swd_select_target(TARGETSEL_0));
+	CHECK(dap_sim_pins.edges == edges);
+}
+
+// Nobody answers a TARGETSEL: the selection fails and the others stay usable
+static void test_no_response(void)
+{
+	uint32_t ok;
+	uint32_t n;
+
+	setup();
+	CHECK(swd_select_target(TARGETSEL_0));
+	write_word(0x30U, 0x1234U);
+
+	CHECK(!swd_select_target(TARGETSEL_NONE));
+	CHECK(!targets[0].selected && !targets[1].selected);
+
+	CHECK(swd_select_target(TARGETSEL_1));
+	write_word(0x30U, 0x5678U);
+	CHECK(swd_select_target(TARGETSEL_0));
+	CHECK(read_word(0x30U) == 0x1234U);
+
+	// Failed selections take no cache slot, both targets stay cached
+	for (n = 0U; n < (2U * DAP_MULTIDROP_CNT); n++)
+	{
+		CHECK(!swd_select_target(TARGETSEL_NONE + (n << 28)));
+	}
+	ok = targets[1].stats.ok;
+	CHECK(swd_select_target(TARGETSEL_1));
+	CHECK(targets[1].stats.ok - ok == 2U);
+	CHECK(read_word(0x30U) == 0x5678U);
+	ok = targets[0].stats.ok;
+	CHECK(swd_select_target(TARGETSEL_0));
+	CHECK(targets[0].stats.ok - ok == 2U);
+}
+
+// A cached target that was power cycled is brought up again: dormant, or woken up by the
+// selection alert for another target with its debug power off
+static void test_power_cycle(void)
+{
+	setup();
+	CHECK(swd_select_target(TARGETSEL_0));
+	write_word(0x40U, 0xCAFEU);
+	CHECK(swd_select_target(TARGETSEL_1));
+
+	targets[0].dormant = 1U;
+	targets[0].selected = 0U;
+	targets[0].ctrl_stat = 0U;
+	CHECK(swd_select_target(TARGETSEL_0));
+	CHECK(!targets[0].dormant && targets[0].selected);
+	CHECK(read_word(0x40U) == 0xCAFEU);
+
+	CHECK(swd_select_target(TARGETSEL_1));
+	targets[0].ctrl_stat = 0U;
+	CHECK(swd_select_target(TARGETSEL_0));
+	CHECK(read_word(0x40U) == 0xCAFEU);
+}
+
+int main(void)
+{
+	test_switch();
+	test_cached_state();
+	test_no_response();
+	test_power_cycle();
+
+	return dap_test_result("test_multidrop");
+}
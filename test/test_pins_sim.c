@@ -0,0 +1,132 @@
+/*---------------------------------------------------------------------------
+ * test_pins_sim.c  Simulated pin driver
+ *
+ * The DAP engine drives the in-memory pins, every rising SWCLK edge reaches
+ * the attached model and lands in the edge trace, nRESET changes reach the
+ * model as well.
+ *---------------------------------------------------------------------------*/
+#include "dap_test.h"
+
+// Model that drives the parity of the edges it has seen and records nRESET
+typedef struct
+{
+	uint32_t edges;
+	uint32_t swdio; // SWDIO samples while the probe drives, oldest in bit 0
+	uint32_t nreset;
+} edge_model_t;
+
+static uint32_t edge_model_clock(void *ctx, uint32_t swdio, uint32_t swdio_oe, uint32_t tdi)
+{
+	edge_model_t *m = ctx;
+
+	(void)tdi;
+	if (swdio_oe && (m->edges < 32U))
+	{
+		m->swdio |= (swdio & 1U) << m->edges;
+	}
+	m->edges++;
+	return m->edges & 1U;
+}
+
+static void edge_model_reset(void *ctx, uint32_t nreset)
+{
+	((edge_model_t *)ctx)->nreset = nreset;
+}
+
+static void test_info(void)
+{
+	static const uint8_t packet_size[] = {ID_DAP_Info, DAP_ID_PACKET_SIZE};
+
+	CHECK(dap_test_command(packet_size) == 4U);
+	CHECK(dap_test_response[1] == 2U);
+	CHECK((dap_test_response[2] | (dap_test_response[3] << 8)) == DAP_PACKET_SIZE);
+}
+
+static void test_leds(void)
+{
+	static const uint8_t on[] = {ID_DAP_HostStatus, DAP_DEBUGGER_CONNECTED, 1};
+	static const uint8_t off[] = {ID_DAP_HostStatus, DAP_DEBUGGER_CONNECTED, 0};
+
+	dap_test_command(on);
+	CHECK(dap_sim_pins.led_connected == 1U);
+	dap_test_command(off);
+	CHECK(dap_sim_pins.led_connected == 0U);
+}
+
+// SWJ_Sequence bits reach the model LSB first, one per edge, and the trace
+// records the probe and target levels of every edge
+static void test_edges(void)
+{
+	static const uint8_t connect[] = {ID_DAP_Connect, DAP_PORT_SWD};
+	static const uint8_t sequence[] = {ID_DAP_SWJ_Sequence, 16, 0xA5, 0x3C};
+	edge_model_t model = {0};
+	dap_sim_model_t sim = {&model, edge_model_clock, edge_model_reset};
+	uint8_t trace[32];
+	uint32_t edges;
+	uint32_t n;
+
+	dap_test_command(connect);
+	CHECK(dap_test_response[1] == DAP_PORT_SWD);
+	dap_sim_attach(&sim);
+	dap_sim_trace(trace, sizeof(trace));
+	edges = dap_sim_pins.edges;
+
+	dap_test_command(sequence);
+	CHECK(dap_test_response[1] == DAP_OK);
+	CHECK(dap_sim_pins.edges - edges == 16U);
+	CHECK(model.edges == 16U);
+	CHECK(model.swdio == 0x3CA5U);
+	CHECK(dap_sim_pins.trace_count == 16U);
+	for (n = 0U; n < 16U; n++)
+	{
+		CHECK(((trace[n] & DAP_SIM_TRACE_SWDIO) != 0U) == ((0x3CA5U >> n) & 1U));
+		CHECK((trace[n] & DAP_SIM_TRACE_SWDIO_OE) != 0U);
+		CHECK(((trace[n] & DAP_SIM_TRACE_TARGET) != 0U) == ((n + 1U) & 1U));
+	}
+	dap_sim_trace(NULL, 0U);
+	dap_sim_attach(NULL);
+}
+
+// Without a model the target leaves SWDIO high, the transfer sees no acknowledge
+static void test_no_target(void)
+{
+	static const uint8_t idcode[] = {ID_DAP_Transfer, 0, 1, 0x02};
+
+	dap_sim_attach(NULL);
+	dap_test_command(idcode);
+	CHECK(dap_test_response[1] == 0U);
+	CHECK(dap_test_response[2] == 0x07U);
+}
+
+static void test_reset(void)
+{
+	static const uint8_t low[] = {ID_DAP_SWJ_Pins, 0x00, 1U << DAP_SWJ_nRESET, 0, 0, 0, 0};
+	static const uint8_t high[] = {ID_DAP_SWJ_Pins, 1U << DAP_SWJ_nRESET, 1U << DAP_SWJ_nRESET, 0, 0, 0, 0};
+	edge_model_t model = {0};
+	dap_sim_model_t sim = {&model, edge_model_clock, edge_model_reset};
+
+	model.nreset = 1U;
+	dap_sim_attach(&sim);
+	dap_test_command(low);
+	CHECK(dap_sim_pins.nreset == 0U);
+	CHECK(model.nreset == 0U);
+	CHECK((dap_test_response[1] & (1U << DAP_SWJ_nRESET)) == 0U);
+	dap_test_command(high);
+	CHECK(dap_sim_pins.nreset == 1U);
+	CHECK(model.nreset == 1U);
+	CHECK((dap_test_response[1] & (1U << DAP_SWJ_nRESET)) != 0U);
+	dap_sim_attach(NULL);
+}
+
+int main(void)
+{
+	DAP_Setup();
+
+	test_info();
+	test_leds();
+	test_edges();
+	test_no_target();
+	test_reset();
+
+	return dap_test_result("test_pins_sim");
+}
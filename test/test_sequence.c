@@ -0,0 +1,138 @@
+/*---------------------------------------------------------------------------
+ * test_sequence.c  SWJ_Sequence and JTAG_Sequence kernels
+ *
+ * Every length from 1 to 64 bits through the fast and the slow kernels: the
+ * bits reach the pins LSB first one per edge, TMS is held, TDO is captured
+ * before each rising edge and packed LSB first, scans without capture
+ * return no data. The sequence benchmark (ID_DAP_Vendor4) is run and its
+ * rates are printed.
+ *---------------------------------------------------------------------------*/
+#include "dap_test.h"
+
+// Target that drives a pseudo random TDO/SWDIO level on every edge
+static uint32_t lfsr_state = 0xACE1U;
+
+static uint32_t lfsr_clock(void *ctx, uint32_t swdio, uint32_t swdio_oe, uint32_t tdi)
+{
+	(void)ctx;
+	(void)swdio;
+	(void)swdio_oe;
+	(void)tdi;
+	lfsr_state = (lfsr_state >> 1) ^ ((lfsr_state & 1U) ? 0xB400U : 0U);
+	return lfsr_state & 1U;
+}
+
+static const dap_sim_model_t lfsr_model = {NULL, lfsr_clock, NULL};
+
+static uint8_t trace[128];
+static uint8_t data[8] = {0x5A, 0xC3, 0x96, 0x0F, 0xE1, 0x3C, 0xA5, 0x69};
+
+static uint32_t bit(const uint8_t *buf, uint32_t n)
+{
+	return (buf[n / 8U] >> (n % 8U)) & 1U;
+}
+
+static void test_swj(uint32_t count)
+{
+	uint8_t request[2 + sizeof(data)];
+	uint32_t n;
+
+	request[0] = ID_DAP_SWJ_Sequence;
+	request[1] = (uint8_t)count;
+	memcpy(&request[2], data, sizeof(data));
+
+	dap_sim_trace(trace, sizeof(trace));
+	dap_test_command(request);
+	CHECK(dap_test_response[1] == DAP_OK);
+	CHECK(dap_sim_pins.trace_count == count);
+	for (n = 0U; n < count; n++)
+	{
+		CHECK(((trace[n] & DAP_SIM_TRACE_SWDIO) != 0U) == bit(data, n));
+	}
+	dap_sim_trace(NULL, 0U);
+}
+
+static void test_jtag(uint32_t count, uint32_t tms, uint32_t capture)
+{
+	uint8_t request[3 + sizeof(data)];
+	uint32_t before;
+	uint32_t expect;
+	uint32_t num;
+	uint32_t n;
+
+	request[0] = ID_DAP_JTAG_Sequence;
+	request[1] = 1U;
+	request[2] = (uint8_t)((count & JTAG_SEQUENCE_TCK) | (tms ? JTAG_SEQUENCE_TMS : 0U) | (capture ? JTAG_SEQUENCE_TDO : 0U));
+	memcpy(&request[3], data, sizeof(data));
+
+	before = dap_sim_pins.target;
+	dap_sim_trace(trace, sizeof(trace));
+	num = dap_test_command(request);
+	CHECK(dap_test_response[0] == ID_DAP_JTAG_Sequence);
+	CHECK(dap_test_response[1] == DAP_OK);
+	CHECK(num == (capture ? (2U + (count + 7U) / 8U) : 2U));
+	CHECK(dap_sim_pins.trace_count == count);
+	for (n = 0U; n < count; n++)
+	{
+		CHECK(((trace[n] & DAP_SIM_TRACE_TDI) != 0U) == bit(data, n));
+		CHECK(((trace[n] & DAP_SIM_TRACE_SWDIO) != 0U) == (tms != 0U));
+		if (capture)
+		{
+			// TDO is sampled before the rising edge, the level the target drove after the previous one
+			expect = (n == 0U) ? before : ((trace[n - 1U] & DAP_SIM_TRACE_TARGET) != 0U);
+			CHECK(bit(&dap_test_response[2], n) == expect);
+		}
+	}
+	if (capture && (count % 8U))
+	{
+		CHECK((dap_test_response[2 + count / 8U] >> (count % 8U)) == 0U);
+	}
+	dap_sim_trace(NULL, 0U);
+}
+
+static void test_kernels(const uint8_t *clock, uint32_t fast)
+{
+	uint32_t count;
+
+	dap_test_command(clock);
+	CHECK(DAP_Data.fast_clock == fast);
+	for (count = 1U; count <= 64U; count++)
+	{
+		test_swj(count);
+		test_jtag(count, count & 1U, 1U);
+		test_jtag(count, (count >> 1) & 1U, 0U);
+	}
+}
+
+static void test_benchmark(void)
+{
+	static const uint8_t request[] = {ID_DAP_Vendor4, 0x00, 0x04}; // 1024 runs
+	uint32_t edges;
+
+	edges = dap_sim_pins.edges;
+	CHECK(dap_test_command(request) == 17U);
+	CHECK(dap_sim_pins.edges - edges == 1024U * (64U + 256U));
+	CHECK(dap_test_get32(&dap_test_response[1]) != 0U);
+	CHECK(dap_test_get32(&dap_test_response[9]) != 0U);
+	printf("64-bit SWJ sequences: %u/s, 256-bit DR scans: %u/s (host simulation)\n",
+		   (unsigned)dap_test_get32(&dap_test_response[5]), (unsigned)dap_test_get32(&dap_test_response[13]));
+}
+
+int main(void)
+{
+	static const uint8_t connect[] = {ID_DAP_Connect, DAP_PORT_JTAG};
+	static const uint8_t fast[] = {ID_DAP_SWJ_Clock, 0x00, 0xE1, 0xF5, 0x05}; // 100 MHz, above the fastest clock
+	static const uint8_t slow[] = {ID_DAP_SWJ_Clock, 0xA0, 0x86, 0x01, 0x00}; // 100 kHz
+
+	DAP_Setup();
+	dap_sim_attach(&lfsr_model);
+	dap_test_command(connect);
+	CHECK(dap_test_response[1] == DAP_PORT_JTAG);
+
+	test_kernels(fast, 1U);
+	test_kernels(slow, 0U);
+	test_kernels(fast, 1U);
+	test_benchmark();
+
+	return dap_test_result("test_sequence");
+}
@@ -0,0 +1,132 @@
+/*---------------------------------------------------------------------------
+ * test_spi.c  SPI shift engine against the bit-bang path (DAP_SPI=1)
+ *
+ * The same command stream runs once with the SPI engine and once bit-banged.
+ * Both have to produce the same per-edge trace and the same responses: line
+ * reset and JTAG-to-SWD switch, DP/AP accesses with WAIT retries, a block
+ * read, a data phase configuration and a JTAG sequence with TDO capture.
+ *---------------------------------------------------------------------------*/
+#include "dap_test.h"
+#include "DAP_target_sim.h"
+
+#define TRACE_SIZE 8192U
+#define OUT_SIZE 1024U
+
+typedef struct
+{
+	uint8_t trace[TRACE_SIZE];
+	uint32_t edges;
+	uint8_t out[OUT_SIZE];
+	uint32_t out_count;
+	uint32_t spi_bits;
+} run_t;
+
+static dap_target_sim_t target;
+static uint8_t ram[0x1000];
+static run_t runs[2];
+
+static const uint8_t clock_4mhz[] = {ID_DAP_SWJ_Clock, 0x00, 0x09, 0x3D, 0x00};
+
+static const uint8_t connect[] = {ID_DAP_Connect, DAP_PORT_SWD};
+static const uint8_t line_reset[] = {ID_DAP_SWJ_Sequence, 51, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+static const uint8_t jtag_to_swd[] = {ID_DAP_SWJ_Sequence, 16, 0x9E, 0xE7};
+static const uint8_t idle[] = {ID_DAP_SWJ_Sequence, 3, 0x00};
+static const uint8_t idcode[] = {ID_DAP_Transfer, 0, 1, 0x02};
+static const uint8_t power_up[] = {ID_DAP_Transfer, 0, 3,
+								   0x04, 0x00, 0x00, 0x00, 0x50,
+								   0x08, 0x00, 0x00, 0x00, 0x00,
+								   0x01, 0x12, 0x00, 0x00, 0xA2};
+static const uint8_t write[] = {ID_DAP_Transfer, 0, 4,
+								0x05, 0x00, 0x00, 0x00, 0x20,
+								0x0D, 0x44, 0x33, 0x22, 0x11,
+								0x0D, 0x88, 0x77, 0x66, 0x55,
+								0x05, 0x00, 0x00, 0x00, 0x20};
+static const uint8_t read[] = {ID_DAP_Transfer, 0, 3, 0x0F, 0x0F, 0x0E};
+static const uint8_t block[] = {ID_DAP_TransferBlock, 0, 2, 0, 0x0F};
+static const uint8_t data_phase[] = {ID_DAP_SWD_Configure, 0x05};
+static const uint8_t read_rdbuff[] = {ID_DAP_Transfer, 0, 2, 0x0F, 0x0E};
+static const uint8_t no_data_phase[] = {ID_DAP_SWD_Configure, 0x00};
+static const uint8_t jtag[] = {ID_DAP_JTAG_Sequence, 3,
+							   0x4C, 0x5A, 0xA5, 0x3C, 0x96, 0x69, 0x0F, 0xF0,
+							   0x85, 0x11, 0x22,
+							   0x0A, 0x33, 0x44};
+
+static const uint8_t *const stream[] = {
+	connect, line_reset, jtag_to_swd, line_reset, idle, idcode, power_up, write,
+	read, block, data_phase, read_rdbuff, no_data_phase, jtag};
+
+static void run(run_t *r, uint32_t spi)
+{
+	uint32_t spi_bits;
+	uint32_t num;
+	uint32_t n;
+
+	memset(ram, 0, sizeof(ram));
+	dap_target_sim_init(&target);
+	dap_target_sim_add_region(&target, 0x20000000U, sizeof(ram), ram, 1U);
+	target.ap_wait = 2U;
+	dap_target_sim_attach(&target);
+
+	dap_test_command(clock_4mhz);
+	CHECK(DAP_Data.spi_clock == 1U);
+	DAP_Data.spi_clock = (uint8_t)spi;
+	SWD_TransferSelect();
+	dap_sim_pins.tdi = 1U;
+	dap_sim_pins.swdio = 1U;
+
+	dap_sim_trace(r->trace, TRACE_SIZE);
+	spi_bits = dap_sim_pins.spi_bits;
+	for (n = 0U; n < sizeof(stream) / sizeof(stream[0]); n++)
+	{
+		num = dap_test_command(stream[n]);
+		if ((r->out_count + num) <= OUT_SIZE)
+		{
+			memcpy(&r->out[r->out_count], dap_test_response, num);
+		}
+		r->out_count += num;
+	}
+	r->edges = dap_sim_pins.trace_count;
+	r->spi_bits = dap_sim_pins.spi_bits - spi_bits;
+	dap_sim_trace(NULL, 0U);
+
+	CHECK(target.stats.wait != 0U);
+	CHECK(dap_test_get32(&ram[0]) == 0x11223344U);
+}
+
+static void test_compare(void)
+{
+	run(&runs[0], 1U);
+	run(&runs[1], 0U);
+
+	CHECK(runs[0].spi_bits != 0U);
+	CHECK(runs[1].spi_bits == 0U);
+	CHECK(runs[0].edges < TRACE_SIZE);
+	CHECK(runs[0].edges == runs[1].edges);
+	CHECK(memcmp(runs[0].trace, runs[1].trace, runs[0].edges) == 0);
+	CHECK(runs[0].out_count <= OUT_SIZE);
+	CHECK(runs[0].out_count == runs[1].out_count);
+	CHECK(memcmp(runs[0].out, runs[1].out, runs[0].out_count) == 0);
+}
+
+// The SPI takes the clocks it can divide down to, below that it is bit-bang only
+static void test_clock(void)
+{
+	static const uint8_t slow[] = {ID_DAP_SWJ_Clock, 100, 0, 0, 0};
+
+	dap_test_command(clock_4mhz);
+	CHECK(DAP_Data.spi_clock == 1U);
+	CHECK(DAP_Data.clock_freq == 4000000U);
+	dap_test_command(slow);
+	CHECK(DAP_Data.spi_clock == 0U);
+	CHECK(DAP_Data.clock_freq != 0U);
+}
+
+int main(void)
+{
+	DAP_Setup();
+
+	test_compare();
+	test_clock();
+
+	return dap_test_result("test_spi");
+}
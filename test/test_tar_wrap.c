@@ -0,0 +1,264 @@
+/*---------------------------------------------------------------------------
+ * test_tar_wrap.c  MEM-AP TAR auto-increment wrap
+ *
+ * SWD_host memory access and DAP_TransferBlock on targets wrapping TAR at
+ * 1, 2 and 4 KB: unaligned reads and writes across the boundaries, raw DRW
+ * blocks continuing linearly over several commands once the AP was
+ * identified as a MEM-AP, the hardware behaviour otherwise, the TarWrap
+ * vendor command and the detection without a ROM table.
+ *---------------------------------------------------------------------------*/
+#include "dap_test.h"
+#include "DAP_target_sim.h"
+#include "SWD_host.h"
+
+#define RAM_BASE 0x20000000U
+#define ROM_BASE 0xE00FF000U
+
+#define ID_DAP_Vendor_TarWrap ID_DAP_Vendor15
+
+static dap_target_sim_t target;
+static uint8_t ram[0x10000];
+static uint8_t rom[0x1000];
+static uint8_t buf[0x4000];
+
+// Fresh target wrapping TAR at wrap with the AP BASE base, connected through SWD_host
+static void setup(uint32_t wrap, uint32_t base)
+{
+	static const uint8_t connect[] = {ID_DAP_Connect, DAP_PORT_SWD};
+	uint32_t i;
+
+	DAP_Setup();
+	dap_target_sim_init(&target);
+	target.tar_wrap = wrap;
+	target.ap_base = base;
+	dap_target_sim_add_region(&target, RAM_BASE, sizeof(ram), ram, 1U);
+	dap_target_sim_add_region(&target, ROM_BASE, sizeof(rom), rom, 0U);
+	dap_target_sim_attach(&target);
+
+	dap_test_command(connect);
+	CHECK(swd_init_debug());
+	dap_test_command(connect); // Port setup of DAP_Transfer after SWD_host
+	for (i = 0U; i < sizeof(ram); i++)
+	{
+		ram[i] = (uint8_t)((i * 7U) + (i >> 8));
+	}
+}
+
+// Read the IDR of AP 0 through DAP_Transfer
+static void identify(void)
+{
+	static const uint8_t request[] = {ID_DAP_Transfer, 0, 3,
+									  0x08, 0xF0, 0x00, 0x00, 0x00, // SELECT = AP 0, bank 0xF
+									  0x0F,							// IDR
+									  0x08, 0x00, 0x00, 0x00, 0x00};
+
+	dap_test_command(request);
+	CHECK(dap_test_response[1] == 3U);
+	CHECK(dap_test_get32(&dap_test_response[3]) == target.ap_idr);
+}
+
+// SELECT AP 0 bank 0, CSW word access with single increment and TAR
+static void set_tar(uint32_t tar)
+{
+	uint8_t request[] = {ID_DAP_Transfer, 0, 3,
+						 0x08, 0x00, 0x00, 0x00, 0x00,
+						 0x01, 0x12, 0x00, 0x00, 0x23,
+						 0x05, 0x00, 0x00, 0x00, 0x00};
+
+	dap_test_put32(&request[14], tar);
+	dap_test_command(request);
+	CHECK(dap_test_response[1] == 3U);
+	CHECK(dap_test_response[2] == DAP_TRANSFER_OK);
+}
+
+// DRW read block of count words expected from addr on
+static void block_read(uint32_t addr, uint32_t count)
+{
+	uint8_t request[] = {ID_DAP_TransferBlock, 0, (uint8_t)count, 0, 0x0F};
+	uint32_t n;
+
+	dap_test_command(request);
+	CHECK(dap_test_response[1] == count);
+	CHECK(dap_test_response[3] == DAP_TRANSFER_OK);
+	for (n = 0U; n < count; n++)
+	{
+		CHECK(dap_test_get32(&dap_test_response[4 + (4 * n)]) == dap_test_get32(&ram[addr - RAM_BASE + (4U * n)]));
+	}
+}
+
+// DRW write block of count words seed, seed + 1, ... expected to land from addr on
+static void block_write(uint32_t addr, uint32_t count, uint32_t seed)
+{
+	uint8_t request[5 + (4 * 16)] = {ID_DAP_TransferBlock, 0, (uint8_t)count, 0, 0x0D};
+	uint32_t n;
+
+	for (n = 0U; n < count; n++)
+	{
+		dap_test_put32(&request[5 + (4 * n)], seed + n);
+	}
+	dap_test_command(request);
+	CHECK(dap_test_response[1] == count);
+	CHECK(dap_test_response[3] == DAP_TRANSFER_OK);
+	for (n = 0U; n < count; n++)
+	{
+		CHECK(dap_test_get32(&ram[addr - RAM_BASE + (4U * n)]) == seed + n);
+	}
+}
+
+// TarWrap vendor command: APSEL and size (0 = detect), returns the status
+static uint8_t tar_wrap(uint8_t apsel, uint32_t size, uint32_t *result)
+{
+	uint8_t request[] = {ID_DAP_Vendor_TarWrap, apsel, 0, 0, 0, 0};
+
+	dap_test_put32(&request[2], size);
+	CHECK(DAP_ExecuteCommand(request, dap_test_response) == ((6U << 16) | 6U));
+	*result = dap_test_get32(&dap_test_response[2]);
+	return dap_test_response[1];
+}
+
+// SWD_host detects the wrap and splits unaligned accesses at it
+static void test_swd_host(uint32_t wrap)
+{
+	uint32_t i;
+
+	CHECK(swd_tar_wrap(0) == 1024U);
+	CHECK(swd_read_memory(RAM_BASE + 0x11U, buf, sizeof(buf)));
+	CHECK(memcmp(buf, &ram[0x11], sizeof(buf)) == 0);
+	CHECK(swd_tar_wrap(0) == wrap);
+
+	for (i = 0U; i < sizeof(buf); i++)
+	{
+		buf[i] = (uint8_t)(i ^ 0x5AU);
+	}
+	CHECK(swd_write_memory(RAM_BASE + 0x2003U, buf, sizeof(buf)));
+	CHECK(memcmp(buf, &ram[0x2003], sizeof(buf)) == 0);
+	CHECK(ram[0x2002] == (uint8_t)((0x2002U * 7U) + 0x20U));
+	CHECK(ram[0x6003] == (uint8_t)((0x6003U * 7U) + 0x60U));
+}
+
+// Raw DRW blocks over each 1 KB boundary below 4 KB, continued by the next command
+static void test_blocks(void)
+{
+	uint32_t b;
+
+	identify();
+	for (b = 1024U; b <= 4096U; b += 1024U)
+	{
+		set_tar(RAM_BASE + b - 8U);
+		block_read(RAM_BASE + b - 8U, 6U);
+		block_read(RAM_BASE + b + 16U, 4U);
+		set_tar(RAM_BASE + 0x8000U + b - 12U);
+		block_write(RAM_BASE + 0x8000U + b - 12U, 7U, b << 8);
+		block_write(RAM_BASE + 0x8000U + b + 16U, 3U, b << 12);
+		block_read(RAM_BASE + 0x8000U + b + 28U, 2U);
+	}
+}
+
+static void test_vendor(uint32_t wrap)
+{
+	uint32_t size;
+
+	CHECK(tar_wrap(0U, 0U, &size) == DAP_OK);
+	CHECK(size == wrap);
+
+	// A configured wrap below the one of the hardware still gives linear blocks
+	CHECK(tar_wrap(0U, 1024U, &size) == DAP_OK);
+	CHECK(size == 1024U);
+	identify();
+	set_tar(RAM_BASE + 2048U - 4U);
+	block_read(RAM_BASE + 2048U - 4U, 4U);
+
+	CHECK(tar_wrap(0U, 1536U, &size) == DAP_ERROR);
+	CHECK(size == 1024U);
+	CHECK(tar_wrap(0U, 512U, &size) == DAP_ERROR);
+	CHECK(tar_wrap(4U, 2048U, &size) == DAP_ERROR);
+}
+
+// Without a ROM table the wrap stays at the 1 KB minimum, without a bus fault
+static void test_no_rom(void)
+{
+	uint32_t fault;
+
+	setup(4096U, 0xFFFFFFFFU);
+	fault = target.stats.fault;
+	CHECK(swd_read_memory(RAM_BASE + 0x100U, buf, 0x3000U));
+	CHECK(memcmp(buf, &ram[0x100], 0x3000U) == 0);
+	CHECK(swd_tar_wrap(0) == 1024U);
+	CHECK(target.stats.fault == fault);
+
+	setup(4096U, ROM_BASE | 0x2U);
+	CHECK(swd_read_memory(RAM_BASE, buf, 0x1000U));
+	CHECK(swd_tar_wrap(0) == 1024U);
+}
+
+// Blocks keep the hardware behaviour, TAR wraps and no TAR writes are added,
+// whenever the DAP can not tell the AP is a MEM-AP or where TAR points
+static void test_hardware_wrap(void)
+{
+	static const uint8_t vendor[] = {ID_DAP_Vendor_TarWrap, 0, 0, 0, 0, 0};
+	static const uint8_t line_reset[] = {ID_DAP_SWJ_Sequence, 56, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+	static const uint8_t idle[] = {ID_DAP_SWJ_Sequence, 8, 0x00};
+	static const uint8_t idcode[] = {ID_DAP_Transfer, 0, 1, 0x02};
+	static const uint8_t read[] = {ID_DAP_TransferBlock, 0, 2, 0, 0x0F};
+	uint32_t ap_wr;
+
+	setup(1024U, ROM_BASE | 0x3U);
+
+	// IDR never read
+	set_tar(RAM_BASE + 1024U - 4U);
+	ap_wr = target.stats.ap_wr;
+	dap_test_command(read);
+	CHECK(target.stats.ap_wr == ap_wr);
+	CHECK(dap_test_get32(&dap_test_response[8]) == dap_test_get32(&ram[0]));
+
+	// TAR unknown after a vendor command
+	identify();
+	set_tar(RAM_BASE + 1024U - 4U);
+	dap_test_command(vendor);
+	ap_wr = target.stats.ap_wr;
+	dap_test_command(read);
+	CHECK(target.stats.ap_wr == ap_wr);
+
+	// Identification dropped by a line reset
+	dap_test_command(line_reset);
+	dap_test_command(idle);
+	dap_test_command(idcode);
+	set_tar(RAM_BASE + 1024U - 4U);
+	ap_wr = target.stats.ap_wr;
+	dap_test_command(read);
+	CHECK(target.stats.ap_wr == ap_wr);
+	CHECK(dap_test_get32(&dap_test_response[8]) == dap_test_get32(&ram[0]));
+
+	// IDR of an AP other than a MEM-AP (JTAG-AP)
+	target.ap_idr = 0x04760010U;
+	identify();
+	set_tar(RAM_BASE + 1024U - 4U);
+	ap_wr = target.stats.ap_wr;
+	dap_test_command(read);
+	CHECK(target.stats.ap_wr == ap_wr);
+	CHECK(dap_test_get32(&dap_test_response[8]) == dap_test_get32(&ram[0]));
+
+	// The same AP read again as a MEM-AP continues
+	target.ap_idr = 0x24770011U;
+	identify();
+	set_tar(RAM_BASE + 1024U - 4U);
+	block_read(RAM_BASE + 1024U - 4U, 2U);
+}
+
+int main(void)
+{
+	static const uint32_t wraps[] = {1024U, 2048U, 4096U};
+	uint32_t w;
+
+	for (w = 0U; w < (sizeof(wraps) / sizeof(wraps[0])); w++)
+	{
+		setup(wraps[w], ROM_BASE | 0x3U);
+		test_swd_host(wraps[w]);
+		test_blocks();
+		test_vendor(wraps[w]);
+	}
+	test_no_rom();
+	test_hardware_wrap();
+
+	return dap_test_result("test_tar_wrap");
+}
@@ -0,0 +1,329 @@
+/*---------------------------------------------------------------------------
+ * test_target_sim.c  ADIv5 SW-DP/MEM-AP target model
+ *
+ * DAP_Transfer, DAP_TransferBlock and SWD_host against the model: IDCODE and
+ * power-up, posted AP reads, TAR auto-increment wrap, AP identification, WAIT
+ * retries, the packet of every SWD_Transfer variant, FAULT and ABORT recovery,
+ * a fault of a posted write, read-only memory, line reset handling, unaligned
+ * memory access and the core register file.
+ *---------------------------------------------------------------------------*/
+#include "dap_test.h"
+#include "DAP_target_sim.h"
+
+static dap_target_sim_t target;
+static uint8_t ram[0x1000];
+static uint8_t rom[0x100];
+
+// Power up the debug domain and set a word access, auto-incrementing CSW
+static void power_up(void)
+{
+	static const uint8_t request[] = {ID_DAP_Transfer, 0, 4,
+									  0x04, 0x00, 0x00, 0x00, 0x50, // CTRL/STAT = CSYSPWRUPREQ | CDBGPWRUPREQ
+									  0x08, 0x00, 0x00, 0x00, 0x00, // SELECT = AP 0, bank 0
+									  0x01, 0x12, 0x00, 0x00, 0x23, // CSW = 32 bit, single increment
+									  0x06};						// CTRL/STAT
+
+	dap_test_command(request);
+	CHECK(dap_test_response[1] == 4U);
+	CHECK(dap_test_response[2] == DAP_TRANSFER_OK);
+	CHECK((dap_test_get32(&dap_test_response[3]) & 0xA0000000U) == 0xA0000000U);
+}
+
+static void test_memory(void)
+{
+	static const uint8_t write[] = {ID_DAP_Transfer, 0, 3,
+									0x05, 0x00, 0x00, 0x00, 0x20, // TAR
+									0x0D, 0x44, 0x33, 0x22, 0x11, // DRW
+									0x0D, 0x88, 0x77, 0x66, 0x55};
+	static const uint8_t read[] = {ID_DAP_Transfer, 0, 3,
+								   0x05, 0x00, 0x00, 0x00, 0x20,
+								   0x0F, 0x0F};
+	static const uint8_t block[] = {ID_DAP_TransferBlock, 0, 2, 0, 0x0F};
+	static const uint8_t tar[] = {ID_DAP_Transfer, 0, 1, 0x05, 0x00, 0x00, 0x00, 0x20};
+
+	dap_test_command(write);
+	CHECK(dap_test_response[1] == 3U);
+	CHECK(dap_test_get32(&ram[0]) == 0x11223344U);
+	CHECK(dap_test_get32(&ram[4]) == 0x55667788U);
+
+	// The second DRW result is collected through RDBUFF
+	dap_test_command(read);
+	CHECK(dap_test_response[1] == 3U);
+	CHECK(dap_test_response[2] == DAP_TRANSFER_OK);
+	CHECK(dap_test_get32(&dap_test_response[3]) == 0x11223344U);
+	CHECK(dap_test_get32(&dap_test_response[7]) == 0x55667788U);
+
+	dap_test_command(tar);
+	dap_test_command(block);
+	CHECK((dap_test_response[1] | (dap_test_response[2] << 8)) == 2U);
+	CHECK(dap_test_response[3] == DAP_TRANSFER_OK);
+	CHECK(dap_test_get32(&dap_test_response[4]) == 0x11223344U);
+	CHECK(dap_test_get32(&dap_test_response[8]) == 0x55667788U);
+}
+
+// A plain DAP_Transfer keeps the hardware behaviour: TAR wraps inside its 1 KB range
+static void test_tar_wrap(void)
+{
+	static const uint8_t read[] = {ID_DAP_Transfer, 0, 4,
+								   0x05, 0xFC, 0x03, 0x00, 0x20, // TAR = 0x200003FC
+								   0x0F, 0x0F,
+								   0x07}; // TAR
+	dap_test_put32(&ram[0x3FC], 0xCAFEF00DU);
+
+	dap_test_command(read);
+	CHECK(dap_test_response[1] == 4U);
+	CHECK(dap_test_get32(&dap_test_response[3]) == 0xCAFEF00DU);
+	CHECK(dap_test_get32(&dap_test_response[7]) == 0x11223344U);
+	CHECK(dap_test_get32(&dap_test_response[11]) == 0x20000004U);
+}
+
+static void test_ap_id(void)
+{
+	static const uint8_t read[] = {ID_DAP_Transfer, 0, 4,
+								   0x08, 0xF0, 0x00, 0x00, 0x00, // SELECT = AP 0, bank 0xF
+								   0x0F,						 // IDR
+								   0x0B,						 // BASE
+								   0x08, 0x00, 0x00, 0x00, 0x00};
+
+	dap_test_command(read);
+	CHECK(dap_test_response[1] == 4U);
+	CHECK(dap_test_get32(&dap_test_response[3]) == target.ap_idr);
+	CHECK(dap_test_get32(&dap_test_response[7]) == target.ap_base);
+}
+
+static void test_wait(void)
+{
+	static const uint8_t read[] = {ID_DAP_Transfer, 0, 3,
+								   0x05, 0x00, 0x00, 0x00, 0x20,
+								   0x0F, 0x0F};
+	uint32_t wait = target.stats.wait;
+
+	target.ap_wait = 3U;
+	dap_test_command(read);
+	target.ap_wait = 0U;
+	CHECK(dap_test_response[1] == 3U);
+	CHECK(dap_test_response[2] == DAP_TRANSFER_OK);
+	CHECK(dap_test_get32(&dap_test_response[3]) == 0x11223344U);
+	CHECK(dap_test_get32(&dap_test_response[7]) == 0x55667788U);
+	CHECK(target.stats.wait > wait);
+}
+
+// SWCLK cycles of a DAP_Transfer command and its first transfer response
+static uint32_t transfer_cycles(const uint8_t *request, uint8_t *ack)
+{
+	uint32_t edges = dap_sim_pins.edges;
+
+	dap_test_command(request);
+	*ack = dap_test_response[2];
+	return dap_sim_pins.edges - edges;
+}
+
+// Every SWD_Transfer variant (delay class, turnaround, data phase, idle cycles) gives
+// the packet length of its configuration, the WAIT case without a retry
+static void test_transfer_variants(void)
+{
+	static const uint8_t idcode[] = {ID_DAP_Transfer, 0, 1, 0x02};
+	static const uint8_t abort[] = {ID_DAP_Transfer, 0, 1, 0x00, 0, 0, 0, 0};
+	static const uint8_t ap_read[] = {ID_DAP_Transfer, 0, 2, 0x05, 0x00, 0x00, 0x00, 0x20, 0x0F};
+	static const uint32_t clocks[] = {100000U, 100000000U};
+	uint8_t configure[] = {ID_DAP_TransferConfigure, 0, 0, 0, 0, 0};
+	uint8_t swd_configure[] = {ID_DAP_SWD_Configure, 0};
+	uint8_t clock[] = {ID_DAP_SWJ_Clock, 0, 0, 0, 0};
+	uint32_t c, trn, phase, idle;
+	uint32_t packet;
+	uint8_t ack;
+
+	for (c = 0U; c < (sizeof(clocks) / sizeof(clocks[0])); c++)
+	{
+		dap_test_put32(&clock[1], clocks[c]);
+		dap_test_command(clock);
+		CHECK(DAP_Data.fast_clock == c);
+		for (trn = 1U; trn <= 2U; trn++)
+		{
+			for (phase = 0U; phase <= 1U; phase++)
+			{
+				for (idle = 0U; idle <= 4U; idle += 4U)
+				{
+					swd_configure[1] = (uint8_t)((trn - 1U) | (phase << 2));
+					dap_test_command(swd_configure);
+					target.turnaround = (uint8_t)trn;
+					configure[1] = (uint8_t)idle;
+					configure[2] = 0U; // No WAIT retry
+					dap_test_command(configure);
+
+					packet = 8U + trn + 3U + trn + 33U + idle;
+					CHECK(transfer_cycles(idcode, &ack) == packet);
+					CHECK(ack == DAP_TRANSFER_OK);
+					CHECK(dap_test_get32(&dap_test_response[3]) == target.idcode);
+					CHECK(transfer_cycles(abort, &ack) == 2U * packet); // Write checked by RDBUFF
+					CHECK(ack == DAP_TRANSFER_OK);
+
+					// TAR write accepted, the DRW read finds the AP busy
+					target.ap_wait = 1U;
+					CHECK(transfer_cycles(ap_read, &ack) == packet + 8U + trn + 3U + (phase * 33U) + trn);
+					CHECK(dap_test_response[1] == 1U);
+					CHECK(ack == DAP_TRANSFER_WAIT);
+					target.ap_wait = 0U;
+					CHECK(transfer_cycles(idcode, &ack) == packet);
+				}
+			}
+		}
+	}
+
+	swd_configure[1] = 0U;
+	dap_test_command(swd_configure);
+	target.turnaround = 1U;
+	configure[1] = 0U;
+	configure[2] = 0x40U;
+	dap_test_command(configure);
+	dap_test_put32(&clock[1], DAP_DEFAULT_SWJ_CLOCK);
+	dap_test_command(clock);
+}
+
+// A bus error sets STICKYERR, further AP accesses FAULT until ABORT clears it
+static void test_fault(void)
+{
+	static const uint8_t read[] = {ID_DAP_Transfer, 0, 3,
+								   0x05, 0x00, 0x00, 0x00, 0x30, // No memory there
+								   0x0F, 0x0F};
+	static const uint8_t abort[] = {ID_DAP_WriteABORT, 0, 0x1E, 0, 0, 0};
+	static const uint8_t again[] = {ID_DAP_Transfer, 0, 2,
+									0x05, 0x00, 0x00, 0x00, 0x20,
+									0x0F};
+
+	dap_test_command(read);
+	CHECK(dap_test_response[1] < 3U);
+	CHECK(dap_test_response[2] == DAP_TRANSFER_FAULT);
+	CHECK(target.ctrl_stat & (1U << 5));
+	dap_test_command(abort);
+	CHECK(dap_test_response[1] == DAP_OK);
+	CHECK((target.ctrl_stat & (1U << 5)) == 0U);
+	dap_test_command(again);
+	CHECK(dap_test_response[1] == 2U);
+	CHECK(dap_test_response[2] == DAP_TRANSFER_OK);
+
+	// Injected fault on the next bus access
+	target.fault_after = 1U;
+	dap_test_command(again);
+	CHECK(dap_test_response[2] == DAP_TRANSFER_FAULT);
+	dap_test_command(abort);
+}
+
+static void test_rom(void)
+{
+	uint32_t val = 0x12345678U;
+	uint32_t back = 0U;
+
+	rom[0] = 0xA5U;
+	CHECK(swd_write_memory(0x08000000U, (uint8_t *)&val, 4U));
+	CHECK(swd_read_memory(0x08000000U, (uint8_t *)&back, 4U));
+	CHECK((back & 0xFFU) == 0xA5U);
+	CHECK(back != val);
+}
+
+// After a line reset only an IDCODE read is answered
+static void test_line_reset(void)
+{
+	static const uint8_t line_reset[] = {ID_DAP_SWJ_Sequence, 56, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+	static const uint8_t idle[] = {ID_DAP_SWJ_Sequence, 8, 0x00};
+	static const uint8_t ctrl_stat[] = {ID_DAP_Transfer, 0, 1, 0x06};
+	static const uint8_t idcode[] = {ID_DAP_Transfer, 0, 2, 0x02, 0x06};
+
+	dap_test_command(line_reset);
+	dap_test_command(idle);
+	dap_test_command(ctrl_stat);
+	CHECK(dap_test_response[1] == 0U);
+	CHECK(dap_test_response[2] == 0x07U);
+
+	dap_test_command(line_reset);
+	dap_test_command(idle);
+	dap_test_command(idcode);
+	CHECK(dap_test_response[1] == 2U);
+	CHECK(dap_test_get32(&dap_test_response[3]) == target.idcode);
+}
+
+static void test_swd_host(void)
+{
+	uint8_t data[61];
+	uint8_t back[61];
+	uint32_t n;
+
+	for (n = 0U; n < sizeof(data); n++)
+	{
+		data[n] = (uint8_t)(n * 3U + 1U);
+	}
+	memset(back, 0, sizeof(back));
+	CHECK(swd_write_memory(0x20000101U, data, sizeof(data)));
+	CHECK(swd_read_memory(0x20000101U, back, sizeof(back)));
+	CHECK(memcmp(data, back, sizeof(data)) == 0);
+	CHECK(memcmp(&ram[0x101], data, sizeof(data)) == 0);
+}
+
+// A bus fault of the last posted write shows up only once the write completes: SWD_host
+// has to wait for it through RDBUFF before it checks CTRL/STAT
+static void test_posted_write_fault(void)
+{
+	uint32_t val = 0U;
+
+	target.ap_wait = 2U;
+	target.fault_after = 1U;
+	CHECK(!swd_write_ap(0x0C, 0x11111111U)); // DRW at TAR, the only bus access
+
+	target.fault_after = 1U;
+	swd_batch_start();
+	swd_batch_write_word(0x20000200U, 0x22222222U);
+	swd_batch_write_word(0x20000204U, 0x33333333U); // Faults, its ACK is OK
+	CHECK(!swd_batch_end());
+	CHECK(target.fault_after == 0U);
+	CHECK(dap_test_get32(&ram[0x204]) != 0x33333333U);
+
+	// The failed batch cleared the sticky error
+	CHECK((target.ctrl_stat & (1U << 5)) == 0U);
+	swd_batch_start();
+	swd_batch_write_word(0x20000208U, 0x44444444U);
+	CHECK(swd_batch_end());
+	target.ap_wait = 0U;
+	swd_batch_start();
+	swd_batch_read_word(0x20000208U, &val);
+	CHECK(swd_batch_end());
+	CHECK(val == 0x44444444U);
+}
+
+static void test_core_registers(void)
+{
+	static const uint8_t regs[] = {0, 7, 15};
+	static const uint32_t val[] = {0x01020304U, 0xDEADBEEFU, 0x08000101U};
+	uint32_t back[3] = {0};
+
+	CHECK(swd_write_core_registers(regs, 3U, val));
+	CHECK(target.reg[0] == val[0]);
+	CHECK(target.reg[7] == val[1]);
+	CHECK(target.reg[15] == val[2]);
+	CHECK(swd_read_core_registers(regs, 3U, back));
+	CHECK(memcmp(back, val, sizeof(val)) == 0);
+}
+
+int main(void)
+{
+	DAP_Setup();
+	dap_target_sim_init(&target);
+	dap_target_sim_add_region(&target, 0x20000000U, sizeof(ram), ram, 1U);
+	dap_target_sim_add_region(&target, 0x08000000U, sizeof(rom), rom, 0U);
+	dap_target_sim_attach(&target);
+
+	CHECK(dap_test_swd_connect() == target.idcode);
+	power_up();
+	test_memory();
+	test_tar_wrap();
+	test_ap_id();
+	test_wait();
+	test_transfer_variants();
+	test_fault();
+	test_swd_host();
+	test_posted_write_fault();
+	test_rom();
+	test_core_registers();
+	test_line_reset();
+
+	return dap_test_result("test_target_sim");
+}
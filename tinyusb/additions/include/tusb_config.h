@@ -65,8 +65,12 @@ extern "C" {
 #define CFG_TUD_CDC_RX_BUFSIZE CONFIG_USB_CDC_RX_BUFSIZE
 #define CFG_TUD_CDC_TX_BUFSIZE CONFIG_USB_CDC_TX_BUFSIZE
 
-#define CFG_TUD_VENDOR_TX_BUFSIZE 64
-#define CFG_TUD_VENDOR_RX_BUFSIZE 64
+// Vendor FIFO size of TX and RX, two packets each so the next CMSIS-DAP v2
+// transfer is queued while the previous one is on the bus. Packet mode keeps
+// the bulk transfer boundaries inside the FIFOs.
+#define CFG_TUD_VENDOR_TX_BUFSIZE 128
+#define CFG_TUD_VENDOR_RX_BUFSIZE 128
+#define CFG_TUD_VENDOR_PACKETS 4
 // MSC Buffer size of Device Mass storage:
 #define CFG_TUD_MSC_BUFSIZE CONFIG_USB_MSC_BUFSIZE
 
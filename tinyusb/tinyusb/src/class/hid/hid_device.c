@@ -325,7 +325,7 @@ bool hidd_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint32_
   {
     if (itf >= TU_ARRAY_SIZE(_hidd_itf)) return false;
 
-    if ( ep_addr == p_hid->ep_out ) break;
+    if ( (ep_addr == p_hid->ep_out) || (ep_addr == p_hid->ep_in) ) break;
   }
 
   if (ep_addr == p_hid->ep_out)
@@ -333,6 +333,11 @@ bool hidd_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint32_
     tud_hid_set_report_cb(0, HID_REPORT_TYPE_INVALID, p_hid->epout_buf, xferred_bytes);
     TU_ASSERT(usbd_edpt_xfer(rhport, p_hid->ep_out, p_hid->epout_buf, sizeof(p_hid->epout_buf)));
   }
+  else if (ep_addr == p_hid->ep_in)
+  {
+    // Report sent, invoked callback if any
+    if (tud_hid_report_complete_cb) tud_hid_report_complete_cb(itf, p_hid->epin_buf, (uint8_t) xferred_bytes);
+  }
 
   return true;
 }
@@ -89,6 +89,9 @@ TU_ATTR_WEAK void tud_hid_boot_mode_cb(uint8_t boot_mode);
 // - Idle Rate > 0 : skip duplication, but send at least 1 report every idle rate (in unit of 4 ms).
 TU_ATTR_WEAK bool tud_hid_set_idle_cb(uint8_t idle_rate);
 
+// Invoked when a report has been sent on the IN endpoint, the next one can be sent
+TU_ATTR_WEAK void tud_hid_report_complete_cb(uint8_t itf, uint8_t const* report, uint8_t len);
+
 /* --------------------------------------------------------------------+
  * HID Report Descriptor Template
  *